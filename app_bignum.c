@@ -0,0 +1,213 @@
+/*******************************************************************************
+  Arbitrary Precision Integers
+
+  File Name:
+    app_bignum.c
+
+  Summary:
+    Base 10^9 limb arithmetic, see app_bignum.h.
+
+  Description:
+    Every step works on one limb at a time with a 64 bit intermediate:
+    a limb product plus two limbs is below 10^18 + 2 * 10^9, well inside
+    64 bits, and the carry out of it is one division by the base (a
+    multiply by the reciprocal on the host, a library call on the PIC32).
+
+    Division normalizes the divisor so its top limb is at least half the
+    base.  Then the estimate of each quotient limb taken from the top two
+    limbs of the remainder is at most two too large, and one more limb
+    catches almost every such case before the multiply and subtract.
+ *******************************************************************************/
+
+#include "app_bignum.h"
+
+/* Length of a without its zero top limbs */
+static size_t appBignumTrim(const uint32_t * a, size_t na)
+{
+    while (na > 0 && a[na - 1] == 0)
+    {
+        na--;
+    }
+    return na;
+}
+
+int APP_BIGNUM_Compare(const uint32_t * a, size_t na, const uint32_t * b, size_t nb)
+{
+    if (na != nb)
+    {
+        return (na < nb) ? -1 : 1;
+    }
+    while (na-- > 0)
+    {
+        if (a[na] != b[na])
+        {
+            return (a[na] < b[na]) ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+size_t APP_BIGNUM_MulSmall(uint32_t * r, const uint32_t * a, size_t na, uint32_t m, uint32_t add)
+{
+    uint64_t t;
+    uint32_t carry = add;
+    size_t i;
+
+    for (i = 0; i < na; i++)
+    {
+        t = (uint64_t)a[i] * m + carry;
+        r[i] = (uint32_t)(t % APP_BIGNUM_BASE);
+        carry = (uint32_t)(t / APP_BIGNUM_BASE);
+    }
+    r[na] = carry;
+    return appBignumTrim(r, na + 1);
+}
+
+size_t APP_BIGNUM_Add(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb)
+{
+    uint32_t carry = 0, s;
+    size_t i;
+
+    if (na < nb)
+    {
+        const uint32_t * t = a;
+
+        a = b;
+        b = t;
+        i = na;
+        na = nb;
+        nb = i;
+    }
+    for (i = 0; i < na; i++)
+    {
+        s = a[i] + ((i < nb) ? b[i] : 0) + carry;
+        carry = (s >= APP_BIGNUM_BASE);
+        r[i] = carry ? s - APP_BIGNUM_BASE : s;
+    }
+    r[na] = carry;
+    return na + carry;
+}
+
+size_t APP_BIGNUM_Sub(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb)
+{
+    uint32_t borrow = 0, d;
+    size_t i;
+
+    for (i = 0; i < na; i++)
+    {
+        d = ((i < nb) ? b[i] : 0) + borrow;
+        borrow = (a[i] < d);
+        r[i] = borrow ? a[i] + APP_BIGNUM_BASE - d : a[i] - d;
+    }
+    return appBignumTrim(r, na);
+}
+
+size_t APP_BIGNUM_Mul(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb)
+{
+    uint64_t t;
+    uint32_t carry;
+    size_t i, j;
+
+    if (na == 0 || nb == 0)
+    {
+        return 0;
+    }
+    for (i = 0; i < nb; i++)
+    {
+        r[i] = 0;
+    }
+    for (i = 0; i < na; i++)
+    {
+        carry = 0;
+        for (j = 0; j < nb; j++)
+        {
+            t = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (uint32_t)(t % APP_BIGNUM_BASE);
+            carry = (uint32_t)(t / APP_BIGNUM_BASE);
+        }
+        r[i + nb] = carry;
+    }
+    return appBignumTrim(r, na + nb);
+}
+
+size_t APP_BIGNUM_Div(uint32_t * q, uint32_t * a, size_t na, uint32_t * b, size_t nb)
+{
+    uint64_t numerator, qhat, rhat, p;
+    uint32_t d, top, next, carry, borrow, s;
+    size_t i, j;
+    int64_t t;
+
+    if (APP_BIGNUM_Compare(a, na, b, nb) < 0)
+    {
+        return 0;
+    }
+
+    /* One limb divisor: plain short division */
+    if (nb == 1)
+    {
+        rhat = 0;
+        for (i = na; i-- > 0; )
+        {
+            numerator = rhat * APP_BIGNUM_BASE + a[i];
+            q[i] = (uint32_t)(numerator / b[0]);
+            rhat = numerator % b[0];
+        }
+        return appBignumTrim(q, na);
+    }
+
+    /* Scale both so the divisor's top limb is at least BASE / 2 */
+    d = APP_BIGNUM_BASE / (b[nb - 1] + 1);
+    APP_BIGNUM_MulSmall(a, a, na, d, 0);
+    APP_BIGNUM_MulSmall(b, b, nb, d, 0);
+    top = b[nb - 1];
+    next = b[nb - 2];
+
+    for (j = na - nb + 1; j-- > 0; )
+    {
+        /* Estimate from the top two limbs, refined with the third */
+        numerator = (uint64_t)a[j + nb] * APP_BIGNUM_BASE + a[j + nb - 1];
+        qhat = numerator / top;
+        rhat = numerator % top;
+        if (qhat >= APP_BIGNUM_BASE)
+        {
+            qhat = APP_BIGNUM_BASE - 1;
+            rhat = numerator - qhat * top;
+        }
+        while (rhat < APP_BIGNUM_BASE &&
+                qhat * next > rhat * APP_BIGNUM_BASE + a[j + nb - 2])
+        {
+            qhat--;
+            rhat += top;
+        }
+
+        /* a[j .. j + nb] -= qhat * b */
+        carry = 0;
+        borrow = 0;
+        for (i = 0; i < nb; i++)
+        {
+            p = qhat * b[i] + carry;
+            carry = (uint32_t)(p / APP_BIGNUM_BASE);
+            s = (uint32_t)(p % APP_BIGNUM_BASE) + borrow;
+            borrow = (a[i + j] < s);
+            a[i + j] = borrow ? a[i + j] + APP_BIGNUM_BASE - s : a[i + j] - s;
+        }
+        t = (int64_t)a[j + nb] - carry - borrow;
+
+        /* Rarely the estimate was still one too large: add b back */
+        if (t < 0)
+        {
+            qhat--;
+            carry = 0;
+            for (i = 0; i < nb; i++)
+            {
+                s = a[i + j] + b[i] + carry;
+                carry = (s >= APP_BIGNUM_BASE);
+                a[i + j] = carry ? s - APP_BIGNUM_BASE : s;
+            }
+            t += carry;
+        }
+        a[j + nb] = (uint32_t)t;
+        q[j] = (uint32_t)qhat;
+    }
+    return appBignumTrim(q, na - nb + 1);
+}
@@ -0,0 +1,103 @@
+/*******************************************************************************
+  Arbitrary Precision Integer Header File
+
+  File Name:
+    app_bignum.h
+
+  Summary:
+    Unsigned integer arithmetic on arrays of base 10^9 limbs.
+
+  Description:
+    A number is an array of uint32_t limbs, least significant first, each
+    holding 0 .. APP_BIGNUM_BASE - 1, plus its length in limbs.  Lengths are
+    always normalized: the top limb is nonzero and zero has length 0.  The
+    caller owns every array, so no routine allocates; each one states how
+    much room its result needs.  Base 10^9 keeps printing trivial (every
+    limb is nine decimal digits) and every partial product fits 64 bits.
+    Signs are left to the caller.
+ *******************************************************************************/
+
+#ifndef _APP_BIGNUM_H
+#define _APP_BIGNUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define APP_BIGNUM_BASE                 1000000000u
+#define APP_BIGNUM_BASE_DIGITS          9
+
+// *****************************************************************************
+/* Function:
+    int APP_BIGNUM_Compare(const uint32_t * a, size_t na, const uint32_t * b, size_t nb)
+
+  Summary:
+    Returns -1, 0 or 1 as a is less than, equal to or greater than b.
+*/
+
+int APP_BIGNUM_Compare(const uint32_t * a, size_t na, const uint32_t * b, size_t nb);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_BIGNUM_MulSmall(uint32_t * r, const uint32_t * a, size_t na,
+                               uint32_t m, uint32_t add)
+
+  Summary:
+    r = a * m + add, returns the length of r.
+
+  Remarks:
+    m and add must be below APP_BIGNUM_BASE.  r needs na + 1 limbs and may
+    be a.  a need not be normalized, the result is.
+*/
+
+size_t APP_BIGNUM_MulSmall(uint32_t * r, const uint32_t * a, size_t na, uint32_t m, uint32_t add);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_BIGNUM_Add(uint32_t * r, const uint32_t * a, size_t na,
+                          const uint32_t * b, size_t nb)
+    size_t APP_BIGNUM_Sub(uint32_t * r, const uint32_t * a, size_t na,
+                          const uint32_t * b, size_t nb)
+
+  Summary:
+    r = a + b and r = a - b, return the length of r.
+
+  Remarks:
+    Add needs max(na, nb) + 1 limbs in r.  Sub requires a >= b and needs na
+    limbs.  r may be a or b.
+*/
+
+size_t APP_BIGNUM_Add(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb);
+size_t APP_BIGNUM_Sub(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_BIGNUM_Mul(uint32_t * r, const uint32_t * a, size_t na,
+                          const uint32_t * b, size_t nb)
+
+  Summary:
+    r = a * b by schoolbook multiplication, returns the length of r.
+
+  Remarks:
+    r needs na + nb limbs and must not overlap a or b.
+*/
+
+size_t APP_BIGNUM_Mul(uint32_t * r, const uint32_t * a, size_t na, const uint32_t * b, size_t nb);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_BIGNUM_Div(uint32_t * q, uint32_t * a, size_t na,
+                          uint32_t * b, size_t nb)
+
+  Summary:
+    q = a / b truncated, by long division (Knuth's algorithm D), returns
+    the length of q.
+
+  Remarks:
+    b must not be zero.  a and b are used as work space and hold no useful
+    value afterwards; each needs room for one limb more than its length.
+    q needs na - nb + 1 limbs (none when a < b) and must not overlap a or b.
+*/
+
+size_t APP_BIGNUM_Div(uint32_t * q, uint32_t * a, size_t na, uint32_t * b, size_t nb);
+
+#endif /* _APP_BIGNUM_H */
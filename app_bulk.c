@@ -0,0 +1,267 @@
+/*******************************************************************************
+  Bulk Arithmetic Kernels
+
+  File Name:
+    app_bulk.c
+
+  Summary:
+    Vector and portable loops of app_bulk.h.
+
+  Description:
+    Each vector loop takes as many operands as fill its lanes and returns
+    how many that was; the portable loop finishes the rest.  A division by
+    0 never reaches a loop, the result is -1 whatever the operand.
+
+    The integer division goes through double: any int32_t is exact in a
+    double, and the truncated quotient of two of them is the exact integer
+    quotient.  INT32_MIN / -1 truncates to the "integer indefinite"
+    0x80000000, which is what the wrapped quotient is as well.
+ *******************************************************************************/
+
+#include <string.h>
+#include <stdbool.h>
+#include "app_bulk.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__)
+#define APP_BULK_X86 1
+#include <immintrin.h>
+#else
+#define APP_BULK_X86 0
+#endif
+
+static int32_t appBulkInt32(unsigned op, int32_t a, int32_t b)
+{
+    switch (op)
+    {
+        case 0:
+            return (int32_t)((uint32_t)a + (uint32_t)b);
+        case 1:
+            return (int32_t)((uint32_t)a - (uint32_t)b);
+        case 2:
+            return (int32_t)((uint32_t)a * (uint32_t)b);
+        default:
+            /* -1 also takes INT32_MIN / -1, which C leaves undefined */
+            return (b == -1) ? (int32_t)(0u - (uint32_t)a) : a / b;
+    }
+}
+
+static float appBulkFloat32(unsigned op, float a, float b)
+{
+    switch (op)
+    {
+        case 0:
+            return a + b;
+        case 1:
+            return a - b;
+        case 2:
+            return a * b;
+        default:
+            return a / b;
+    }
+}
+
+#if APP_BULK_X86
+/* Whether the AVX2 loops may run, -1 until asked */
+static int appBulkAvx2 = -1;
+
+static bool appBulkHasAvx2(void)
+{
+    if (appBulkAvx2 < 0)
+    {
+        appBulkAvx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return appBulkAvx2 != 0;
+}
+
+__attribute__((target("avx2")))
+static size_t appBulkInt32Avx2(unsigned op, int32_t scalar, const uint8_t * in, uint8_t * out,
+        size_t count)
+{
+    __m256i s = _mm256_set1_epi32(scalar), x;
+    __m256d d = _mm256_set1_pd((double)scalar);
+    __m128i lo, hi;
+    size_t k;
+
+    for (k = 0; k + 8 <= count; k += 8)
+    {
+        x = _mm256_loadu_si256((const __m256i *)&in[4 * k]);
+        switch (op)
+        {
+            case 0:
+                x = _mm256_add_epi32(x, s);
+                break;
+            case 1:
+                x = _mm256_sub_epi32(x, s);
+                break;
+            case 2:
+                x = _mm256_mullo_epi32(x, s);
+                break;
+            default:
+                lo = _mm256_cvttpd_epi32(_mm256_div_pd(
+                        _mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), d));
+                hi = _mm256_cvttpd_epi32(_mm256_div_pd(
+                        _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)), d));
+                x = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+                break;
+        }
+        _mm256_storeu_si256((__m256i *)&out[4 * k], x);
+    }
+    return k;
+}
+
+__attribute__((target("avx2")))
+static size_t appBulkFloat32Avx2(unsigned op, float scalar, const uint8_t * in, uint8_t * out,
+        size_t count)
+{
+    __m256 s = _mm256_set1_ps(scalar), x;
+    size_t k;
+
+    for (k = 0; k + 8 <= count; k += 8)
+    {
+        x = _mm256_loadu_ps((const float *)&in[4 * k]);
+        switch (op)
+        {
+            case 0:
+                x = _mm256_add_ps(x, s);
+                break;
+            case 1:
+                x = _mm256_sub_ps(x, s);
+                break;
+            case 2:
+                x = _mm256_mul_ps(x, s);
+                break;
+            default:
+                x = _mm256_div_ps(x, s);
+                break;
+        }
+        _mm256_storeu_ps((float *)&out[4 * k], x);
+    }
+    return k;
+}
+
+static size_t appBulkInt32Sse2(unsigned op, int32_t scalar, const uint8_t * in, uint8_t * out,
+        size_t count)
+{
+    __m128i s = _mm_set1_epi32(scalar), s13 = _mm_srli_epi64(s, 32), x, even, odd;
+    __m128d d = _mm_set1_pd((double)scalar);
+    size_t k;
+
+    for (k = 0; k + 4 <= count; k += 4)
+    {
+        x = _mm_loadu_si128((const __m128i *)&in[4 * k]);
+        switch (op)
+        {
+            case 0:
+                x = _mm_add_epi32(x, s);
+                break;
+            case 1:
+                x = _mm_sub_epi32(x, s);
+                break;
+            case 2:
+                /* No 32 bit multiply before SSE4.1: lanes 0 and 2, then 1
+                 * and 3, as 64 bit products whose low halves are kept */
+                even = _mm_mul_epu32(x, s);
+                odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), s13);
+                x = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+                break;
+            default:
+                even = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(x), d));
+                odd = _mm_cvttpd_epi32(_mm_div_pd(
+                        _mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2))), d));
+                x = _mm_unpacklo_epi64(even, odd);
+                break;
+        }
+        _mm_storeu_si128((__m128i *)&out[4 * k], x);
+    }
+    return k;
+}
+
+static size_t appBulkFloat32Sse2(unsigned op, float scalar, const uint8_t * in, uint8_t * out,
+        size_t count)
+{
+    __m128 s = _mm_set1_ps(scalar), x;
+    size_t k;
+
+    for (k = 0; k + 4 <= count; k += 4)
+    {
+        x = _mm_loadu_ps((const float *)&in[4 * k]);
+        switch (op)
+        {
+            case 0:
+                x = _mm_add_ps(x, s);
+                break;
+            case 1:
+                x = _mm_sub_ps(x, s);
+                break;
+            case 2:
+                x = _mm_mul_ps(x, s);
+                break;
+            default:
+                x = _mm_div_ps(x, s);
+                break;
+        }
+        _mm_storeu_ps((float *)&out[4 * k], x);
+    }
+    return k;
+}
+#endif
+
+/* Every result -1, the answer to a division by 0 */
+static void appBulkMinusOne(const void * minusOne, uint8_t * out, size_t count)
+{
+    size_t k;
+
+    for (k = 0; k < count; k++)
+    {
+        memcpy(&out[4 * k], minusOne, 4);
+    }
+}
+
+void APP_BULK_Int32(unsigned op, int32_t scalar, const uint8_t * in, uint8_t * out,
+        size_t count)
+{
+    static const int32_t minusOne = -1;
+    int32_t a;
+    size_t k = 0;
+
+    if (op == 3 && scalar == 0)
+    {
+        appBulkMinusOne(&minusOne, out, count);
+        return;
+    }
+#if APP_BULK_X86
+    k = appBulkHasAvx2() ? appBulkInt32Avx2(op, scalar, in, out, count) :
+            appBulkInt32Sse2(op, scalar, in, out, count);
+#endif
+    for (; k < count; k++)
+    {
+        memcpy(&a, &in[4 * k], sizeof(a));
+        a = appBulkInt32(op, a, scalar);
+        memcpy(&out[4 * k], &a, sizeof(a));
+    }
+}
+
+void APP_BULK_Float32(unsigned op, float scalar, const uint8_t * in, uint8_t * out,
+        size_t count)
+{
+    static const float minusOne = -1.0f;
+    float a;
+    size_t k = 0;
+
+    if (op == 3 && scalar == 0)
+    {
+        appBulkMinusOne(&minusOne, out, count);
+        return;
+    }
+#if APP_BULK_X86
+    k = appBulkHasAvx2() ? appBulkFloat32Avx2(op, scalar, in, out, count) :
+            appBulkFloat32Sse2(op, scalar, in, out, count);
+#endif
+    for (; k < count; k++)
+    {
+        memcpy(&a, &in[4 * k], sizeof(a));
+        a = appBulkFloat32(op, a, scalar);
+        memcpy(&out[4 * k], &a, sizeof(a));
+    }
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+  Bulk Arithmetic Kernels Header File
+
+  File Name:
+    app_bulk.h
+
+  Summary:
+    One operator and one scalar applied to a packed array of operands.
+
+  Description:
+    The operands of a bulk request (app_frame.h) arrive packed, little
+    endian, at whatever offset of the read buffer the USB packet put them.
+    These kernels take them from there and write the results packed the
+    same way, ready to be queued for the host:
+
+        out[k] = in[k] op scalar
+
+    with the arithmetic of the calculators: int32_t wraps around, float is
+    IEEE single precision, and a division by 0 gives -1.
+
+    The host build picks an AVX2 loop at run time when the CPU has it and
+    an SSE2 loop otherwise.  The PIC32's DSP ASE only has 8 and 16 bit
+    lanes, none of which fit an int32_t or a float, so the device runs the
+    portable loop.
+
+  Remarks:
+    Little endian targets only, as both the PIC32 and x86 are.
+ *******************************************************************************/
+
+#ifndef _APP_BULK_H
+#define _APP_BULK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Operands handed to a kernel at once: bounds the results buffer */
+#ifndef APP_BULK_BLOCK
+#define APP_BULK_BLOCK                  64
+#endif
+
+// *****************************************************************************
+/* Function:
+    void APP_BULK_Int32(unsigned op, int32_t scalar, const uint8_t * in,
+                        uint8_t * out, size_t count)
+
+  Summary:
+    count int32_t results of in[k] op scalar, op 0 +, 1 -, 2 *, 3 /.
+
+  Remarks:
+    in and out need no alignment and may be the same buffer.
+*/
+
+void APP_BULK_Int32(unsigned op, int32_t scalar, const uint8_t * in, uint8_t * out,
+        size_t count);
+
+// *****************************************************************************
+/* Function:
+    void APP_BULK_Float32(unsigned op, float scalar, const uint8_t * in,
+                          uint8_t * out, size_t count)
+
+  Summary:
+    count float results of in[k] op scalar, op 0 +, 1 -, 2 *, 3 /.
+
+  Remarks:
+    in and out need no alignment and may be the same buffer.
+*/
+
+void APP_BULK_Float32(unsigned op, float scalar, const uint8_t * in, uint8_t * out,
+        size_t count);
+
+#endif /* _APP_BULK_H */
@@ -0,0 +1,74 @@
+/*******************************************************************************
+  Input Debounce
+
+  File Name:
+    app_debounce.c
+
+  Summary:
+    Integrator debounce for push buttons, see app_debounce.h.
+ *******************************************************************************/
+
+#include "app_debounce.h"
+
+void APP_DEBOUNCE_Initialize(APP_DEBOUNCE * debounce)
+{
+    debounce->count = 0;
+}
+
+int APP_DEBOUNCE_Add(APP_DEBOUNCE * debounce, APP_DEBOUNCE_READ read, unsigned samples)
+{
+    APP_DEBOUNCE_INPUT * input;
+
+    if (debounce->count == APP_DEBOUNCE_INPUTS)
+    {
+        return -1;
+    }
+    input = &debounce->input[debounce->count];
+    input->read = read;
+    input->integrator = 0;
+    input->limit = (uint16_t)((samples == 0) ? 1 : (samples > UINT16_MAX) ? UINT16_MAX : samples);
+    input->active = false;
+    input->pressed = false;
+    return (int)debounce->count++;
+}
+
+void APP_DEBOUNCE_Sample(APP_DEBOUNCE * debounce)
+{
+    APP_DEBOUNCE_INPUT * input;
+    unsigned n;
+
+    for (n = 0; n < debounce->count; n++)
+    {
+        input = &debounce->input[n];
+        if (input->read())
+        {
+            if (input->integrator < input->limit && ++input->integrator == input->limit && !input->active)
+            {
+                input->active = true;
+                input->pressed = true;
+            }
+        }
+        else if (input->integrator > 0 && --input->integrator == 0)
+        {
+            input->active = false;
+        }
+    }
+}
+
+bool APP_DEBOUNCE_Active(const APP_DEBOUNCE * debounce, unsigned input)
+{
+    return (input < debounce->count) && debounce->input[input].active;
+}
+
+bool APP_DEBOUNCE_Pressed(APP_DEBOUNCE * debounce, unsigned input)
+{
+    bool pressed;
+
+    if (input >= debounce->count)
+    {
+        return false;
+    }
+    pressed = debounce->input[input].pressed;
+    debounce->input[input].pressed = false;
+    return pressed;
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************
+  Input Debounce Header File
+
+  File Name:
+    app_debounce.h
+
+  Summary:
+    Integrator debounce for any number of push buttons.
+
+  Description:
+    Every input has a counter that moves one step towards its limit on each
+    sample that reads active and one step towards zero on each sample that
+    reads inactive.  The debounced state only turns active when the counter
+    reaches the limit and only turns inactive again when it gets back to
+    zero, so contact bounce and short glitches shorter than the limit in
+    either direction never show.  A press is reported once per inactive to
+    active transition.
+
+    The module only counts samples: the caller decides how often
+    APP_DEBOUNCE_Sample() runs (a timer tick), so the debounce time is
+    limit times the sample period.
+ *******************************************************************************/
+
+#ifndef _APP_DEBOUNCE_H
+#define _APP_DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Inputs one APP_DEBOUNCE can hold */
+#ifndef APP_DEBOUNCE_INPUTS
+#define APP_DEBOUNCE_INPUTS             4
+#endif
+
+/* Reads the raw level of an input, true while it is active (pressed) */
+typedef bool (*APP_DEBOUNCE_READ)(void);
+
+typedef struct
+{
+    APP_DEBOUNCE_READ read;
+    uint16_t integrator;
+    uint16_t limit;
+
+    /* Debounced level */
+    bool active;
+
+    /* A press not yet taken with APP_DEBOUNCE_Pressed() */
+    bool pressed;
+
+} APP_DEBOUNCE_INPUT;
+
+typedef struct
+{
+    APP_DEBOUNCE_INPUT input[APP_DEBOUNCE_INPUTS];
+    unsigned count;
+
+} APP_DEBOUNCE;
+
+// *****************************************************************************
+/* Function:
+    void APP_DEBOUNCE_Initialize(APP_DEBOUNCE * debounce)
+
+  Summary:
+    Removes every input.
+*/
+
+void APP_DEBOUNCE_Initialize(APP_DEBOUNCE * debounce);
+
+// *****************************************************************************
+/* Function:
+    int APP_DEBOUNCE_Add(APP_DEBOUNCE * debounce, APP_DEBOUNCE_READ read,
+                         unsigned samples)
+
+  Summary:
+    Adds an input that changes state after samples consecutive samples at
+    the new level.  Returns its index, or -1 if there is no room.
+
+  Remarks:
+    The input starts inactive.  samples is clamped to 1 .. 65535.
+*/
+
+int APP_DEBOUNCE_Add(APP_DEBOUNCE * debounce, APP_DEBOUNCE_READ read, unsigned samples);
+
+// *****************************************************************************
+/* Function:
+    void APP_DEBOUNCE_Sample(APP_DEBOUNCE * debounce)
+
+  Summary:
+    Reads every input once and moves its integrator one step.
+*/
+
+void APP_DEBOUNCE_Sample(APP_DEBOUNCE * debounce);
+
+// *****************************************************************************
+/* Function:
+    bool APP_DEBOUNCE_Active(const APP_DEBOUNCE * debounce, unsigned input)
+    bool APP_DEBOUNCE_Pressed(APP_DEBOUNCE * debounce, unsigned input)
+
+  Summary:
+    Debounced level of an input / true once for every press, then false
+    until the input has been released and pressed again.
+*/
+
+bool APP_DEBOUNCE_Active(const APP_DEBOUNCE * debounce, unsigned input);
+bool APP_DEBOUNCE_Pressed(APP_DEBOUNCE * debounce, unsigned input);
+
+#endif /* _APP_DEBOUNCE_H */
@@ -0,0 +1,147 @@
+/*******************************************************************************
+  Digit Run Scanner
+
+  File Name:
+    app_digits.c
+
+  Summary:
+    Digit run search and conversion, see app_digits.h.
+
+  Description:
+    A byte is a digit when b ^ '0' is below 10.  For eight bytes in a word
+    that test is done on all lanes at once without carries between them:
+    adding 0x76 to the low seven bits of each lane sets its top bit exactly
+    when those bits are 10 or more, and a lane whose own top bit is set
+    is not a digit either.  The first flagged lane is the end of the run.
+
+    Eight digits, first one in the lowest byte, become a number with
+        v = v * 10    + (v >> 8),  keep the low byte of every pair
+        v = v * 100   + (v >> 16), keep the low half of every quad
+        v = v * 10000 + (v >> 32), keep the low half
+    which folds neighbouring lanes together, high digit times its weight
+    plus the low one, until one value is left.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_digits.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define APP_DIGITS_LANES                0x0101010101010101ull
+
+/* Lanes of x (little endian) that hold something other than a digit */
+static uint64_t appDigitsNonDigits(uint64_t x)
+{
+    uint64_t t = x ^ (APP_DIGITS_LANES * '0');
+
+    return (((t & (APP_DIGITS_LANES * 0x7F)) + APP_DIGITS_LANES * 0x76) | t) & (APP_DIGITS_LANES * 0x80);
+}
+
+/* Lowest set bit, counted from 0 */
+static unsigned appDigitsFirst(uint64_t mask)
+{
+    return (unsigned)__builtin_ctzll(mask);
+}
+
+/* Value of eight digits, the first one most significant */
+static uint32_t appDigitsFold8(const char * digits)
+{
+    uint64_t v;
+
+    memcpy(&v, digits, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    v = __builtin_bswap64(v);
+#endif
+    v -= APP_DIGITS_LANES * '0';
+    v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FFull;
+    v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFFull;
+    v = (v * 10000 + (v >> 32)) & 0x00000000FFFFFFFFull;
+    return (uint32_t)v;
+}
+
+size_t APP_DIGITS_Span(const char * data, size_t length)
+{
+    size_t i = 0;
+    uint64_t word, mask;
+
+#if defined(__AVX2__)
+    const __m256i zero32 = _mm256_set1_epi8('0');
+    const __m256i nine32 = _mm256_set1_epi8(9);
+
+    for (; length - i >= 32; i += 32)
+    {
+        __m256i t = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *)&data[i]), zero32);
+        uint32_t digits = (uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_max_epu8(t, nine32), nine32));
+
+        if (digits != 0xFFFFFFFFu)
+        {
+            return i + appDigitsFirst(~digits);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    {
+        const __m128i zero16 = _mm_set1_epi8('0');
+        const __m128i nine16 = _mm_set1_epi8(9);
+
+        for (; length - i >= 16; i += 16)
+        {
+            __m128i t = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)&data[i]), zero16);
+            uint32_t digits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(t, nine16), nine16));
+
+            if (digits != 0xFFFFu)
+            {
+                return i + appDigitsFirst(~digits & 0xFFFFu);
+            }
+        }
+    }
+#endif
+
+    /* SWAR, eight lanes per word */
+    for (; length - i >= 8; i += 8)
+    {
+        memcpy(&word, &data[i], sizeof(word));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        word = __builtin_bswap64(word);
+#endif
+        mask = appDigitsNonDigits(word);
+        if (mask != 0)
+        {
+            return i + appDigitsFirst(mask) / 8;
+        }
+    }
+
+    for (; i < length; i++)
+    {
+        if ((unsigned char)(data[i] - '0') > 9)
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+uint64_t APP_DIGITS_Accumulate(uint64_t value, const char * digits, size_t length)
+{
+    static const uint32_t powers[9] =
+    {
+        1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u
+    };
+    char padded[8];
+
+    for (; length >= 8; length -= 8, digits += 8)
+    {
+        value = value * powers[8] + appDigitsFold8(digits);
+    }
+    if (length != 0)
+    {
+        /* Leading '0's do not change the value of the last few digits */
+        memset(padded, '0', sizeof(padded));
+        memcpy(&padded[8 - length], digits, length);
+        value = value * powers[length] + appDigitsFold8(padded);
+    }
+    return value;
+}
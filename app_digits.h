@@ -0,0 +1,56 @@
+/*******************************************************************************
+  Digit Run Scanner Header File
+
+  File Name:
+    app_digits.h
+
+  Summary:
+    Finds and converts runs of ASCII digits several bytes at a time.
+
+  Description:
+    Long operands arrive as runs of '0'..'9' in the CDC read buffer.  These
+    routines find where such a run ends and fold it into an integer eight
+    digits per step instead of one byte per step.  On the device the bytes
+    are tested as one 64 bit word (SWAR); the host build uses SSE2, or AVX2
+    when the compiler targets it.
+ *******************************************************************************/
+
+#ifndef _APP_DIGITS_H
+#define _APP_DIGITS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// *****************************************************************************
+/* Function:
+    size_t APP_DIGITS_Span(const char * data, size_t length)
+
+  Summary:
+    Returns how many of the first length bytes of data are ASCII digits
+    before the first byte that is not one.
+
+  Remarks:
+    Never reads past data[length - 1].
+*/
+
+size_t APP_DIGITS_Span(const char * data, size_t length);
+
+// *****************************************************************************
+/* Function:
+    uint64_t APP_DIGITS_Accumulate(uint64_t value, const char * digits, size_t length)
+
+  Summary:
+    Returns value * 10^length plus the number written in digits, modulo
+    2^64.
+
+  Description:
+    Every byte must be an ASCII digit.  Eight digits are converted at a
+    time with three multiply-add folds (pairs, quads, then the two halves),
+    so the result is what length steps of value = value * 10 + digit give,
+    wrap around included.  Truncating it to fewer bits gives the same
+    wrapped result as those steps in the narrower type.
+*/
+
+uint64_t APP_DIGITS_Accumulate(uint64_t value, const char * digits, size_t length);
+
+#endif /* _APP_DIGITS_H */
@@ -0,0 +1,66 @@
+/*******************************************************************************
+  Application Event Queue
+
+  File Name:
+    app_event.c
+
+  Summary:
+    Single-producer/single-consumer event queue, see app_event.h.
+
+  Description:
+    head is published with release semantics after the event is stored and
+    tail after it has been copied out, as in app_txring.c.
+ *******************************************************************************/
+
+#include "app_event.h"
+
+#define APP_EVENT_QUEUE_MASK            (APP_EVENT_QUEUE_SIZE - 1)
+
+#if (APP_EVENT_QUEUE_SIZE & APP_EVENT_QUEUE_MASK) != 0
+#error "APP_EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+void APP_EVENT_Initialize(APP_EVENT_QUEUE * queue)
+{
+    queue->head = 0;
+    queue->tail = 0;
+    queue->overflow = false;
+    queue->dropped = 0;
+}
+
+bool APP_EVENT_Post(APP_EVENT_QUEUE * queue, APP_EVENT_TYPE type, unsigned port)
+{
+    uint32_t head = queue->head;
+    APP_EVENT * event;
+
+    if (head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) >= APP_EVENT_QUEUE_SIZE)
+    {
+        queue->dropped++;
+        queue->overflow = true;
+        return false;
+    }
+    event = &queue->event[head & APP_EVENT_QUEUE_MASK];
+    event->type = (uint8_t)type;
+    event->port = (uint8_t)port;
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool APP_EVENT_Get(APP_EVENT_QUEUE * queue, APP_EVENT * event)
+{
+    uint32_t tail = queue->tail;
+
+    if (tail == __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE))
+    {
+        return false;
+    }
+    *event = queue->event[tail & APP_EVENT_QUEUE_MASK];
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool APP_EVENT_Empty(const APP_EVENT_QUEUE * queue)
+{
+    return __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+}
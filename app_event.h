@@ -0,0 +1,140 @@
+/*******************************************************************************
+  Application Event Queue Header File
+
+  File Name:
+    app_event.h
+
+  Summary:
+    Single-producer/single-consumer queue of USB events for the event
+    driven main loop.
+
+  Description:
+    With the USB stack in interrupt mode the device and CDC callbacks run
+    in the USB interrupt.  Instead of setting flags that APP_Tasks polls on
+    every pass, they post a small event naming what happened and on which
+    port.  APP_Tasks takes the events, runs only the handlers they name and
+    idles the core once the queue is empty.  The interrupt only ever moves
+    head and APP_Tasks only ever moves tail, so neither side needs a lock.
+ *******************************************************************************/
+
+#ifndef _APP_EVENT_H
+#define _APP_EVENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Queue capacity in events, must be a power of two */
+#ifndef APP_EVENT_QUEUE_SIZE
+#define APP_EVENT_QUEUE_SIZE            32
+#endif
+
+typedef enum
+{
+    /* Configured, reset, detached: every port has to be looked at */
+    APP_EVENT_DEVICE = 0,
+
+    /* A CDC read or write of port completed */
+    APP_EVENT_READ,
+    APP_EVENT_WRITE
+
+} APP_EVENT_TYPE;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t port;
+
+} APP_EVENT;
+
+typedef struct
+{
+    APP_EVENT event[APP_EVENT_QUEUE_SIZE];
+
+    /* Free running indices, wrapped with APP_EVENT_QUEUE_SIZE - 1 on access */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+
+    /* Set when an event was lost; the consumer then looks at everything */
+    volatile bool overflow;
+
+    /* Events lost because the queue was full */
+    uint32_t dropped;
+
+} APP_EVENT_QUEUE;
+
+// *****************************************************************************
+/* Event Loop Statistics
+
+  Summary:
+    What the main loop did and how fast it answered.
+
+  Description:
+    wakeups counts passes of APP_Tasks that had events to handle and sleeps
+    the times the core was idled because there were none.  A response is
+    the first write issued on a port after one of its reads completed; its
+    latency runs from the read completion callback to that write, in
+    timestamp counts (the core timer on the device).  Both loop modes keep
+    the latency figures, so they can be compared.
+*/
+
+typedef struct
+{
+    uint32_t wakeups;
+    uint32_t sleeps;
+    uint32_t responses;
+    uint64_t latencySum;
+    uint32_t latencyMax;
+
+} APP_EVENT_STATS;
+
+// *****************************************************************************
+/* Function:
+    void APP_EVENT_Initialize(APP_EVENT_QUEUE * queue)
+
+  Summary:
+    Empties the queue and clears the overflow flag and drop counter.
+*/
+
+void APP_EVENT_Initialize(APP_EVENT_QUEUE * queue);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EVENT_Post(APP_EVENT_QUEUE * queue, APP_EVENT_TYPE type,
+                        unsigned port)
+
+  Summary:
+    Producer side.  Appends an event, returns false if the queue was full.
+
+  Remarks:
+    A lost event sets the overflow flag.  Callable from the interrupt.
+*/
+
+bool APP_EVENT_Post(APP_EVENT_QUEUE * queue, APP_EVENT_TYPE type, unsigned port);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EVENT_Get(APP_EVENT_QUEUE * queue, APP_EVENT * event)
+
+  Summary:
+    Consumer side.  Removes the oldest event into *event, returns false
+    when there is none.
+*/
+
+bool APP_EVENT_Get(APP_EVENT_QUEUE * queue, APP_EVENT * event);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EVENT_Empty(const APP_EVENT_QUEUE * queue)
+
+  Summary:
+    True when no event is waiting.
+
+  Remarks:
+    To idle without missing an event, check this with interrupts disabled
+    and enter the power saving mode before enabling them again.
+*/
+
+bool APP_EVENT_Empty(const APP_EVENT_QUEUE * queue);
+
+#endif /* _APP_EVENT_H */
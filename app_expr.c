@@ -0,0 +1,160 @@
+/*******************************************************************************
+  Infix Expression Compiler
+
+  File Name:
+    app_expr.c
+
+  Summary:
+    Shunting-yard compiler, see app_expr.h.
+
+  Description:
+    Every operator on the pending stack will cost one byte of code, so the
+    bytes emitted plus the operators pending are the least the program
+    will take.  An operator or a unary minus is only taken when that, the
+    operator itself and the operand that must follow it still fit, which
+    is why APP_EXPR_End() never runs out of room.
+ *******************************************************************************/
+
+#include "app_expr.h"
+
+static unsigned appExprPrecedence(uint8_t op)
+{
+    switch (op)
+    {
+        case APP_EXPR_ADD:
+        case APP_EXPR_SUB:
+            return 1;
+        case APP_EXPR_MUL:
+        case APP_EXPR_DIV:
+            return 2;
+        case APP_EXPR_NEG:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+/* Bytes the program will take at least */
+static unsigned appExprCommitted(const APP_EXPR * expr)
+{
+    unsigned committed = expr->length, k;
+
+    for (k = 0; k < expr->pendingCount; k++)
+    {
+        committed += (expr->pending[k] != APP_EXPR_PAREN);
+    }
+    return committed;
+}
+
+/* Moves the pending operator on top into the code */
+static void appExprEmit(APP_EXPR * expr)
+{
+    expr->code[expr->length++] = expr->pending[--expr->pendingCount];
+}
+
+void APP_EXPR_Initialize(APP_EXPR * expr)
+{
+    expr->length = 0;
+    expr->operands = 0;
+    expr->pendingCount = 0;
+    expr->open = 0;
+    expr->operandDue = true;
+}
+
+bool APP_EXPR_Open(APP_EXPR * expr)
+{
+    if (!expr->operandDue || expr->pendingCount == APP_EXPR_NEST_MAX)
+    {
+        return false;
+    }
+    expr->pending[expr->pendingCount++] = APP_EXPR_PAREN;
+    expr->open++;
+    return true;
+}
+
+bool APP_EXPR_Close(APP_EXPR * expr)
+{
+    if (expr->operandDue || expr->open == 0)
+    {
+        return false;
+    }
+    while (expr->pending[expr->pendingCount - 1] != APP_EXPR_PAREN)
+    {
+        appExprEmit(expr);
+    }
+    expr->pendingCount--;
+    expr->open--;
+    return true;
+}
+
+bool APP_EXPR_Operand(APP_EXPR * expr, uint8_t * index)
+{
+    if (!expr->operandDue || expr->operands == APP_EXPR_OPERANDS_MAX ||
+            appExprCommitted(expr) + 2 > APP_EXPR_CODE_MAX)
+    {
+        return false;
+    }
+    *index = expr->operands++;
+    expr->code[expr->length++] = APP_EXPR_PUSH;
+    expr->code[expr->length++] = *index;
+    expr->operandDue = false;
+    return true;
+}
+
+bool APP_EXPR_Operator(APP_EXPR * expr, unsigned op)
+{
+    unsigned precedence = appExprPrecedence((uint8_t)op), popped = 0;
+
+    if (expr->operandDue || op > APP_EXPR_DIV)
+    {
+        return false;
+    }
+
+    /* Left associative: equal precedence goes first */
+    while (popped < expr->pendingCount &&
+            appExprPrecedence(expr->pending[expr->pendingCount - 1 - popped]) >= precedence)
+    {
+        popped++;
+    }
+    if (expr->pendingCount - popped == APP_EXPR_NEST_MAX ||
+            appExprCommitted(expr) + 1 + 2 > APP_EXPR_CODE_MAX)
+    {
+        return false;
+    }
+    while (popped-- > 0)
+    {
+        appExprEmit(expr);
+    }
+    expr->pending[expr->pendingCount++] = (uint8_t)op;
+    expr->operandDue = true;
+    return true;
+}
+
+bool APP_EXPR_Negate(APP_EXPR * expr)
+{
+    if (!expr->operandDue || expr->pendingCount == APP_EXPR_NEST_MAX ||
+            appExprCommitted(expr) + 1 + 2 > APP_EXPR_CODE_MAX)
+    {
+        return false;
+    }
+    expr->pending[expr->pendingCount++] = APP_EXPR_NEG;
+    return true;
+}
+
+bool APP_EXPR_Complete(const APP_EXPR * expr)
+{
+    return !expr->operandDue && expr->open == 0;
+}
+
+bool APP_EXPR_End(APP_EXPR * expr)
+{
+    if (!APP_EXPR_Complete(expr))
+    {
+        return false;
+    }
+    while (expr->pendingCount > 0)
+    {
+        appExprEmit(expr);
+    }
+    return true;
+}
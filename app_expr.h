@@ -0,0 +1,179 @@
+/*******************************************************************************
+  Infix Expression Compiler Header File
+
+  File Name:
+    app_expr.h
+
+  Summary:
+    Shunting-yard compiler from infix tokens to stack machine bytecode.
+
+  Description:
+    The caller tokenizes the input and hands each token over as it is
+    typed: an opening or closing parenthesis, an operand, a binary operator
+    or a unary minus.  Operators are kept on a small stack and emitted by
+    precedence, so when the expression is complete the bytecode already is
+    in postfix order:
+
+        "(1+2*(3-4))"   PUSH 0  PUSH 1  PUSH 2  PUSH 3  SUB  MUL  ADD
+
+    * and / bind tighter than + and -, all four are left associative and a
+    unary minus binds tightest of all.  An APP_EXPR_PUSH is followed by one
+    byte, the operand's index: the values themselves are kept by the
+    caller, who also runs the bytecode with its own arithmetic.  The module
+    only tracks the stack depth the program needs, never a value.
+
+    A token that is not valid where it arrives (an operator where an
+    operand is due, a ')' without its '(') or that would overflow one of
+    the fixed limits below is refused and leaves everything as it was, so
+    the caller can simply ignore that keystroke.  Nothing is allocated: an
+    APP_EXPR holds the whole program.
+ *******************************************************************************/
+
+#ifndef _APP_EXPR_H
+#define _APP_EXPR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Bytecode of one expression, an operand takes two bytes */
+#ifndef APP_EXPR_CODE_MAX
+#define APP_EXPR_CODE_MAX               96
+#endif
+
+/* Operands of one expression */
+#ifndef APP_EXPR_OPERANDS_MAX
+#define APP_EXPR_OPERANDS_MAX           32
+#endif
+
+/* Parentheses and operators waiting for their right operand */
+#ifndef APP_EXPR_NEST_MAX
+#define APP_EXPR_NEST_MAX               16
+#endif
+
+/* Operand stack the bytecode can need: one entry per waiting binary
+ * operator plus the operand being computed */
+#define APP_EXPR_STACK_MAX              (APP_EXPR_NEST_MAX + 1)
+
+typedef enum
+{
+    /* Binary operators, in the order of the calculators' enum Oper.  Pop b,
+     * pop a, push a op b */
+    APP_EXPR_ADD = 0,
+    APP_EXPR_SUB,
+    APP_EXPR_MUL,
+    APP_EXPR_DIV,
+
+    /* Negate the top of the stack */
+    APP_EXPR_NEG,
+
+    /* Push operand number code[k + 1] */
+    APP_EXPR_PUSH,
+
+    /* Only ever on the operator stack */
+    APP_EXPR_PAREN
+
+} APP_EXPR_OPCODE;
+
+typedef struct
+{
+    uint8_t code[APP_EXPR_CODE_MAX];
+    uint8_t length;
+
+    /* Operands handed out so far */
+    uint8_t operands;
+
+    /* Operators not emitted yet and APP_EXPR_PAREN for each open '(' */
+    uint8_t pending[APP_EXPR_NEST_MAX];
+    uint8_t pendingCount;
+    uint8_t open;
+
+    /* Whether the next token must start an operand */
+    bool operandDue;
+
+} APP_EXPR;
+
+// *****************************************************************************
+/* Function:
+    void APP_EXPR_Initialize(APP_EXPR * expr)
+
+  Summary:
+    Starts an empty expression, waiting for its first operand.
+*/
+
+void APP_EXPR_Initialize(APP_EXPR * expr);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EXPR_Open(APP_EXPR * expr)
+    bool APP_EXPR_Close(APP_EXPR * expr)
+
+  Summary:
+    A '(' where an operand is due, or the ')' that ends an operand.
+    Return false, and change nothing, when the token is refused.
+*/
+
+bool APP_EXPR_Open(APP_EXPR * expr);
+bool APP_EXPR_Close(APP_EXPR * expr);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EXPR_Operand(APP_EXPR * expr, uint8_t * index)
+
+  Summary:
+    An operand where one is due.  Emits its APP_EXPR_PUSH and returns in
+    *index the number the bytecode knows it by, 0 for the first operand,
+    1 for the next and so on.
+
+  Remarks:
+    The value is the caller's business and may still change after the
+    call, while its digits are typed.
+*/
+
+bool APP_EXPR_Operand(APP_EXPR * expr, uint8_t * index);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EXPR_Operator(APP_EXPR * expr, unsigned op)
+
+  Summary:
+    A binary operator, APP_EXPR_ADD to APP_EXPR_DIV, after an operand.
+*/
+
+bool APP_EXPR_Operator(APP_EXPR * expr, unsigned op);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EXPR_Negate(APP_EXPR * expr)
+
+  Summary:
+    A unary minus where an operand is due.
+*/
+
+bool APP_EXPR_Negate(APP_EXPR * expr);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EXPR_Complete(const APP_EXPR * expr)
+
+  Summary:
+    Whether the tokens so far form a whole expression: every parenthesis
+    is closed and no operator waits for an operand.
+*/
+
+bool APP_EXPR_Complete(const APP_EXPR * expr);
+
+// *****************************************************************************
+/* Function:
+    bool APP_EXPR_End(APP_EXPR * expr)
+
+  Summary:
+    Emits the operators still pending.  Afterwards code[0..length) is the
+    whole program; running it leaves exactly one value on the stack.
+
+  Remarks:
+    Refused unless APP_EXPR_Complete().
+*/
+
+bool APP_EXPR_End(APP_EXPR * expr);
+
+#endif /* _APP_EXPR_H */
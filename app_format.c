@@ -0,0 +1,286 @@
+/*******************************************************************************
+  Number Formatting
+
+  File Name:
+    app_format.c
+
+  Summary:
+    Number to ASCII conversion, see app_format.h.
+
+  Description:
+    The length is known up front from a few compares against powers of
+    ten, so digits go straight to their final place, least significant
+    first and two per step: one division by 100 (a multiply by the
+    reciprocal on every compiler we use) and one copy out of appDigitPairs.
+
+    Floats are split into their integer mantissa and binary exponent and
+    converted exactly with integer arithmetic, no float operation and no
+    libc: the digits are those of the true binary value, rounded half to
+    even at the last requested decimal, the same as printf("%.*f").
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_format.h"
+
+/* "00" "01" ... "99" */
+static const char appDigitPairs[200] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* 10^n, to count digits with compares instead of divisions */
+static const uint32_t appPowersOf10[10] =
+{
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u
+};
+
+/* Digits of value, most significant first, no leading zeros */
+static size_t appFormatUnsigned(char * buffer, uint32_t value)
+{
+    uint32_t pair;
+    size_t length;
+    char * p;
+
+    for (length = 1; (length < 10) && (value >= appPowersOf10[length]); length++)
+    {
+    }
+
+    /* Fill from the last digit backwards, two per division */
+    p = &buffer[length];
+    while (value >= 100)
+    {
+        pair = value % 100;
+        value /= 100;
+        p -= 2;
+        memcpy(p, &appDigitPairs[2 * pair], 2);
+    }
+    if (value >= 10)
+    {
+        memcpy(p - 2, &appDigitPairs[2 * value], 2);
+    }
+    else
+    {
+        p[-1] = (char)('0' + value);
+    }
+
+    return length;
+}
+
+/* Exactly digits digits of value, zero padded on the left */
+static void appFormatPadded(char * buffer, uint32_t value, unsigned digits)
+{
+    char * p = &buffer[digits];
+    uint32_t pair;
+
+    while (p - buffer >= 2)
+    {
+        pair = value % 100;
+        value /= 100;
+        p -= 2;
+        memcpy(p, &appDigitPairs[2 * pair], 2);
+    }
+    if (p != buffer)
+    {
+        *--p = (char)('0' + value % 10);
+    }
+}
+
+/* Digits of m * 2^e for e up to 104, i.e. any float of 2^32 or more.  The
+ * value is held in four 32 bit limbs and cut into base 10^9 chunks. */
+static size_t appFormatBig(char * buffer, uint32_t m, int e)
+{
+    uint32_t limbs[5] = { 0, 0, 0, 0, 0 };
+    uint32_t chunks[5];
+    uint64_t shifted = (uint64_t)m << (e % 32);
+    uint64_t current;
+    int top = 3, n = 0, i;
+    size_t length;
+
+    limbs[e / 32] = (uint32_t)shifted;
+    limbs[e / 32 + 1] = (uint32_t)(shifted >> 32);
+
+    while (top >= 0)
+    {
+        current = 0;
+        for (i = top; i >= 0; i--)
+        {
+            current = (current << 32) | limbs[i];
+            limbs[i] = (uint32_t)(current / 1000000000u);
+            current %= 1000000000u;
+        }
+        chunks[n++] = (uint32_t)current;
+        while (top >= 0 && limbs[top] == 0)
+        {
+            top--;
+        }
+    }
+
+    length = appFormatUnsigned(buffer, chunks[--n]);
+    while (n > 0)
+    {
+        appFormatPadded(&buffer[length], chunks[--n], 9);
+        length += 9;
+    }
+    return length;
+}
+
+size_t APP_FORMAT_Int(char * buffer, int32_t value)
+{
+    /* Negate in unsigned arithmetic, -INT32_MIN does not fit an int32_t */
+    if (value < 0)
+    {
+        buffer[0] = '-';
+        return 1 + appFormatUnsigned(&buffer[1], 0u - (uint32_t)value);
+    }
+    return appFormatUnsigned(buffer, (uint32_t)value);
+}
+
+size_t APP_FORMAT_Unsigned(char * buffer, uint32_t value)
+{
+    return appFormatUnsigned(buffer, value);
+}
+
+size_t APP_FORMAT_Padded(char * buffer, uint32_t value, unsigned digits)
+{
+    appFormatPadded(buffer, value, digits);
+    return digits;
+}
+
+size_t APP_FORMAT_Float(char * buffer, float value, unsigned decimals)
+{
+    uint32_t bits, m, integer, fraction, scale;
+    uint64_t scaled, rest, half;
+    size_t length = 0;
+    int e, k;
+
+    memcpy(&bits, &value, sizeof(bits));
+    e = (int)((bits >> 23) & 0xFF);
+    m = bits & 0x7FFFFF;
+
+    if (decimals > APP_FORMAT_FLOAT_MAX_DECIMALS)
+    {
+        decimals = APP_FORMAT_FLOAT_MAX_DECIMALS;
+    }
+    if (bits >> 31)
+    {
+        buffer[length++] = '-';
+    }
+    if (e == 0xFF)
+    {
+        memcpy(&buffer[length], (m != 0) ? "nan" : "inf", 3);
+        return length + 3;
+    }
+
+    /* value = m * 2^e with m an integer of at most 24 bits */
+    if (e == 0)
+    {
+        e = -149;
+    }
+    else
+    {
+        m |= 0x800000;
+        e -= 150;
+    }
+    scale = appPowersOf10[decimals];
+
+    if (e >= 0)
+    {
+        /* An integer, nothing after the point */
+        length += (e <= 8) ? appFormatUnsigned(&buffer[length], m << e)
+                           : appFormatBig(&buffer[length], m, e);
+        fraction = 0;
+    }
+    else
+    {
+        /* k fraction bits.  fraction * 10^decimals fits 54 bits, so the
+         * digits and the rounding remainder come out of one 64 bit
+         * product. Past 63 bits the value is below 10^-10 and rounds to 0 */
+        k = -e;
+        integer = (k < 24) ? (m >> k) : 0;
+        if (k < 64)
+        {
+            scaled = (uint64_t)((k < 24) ? (m & ((1u << k) - 1)) : m) * scale;
+            fraction = (uint32_t)(scaled >> k);
+            rest = scaled & (((uint64_t)1 << k) - 1);
+            half = (uint64_t)1 << (k - 1);
+
+            /* Round half to even on the exact binary value, as printf does */
+            if ((rest > half) || ((rest == half) && (((decimals ? fraction : integer) & 1) != 0)))
+            {
+                if (++fraction == scale)
+                {
+                    fraction = 0;
+                    integer++;
+                }
+            }
+        }
+        else
+        {
+            fraction = 0;
+        }
+        length += appFormatUnsigned(&buffer[length], integer);
+    }
+
+    if (decimals != 0)
+    {
+        buffer[length++] = '.';
+        appFormatPadded(&buffer[length], fraction, decimals);
+        length += decimals;
+    }
+    return length;
+}
+
+size_t APP_FORMAT_Fixed(char * buffer, int64_t value, unsigned decimals)
+{
+    uint64_t magnitude, integer;
+    uint32_t fraction, scale, chunks[3];
+    size_t length = 0;
+    int n = 0;
+
+    if (decimals > APP_FORMAT_FLOAT_MAX_DECIMALS)
+    {
+        decimals = APP_FORMAT_FLOAT_MAX_DECIMALS;
+    }
+    if (value < 0)
+    {
+        buffer[length++] = '-';
+        magnitude = 0u - (uint64_t)value;
+    }
+    else
+    {
+        magnitude = (uint64_t)value;
+    }
+    scale = appPowersOf10[decimals];
+
+    if ((magnitude >> 32) == 0)
+    {
+        length += appFormatUnsigned(&buffer[length], (uint32_t)magnitude / scale);
+        fraction = (uint32_t)magnitude % scale;
+    }
+    else
+    {
+        /* Up to 20 integer digits, cut into base 10^9 chunks */
+        integer = magnitude / scale;
+        fraction = (uint32_t)(magnitude % scale);
+        do
+        {
+            chunks[n++] = (uint32_t)(integer % 1000000000u);
+            integer /= 1000000000u;
+        } while (integer != 0);
+
+        length += appFormatUnsigned(&buffer[length], chunks[--n]);
+        while (n > 0)
+        {
+            appFormatPadded(&buffer[length], chunks[--n], 9);
+            length += 9;
+        }
+    }
+
+    if (decimals != 0)
+    {
+        buffer[length++] = '.';
+        appFormatPadded(&buffer[length], fraction, decimals);
+        length += decimals;
+    }
+    return length;
+}
@@ -0,0 +1,122 @@
+/*******************************************************************************
+  Number Formatting Header File
+
+  File Name:
+    app_format.h
+
+  Summary:
+    Number to ASCII conversion for the calculator results.
+
+  Description:
+    The PIC32 core has no fast divider, so the formatters here divide once
+    per two digits and look the pair up in a 200 byte table instead of
+    dividing once per digit.  Every routine writes its digits in a single
+    pass and returns the number of characters written.  No terminating NUL
+    is written.
+ *******************************************************************************/
+
+#ifndef _APP_FORMAT_H
+#define _APP_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Longest output of APP_FORMAT_Int: "-2147483648" */
+#define APP_FORMAT_INT_MAX_LENGTH       11
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FORMAT_Int(char * buffer, int32_t value)
+
+  Summary:
+    Writes value in decimal, with a leading '-' when negative.
+
+  Remarks:
+    Covers the whole int32_t range, INT32_MIN included.  buffer must have
+    room for APP_FORMAT_INT_MAX_LENGTH characters.
+*/
+
+size_t APP_FORMAT_Int(char * buffer, int32_t value);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FORMAT_Unsigned(char * buffer, uint32_t value)
+
+  Summary:
+    Writes value in decimal, with no sign.
+
+  Remarks:
+    For counters that may pass INT32_MAX.  buffer must have room for
+    APP_FORMAT_INT_MAX_LENGTH - 1 characters.
+*/
+
+size_t APP_FORMAT_Unsigned(char * buffer, uint32_t value);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FORMAT_Padded(char * buffer, uint32_t value, unsigned digits)
+
+  Summary:
+    Writes the last digits decimal digits of value, zero padded on the
+    left, and returns digits.
+
+  Remarks:
+    For numbers printed in pieces, e.g. the base 10^9 limbs of a bignum
+    below the top one.
+*/
+
+size_t APP_FORMAT_Padded(char * buffer, uint32_t value, unsigned digits);
+
+/* Most decimals APP_FORMAT_Float accepts */
+#define APP_FORMAT_FLOAT_MAX_DECIMALS   9
+
+/* Longest output of APP_FORMAT_Float: sign, 39 integer digits, point and
+   APP_FORMAT_FLOAT_MAX_DECIMALS decimals */
+#define APP_FORMAT_FLOAT_MAX_LENGTH     (1 + 39 + 1 + APP_FORMAT_FLOAT_MAX_DECIMALS)
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FORMAT_Float(char * buffer, float value, unsigned decimals)
+
+  Summary:
+    Writes value in fixed point with the given number of decimals.
+
+  Description:
+    The output is the one printf("%.*f", decimals, value) gives: correctly
+    rounded (half to even on the exact binary value), a '-' whenever the
+    sign bit is set, no point when decimals is 0, and "inf"/"nan" for the
+    special values.  Uses 32 and 64 bit integer arithmetic only.
+
+  Remarks:
+    decimals above APP_FORMAT_FLOAT_MAX_DECIMALS are clamped.  buffer must
+    have room for APP_FORMAT_FLOAT_MAX_LENGTH characters.
+*/
+
+size_t APP_FORMAT_Float(char * buffer, float value, unsigned decimals);
+
+/* Longest output of APP_FORMAT_Fixed: sign, 19 integer digits, point and
+   APP_FORMAT_FLOAT_MAX_DECIMALS decimals */
+#define APP_FORMAT_FIXED_MAX_LENGTH     (1 + 19 + 1 + APP_FORMAT_FLOAT_MAX_DECIMALS)
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FORMAT_Fixed(char * buffer, int64_t value, unsigned decimals)
+
+  Summary:
+    Writes value / 10^decimals with exactly the given number of decimals.
+
+  Description:
+    For numbers kept as integer multiples of 10^-decimals, so no rounding
+    takes place: the integer part and the zero padded fraction are the
+    quotient and remainder of one division.  The layout matches
+    APP_FORMAT_Float: a '-' for negative values and no point when decimals
+    is 0.  When the magnitude fits 32 bits only 32 bit divisions are used.
+
+  Remarks:
+    decimals above APP_FORMAT_FLOAT_MAX_DECIMALS are clamped.  buffer must
+    have room for APP_FORMAT_FIXED_MAX_LENGTH characters.
+*/
+
+size_t APP_FORMAT_Fixed(char * buffer, int64_t value, unsigned decimals);
+
+#endif /* _APP_FORMAT_H */
@@ -0,0 +1,275 @@
+/*******************************************************************************
+  Binary Frame Protocol
+
+  File Name:
+    app_frame.c
+
+  Summary:
+    Request decoder and response encoder, see app_frame.h.
+
+  Description:
+    Multi-byte fields are put together byte by byte: frames sit at any
+    offset of the read buffer, so the fields are not aligned.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_frame.h"
+
+size_t APP_FRAME_Width(unsigned format)
+{
+    switch (format)
+    {
+        case APP_FRAME_INT32:
+        case APP_FRAME_FLOAT32:
+            return 4;
+        case APP_FRAME_DECIMAL:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static uint64_t appFrameGet(const uint8_t * data, size_t width)
+{
+    uint64_t value = 0;
+
+    while (width > 0)
+    {
+        width--;
+        value = (value << 8) | data[width];
+    }
+    return value;
+}
+
+static void appFramePut(uint8_t * data, uint64_t value, size_t width)
+{
+    size_t k;
+
+    for (k = 0; k < width; k++)
+    {
+        data[k] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+static void appFrameValue(APP_FRAME_VALUE * value, const uint8_t * data, unsigned format)
+{
+    uint32_t bits;
+
+    switch (format)
+    {
+        case APP_FRAME_INT32:
+            value->i = (int32_t)(uint32_t)appFrameGet(data, 4);
+            break;
+        case APP_FRAME_FLOAT32:
+            bits = (uint32_t)appFrameGet(data, 4);
+            memcpy(&value->f, &bits, sizeof(bits));
+            break;
+        default:
+            value->d = (int64_t)appFrameGet(data, 8);
+            break;
+    }
+}
+
+/* Fills *request from a whole frame of total bytes; only the first
+ * APP_FRAME_REQUEST_MAX of them are in frame */
+static void appFrameParse(const uint8_t * frame, size_t total, APP_FRAME_REQUEST * request)
+{
+    size_t width;
+
+    memset(request, 0, sizeof(*request));
+    if (total < 4)
+    {
+        request->id = (total == 3) ? (uint16_t)appFrameGet(&frame[1], 2) : 0;
+        request->status = APP_FRAME_MALFORMED;
+        return;
+    }
+    request->id = (uint16_t)appFrameGet(&frame[1], 2);
+    request->bulk = (frame[3] & APP_FRAME_BULK) != 0;
+    request->op = frame[3] & 0x07;
+    request->format = frame[3] >> 4;
+    width = APP_FRAME_Width(request->format);
+    if (request->bulk)
+    {
+        /* The count is only believed when the header is well formed, and
+         * then the operands must be taken even if the op is unknown */
+        if (width == 0)
+        {
+            request->status = APP_FRAME_UNSUPPORTED;
+        }
+        else if (total != 4 + width + 4)
+        {
+            request->status = APP_FRAME_MALFORMED;
+        }
+        else
+        {
+            appFrameValue(&request->b, &frame[4], request->format);
+            request->count = (uint32_t)appFrameGet(&frame[4 + width], 4);
+            request->status = (request->op > 3) ? APP_FRAME_UNSUPPORTED : APP_FRAME_OK;
+        }
+    }
+    else if (width == 0 || request->op > 3)
+    {
+        request->status = APP_FRAME_UNSUPPORTED;
+    }
+    else if (total != 4 + 2 * width)
+    {
+        request->status = APP_FRAME_MALFORMED;
+    }
+    else
+    {
+        appFrameValue(&request->a, &frame[4], request->format);
+        appFrameValue(&request->b, &frame[4 + width], request->format);
+        request->status = APP_FRAME_OK;
+    }
+}
+
+/* The operands of a bulk request come next */
+static void appFrameBulk(APP_FRAME_DECODER * decoder, const APP_FRAME_REQUEST * request)
+{
+    if (request->bulk && request->count > 0)
+    {
+        decoder->operands = request->count;
+        decoder->width = (uint8_t)APP_FRAME_Width(request->format);
+        decoder->elementLength = 0;
+    }
+}
+
+void APP_FRAME_Initialize(APP_FRAME_DECODER * decoder)
+{
+    decoder->length = 0;
+    decoder->operands = 0;
+    decoder->elementLength = 0;
+}
+
+size_t APP_FRAME_Decode(APP_FRAME_DECODER * decoder, const uint8_t * data,
+        size_t length, APP_FRAME_REQUEST * request, bool * ready)
+{
+    size_t total, take, keep;
+
+    *ready = false;
+    if (length == 0)
+    {
+        return 0;
+    }
+    if (decoder->length == 0)
+    {
+        total = (size_t)data[0] + 1;
+        if (total <= length)
+        {
+            /* The common case, the whole frame is here */
+            if (total > 1)
+            {
+                appFrameParse(data, total, request);
+                appFrameBulk(decoder, request);
+                *ready = true;
+            }
+            return total;
+        }
+    }
+    else
+    {
+        total = (size_t)decoder->frame[0] + 1;
+    }
+
+    /* Bytes past APP_FRAME_REQUEST_MAX only matter for the count, such a
+     * frame is malformed anyway */
+    take = total - decoder->length;
+    if (take > length)
+    {
+        take = length;
+    }
+    keep = (decoder->length < APP_FRAME_REQUEST_MAX) ? APP_FRAME_REQUEST_MAX - decoder->length : 0;
+    memcpy(&decoder->frame[decoder->length], data, (take < keep) ? take : keep);
+    decoder->length += take;
+    if (decoder->length == total)
+    {
+        appFrameParse(decoder->frame, total, request);
+        appFrameBulk(decoder, request);
+        *ready = true;
+        decoder->length = 0;
+    }
+    return take;
+}
+
+size_t APP_FRAME_Encode(uint8_t * frame, uint16_t id, unsigned status,
+        unsigned format, const APP_FRAME_VALUE * result)
+{
+    size_t width = APP_FRAME_Width(format);
+    uint32_t bits;
+
+    frame[0] = (uint8_t)(3 + width);
+    appFramePut(&frame[1], id, 2);
+    frame[3] = (uint8_t)((status & 0x0F) | (format << 4));
+    switch (width)
+    {
+        case 4:
+            if (format == APP_FRAME_FLOAT32)
+            {
+                memcpy(&bits, &result->f, sizeof(bits));
+            }
+            else
+            {
+                bits = (uint32_t)result->i;
+            }
+            appFramePut(&frame[4], bits, 4);
+            break;
+        case 8:
+            appFramePut(&frame[4], (uint64_t)result->d, 8);
+            break;
+        default:
+            break;
+    }
+    return 4 + width;
+}
+
+size_t APP_FRAME_Operands(APP_FRAME_DECODER * decoder, const uint8_t * data,
+        size_t length, size_t maxCount, const uint8_t ** operands, size_t * count)
+{
+    size_t width = decoder->width, take;
+
+    *count = 0;
+    *operands = decoder->element;
+    if (decoder->elementLength > 0 || length < width)
+    {
+        /* An operand split over two reads */
+        take = width - decoder->elementLength;
+        if (take > length)
+        {
+            take = length;
+        }
+        memcpy(&decoder->element[decoder->elementLength], data, take);
+        decoder->elementLength += (uint8_t)take;
+        if (decoder->elementLength == width)
+        {
+            decoder->elementLength = 0;
+            decoder->operands--;
+            *count = 1;
+        }
+        return take;
+    }
+
+    take = length / width;
+    if (take > maxCount)
+    {
+        take = maxCount;
+    }
+    if (take > decoder->operands)
+    {
+        take = decoder->operands;
+    }
+    decoder->operands -= (uint32_t)take;
+    *operands = data;
+    *count = take;
+    return take * width;
+}
+
+size_t APP_FRAME_EncodeBulk(uint8_t * frame, uint16_t id, unsigned status,
+        unsigned format, uint32_t count)
+{
+    frame[0] = 7;
+    appFramePut(&frame[1], id, 2);
+    frame[3] = (uint8_t)((status & 0x0F) | APP_FRAME_BULK | (format << 4));
+    appFramePut(&frame[4], count, 4);
+    return 8;
+}
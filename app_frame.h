@@ -0,0 +1,248 @@
+/*******************************************************************************
+  Binary Frame Protocol Header File
+
+  File Name:
+    app_frame.h
+
+  Summary:
+    Length prefixed request and response frames for automated clients.
+
+  Description:
+    A port in binary mode takes no keystrokes and echoes nothing.  The host
+    sends request frames and gets one response frame per request, in the
+    same order, several of them per USB packet.  All fields are little
+    endian:
+
+        request     len  u8     bytes that follow: 3 + 2 * width
+                    id   u16    copied into the response
+                    op   u8     low nibble: 0 +, 1 -, 2 *, 3 /
+                                high nibble: APP_FRAME_FORMAT of a and b
+                    a, b        width bytes each
+
+        response    len  u8     bytes that follow: 3 + width
+                    id   u16
+                    stat u8     low nibble: APP_FRAME_STATUS
+                                high nibble: format of the result
+                    result      width bytes, the request's format
+
+    width is 4 for APP_FRAME_INT32 and APP_FRAME_FLOAT32 and 8 for
+    APP_FRAME_DECIMAL.  A frame with len 0 is padding and gets no response.
+    A frame whose length does not match its format is skipped whole and
+    answered with APP_FRAME_MALFORMED, so the stream never loses its
+    framing.
+
+    A bulk request applies one operator and one scalar to a whole array.
+    It sets APP_FRAME_BULK in op and carries a count instead of a; that
+    many operands follow it packed, without framing of their own:
+
+        bulk        len  u8     3 + width + 4
+                    id   u16
+                    op   u8     low nibble: operator | APP_FRAME_BULK
+                                high nibble: APP_FRAME_FORMAT
+                    b           width bytes, the scalar
+                    count u32   operands that follow
+                    in          count * width bytes
+
+        response    len  u8     7
+                    id   u16
+                    stat u8     low nibble: APP_FRAME_STATUS | APP_FRAME_BULK
+                                high nibble: format of the results
+                    count u32   results that follow
+                    out         count * width bytes, out[k] = in[k] op b
+
+    The status of the header covers every result: UNSUPPORTED and OVERFLOW
+    make them all 0 and DIV_ZERO all -1.  A DECIMAL result that does not
+    fit is APP_FRAME_DECIMAL_OVERFLOW on its own.  A bulk request whose
+    length is wrong or whose format is unknown says nothing reliable about
+    the operands, so none are taken and the response has count 0.
+
+    The codec knows nothing about arithmetic: the calculator decides which
+    formats it computes (calcPeticion and calcLote in interfacesP4puntoN.c).
+ *******************************************************************************/
+
+#ifndef _APP_FRAME_H
+#define _APP_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum
+{
+    /* int32_t */
+    APP_FRAME_INT32 = 0,
+
+    /* IEEE 754 single precision */
+    APP_FRAME_FLOAT32,
+
+    /* int64_t in units of 10^-APP_FRAME_DECIMALS */
+    APP_FRAME_DECIMAL
+
+} APP_FRAME_FORMAT;
+
+/* Decimal places of an APP_FRAME_DECIMAL on the wire */
+#define APP_FRAME_DECIMALS              6
+
+typedef enum
+{
+    APP_FRAME_OK = 0,
+
+    /* An operand or the result does not fit, the result is 0 */
+    APP_FRAME_OVERFLOW,
+
+    /* b was 0. The result is -1, as the keystroke protocol prints it */
+    APP_FRAME_DIV_ZERO,
+
+    /* An op or format this device does not compute, the result is 0 */
+    APP_FRAME_UNSUPPORTED,
+
+    /* len did not match the format, the result is 0 */
+    APP_FRAME_MALFORMED
+
+} APP_FRAME_STATUS;
+
+/* Set in the low nibble of op and stat by bulk requests and responses */
+#define APP_FRAME_BULK                  0x08
+
+/* A DECIMAL result of a bulk request that does not fit */
+#define APP_FRAME_DECIMAL_OVERFLOW      INT64_MIN
+
+/* Longest request and response frames, len byte included */
+#define APP_FRAME_REQUEST_MAX           (1 + 3 + 2 * 8)
+#define APP_FRAME_RESPONSE_MAX          (1 + 3 + 8)
+
+typedef union
+{
+    int32_t i;
+    float f;
+    int64_t d;
+
+} APP_FRAME_VALUE;
+
+typedef struct
+{
+    uint16_t id;
+
+    /* 0 +, 1 -, 2 *, 3 / */
+    uint8_t op;
+    uint8_t format;
+
+    /* APP_FRAME_OK, or why the frame cannot be computed */
+    uint8_t status;
+
+    /* A bulk request of count operands, b is the scalar and a unused */
+    bool bulk;
+    uint32_t count;
+
+    APP_FRAME_VALUE a;
+    APP_FRAME_VALUE b;
+
+} APP_FRAME_REQUEST;
+
+/* A request that arrived split over several reads is put together here,
+ * and so is an operand of a bulk request */
+typedef struct
+{
+    uint8_t frame[APP_FRAME_REQUEST_MAX];
+    size_t length;
+
+    /* Operands of the last bulk request not taken yet, width bytes each */
+    uint32_t operands;
+    uint8_t width;
+    uint8_t element[8];
+    uint8_t elementLength;
+
+} APP_FRAME_DECODER;
+
+// *****************************************************************************
+/* Function:
+    void APP_FRAME_Initialize(APP_FRAME_DECODER * decoder)
+
+  Summary:
+    Drops any partial frame; the next byte starts a new one.
+*/
+
+void APP_FRAME_Initialize(APP_FRAME_DECODER * decoder);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FRAME_Decode(APP_FRAME_DECODER * decoder, const uint8_t * data,
+                            size_t length, APP_FRAME_REQUEST * request,
+                            bool * ready)
+
+  Summary:
+    Takes bytes of the request stream, up to the end of the current frame,
+    and returns how many it took.  *ready tells whether that completed a
+    request, which is then in *request.
+
+  Remarks:
+    Takes at least one byte whenever length is not 0.  A frame that lies
+    whole in data is decoded in place, without copying.  Not to be called
+    while decoder->operands is not 0: those bytes go to
+    APP_FRAME_Operands().
+*/
+
+size_t APP_FRAME_Decode(APP_FRAME_DECODER * decoder, const uint8_t * data,
+        size_t length, APP_FRAME_REQUEST * request, bool * ready);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FRAME_Encode(uint8_t * frame, uint16_t id, unsigned status,
+                            unsigned format, const APP_FRAME_VALUE * result)
+
+  Summary:
+    Writes a response frame, APP_FRAME_RESPONSE_MAX bytes at most, and
+    returns its length.
+
+  Remarks:
+    An unknown format gets a response without result bytes.
+*/
+
+size_t APP_FRAME_Encode(uint8_t * frame, uint16_t id, unsigned status,
+        unsigned format, const APP_FRAME_VALUE * result);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FRAME_Operands(APP_FRAME_DECODER * decoder, const uint8_t * data,
+                              size_t length, size_t maxCount,
+                              const uint8_t ** operands, size_t * count)
+
+  Summary:
+    Takes operands of the pending bulk request, maxCount at most, and
+    returns how many bytes it took.  *count operands of decoder->width bytes
+    are then at *operands.
+
+  Remarks:
+    The operands are left where they are in data, without copying; only
+    one split over two reads is put together in the decoder, and that one
+    comes alone.  *count may be 0 when data ends inside an operand.
+    maxCount must not be 0.
+*/
+
+size_t APP_FRAME_Operands(APP_FRAME_DECODER * decoder, const uint8_t * data,
+        size_t length, size_t maxCount, const uint8_t ** operands, size_t * count);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FRAME_EncodeBulk(uint8_t * frame, uint16_t id, unsigned status,
+                                unsigned format, uint32_t count)
+
+  Summary:
+    Writes the response header of a bulk request, APP_FRAME_RESPONSE_MAX
+    bytes at most, and returns its length.  The count results follow it.
+*/
+
+size_t APP_FRAME_EncodeBulk(uint8_t * frame, uint16_t id, unsigned status,
+        unsigned format, uint32_t count);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_FRAME_Width(unsigned format)
+
+  Summary:
+    Bytes of an operand or result of format, 0 if the format is unknown.
+*/
+
+size_t APP_FRAME_Width(unsigned format);
+
+#endif /* _APP_FRAME_H */
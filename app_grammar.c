@@ -0,0 +1,136 @@
+/*******************************************************************************
+  Grammar Blob
+
+  File Name:
+    app_grammar.c
+
+  Summary:
+    Loader and encoder of app_grammar.h.
+
+  Description:
+    The CRC is computed bit by bit: a grammar is loaded once, not per
+    byte, and a table would cost 1 KB of flash.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_grammar.h"
+
+static const uint8_t appGrammarMagic[4] = { 'C', 'A', 'L', 'G' };
+
+uint32_t APP_GRAMMAR_Crc32(const uint8_t * data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    unsigned bit;
+
+    while (length-- > 0)
+    {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+size_t APP_GRAMMAR_Length(const uint8_t * blob, size_t available)
+{
+    if (available < APP_GRAMMAR_LENGTH_NEEDED)
+    {
+        return 0;
+    }
+    return (size_t)blob[8] | ((size_t)blob[9] << 8);
+}
+
+APP_GRAMMAR_STATUS APP_GRAMMAR_Load(APP_GRAMMAR * grammar, const uint8_t * blob,
+        size_t length, const APP_GRAMMAR_RULES * rules)
+{
+    const uint8_t * classes = &blob[APP_GRAMMAR_HEADER_SIZE];
+    const APP_GRAMMAR_STEP * steps;
+    size_t total, count, k;
+    uint32_t crc;
+
+    if (length < APP_GRAMMAR_HEADER_SIZE)
+    {
+        return APP_GRAMMAR_TRUNCATED;
+    }
+    if (memcmp(blob, appGrammarMagic, sizeof(appGrammarMagic)) != 0)
+    {
+        return APP_GRAMMAR_BAD_MAGIC;
+    }
+    if (blob[4] != APP_GRAMMAR_VERSION)
+    {
+        return APP_GRAMMAR_BAD_VERSION;
+    }
+    total = APP_GRAMMAR_Length(blob, length);
+    if (total > length || total != APP_GRAMMAR_SIZE(blob[6], blob[7]))
+    {
+        return APP_GRAMMAR_TRUNCATED;
+    }
+    crc = (uint32_t)blob[total - 4] | ((uint32_t)blob[total - 3] << 8) |
+            ((uint32_t)blob[total - 2] << 16) | ((uint32_t)blob[total - 1] << 24);
+    if (APP_GRAMMAR_Crc32(blob, total - APP_GRAMMAR_CRC_SIZE) != crc)
+    {
+        return APP_GRAMMAR_BAD_CRC;
+    }
+    if (blob[5] != rules->actionSet || blob[6] != rules->states ||
+            blob[7] != rules->classes || blob[10] != rules->actions || blob[11] != 0)
+    {
+        return APP_GRAMMAR_WRONG_SET;
+    }
+
+    for (k = 0; k < 256; k++)
+    {
+        if (classes[k] >= rules->classes)
+        {
+            return APP_GRAMMAR_BAD_CLASS;
+        }
+    }
+
+    /* Two bytes without padding, so the steps map onto the blob as is */
+    steps = (const APP_GRAMMAR_STEP *)&classes[256];
+    count = (size_t)rules->states * rules->classes;
+    for (k = 0; k < count; k++)
+    {
+        if ((steps[k].action >= rules->actions) ||
+                ((steps[k].next >= rules->states) &&
+                 ((steps[k].action >= 32) || !(rules->fixedNext & (1ul << steps[k].action)))))
+        {
+            return APP_GRAMMAR_BAD_STEP;
+        }
+    }
+
+    grammar->classes = classes;
+    grammar->steps = steps;
+    return APP_GRAMMAR_OK;
+}
+
+size_t APP_GRAMMAR_Encode(uint8_t * blob, size_t size, const APP_GRAMMAR * grammar,
+        const APP_GRAMMAR_RULES * rules)
+{
+    size_t total = APP_GRAMMAR_SIZE(rules->states, rules->classes);
+    size_t steps = 2 * (size_t)rules->states * rules->classes;
+    uint32_t crc;
+
+    if (size < total || total > 0xFFFF)
+    {
+        return 0;
+    }
+    memcpy(blob, appGrammarMagic, sizeof(appGrammarMagic));
+    blob[4] = APP_GRAMMAR_VERSION;
+    blob[5] = rules->actionSet;
+    blob[6] = rules->states;
+    blob[7] = rules->classes;
+    blob[8] = (uint8_t)total;
+    blob[9] = (uint8_t)(total >> 8);
+    blob[10] = rules->actions;
+    blob[11] = 0;
+    memcpy(&blob[APP_GRAMMAR_HEADER_SIZE], grammar->classes, 256);
+    memcpy(&blob[APP_GRAMMAR_HEADER_SIZE + 256], grammar->steps, steps);
+    crc = APP_GRAMMAR_Crc32(blob, total - APP_GRAMMAR_CRC_SIZE);
+    blob[total - 4] = (uint8_t)crc;
+    blob[total - 3] = (uint8_t)(crc >> 8);
+    blob[total - 2] = (uint8_t)(crc >> 16);
+    blob[total - 1] = (uint8_t)(crc >> 24);
+    return total;
+}
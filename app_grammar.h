@@ -0,0 +1,168 @@
+/*******************************************************************************
+  Grammar Blob Header File
+
+  File Name:
+    app_grammar.h
+
+  Summary:
+    The calculator's byte classes and transition table as one binary blob.
+
+  Description:
+    A grammar tells the keystroke state machine which class each byte
+    belongs to and, for every state and class, the next state and the
+    action to run.  Packed, little endian:
+
+        offset  size
+        0       4       magic "CALG"
+        4       1       APP_GRAMMAR_VERSION
+        5       1       action set the steps refer to
+        6       1       states
+        7       1       classes
+        8       2       length of the whole blob, CRC included
+        10      1       actions of the set
+        11      1       0
+        12      256     class of every byte value, 0 = invalid
+        268     2*s*c   steps, row after row: next state u8, action u8
+        end     4       CRC-32 (IEEE 802.3) of every byte before it
+
+    Loading checks the blob and points into it: nothing is copied, so a
+    blob linked into flash costs no RAM, and a lookup is the same indexing
+    as in a table compiled in.  The blob must stay where it is for as long
+    as a grammar loaded from it is in use.
+
+    The actions are compiled in.  Each calculator variant numbers its own
+    states, classes and actions, and a blob only loads into the variant
+    whose action set it names (calcGramaticaCarga in interfacesP4puntoN.c).
+ *******************************************************************************/
+
+#ifndef _APP_GRAMMAR_H
+#define _APP_GRAMMAR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define APP_GRAMMAR_VERSION             1
+
+#define APP_GRAMMAR_HEADER_SIZE         12
+#define APP_GRAMMAR_CRC_SIZE            4
+
+/* Bytes a blob needs before its length can be read */
+#define APP_GRAMMAR_LENGTH_NEEDED       10
+
+#define APP_GRAMMAR_SIZE(states, classes) \
+        (APP_GRAMMAR_HEADER_SIZE + 256 + 2 * (states) * (classes) + APP_GRAMMAR_CRC_SIZE)
+
+typedef struct
+{
+    uint8_t next;
+    uint8_t action;
+
+} APP_GRAMMAR_STEP;
+
+typedef struct
+{
+    /* Class of every byte value */
+    const uint8_t * classes;
+
+    /* steps[state * classes + class] */
+    const APP_GRAMMAR_STEP * steps;
+
+} APP_GRAMMAR;
+
+typedef struct
+{
+    uint8_t actionSet;
+    uint8_t states;
+    uint8_t classes;
+    uint8_t actions;
+
+    /* Bit n set: action n picks the next state itself, so the step's next
+     * state may be anything */
+    uint32_t fixedNext;
+
+} APP_GRAMMAR_RULES;
+
+typedef enum
+{
+    APP_GRAMMAR_OK = 0,
+
+    /* Shorter than its header or than the length it gives */
+    APP_GRAMMAR_TRUNCATED,
+
+    APP_GRAMMAR_BAD_MAGIC,
+    APP_GRAMMAR_BAD_VERSION,
+    APP_GRAMMAR_BAD_CRC,
+
+    /* Another action set, or as many states, classes or actions as it
+     * does not have */
+    APP_GRAMMAR_WRONG_SET,
+
+    /* A byte whose class is not below the class count */
+    APP_GRAMMAR_BAD_CLASS,
+
+    /* An action out of the set, or a next state out of the table */
+    APP_GRAMMAR_BAD_STEP
+
+} APP_GRAMMAR_STATUS;
+
+// *****************************************************************************
+/* Function:
+    uint32_t APP_GRAMMAR_Crc32(const uint8_t * data, size_t length)
+
+  Summary:
+    CRC-32 of the IEEE 802.3, the one of zlib and PNG.
+*/
+
+uint32_t APP_GRAMMAR_Crc32(const uint8_t * data, size_t length);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_GRAMMAR_Length(const uint8_t * blob, size_t available)
+
+  Summary:
+    The length a blob's header gives, 0 while fewer than
+    APP_GRAMMAR_LENGTH_NEEDED bytes of it are available.
+
+  Remarks:
+    For a blob that arrives in pieces; nothing else is checked.
+*/
+
+size_t APP_GRAMMAR_Length(const uint8_t * blob, size_t available);
+
+// *****************************************************************************
+/* Function:
+    APP_GRAMMAR_STATUS APP_GRAMMAR_Load(APP_GRAMMAR * grammar,
+                                        const uint8_t * blob, size_t length,
+                                        const APP_GRAMMAR_RULES * rules)
+
+  Summary:
+    Checks a blob against the rules of an action set and points grammar
+    at its tables.
+
+  Description:
+    After APP_GRAMMAR_OK every byte has a class below rules->classes, every
+    step an action below rules->actions and a next state below
+    rules->states unless its action is one of rules->fixedNext, so a
+    lookup needs no bounds checks.  On any other status grammar is left as
+    it was.  length may go past the end of the blob, as a flash page
+    does.
+*/
+
+APP_GRAMMAR_STATUS APP_GRAMMAR_Load(APP_GRAMMAR * grammar, const uint8_t * blob,
+        size_t length, const APP_GRAMMAR_RULES * rules);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_GRAMMAR_Encode(uint8_t * blob, size_t size,
+                              const APP_GRAMMAR * grammar,
+                              const APP_GRAMMAR_RULES * rules)
+
+  Summary:
+    Packs grammar, whose tables have the shape of rules, into a blob and
+    returns its length, 0 if size is too small.
+*/
+
+size_t APP_GRAMMAR_Encode(uint8_t * blob, size_t size, const APP_GRAMMAR * grammar,
+        const APP_GRAMMAR_RULES * rules);
+
+#endif /* _APP_GRAMMAR_H */
@@ -0,0 +1,84 @@
+/*******************************************************************************
+  Performance Counters
+
+  File Name:
+    app_perf.c
+
+  Summary:
+    Power of two histograms and their text report, see app_perf.h.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_perf.h"
+#include "app_format.h"
+
+/* The name, truncated to 8 characters */
+static size_t appPerfName(char * buffer, const char * name)
+{
+    size_t length = strlen(name);
+
+    if (length > 8)
+    {
+        length = 8;
+    }
+    memcpy(buffer, name, length);
+    return length;
+}
+
+void APP_PERF_Clear(APP_PERF_HIST * hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+void APP_PERF_Add(APP_PERF_HIST * hist, uint32_t value)
+{
+    unsigned bits = (value == 0) ? 0 : 32 - (unsigned)__builtin_clz(value);
+
+    if (bits >= APP_PERF_BUCKETS)
+    {
+        bits = APP_PERF_BUCKETS - 1;
+    }
+    hist->bucket[bits]++;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max)
+    {
+        hist->max = value;
+    }
+}
+
+size_t APP_PERF_Format(char * buffer, const char * name, const APP_PERF_HIST * hist)
+{
+    size_t length = appPerfName(buffer, name);
+    unsigned used = APP_PERF_BUCKETS, k;
+
+    while (used > 0 && hist->bucket[used - 1] == 0)
+    {
+        used--;
+    }
+    buffer[length++] = ' ';
+    length += APP_FORMAT_Unsigned(&buffer[length], hist->count);
+    buffer[length++] = ' ';
+    length += APP_FORMAT_Unsigned(&buffer[length], hist->count ? (uint32_t)(hist->sum / hist->count) : 0);
+    buffer[length++] = ' ';
+    length += APP_FORMAT_Unsigned(&buffer[length], hist->max);
+    for (k = 0; k < used; k++)
+    {
+        buffer[length++] = (k == 0) ? ' ' : ',';
+        length += APP_FORMAT_Unsigned(&buffer[length], hist->bucket[k]);
+    }
+    buffer[length++] = '\r';
+    buffer[length++] = '\n';
+    return length;
+}
+
+size_t APP_PERF_FormatCount(char * buffer, const char * name, uint32_t value)
+{
+    size_t length = appPerfName(buffer, name);
+
+    buffer[length++] = ' ';
+    length += APP_FORMAT_Unsigned(&buffer[length], value);
+    buffer[length++] = '\r';
+    buffer[length++] = '\n';
+    return length;
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+  Performance Counters Header File
+
+  File Name:
+    app_perf.h
+
+  Summary:
+    Fixed size histograms for timing samples and their text report.
+
+  Description:
+    A histogram keeps the number of samples, their sum and maximum and a
+    count per power of two: bucket k takes the samples that need k bits, so
+    bucket 0 holds the zeros, bucket 1 the ones, bucket 2 holds 2..3, bucket
+    3 holds 4..7 and the last bucket everything from there up.  Adding a
+    sample costs a count-leading-zeros and four increments, no division, and
+    the memory never grows.
+
+    The module does not read any clock.  Samples are differences of
+    whatever time stamp the caller uses (the core timer on the device), and
+    the report prints them in those units.
+ *******************************************************************************/
+
+#ifndef _APP_PERF_H
+#define _APP_PERF_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Buckets per histogram, the last one is open ended */
+#ifndef APP_PERF_BUCKETS
+#define APP_PERF_BUCKETS                20
+#endif
+
+/* Longest lines APP_PERF_Format() and APP_PERF_FormatCount() write, an 8
+ * character name included */
+#define APP_PERF_LINE_MAX               (8 + 3 * 11 + APP_PERF_BUCKETS * 11 + 2)
+#define APP_PERF_COUNT_LINE_MAX         (8 + 11 + 2)
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t bucket[APP_PERF_BUCKETS];
+
+} APP_PERF_HIST;
+
+// *****************************************************************************
+/* Function:
+    void APP_PERF_Clear(APP_PERF_HIST * hist)
+
+  Summary:
+    Forgets every sample.
+*/
+
+void APP_PERF_Clear(APP_PERF_HIST * hist);
+
+// *****************************************************************************
+/* Function:
+    void APP_PERF_Add(APP_PERF_HIST * hist, uint32_t value)
+
+  Summary:
+    Adds one sample.
+*/
+
+void APP_PERF_Add(APP_PERF_HIST * hist, uint32_t value);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_PERF_Format(char * buffer, const char * name,
+                           const APP_PERF_HIST * hist)
+
+  Summary:
+    Writes "name count avg max b0,b1,..." and a CR LF into buffer and
+    returns its length.
+
+  Remarks:
+    Trailing empty buckets are left out.  buffer needs APP_PERF_LINE_MAX
+    bytes for names of up to 8 characters; nothing is NUL terminated.
+*/
+
+size_t APP_PERF_Format(char * buffer, const char * name, const APP_PERF_HIST * hist);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_PERF_FormatCount(char * buffer, const char * name,
+                                uint32_t value)
+
+  Summary:
+    Writes "name value" and a CR LF, for plain counters.
+*/
+
+size_t APP_PERF_FormatCount(char * buffer, const char * name, uint32_t value);
+
+#endif /* _APP_PERF_H */
@@ -0,0 +1,1660 @@
+/*******************************************************************************
+  USB CDC Port Layer
+
+  File Name:
+    app_port.c
+
+  Summary:
+    The MPLAB Harmony application of both calculators: USB device events,
+    the switch and LEDs, and the read, parse and write pipeline of every
+    CDC port.
+
+  Description:
+    A port's calculator is only reached through the calc* entry points
+    listed in app_port.h, so this file is the same for punto1 and punto2
+    and interfacesP4puntoN.c keeps just the calculator.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files 
+// *****************************************************************************
+// *****************************************************************************
+
+#include "app.h"
+#include "app_port.h"
+#include "app_event.h"
+#include "app_debounce.h"
+#include "app_perf.h"
+#include "app_frame.h"
+#include "app_bulk.h"
+#include "app_stream.h"
+#include <string.h>
+
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global Data Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+uint8_t CACHE_ALIGN switchPromptUSB[] = "\r\nPUSH BUTTON PRESSED";
+
+/* Number of CDC instances served. Each one is a separate COM port on the
+ * host with its own calculator, so several processes can submit
+ * expressions at the same time. Port n is USB_DEVICE_CDC_INDEX_n. */
+#ifndef APP_CDC_PORTS
+#define APP_CDC_PORTS USB_DEVICE_CDC_INSTANCES_NUMBER
+#endif
+
+/* Port that gets the switch prompt and drives the board LEDs */
+#define APP_CONSOLE_PORT USB_DEVICE_CDC_INDEX_0
+
+/* Number of CDC reads kept queued with the driver per port. While
+ * APP_Tasks parses one buffer the next transfer is already in flight. A
+ * parsed buffer stays out of the queue until its echo has been sent, two
+ * more cover the time that takes. */
+#define APP_READ_QUEUE_DEPTH 4
+
+uint8_t CACHE_ALIGN cdcReadBuffer[APP_CDC_PORTS][APP_READ_QUEUE_DEPTH][APP_READ_BUFFER_SIZE];
+
+/* Largest chunk handed to USB_DEVICE_CDC_Write, one full speed bulk packet */
+#define APP_WRITE_PACKET_SIZE 64
+
+/* Short output pieces of a port are copied here to leave as one packet */
+uint8_t CACHE_ALIGN cdcWriteBuffer[APP_CDC_PORTS][APP_WRITE_PACKET_SIZE];
+
+/* Parsing pauses while the TX ring has less room than the longest single
+ * write of the calculator (CALC_SALIDA_MAX, a formatted result), so no
+ * output is ever dropped. The rest of the read buffer is parsed once the
+ * writer stage has made room. */
+#define APP_TX_RESERVE CALC_SALIDA_MAX
+
+/* Binary mode: a port whose host sets this bit rate with SET_LINE_CODING
+ * takes request frames instead of keystrokes, see app_frame.h. No
+ * terminal asks for it; any other rate goes back to keystrokes. */
+#define APP_FRAME_DTE_RATE 314159
+
+/* Streaming mode: at this bit rate a port takes a stream of numbers in
+ * text, keeps their count, sum, min, max and mean and only answers when
+ * the host sends '?', see app_stream.h. */
+#define APP_STREAM_DTE_RATE 271828
+
+/* Grammar upload: at this bit rate a port takes grammar blobs, see
+ * app_grammar.h, and answers each one with "grammar ok" or "grammar
+ * error n", n the APP_GRAMMAR_STATUS. Once the host goes back to
+ * keystrokes the port's calculator steps with the last blob that loaded. */
+#define APP_GRAMMAR_DTE_RATE 161803
+
+/* Event driven loop: the USB callbacks post events and APP_Tasks idles the
+ * core while there are none, instead of polling every port on every pass.
+ * Needs the USB driver in interrupt mode. */
+#ifndef APP_EVENT_MODE
+#define APP_EVENT_MODE 0
+#endif
+
+/* Instrumentation: core timer histograms of the hot paths (state dwell
+ * times, per byte parse cost, response latency), dumped as text on the
+ * port that sends APP_PERF_DUMP_CHAR. Costs two timer reads per parse
+ * step, so it is off unless asked for. */
+#ifndef APP_PERF
+#define APP_PERF 0
+#endif
+
+/* The switch is sampled every APP_SWITCH_PERIOD_MS and has to read the same
+ * for APP_SWITCH_DEBOUNCE_MS before a press or release counts. The sample
+ * tick comes from a periodic system timer callback, which keeps running
+ * while the bus is suspended. APP_SWITCH_TICK_SOF=1 paces it with USB
+ * frames instead, for configurations without the timer service. */
+#define APP_SWITCH_PERIOD_MS 5
+#define APP_SWITCH_DEBOUNCE_MS 150
+
+#ifndef APP_SWITCH_TICK_SOF
+#define APP_SWITCH_TICK_SOF 0
+#endif
+
+/* Results a port's calculator prints are copied into that port's ring */
+APP_TXRING CACHE_ALIGN appTxRing[APP_CDC_PORTS];
+
+/* Everything a port sends, in order. The echo is never copied: its spans
+ * point into cdcReadBuffer, which is why a read buffer is only queued
+ * again once none of them refers to it. */
+APP_TXSPAN appTxSpan[APP_CDC_PORTS];
+
+#if CALC_CACHE
+/* Results already printed, shared by every port: clients tend to send the
+ * same expressions. hits and misses are the counters to watch */
+APP_RCACHE appResultCache;
+#endif
+
+/* Spans a single calcStepRef can add: its echo and a result */
+#define APP_TX_SPAN_RESERVE 2
+
+/* Push buttons, one so far: the board switch */
+APP_DEBOUNCE appInputs;
+int appSwitchInput = -1;
+
+/* Sample ticks posted by the timer (or SOF) and taken by APP_Tasks */
+volatile uint32_t appSwitchTicks = 0;
+uint32_t appSwitchTicksSeen = 0;
+
+#if APP_SWITCH_TICK_SOF
+/* Frames per sample tick, set from the bus speed when configured */
+unsigned int appSofPerTick = APP_SWITCH_PERIOD_MS;
+unsigned int appSofCount = 0;
+#else
+SYS_TMR_HANDLE appSwitchTimer = SYS_TMR_HANDLE_INVALID;
+#endif
+
+/* Bus speed, read once when the device gets configured */
+USB_SPEED appUsbSpeed = USB_SPEED_ERROR;
+
+/* Loop statistics and response latency, see app_event.h */
+APP_EVENT_STATS appEventStats;
+
+#if APP_EVENT_MODE
+/* Posted by the USB callbacks, taken by APP_Tasks */
+APP_EVENT_QUEUE appEvents;
+
+/* Steps a port may take in one pass before the next port is served */
+#define APP_EVENT_PORT_STEPS 8
+
+/* Bit n stands for port n */
+#define APP_PORTS_ALL ((1u << APP_CDC_PORTS) - 1u)
+
+#define APP_EVENT_POST(type, port) APP_EVENT_Post(&appEvents, (type), (port))
+#else
+#define APP_EVENT_POST(type, port)
+#endif
+
+#if APP_PERF
+/* Ctrl-T, as the BSD status key. The calculator ignores it anyway, so it
+ * is taken out of the stream without touching the expression in progress */
+#define APP_PERF_DUMP_CHAR 0x14
+
+/* Room for the report of one port */
+#ifndef APP_PERF_REPORT_SIZE
+#define APP_PERF_REPORT_SIZE 1024
+#endif
+
+/* Values of APP_STATES */
+#define APP_PERF_STATES (APP_STATE_ERROR + 1)
+
+/* Histograms in the report: both state sets, step, digits and latency */
+#define APP_PERF_LINES (2 * APP_PERF_STATES + 3)
+
+/* Plain counters after them: dropped bytes, then cache hits and misses */
+#if CALC_CACHE
+#define APP_PERF_COUNTS 3
+#else
+#define APP_PERF_COUNTS 1
+#endif
+
+// *****************************************************************************
+/* Performance Counters
+
+  Summary:
+    Histograms of the hot paths, in core timer counts.
+
+  Description:
+    task and port hold how long appData.state and the port pipelines stayed
+    in each state, taken when the state is left. step is the cost of one
+    calcStepRef, digits the cost per byte of a calcDigitos run. latency
+    runs from a read completion to the write that answers it, like
+    appEventStats. Bytes the calculators could not queue are counted by
+    the span lists.
+*/
+
+typedef struct
+{
+    APP_PERF_HIST task[APP_PERF_STATES];
+    APP_PERF_HIST port[APP_PERF_STATES];
+    APP_PERF_HIST step;
+    APP_PERF_HIST digits;
+    APP_PERF_HIST latency;
+    uint32_t taskStamp;
+} APP_PERF_COUNTERS;
+
+APP_PERF_COUNTERS appPerf;
+
+/* The report is referenced from the span list, not copied */
+uint8_t CACHE_ALIGN appPerfReport[APP_CDC_PORTS][APP_PERF_REPORT_SIZE];
+
+#define APP_PERF_NOW() _CP0_GET_COUNT()
+#define APP_PERF_ADD(hist, value) APP_PERF_Add(&appPerf.hist, (value))
+#else
+#define APP_PERF_NOW() 0
+#define APP_PERF_ADD(hist, value)
+#endif
+
+
+// *****************************************************************************
+/* Application Data
+
+  Summary:
+    Holds application data
+
+  Description:
+    This structure holds the application's data.
+
+  Remarks:
+    This structure should be initialized by the APP_Initialize function.
+    
+    Application strings and buffers are be defined outside this structure.
+*/
+
+APP_DATA appData;
+
+
+// *****************************************************************************
+/* Read Queue
+
+  Summary:
+    Tracks the CDC reads queued with the driver.
+
+  Description:
+    Reads complete in the order they were queued, so three free running
+    counters are enough: reads queued, reads completed (advanced by the CDC
+    event handler) and buffers already parsed. Read n lands in
+    cdcReadBuffer[n % APP_READ_QUEUE_DEPTH].
+*/
+
+typedef struct
+{
+    uint32_t numBytesRead[APP_READ_QUEUE_DEPTH];
+    uint32_t parsePos;
+    unsigned int queued;
+    volatile unsigned int completed;
+    unsigned int parsed;
+} APP_READ_QUEUE;
+
+
+// *****************************************************************************
+/* Port Protocols
+
+  Summary:
+    What the bytes a port reads are, picked by the bit rate of SET LINE
+    CODING.
+*/
+
+typedef enum
+{
+    /* Calculator keystrokes, echoed */
+    APP_PROTOCOL_KEYSTROKES = 0,
+
+    /* Request frames, at APP_FRAME_DTE_RATE */
+    APP_PROTOCOL_FRAMES,
+
+    /* Samples to aggregate, at APP_STREAM_DTE_RATE */
+    APP_PROTOCOL_STREAM,
+
+    /* Grammar blobs, at APP_GRAMMAR_DTE_RATE */
+    APP_PROTOCOL_GRAMMAR
+
+} APP_PROTOCOL;
+
+// *****************************************************************************
+/* CDC Port
+
+  Summary:
+    Holds the state of one CDC instance.
+
+  Description:
+    appData keeps what belongs to the device as a whole: device handle,
+    configuration, line coding and the switch. Everything that belongs to a
+    single COM port lives here: the state of its read/parse/write pipeline,
+    its transfer handles, its read queue and the calculator session fed
+    from it. Its buffers are cdcReadBuffer[index], appTxRing[index] and
+    appTxSpan[index].
+
+  Remarks:
+    txInFlight bytes at the tail of the span list belong to the CDC driver
+    until the write completes. readStamp is when the oldest read still
+    waiting for an answer completed. protocolWanted is the protocol the
+    host asked for last, and it applies from the read numbered
+    protocolFrom on. bulk is the bulk request whose operands are still
+    arriving, its status that of its response header. stream and flujo
+    are the scanner and aggregates of the streaming protocol.
+    grammarReceived bytes of a blob have been uploaded to
+    appGrammarBlob[index]; grammar points into the last one that loaded,
+    if grammarLoaded.
+    With APP_PERF, perfStamp is when the pipeline entered its current
+    state and perfDump is a report request not served yet.
+*/
+
+typedef struct
+{
+    USB_DEVICE_CDC_INDEX index;
+    APP_STATES state;
+    USB_DEVICE_CDC_TRANSFER_HANDLE readTransferHandle;
+    USB_DEVICE_CDC_TRANSFER_HANDLE writeTransferHandle;
+    volatile bool isWriteComplete;
+    size_t txInFlight;
+    volatile bool responsePending;
+    volatile uint32_t readStamp;
+    APP_READ_QUEUE readQueue;
+    CALC_SESSION calc;
+    APP_PROTOCOL protocol;
+    volatile APP_PROTOCOL protocolWanted;
+    volatile unsigned int protocolFrom;
+    APP_FRAME_DECODER frames;
+    APP_FRAME_REQUEST bulk;
+    APP_STREAM_SCANNER stream;
+    CALC_FLUJO flujo;
+    APP_GRAMMAR grammar;
+    bool grammarLoaded;
+    size_t grammarReceived;
+#if APP_PERF
+    uint32_t perfStamp;
+    bool perfDump;
+#endif
+} APP_PORT;
+
+APP_PORT appPort[APP_CDC_PORTS];
+
+/* Uploaded grammars are used where they are, not copied */
+uint8_t appGrammarBlob[APP_CDC_PORTS][CALC_GRAMATICA_LARGO];
+
+static const char appGrammarOk[] = "grammar ok\r";
+static const char appGrammarError[] = "grammar error ";
+
+/* Port the scheduler services first on the next pass of APP_Tasks */
+unsigned int appPortNext = 0;
+
+#if APP_EVENT_MODE
+/* Ports that still had work at the end of the last pass */
+uint32_t appPortDirty = 0;
+#endif
+
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Application Callback Functions
+// *****************************************************************************
+// *****************************************************************************
+
+
+
+/*******************************************************
+ * USB CDC Device Events - Application Event Handler
+ *******************************************************/
+
+USB_DEVICE_CDC_EVENT_RESPONSE APP_USBDeviceCDCEventHandler
+(
+    USB_DEVICE_CDC_INDEX index,
+    USB_DEVICE_CDC_EVENT event,
+    void * pData,
+    uintptr_t userData
+)
+{
+    APP_DATA * appDataObject;
+    APP_PORT * port;
+    USB_CDC_CONTROL_LINE_STATE * controlLineStateData;
+    USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE * eventDataRead;
+    
+    appDataObject = (APP_DATA *)userData;
+
+    /* The line coding is shared, the data path is per port */
+    if(index >= APP_CDC_PORTS)
+    {
+        return USB_DEVICE_CDC_EVENT_RESPONSE_NONE;
+    }
+    port = &appPort[index];
+
+    switch(event)
+    {
+        case USB_DEVICE_CDC_EVENT_GET_LINE_CODING:
+
+            /* This means the host wants to know the current line
+             * coding. This is a control transfer request. Use the
+             * USB_DEVICE_ControlSend() function to send the data to
+             * host.  */
+
+            USB_DEVICE_ControlSend(appDataObject->deviceHandle,
+                    &appDataObject->getLineCodingData, sizeof(USB_CDC_LINE_CODING));
+
+            break;
+
+        case USB_DEVICE_CDC_EVENT_SET_LINE_CODING:
+
+            /* This means the host wants to set the line coding.
+             * This is a control transfer request. Use the
+             * USB_DEVICE_ControlReceive() function to receive the
+             * data from the host */
+
+            USB_DEVICE_ControlReceive(appDataObject->deviceHandle,
+                    &appDataObject->setLineCodingData, sizeof(USB_CDC_LINE_CODING));
+
+            break;
+
+        case USB_DEVICE_CDC_EVENT_SET_CONTROL_LINE_STATE:
+
+            /* This means the host is setting the control line state.
+             * Read the control line state. We will accept this request
+             * for now. */
+
+            controlLineStateData = (USB_CDC_CONTROL_LINE_STATE *)pData;
+            appDataObject->controlLineStateData.dtr = controlLineStateData->dtr;
+            appDataObject->controlLineStateData.carrier = controlLineStateData->carrier;
+
+            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
+
+            break;
+
+        case USB_DEVICE_CDC_EVENT_SEND_BREAK:
+
+            /* This means that the host is requesting that a break of the
+             * specified duration be sent. Read the break duration */
+
+            appDataObject->breakData = ((USB_DEVICE_CDC_EVENT_DATA_SEND_BREAK *)pData)->breakDuration;
+            
+            /* Complete the control transfer by sending a ZLP  */
+            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
+            
+            break;
+
+        case USB_DEVICE_CDC_EVENT_READ_COMPLETE:
+
+            /* This means that the host has sent some data*/
+            eventDataRead = (USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE *)pData;
+            
+            /* Reads complete in the order they were queued. A failed read
+             * hands its buffer back empty so the slot is reused. */
+            port->readQueue.numBytesRead[port->readQueue.completed % APP_READ_QUEUE_DEPTH] =
+                    (eventDataRead->status != USB_DEVICE_CDC_RESULT_ERROR) ? eventDataRead->length : 0;
+            port->readQueue.completed++;
+
+            /* The response time starts here, unless an earlier read is
+             * still waiting for its answer */
+            if(!port->responsePending)
+            {
+                port->readStamp = _CP0_GET_COUNT();
+                port->responsePending = true;
+            }
+            APP_EVENT_POST(APP_EVENT_READ, index);
+            break;
+
+        case USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_RECEIVED:
+
+            /* The data stage of the last control transfer is
+             * complete. For now we accept all the data. Only SET LINE
+             * CODING has one: its bit rate picks the protocol of the
+             * reads that complete from now on */
+
+            switch(appDataObject->setLineCodingData.dwDTERate)
+            {
+                case APP_FRAME_DTE_RATE:
+                    port->protocolWanted = APP_PROTOCOL_FRAMES;
+                    break;
+                case APP_STREAM_DTE_RATE:
+                    port->protocolWanted = APP_PROTOCOL_STREAM;
+                    break;
+                case APP_GRAMMAR_DTE_RATE:
+                    port->protocolWanted = APP_PROTOCOL_GRAMMAR;
+                    break;
+                default:
+                    port->protocolWanted = APP_PROTOCOL_KEYSTROKES;
+                    break;
+            }
+            port->protocolFrom = port->readQueue.completed;
+
+            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
+            break;
+
+        case USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_SENT:
+
+            /* This means the GET LINE CODING function data is valid. We don't
+             * do much with this data in this demo. */
+            break;
+
+        case USB_DEVICE_CDC_EVENT_WRITE_COMPLETE:
+
+            /* This means that the data write got completed. The writer
+             * stage of this port can send the next chunk. */
+
+            port->isWriteComplete = true;
+            APP_EVENT_POST(APP_EVENT_WRITE, index);
+            break;
+
+        default:
+            break;
+    }
+
+    return USB_DEVICE_CDC_EVENT_RESPONSE_NONE;
+}
+
+/***********************************************
+ * Application USB Device Layer Event Handler.
+ ***********************************************/
+void APP_USBDeviceEventHandler 
+(
+    USB_DEVICE_EVENT event, 
+    void * eventData, 
+    uintptr_t context 
+)
+{
+    USB_DEVICE_EVENT_DATA_CONFIGURED *configuredEventData;
+    USB_DEVICE_CDC_INDEX index;
+
+    switch(event)
+    {
+        case USB_DEVICE_EVENT_SOF:
+
+#if APP_SWITCH_TICK_SOF
+            /* Frames pace the switch samples */
+            if(++appSofCount >= appSofPerTick)
+            {
+                appSofCount = 0;
+                appSwitchTicks++;
+            }
+#endif
+            break;
+
+        case USB_DEVICE_EVENT_RESET:
+
+            /* Update LED to show reset state */
+            LED_Off();
+
+            appData.isConfigured = false;
+            APP_EVENT_POST(APP_EVENT_DEVICE, 0);
+
+            break;
+
+        case USB_DEVICE_EVENT_CONFIGURED:
+
+            /* Check the configuration. We only support configuration 1 */
+            configuredEventData = (USB_DEVICE_EVENT_DATA_CONFIGURED*)eventData;
+            
+            if ( configuredEventData->configurationValue == 1)
+            {
+                /* Update LED to show configured state */
+                LED_On();
+                
+                /* Register the CDC Device application event handler of
+                 * every port here. Note how the appData object pointer is
+                 * passed as the user data */
+
+                for(index = 0; index < APP_CDC_PORTS; index++)
+                {
+                    USB_DEVICE_CDC_EventHandlerSet(index, APP_USBDeviceCDCEventHandler, (uintptr_t)&appData);
+                }
+
+                /* The speed does not change until the next reset */
+                appUsbSpeed = USB_DEVICE_ActiveSpeedGet(appData.deviceHandle);
+#if APP_SWITCH_TICK_SOF
+                appSofPerTick = ((appUsbSpeed == USB_SPEED_HIGH) ? 8 : 1) * APP_SWITCH_PERIOD_MS;
+                appSofCount = 0;
+#endif
+
+                /* Mark that the device is now configured */
+                appData.isConfigured = true;
+                APP_EVENT_POST(APP_EVENT_DEVICE, 0);
+            }
+            
+            break;
+
+        case USB_DEVICE_EVENT_POWER_DETECTED:
+
+            /* VBUS was detected. We can attach the device */
+            USB_DEVICE_Attach(appData.deviceHandle);
+            
+            break;
+
+        case USB_DEVICE_EVENT_POWER_REMOVED:
+            
+            /* VBUS is not available. We can detach the device */
+            USB_DEVICE_Detach(appData.deviceHandle);
+            
+            appData.isConfigured = false;
+            APP_EVENT_POST(APP_EVENT_DEVICE, 0);
+            
+            LED_Off();
+            
+            break;
+
+        case USB_DEVICE_EVENT_SUSPENDED:
+
+            /* Switch LED to show suspended state */
+            LED_Off();
+            
+            break;
+
+        case USB_DEVICE_EVENT_RESUMED:
+        case USB_DEVICE_EVENT_ERROR:
+        default:
+            
+            break;
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Application Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/*****************************************************
+ * Raw level of the board switch, for the debouncer.
+ *****************************************************/
+
+bool APP_SwitchRead(void)
+{
+    return (SWITCH_STATE_PRESSED == SWITCH_Get());
+}
+
+#if !APP_SWITCH_TICK_SOF
+/*****************************************************
+ * System timer callback, every APP_SWITCH_PERIOD_MS.
+ * It only counts, the samples are taken by APP_Tasks.
+ *****************************************************/
+
+void APP_SwitchTick(uintptr_t context, uint32_t currTick)
+{
+    appSwitchTicks++;
+}
+#endif
+
+void APP_ProcessSwitchPress(void)
+{
+    /* This function takes one debounce sample for every tick since the
+     * last call and flags a press of the switch */
+
+    uint32_t ticks = appSwitchTicks;
+
+    /* After a long stall the oldest ticks would only repeat the same level */
+    if((ticks - appSwitchTicksSeen) > (APP_SWITCH_DEBOUNCE_MS / APP_SWITCH_PERIOD_MS))
+    {
+        appSwitchTicksSeen = ticks - (APP_SWITCH_DEBOUNCE_MS / APP_SWITCH_PERIOD_MS);
+    }
+    while(appSwitchTicksSeen != ticks)
+    {
+        APP_DEBOUNCE_Sample(&appInputs);
+        appSwitchTicksSeen++;
+    }
+
+    if(APP_DEBOUNCE_Pressed(&appInputs, appSwitchInput))
+    {
+        /* The switch is pressed flag will be cleared by the application
+         * tasks routine */
+        appData.isSwitchPressed = true;
+    }
+}
+
+/*****************************************************
+ * Puts a port back at the start of its pipeline:
+ * no reads queued, nothing waiting to be sent and
+ * an idle calculator, with no result half printed.
+ *****************************************************/
+
+void APP_PortReset(APP_PORT * port)
+{
+    port->state = APP_STATE_SCHEDULE_READ;
+    port->readTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+    port->writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+    port->isWriteComplete = true;
+    port->readQueue.queued = 0;
+    port->readQueue.completed = 0;
+    port->readQueue.parsed = 0;
+    port->readQueue.parsePos = 0;
+    APP_TXRING_Initialize(&appTxRing[port->index]);
+    APP_TXSPAN_Initialize(&appTxSpan[port->index], &appTxRing[port->index]);
+    port->txInFlight = 0;
+    port->responsePending = false;
+    port->protocol = APP_PROTOCOL_KEYSTROKES;
+    port->protocolWanted = APP_PROTOCOL_KEYSTROKES;
+    port->protocolFrom = 0;
+    APP_FRAME_Initialize(&port->frames);
+    APP_STREAM_Initialize(&port->stream);
+    calcFlujoInicia(&port->flujo);
+    port->grammarReceived = 0;
+    calcSessionInit(&port->calc, &appTxRing[port->index], port->index == APP_CONSOLE_PORT);
+    calcSessionSpans(&port->calc, &appTxSpan[port->index]);
+#if CALC_CACHE
+    calcSessionCache(&port->calc, &appResultCache);
+#endif
+    calcSessionGramatica(&port->calc, port->grammarLoaded ? &port->grammar : NULL);
+#if APP_PERF
+    port->perfStamp = APP_PERF_NOW();
+    port->perfDump = false;
+#endif
+}
+
+/*****************************************************
+ * This function is called in every step of the
+ * application state machine.
+ *****************************************************/
+
+bool APP_StateReset(void)
+{
+    /* This function returns true if the device
+     * was reset  */
+
+    bool retVal;
+    unsigned int n;
+
+    if(appData.isConfigured == false)
+    {
+        appData.state = APP_STATE_WAIT_FOR_CONFIGURATION;
+        appData.readTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+        appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+        appData.isReadComplete = true;
+        appData.isWriteComplete = true;
+        for(n = 0; n < APP_CDC_PORTS; n++)
+        {
+            APP_PortReset(&appPort[n]);
+        }
+        retVal = true;
+    }
+    else
+    {
+        retVal = false;
+    }
+
+    return(retVal);
+}
+
+/*****************************************************
+ * Writer stage. Runs on every visit to a port and
+ * drains its span list one packet at a time, as soon
+ * as the previous write has completed.
+ *****************************************************/
+
+void APP_WriterTasks(APP_PORT * port)
+{
+    APP_TXSPAN * spans = &appTxSpan[port->index];
+    const uint8_t * data;
+    size_t count;
+    uint32_t latency;
+
+    if(port->isWriteComplete == false)
+    {
+        return;
+    }
+
+    /* The driver is done with the last chunk */
+    APP_TXSPAN_Release(spans, port->txInFlight);
+    port->txInFlight = 0;
+
+    /* A piece is sent from where it lies, echo from the read buffer and
+     * results from the ring. USB_DEVICE_CDC_Write takes one buffer, so
+     * short pieces with more behind them (echo cut by results) are copied
+     * into one packet rather than sent one transfer each */
+    count = APP_TXSPAN_Peek(spans, &data, APP_WRITE_PACKET_SIZE);
+    if(count == 0)
+    {
+        return;
+    }
+    if((count < APP_WRITE_PACKET_SIZE) && (APP_TXSPAN_Count(spans) > count))
+    {
+        data = cdcWriteBuffer[port->index];
+        count = APP_TXSPAN_Gather(spans, cdcWriteBuffer[port->index], APP_WRITE_PACKET_SIZE);
+    }
+
+    port->writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+    port->isWriteComplete = false;
+
+    USB_DEVICE_CDC_Write(port->index, &port->writeTransferHandle,
+            data, count, USB_DEVICE_CDC_TRANSFER_FLAGS_DATA_COMPLETE);
+
+    if(port->writeTransferHandle == USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID)
+    {
+        port->isWriteComplete = true;
+        port->state = APP_STATE_ERROR;
+        return;
+    }
+    port->txInFlight = count;
+
+    /* First write since a read completed: that read has its answer */
+    if(port->responsePending)
+    {
+        latency = _CP0_GET_COUNT() - port->readStamp;
+        port->responsePending = false;
+        appEventStats.responses++;
+        appEventStats.latencySum += latency;
+        if(latency > appEventStats.latencyMax)
+        {
+            appEventStats.latencyMax = latency;
+        }
+        APP_PERF_ADD(latency, latency);
+    }
+}
+
+#if APP_PERF
+/*****************************************************
+ * Closes the dwell time sample of a state that was
+ * just left and starts the next one.
+ *****************************************************/
+
+void APP_PerfDwell(APP_PERF_HIST * hist, uint32_t * stamp)
+{
+    uint32_t now = APP_PERF_NOW();
+
+    APP_PERF_Add(hist, now - *stamp);
+    *stamp = now;
+}
+
+/*****************************************************
+ * Queues the counters on a port as text, one line per
+ * histogram that has samples. Returns false while the
+ * port's last report is still being sent.
+ *****************************************************/
+
+bool APP_PerfReport(APP_PORT * port)
+{
+    static const char * const name[APP_PERF_LINES] = {
+        "t.init", "t.config", "t.run", "t.rdwait", "t.write", "t.wrwait", "t.switch", "t.error",
+        "p.init", "p.config", "p.read", "p.rdwait", "p.write", "p.wrwait", "p.switch", "p.error",
+        "step", "digits", "latency" };
+    static const APP_PERF_HIST * const hist[APP_PERF_LINES] = {
+        &appPerf.task[0], &appPerf.task[1], &appPerf.task[2], &appPerf.task[3],
+        &appPerf.task[4], &appPerf.task[5], &appPerf.task[6], &appPerf.task[7],
+        &appPerf.port[0], &appPerf.port[1], &appPerf.port[2], &appPerf.port[3],
+        &appPerf.port[4], &appPerf.port[5], &appPerf.port[6], &appPerf.port[7],
+        &appPerf.step, &appPerf.digits, &appPerf.latency };
+    static const char header[] = "\r\nperf count avg max log2\r\n";
+    APP_TXSPAN * spans = &appTxSpan[port->index];
+    char * report = (char *)appPerfReport[port->index];
+    size_t length = sizeof(header) - 1;
+    uint32_t dropped = 0;
+    unsigned int n;
+
+    if((APP_TXSPAN_Free(spans) == 0) || APP_TXSPAN_Holds(spans, report, APP_PERF_REPORT_SIZE))
+    {
+        return false;
+    }
+
+    /* Histograms that would not fit are left out, the counts always fit */
+    memcpy(report, header, length);
+    for(n = 0; n < APP_PERF_LINES; n++)
+    {
+        if(hist[n]->count &&
+                (length + APP_PERF_LINE_MAX + APP_PERF_COUNTS * APP_PERF_COUNT_LINE_MAX <= APP_PERF_REPORT_SIZE))
+        {
+            length += APP_PERF_Format(&report[length], name[n], hist[n]);
+        }
+    }
+    for(n = 0; n < APP_CDC_PORTS; n++)
+    {
+        dropped += appTxSpan[n].dropped;
+    }
+    length += APP_PERF_FormatCount(&report[length], "dropped", dropped);
+#if CALC_CACHE
+    length += APP_PERF_FormatCount(&report[length], "c.hits", appResultCache.hits);
+    length += APP_PERF_FormatCount(&report[length], "c.misses", appResultCache.misses);
+#endif
+
+    APP_TXSPAN_Reference(spans, report, length);
+    return true;
+}
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Application Initialization and State Machine Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/*******************************************************************************
+  Function:
+    void APP_Initialize(void)
+
+  Remarks:
+    See prototype in app.h.
+ */
+
+void APP_Initialize(void)
+{
+    unsigned int n;
+
+    /* Place the App state machine in its initial state. */
+    appData.state = APP_STATE_INIT;
+    
+    /* Device Layer Handle  */
+    appData.deviceHandle = USB_DEVICE_HANDLE_INVALID ;
+
+    /* Device configured status */
+    appData.isConfigured = false;
+
+    /* Initial get line coding state */
+    appData.getLineCodingData.dwDTERate = 9600;
+    appData.getLineCodingData.bParityType = 0;
+    appData.getLineCodingData.bParityType = 0;
+    appData.getLineCodingData.bDataBits = 8;
+
+    /* Read Transfer Handle */
+    appData.readTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+
+    /* Write Transfer Handle */
+    appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+
+    /* Initialize the read complete flag */
+    appData.isReadComplete = true;
+
+    /*Initialize the write complete flag*/
+    appData.isWriteComplete = true;
+
+    /* To know status of Switch */
+    appData.isSwitchPressed = false;
+
+    /* Debounce the switch, it starts released */
+    APP_DEBOUNCE_Initialize(&appInputs);
+    appSwitchInput = APP_DEBOUNCE_Add(&appInputs, APP_SwitchRead,
+            APP_SWITCH_DEBOUNCE_MS / APP_SWITCH_PERIOD_MS);
+    appSwitchTicksSeen = appSwitchTicks;
+
+    /* Set up the read buffer */
+    appData.cdcReadBuffer = &cdcReadBuffer[0][0][0];
+
+    /* Set up the read buffer */
+    appData.cdcWriteBuffer = &cdcWriteBuffer[0][0];       
+
+    /* Every port idle: no reads queued, nothing to send and its
+     * calculator waiting for '('. Only the console moves the LEDs */
+    for(n = 0; n < APP_CDC_PORTS; n++)
+    {
+        appPort[n].index = n;
+        appPort[n].grammarLoaded = false;
+        APP_PortReset(&appPort[n]);
+    }
+    appPortNext = 0;
+#if CALC_CACHE
+    APP_RCACHE_Initialize(&appResultCache);
+#endif
+
+    memset(&appEventStats, 0, sizeof(appEventStats));
+#if APP_PERF
+    memset(&appPerf, 0, sizeof(appPerf));
+    appPerf.taskStamp = APP_PERF_NOW();
+#endif
+#if APP_EVENT_MODE
+    APP_EVENT_Initialize(&appEvents);
+    appPortDirty = APP_PORTS_ALL;
+#endif
+}
+
+
+/*****************************************************
+ * Binary mode: answers the request frames of a read
+ * buffer from position start on. Returns where it
+ * stopped, short of numBytesRead only while the TX
+ * ring is short of room.
+ *****************************************************/
+
+uint32_t APP_PortFrames(APP_PORT * port, const uint8_t * buffer, uint32_t start, uint32_t numBytesRead)
+{
+    APP_TXRING * ring = &appTxRing[port->index];
+    APP_TXSPAN * spans = &appTxSpan[port->index];
+    APP_FRAME_REQUEST request;
+    APP_FRAME_VALUE result;
+    uint8_t frame[APP_FRAME_RESPONSE_MAX];
+    uint8_t results[APP_BULK_BLOCK * 8];
+    const uint8_t * operands;
+    size_t count, room;
+    uint32_t i = start;
+    uint8_t status;
+    bool ready;
+
+    /* Responses are copied into the ring back to back, the writer sends
+     * as many of them per packet as fit */
+    while((i < numBytesRead) && (APP_TXSPAN_Free(spans) > 0))
+    {
+        if(port->frames.operands > 0)
+        {
+            /* Operands of a bulk request, computed straight from the read
+             * buffer a block at a time; the writer sends one block while
+             * the next is computed */
+            room = APP_TXRING_Free(ring) / port->frames.width;
+            if(room == 0)
+            {
+                break;
+            }
+            i += APP_FRAME_Operands(&port->frames, &buffer[i], numBytesRead - i,
+                    (room < APP_BULK_BLOCK) ? room : APP_BULK_BLOCK, &operands, &count);
+            if(count > 0)
+            {
+                calcLote(&port->bulk, operands, results, count);
+                APP_TXSPAN_Write(spans, results, count * port->frames.width);
+            }
+            continue;
+        }
+        if(APP_TXRING_Free(ring) < APP_FRAME_RESPONSE_MAX)
+        {
+            break;
+        }
+        i += APP_FRAME_Decode(&port->frames, &buffer[i], numBytesRead - i, &request, &ready);
+        if(ready && request.bulk)
+        {
+            port->bulk = request;
+            port->bulk.status = calcLoteEstado(&request);
+            APP_TXSPAN_Write(spans, frame, APP_FRAME_EncodeBulk(frame, request.id,
+                    port->bulk.status, request.format, request.count));
+        }
+        else if(ready)
+        {
+            status = calcPeticion(&request, &result);
+            APP_TXSPAN_Write(spans, frame,
+                    APP_FRAME_Encode(frame, request.id, status, request.format, &result));
+        }
+    }
+    return i;
+}
+
+/*****************************************************
+ * Streaming mode: folds the numbers of a read buffer
+ * from position start on into the port's aggregates.
+ * Returns where it stopped, short of numBytesRead
+ * only while the TX ring has no room for a report.
+ *****************************************************/
+
+uint32_t APP_PortStream(APP_PORT * port, const uint8_t * buffer, uint32_t start, uint32_t numBytesRead)
+{
+    APP_TXRING * ring = &appTxRing[port->index];
+    APP_TXSPAN * spans = &appTxSpan[port->index];
+    APP_STREAM_NUMBER number;
+    APP_STREAM_TOKEN token;
+    char report[CALC_FLUJO_REPORTE_MAX];
+    uint32_t i = start;
+
+    /* Samples only move the accumulators, nothing is written until the
+     * host asks; a report always finds room when its '?' is taken */
+    while((i < numBytesRead) && (APP_TXRING_Free(ring) >= CALC_FLUJO_REPORTE_MAX) &&
+            (APP_TXSPAN_Free(spans) > 0))
+    {
+        i += APP_STREAM_Scan(&port->stream, &buffer[i], numBytesRead - i, &number, &token);
+        switch(token)
+        {
+            case APP_STREAM_SAMPLE:
+                calcFlujoSuma(&port->flujo, &number);
+                break;
+            case APP_STREAM_QUERY:
+                APP_TXSPAN_Write(spans, report, calcFlujoReporte(&port->flujo, report));
+                break;
+            case APP_STREAM_CLEAR:
+                calcFlujoInicia(&port->flujo);
+                break;
+            default:
+                break;
+        }
+    }
+    return i;
+}
+
+/*****************************************************
+ * Grammar upload: gathers the blob that the read
+ * buffers carry and loads it once it is complete.
+ * A length this variant cannot take, shorter than
+ * a header included, ends the blob where it is, and
+ * the rest of the read is dropped since it cannot
+ * be framed. Returns where it
+ * stopped, short of numBytesRead only while the TX
+ * ring has no room for an answer.
+ *****************************************************/
+
+uint32_t APP_PortGrammar(APP_PORT * port, const uint8_t * buffer, uint32_t start, uint32_t numBytesRead)
+{
+    APP_TXRING * ring = &appTxRing[port->index];
+    APP_TXSPAN * spans = &appTxSpan[port->index];
+    uint8_t * blob = appGrammarBlob[port->index];
+    APP_GRAMMAR_STATUS status;
+    char reply[sizeof(appGrammarError) + 1];
+    size_t length, wanted, taken;
+    uint32_t i = start;
+    bool framed;
+
+    while((i < numBytesRead) && (APP_TXRING_Free(ring) >= sizeof(reply)) &&
+            (APP_TXSPAN_Free(spans) > 0))
+    {
+        length = APP_GRAMMAR_Length(blob, port->grammarReceived);
+        framed = (port->grammarReceived >= APP_GRAMMAR_LENGTH_NEEDED);
+        if(!framed)
+        {
+            /* The header, up to the length */
+            wanted = APP_GRAMMAR_LENGTH_NEEDED;
+        }
+        else if((length < APP_GRAMMAR_HEADER_SIZE) || (length <= port->grammarReceived) ||
+                (length > CALC_GRAMATICA_LARGO))
+        {
+            wanted = port->grammarReceived;
+            i = numBytesRead;
+        }
+        else
+        {
+            wanted = length;
+        }
+
+        taken = wanted - port->grammarReceived;
+        if(taken > numBytesRead - i)
+        {
+            taken = numBytesRead - i;
+        }
+        memcpy(&blob[port->grammarReceived], &buffer[i], taken);
+        port->grammarReceived += taken;
+        i += taken;
+
+        if(framed && (port->grammarReceived == wanted))
+        {
+            status = calcGramaticaCarga(&port->grammar, blob, port->grammarReceived);
+            port->grammarLoaded = (status == APP_GRAMMAR_OK);
+            port->grammarReceived = 0;
+            if(status == APP_GRAMMAR_OK)
+            {
+                APP_TXSPAN_Reference(spans, appGrammarOk, sizeof(appGrammarOk) - 1);
+            }
+            else
+            {
+                memcpy(reply, appGrammarError, sizeof(appGrammarError) - 1);
+                reply[sizeof(appGrammarError) - 1] = (char)('0' + status);
+                reply[sizeof(appGrammarError)] = 0x0D;
+                APP_TXSPAN_Write(spans, reply, sizeof(reply));
+            }
+        }
+    }
+    return i;
+}
+
+/******************************************************************************
+  Function:
+    void APP_PortTasks(APP_PORT * port)
+
+  Remarks:
+    One step of a port's read/parse/write pipeline. A step queues reads,
+    checks for completed ones or parses at most one read buffer, so its
+    cost is bounded no matter how busy the port is.
+ */
+
+void APP_PortTasks(APP_PORT * port)
+{
+    APP_TXRING * ring = &appTxRing[port->index];
+    APP_TXSPAN * spans = &appTxSpan[port->index];
+    uint8_t * buffer;
+    uint32_t numBytesRead, i, taken;
+#if APP_PERF
+    APP_STATES state = port->state;
+    uint32_t perfStart;
+#endif
+
+    switch(port->state)
+    {
+        case APP_STATE_SCHEDULE_READ:
+
+            /* Keep every free read buffer queued with the driver, so the
+             * host can send the next packet while we parse this one. A
+             * buffer whose echo has not been sent yet is not free */
+
+            port->state = APP_STATE_WAIT_FOR_READ_COMPLETE;
+            while(((port->readQueue.queued - port->readQueue.parsed) < APP_READ_QUEUE_DEPTH) &&
+                    !APP_TXSPAN_Holds(spans,
+                        cdcReadBuffer[port->index][port->readQueue.queued % APP_READ_QUEUE_DEPTH],
+                        APP_READ_BUFFER_SIZE))
+            {
+                port->readTransferHandle =  USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+
+                USB_DEVICE_CDC_Read (port->index,
+                        &port->readTransferHandle,
+                        cdcReadBuffer[port->index][port->readQueue.queued % APP_READ_QUEUE_DEPTH],
+                        APP_READ_BUFFER_SIZE);
+                
+                if(port->readTransferHandle == USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID)
+                {
+                    port->state = APP_STATE_ERROR;
+                    break;
+                }
+                port->readQueue.queued++;
+            }
+
+            break;
+
+        case APP_STATE_WAIT_FOR_READ_COMPLETE:
+        case APP_STATE_CHECK_SWITCH_PRESSED:
+
+            /* Check if a character was received or, on the console, a
+             * switch was pressed. The read queue gets updated in the CDC
+             * event handler. */
+
+            if((port->readQueue.completed != port->readQueue.parsed) ||
+                    ((port->index == APP_CONSOLE_PORT) && appData.isSwitchPressed))
+            {
+                port->state = APP_STATE_SCHEDULE_WRITE;
+            }
+            else if(((port->readQueue.queued - port->readQueue.parsed) < APP_READ_QUEUE_DEPTH) &&
+                    !APP_TXSPAN_Holds(spans,
+                        cdcReadBuffer[port->index][port->readQueue.queued % APP_READ_QUEUE_DEPTH],
+                        APP_READ_BUFFER_SIZE))
+            {
+                /* A buffer held back for its echo is free now */
+                port->state = APP_STATE_SCHEDULE_READ;
+            }
+
+            break;
+
+
+        case APP_STATE_SCHEDULE_WRITE:
+
+            /* Output is queued in the span list and sent by the writer
+             * stage, so reading resumes right away */
+
+            port->state = APP_STATE_SCHEDULE_READ;
+
+            if((port->index == APP_CONSOLE_PORT) && appData.isSwitchPressed)
+            {
+                /* If the switch was pressed, then send the switch prompt*/
+                appData.isSwitchPressed = false;
+                APP_TXSPAN_Reference(spans, switchPromptUSB, sizeof(switchPromptUSB));
+            }
+            else
+            {
+                /* Parse the oldest completed buffer while the driver keeps
+                 * filling the next one */
+                buffer = cdcReadBuffer[port->index][port->readQueue.parsed % APP_READ_QUEUE_DEPTH];
+                numBytesRead = port->readQueue.numBytesRead[port->readQueue.parsed % APP_READ_QUEUE_DEPTH];
+
+                /* A new protocol starts with the first read that
+                 * completed after the host asked for it */
+                if((port->readQueue.parsePos == 0) && !calcFlush(&port->calc) &&
+                        (port->protocol != port->protocolWanted) &&
+                        ((int)(port->readQueue.parsed - port->protocolFrom) >= 0))
+                {
+                    port->protocol = port->protocolWanted;
+                    APP_FRAME_Initialize(&port->frames);
+                    APP_STREAM_Initialize(&port->stream);
+                    calcFlujoInicia(&port->flujo);
+                    calcSessionInit(&port->calc, ring, port->index == APP_CONSOLE_PORT);
+                    calcSessionSpans(&port->calc, spans);
+#if CALC_CACHE
+                    calcSessionCache(&port->calc, &appResultCache);
+#endif
+                    if(port->protocol == APP_PROTOCOL_GRAMMAR)
+                    {
+                        /* The blob in use is about to be overwritten */
+                        port->grammarLoaded = false;
+                        port->grammarReceived = 0;
+                    }
+                    calcSessionGramatica(&port->calc, port->grammarLoaded ? &port->grammar : NULL);
+                }
+
+                if(port->protocol == APP_PROTOCOL_FRAMES)
+                {
+                    /* Frames bypass the keystroke state machine */
+                    i = APP_PortFrames(port, buffer, port->readQueue.parsePos, numBytesRead);
+                }
+                else if(port->protocol == APP_PROTOCOL_STREAM)
+                {
+                    /* So do samples */
+                    i = APP_PortStream(port, buffer, port->readQueue.parsePos, numBytesRead);
+                }
+                else if(port->protocol == APP_PROTOCOL_GRAMMAR)
+                {
+                    i = APP_PortGrammar(port, buffer, port->readQueue.parsePos, numBytesRead);
+                }
+                else
+                {
+                    /* Else echo each received character by adding 1. Every
+                     * expression in the buffer is evaluated; parsing stops early
+                     * only while the TX ring or span list is short of room */
+                    for(i = port->readQueue.parsePos; i < numBytesRead; i += taken)
+                    {
+                        if(calcFlush(&port->calc) || (APP_TXRING_Free(ring) < APP_TX_RESERVE) ||
+                                (APP_TXSPAN_Free(spans) < APP_TX_SPAN_RESERVE))
+                        {
+                            break;
+                        }
+
+                        /* Inside an operand a run of digits is taken whole */
+#if APP_PERF
+                        perfStart = APP_PERF_NOW();
+#endif
+                        taken = 0;
+                        if((uint8_t)(buffer[i] - '0') <= 9)
+                        {
+                            taken = calcDigitos(&port->calc, (const char *)&buffer[i], numBytesRead - i);
+                        }
+                        if(taken != 0)
+                        {
+                            APP_PERF_ADD(digits, (APP_PERF_NOW() - perfStart) / taken);
+                        }
+#if APP_PERF
+                        else if(buffer[i] == APP_PERF_DUMP_CHAR)
+                        {
+                            /* Served once the buffer has been parsed */
+                            port->perfDump = true;
+                            taken = 1;
+                        }
+#endif
+                        else
+                        {
+                            //CR y LF tienen transición 0, no cambian el estado
+                            calcStepRef(&port->calc, (const char *)&buffer[i]);
+                            taken = 1;
+                            APP_PERF_ADD(step, APP_PERF_NOW() - perfStart);
+                        }
+                    }
+                }
+
+                if(i < numBytesRead)
+                {
+                    /* Resume here once the writer has made room */
+                    port->readQueue.parsePos = i;
+                    port->state = APP_STATE_SCHEDULE_WRITE;
+                }
+                else
+                {
+                    port->readQueue.parsePos = 0;
+                    port->readQueue.parsed++;
+                }
+
+              
+            }
+
+            break;
+
+        case APP_STATE_ERROR:
+        default:
+            
+            break;
+    }
+
+    if(port->state != APP_STATE_ERROR)
+    {
+        /* A long result is printed as the writer makes room for it */
+#if APP_PERF
+        /* The report goes between results, never inside one */
+        if(!calcFlush(&port->calc) && port->perfDump && APP_PerfReport(port))
+        {
+            port->perfDump = false;
+        }
+#else
+        calcFlush(&port->calc);
+#endif
+        APP_WriterTasks(port);
+    }
+
+#if APP_PERF
+    if(port->state != state)
+    {
+        APP_PerfDwell(&appPerf.port[state], &port->perfStamp);
+    }
+#endif
+}
+
+#if APP_EVENT_MODE
+/*****************************************************
+ * Steps a port until a step changes nothing, that is
+ * until it can only go on after its next event.
+ * Returns false if it was still busy after
+ * APP_EVENT_PORT_STEPS steps.
+ *****************************************************/
+
+bool APP_PortService(APP_PORT * port)
+{
+    APP_STATES state;
+    unsigned int step, queued, parsed;
+    uint32_t parsePos;
+    size_t pending, txInFlight;
+
+    for(step = 0; step < APP_EVENT_PORT_STEPS; step++)
+    {
+        state = port->state;
+        queued = port->readQueue.queued;
+        parsed = port->readQueue.parsed;
+        parsePos = port->readQueue.parsePos;
+        pending = APP_TXSPAN_Count(&appTxSpan[port->index]);
+        txInFlight = port->txInFlight;
+
+        APP_PortTasks(port);
+
+        if((port->state == state) && (port->readQueue.queued == queued) &&
+                (port->readQueue.parsed == parsed) && (port->readQueue.parsePos == parsePos) &&
+                (APP_TXSPAN_Count(&appTxSpan[port->index]) == pending) &&
+                (port->txInFlight == txInFlight))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*****************************************************
+ * Idles the core until the next interrupt, unless an
+ * event or a switch tick is already waiting.
+ * Interrupts stay masked
+ * between the check and the WAIT, so an event posted
+ * in between still ends the idle.
+ *****************************************************/
+
+void APP_Idle(void)
+{
+    SYS_INT_Disable();
+    if(APP_EVENT_Empty(&appEvents) && (appSwitchTicks == appSwitchTicksSeen))
+    {
+        appEventStats.sleeps++;
+        SYS_DEVCON_PowerModeEnter(SYS_POWER_MODE_IDLE);
+    }
+    SYS_INT_Enable();
+}
+
+/*****************************************************
+ * One pass of the event driven loop: takes every
+ * waiting event, serves only the ports they name and
+ * idles when there were none.
+ *****************************************************/
+
+void APP_EventTasks(void)
+{
+    APP_EVENT event;
+    uint32_t dirty = appPortDirty;
+    unsigned int n, index;
+    bool woken = false;
+
+    /* Switch samples due since the last pass; a press wakes the console */
+    APP_ProcessSwitchPress();
+    if(appData.isSwitchPressed)
+    {
+        dirty |= 1u << APP_CONSOLE_PORT;
+    }
+
+    while(APP_EVENT_Get(&appEvents, &event))
+    {
+        woken = true;
+        switch(event.type)
+        {
+            case APP_EVENT_READ:
+            case APP_EVENT_WRITE:
+
+                dirty |= 1u << event.port;
+                break;
+
+            case APP_EVENT_DEVICE:
+            default:
+
+                dirty = APP_PORTS_ALL;
+                break;
+        }
+    }
+    if(appEvents.overflow)
+    {
+        /* Events were lost: look at every port, as a polling pass would */
+        appEvents.overflow = false;
+        dirty = APP_PORTS_ALL;
+    }
+
+    if(dirty == 0)
+    {
+        APP_Idle();
+        return;
+    }
+    if(woken)
+    {
+        appEventStats.wakeups++;
+    }
+
+    /* Same rotation as the polling loop. A port still busy after its
+     * steps is served again on the next pass, before idling */
+    appPortDirty = 0;
+    for(n = 0; n < APP_CDC_PORTS; n++)
+    {
+        index = (appPortNext + n) % APP_CDC_PORTS;
+        if((dirty & (1u << index)) && !APP_PortService(&appPort[index]))
+        {
+            appPortDirty |= 1u << index;
+        }
+    }
+    appPortNext = (appPortNext + 1) % APP_CDC_PORTS;
+}
+#endif
+
+/******************************************************************************
+  Function:
+    void APP_Tasks(void)
+
+  Remarks:
+    See prototype in app.h.
+ */
+
+void APP_Tasks(void)
+{
+    /* Update the application state machine based
+     * on the current state */
+#if APP_EVENT_MODE
+    APP_EVENT event;
+#else
+    unsigned int n;
+#endif
+#if APP_PERF
+    APP_STATES state = appData.state;
+#endif
+    
+    switch(appData.state)
+    {
+        case APP_STATE_INIT:
+
+#if !APP_SWITCH_TICK_SOF
+            /* The switch sample tick, retried until the timer service is up */
+            if(appSwitchTimer == SYS_TMR_HANDLE_INVALID)
+            {
+                appSwitchTimer = SYS_TMR_CallbackPeriodic(APP_SWITCH_PERIOD_MS, 0, APP_SwitchTick);
+                if(appSwitchTimer == SYS_TMR_HANDLE_INVALID)
+                {
+                    break;
+                }
+            }
+#endif
+
+            /* Open the device layer */
+            appData.deviceHandle = USB_DEVICE_Open( USB_DEVICE_INDEX_0, DRV_IO_INTENT_READWRITE );
+
+            if(appData.deviceHandle != USB_DEVICE_HANDLE_INVALID)
+            {
+                /* Register a callback with device layer to get event notification (for end point 0) */
+                USB_DEVICE_EventHandlerSet(appData.deviceHandle, APP_USBDeviceEventHandler, 0);
+
+                appData.state = APP_STATE_WAIT_FOR_CONFIGURATION;
+            }
+            else
+            {
+                /* The Device Layer is not ready to be opened. We should try
+                 * again later. */
+            }
+
+            break;
+
+        case APP_STATE_WAIT_FOR_CONFIGURATION:
+
+#if APP_EVENT_MODE
+            /* Events from before the configuration only say "look again",
+             * and every port starts over anyway */
+            while(APP_EVENT_Get(&appEvents, &event))
+            {
+            }
+            appEvents.overflow = false;
+            appPortDirty = APP_PORTS_ALL;
+
+            /* The switch is ignored until then */
+            appSwitchTicksSeen = appSwitchTicks;
+#endif
+
+            /* Check if the device was configured */
+            if(appData.isConfigured)
+            {
+                /* If the device is configured then lets start reading */
+                appData.state = APP_STATE_SCHEDULE_READ;
+            }
+#if APP_EVENT_MODE
+            else
+            {
+                APP_Idle();
+            }
+#endif
+            
+            break;
+
+        case APP_STATE_SCHEDULE_READ:
+
+            /* The device is up. appData.state stays here and every port
+             * runs its own pipeline */
+
+            if(APP_StateReset())
+            {
+                break;
+            }
+
+#if APP_EVENT_MODE
+            APP_EventTasks();
+#else
+            APP_ProcessSwitchPress();
+
+            /* Round robin: each port gets exactly one pipeline step per
+             * pass and the first port served rotates, so a port streaming
+             * a long script cannot hold the others off */
+            for(n = 0; n < APP_CDC_PORTS; n++)
+            {
+                APP_PortTasks(&appPort[(appPortNext + n) % APP_CDC_PORTS]);
+            }
+            appPortNext = (appPortNext + 1) % APP_CDC_PORTS;
+#endif
+
+            break;
+
+        case APP_STATE_ERROR:
+        default:
+            
+            break;
+    }
+
+#if APP_PERF
+    if(appData.state != state)
+    {
+        APP_PerfDwell(&appPerf.task[state], &appPerf.taskStamp);
+    }
+#endif
+}
+
+/*******************************************************************************
+ End of File
+ */
+
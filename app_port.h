@@ -0,0 +1,44 @@
+/*******************************************************************************
+  USB CDC Port Layer Header File
+
+  File Name:
+    app_port.h
+
+  Summary:
+    The calculator app_port.c drives.
+
+  Description:
+    app_port.c implements APP_Initialize and APP_Tasks of app.h once for
+    both calculators.  The project defines PUNTO, 1 or 2, for every file:
+    app_port.c then embeds that calculator's CALC_SESSION, and
+    interfacesP4puntoN.c refuses to build under any other PUNTO, so the
+    two cannot disagree on its layout.  app_port.c reaches the calculator
+    only through what both calculator headers declare alike:
+
+        calcSessionInit, calcSessionSpans,      a session per port
+        calcSessionCache, calcSessionGramatica
+        calcDigitos, calcStepRef, calcFlush     keystrokes
+        calcPeticion, calcLoteEstado, calcLote  request frames, app_frame.h
+        calcFlujoInicia, calcFlujoSuma,         number streams, app_stream.h
+        calcFlujoReporte
+        calcGramaticaCarga                      grammar blobs, app_grammar.h
+
+    together with CALC_SESSION, CALC_FLUJO, CALC_CACHE, CALC_SALIDA_MAX,
+    CALC_FLUJO_REPORTE_MAX and CALC_GRAMATICA_LARGO.
+ *******************************************************************************/
+
+#ifndef _APP_PORT_H
+#define _APP_PORT_H
+
+/* Calculator the firmware is built with, interfacesP4puntoN.c */
+#if !defined(PUNTO)
+#error "PUNTO must name the calculator linked, 1 or 2"
+#elif PUNTO == 2
+#include "interfacesP4punto2.h"
+#elif PUNTO == 1
+#include "interfacesP4punto1.h"
+#else
+#error "PUNTO must be 1 or 2"
+#endif
+
+#endif /* _APP_PORT_H */
@@ -0,0 +1,84 @@
+/*******************************************************************************
+  Result Cache
+
+  File Name:
+    app_rcache.c
+
+  Summary:
+    Two way set associative result cache, see app_rcache.h.
+
+  Description:
+    The set comes from the key folded to 32 bits and mixed with the
+    MurmurHash3 finalizer, so operands that only differ in their high bits
+    (the exponent of a float, with a mantissa full of trailing zeros) still
+    spread over the sets.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_rcache.h"
+
+static unsigned appRcacheSet(unsigned op, uint64_t a, uint64_t b)
+{
+    uint32_t h = (uint32_t)a ^ (uint32_t)(a >> 32);
+
+    h = h * 0x9E3779B1u + ((uint32_t)b ^ (uint32_t)(b >> 32)) + op;
+
+    /* Every key bit reaches the low bits that pick the set */
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h & (APP_RCACHE_SETS - 1);
+}
+
+void APP_RCACHE_Initialize(APP_RCACHE * cache)
+{
+    memset(cache, 0, sizeof(*cache));
+}
+
+const uint8_t * APP_RCACHE_Lookup(APP_RCACHE * cache, unsigned op,
+        uint64_t a, uint64_t b, size_t * length, uint64_t * value)
+{
+    unsigned set = appRcacheSet(op, a, b), way;
+    APP_RCACHE_ENTRY * entry;
+
+    for (way = 0; way < APP_RCACHE_WAYS; way++)
+    {
+        entry = &cache->entry[set][way];
+        if (entry->length != 0 && entry->a == a && entry->b == b && entry->op == op)
+        {
+            cache->recent[set] = (uint8_t)way;
+            cache->hits++;
+            *length = entry->length;
+            *value = entry->value;
+            return entry->result;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+void APP_RCACHE_Insert(APP_RCACHE * cache, unsigned op, uint64_t a, uint64_t b,
+        uint64_t value, const void * result, size_t length)
+{
+    unsigned set = appRcacheSet(op, a, b), way;
+    APP_RCACHE_ENTRY * entry;
+
+    if (length == 0 || length > APP_RCACHE_RESULT_MAX)
+    {
+        return;
+    }
+
+    /* An empty way first, else the one not used last */
+    way = (cache->entry[set][0].length == 0) ? 0 :
+            (cache->entry[set][1].length == 0) ? 1 : 1u - cache->recent[set];
+    entry = &cache->entry[set][way];
+    entry->a = a;
+    entry->b = b;
+    entry->op = (uint8_t)op;
+    entry->value = value;
+    entry->length = (uint8_t)length;
+    memcpy(entry->result, result, length);
+    cache->recent[set] = (uint8_t)way;
+}
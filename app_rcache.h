@@ -0,0 +1,116 @@
+/*******************************************************************************
+  Result Cache Header File
+
+  File Name:
+    app_rcache.h
+
+  Summary:
+    Two way set associative cache of formatted results keyed on (op, a, b).
+
+  Description:
+    Clients that poll the calculator send the same few expressions over and
+    over.  The cache remembers, for an operator and the bit patterns of its
+    two operands, the bytes that were printed as the result and the bits of
+    the result itself, so a repeated expression is answered with a copy: no
+    arithmetic and no formatting.
+
+    The key is compared bit for bit, whatever the operands are (int32_t,
+    float or a fixed point int64_t), which is exact: equal bits give the
+    same result.  A set holds two entries; a miss replaces the one that was
+    used least recently.  Results longer than APP_RCACHE_RESULT_MAX are not
+    kept.
+
+  Remarks:
+    The cache is not locked.  Sessions that share one must run in the same
+    context (the superloop on the device); host threads keep their own.
+ *******************************************************************************/
+
+#ifndef _APP_RCACHE_H
+#define _APP_RCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Sets, must be a power of two.  Two entries per set */
+#ifndef APP_RCACHE_SETS
+#define APP_RCACHE_SETS                 128
+#endif
+
+/* Longest result that is kept, "=-1234.567890\r" is 14 */
+#ifndef APP_RCACHE_RESULT_MAX
+#define APP_RCACHE_RESULT_MAX           22
+#endif
+
+#define APP_RCACHE_WAYS                 2
+
+typedef struct
+{
+    uint64_t a;
+    uint64_t b;
+    uint8_t op;
+
+    /* Bits of the result, for callers that keep it */
+    uint64_t value;
+
+    /* Bytes in result, 0 while the entry is empty */
+    uint8_t length;
+    uint8_t result[APP_RCACHE_RESULT_MAX];
+
+} APP_RCACHE_ENTRY;
+
+typedef struct
+{
+    APP_RCACHE_ENTRY entry[APP_RCACHE_SETS][APP_RCACHE_WAYS];
+
+    /* Way of each set that was used last */
+    uint8_t recent[APP_RCACHE_SETS];
+
+    uint32_t hits;
+    uint32_t misses;
+
+} APP_RCACHE;
+
+// *****************************************************************************
+/* Function:
+    void APP_RCACHE_Initialize(APP_RCACHE * cache)
+
+  Summary:
+    Empties the cache and clears its counters.
+*/
+
+void APP_RCACHE_Initialize(APP_RCACHE * cache);
+
+// *****************************************************************************
+/* Function:
+    const uint8_t * APP_RCACHE_Lookup(APP_RCACHE * cache, unsigned op,
+                                      uint64_t a, uint64_t b, size_t * length,
+                                      uint64_t * value)
+
+  Summary:
+    Returns the result kept for (op, a, b), its length in *length and the
+    bits of its value in *value, or NULL if there is none.  Counts a hit or
+    a miss.
+
+  Remarks:
+    The bytes stay valid until the next APP_RCACHE_Insert(), so the caller
+    copies them.
+*/
+
+const uint8_t * APP_RCACHE_Lookup(APP_RCACHE * cache, unsigned op,
+        uint64_t a, uint64_t b, size_t * length, uint64_t * value);
+
+// *****************************************************************************
+/* Function:
+    void APP_RCACHE_Insert(APP_RCACHE * cache, unsigned op, uint64_t a,
+                           uint64_t b, uint64_t value, const void * result,
+                           size_t length)
+
+  Summary:
+    Keeps the result of (op, a, b), normally right after a missed lookup.
+*/
+
+void APP_RCACHE_Insert(APP_RCACHE * cache, unsigned op, uint64_t a, uint64_t b,
+        uint64_t value, const void * result, size_t length);
+
+#endif /* _APP_RCACHE_H */
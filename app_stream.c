@@ -0,0 +1,178 @@
+/*******************************************************************************
+  Number Stream Scanner
+
+  File Name:
+    app_stream.c
+
+  Summary:
+    Scanner and conversions of app_stream.h.
+
+  Description:
+    Inside a number the digits are taken in a tight loop, which is where a
+    stream of samples spends its time; a byte between numbers costs one
+    comparison or two.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_stream.h"
+
+/* A mantissa below this still takes a digit */
+#define APP_STREAM_MANTISSA_FULL        ((UINT64_MAX - 9) / 10)
+
+static const uint64_t appStreamPowersOf10[APP_STREAM_DECIMALS_MAX + 1] =
+{
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+static const float appStreamPowersOf10F[APP_STREAM_DECIMALS_MAX + 1] =
+{
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f,
+    1e10f, 1e11f, 1e12f, 1e13f, 1e14f, 1e15f, 1e16f, 1e17f, 1e18f, 1e19f
+};
+
+static void appStreamDigit(APP_STREAM_SCANNER * scanner, unsigned digit)
+{
+    APP_STREAM_NUMBER * number = &scanner->number;
+
+    scanner->digits = true;
+    if (scanner->point)
+    {
+        /* Decimals that no longer fit are only precision */
+        if (number->mantissa < APP_STREAM_MANTISSA_FULL &&
+                number->decimals < APP_STREAM_DECIMALS_MAX)
+        {
+            number->mantissa = number->mantissa * 10 + digit;
+            number->decimals++;
+        }
+    }
+    else if (number->mantissa < APP_STREAM_MANTISSA_FULL)
+    {
+        number->mantissa = number->mantissa * 10 + digit;
+    }
+    else
+    {
+        number->overflow = true;
+    }
+}
+
+void APP_STREAM_Initialize(APP_STREAM_SCANNER * scanner)
+{
+    memset(scanner, 0, sizeof(*scanner));
+}
+
+size_t APP_STREAM_Scan(APP_STREAM_SCANNER * scanner, const uint8_t * data,
+        size_t length, APP_STREAM_NUMBER * number, APP_STREAM_TOKEN * token)
+{
+    size_t k = 0;
+    unsigned digit;
+    uint8_t ch;
+
+    *token = APP_STREAM_NONE;
+    while (k < length)
+    {
+        if (scanner->inNumber)
+        {
+            while (k < length && (digit = (unsigned)(data[k] - '0')) <= 9)
+            {
+                appStreamDigit(scanner, digit);
+                k++;
+            }
+            if (k == length)
+            {
+                break;
+            }
+            if (data[k] == '.' && !scanner->point)
+            {
+                scanner->point = true;
+                k++;
+                continue;
+            }
+            scanner->inNumber = false;
+            if (scanner->digits)
+            {
+                /* data[k] is looked at by the next call */
+                *number = scanner->number;
+                *token = APP_STREAM_SAMPLE;
+                return k;
+            }
+            /* A sign or point alone, data[k] may start a number itself */
+        }
+
+        ch = data[k++];
+        if ((unsigned)(ch - '0') <= 9 || ch == '-' || ch == '+' || ch == '.')
+        {
+            memset(&scanner->number, 0, sizeof(scanner->number));
+            scanner->number.negative = (ch == '-');
+            scanner->point = (ch == '.');
+            scanner->digits = false;
+            scanner->inNumber = true;
+            if ((unsigned)(ch - '0') <= 9)
+            {
+                appStreamDigit(scanner, (unsigned)(ch - '0'));
+            }
+        }
+        else if (ch == APP_STREAM_QUERY_CHAR)
+        {
+            *token = APP_STREAM_QUERY;
+            return k;
+        }
+        else if (ch == APP_STREAM_CLEAR_CHAR)
+        {
+            *token = APP_STREAM_CLEAR;
+            return k;
+        }
+    }
+    return k;
+}
+
+bool APP_STREAM_Scaled(const APP_STREAM_NUMBER * number, unsigned decimals,
+        int64_t * value)
+{
+    uint64_t magnitude = number->mantissa, scale, remainder;
+
+    if (number->overflow)
+    {
+        return false;
+    }
+    if (number->decimals > decimals)
+    {
+        scale = appStreamPowersOf10[number->decimals - decimals];
+        remainder = magnitude % scale;
+        magnitude = magnitude / scale + (remainder >= scale / 2);
+    }
+    else if (number->decimals < decimals && magnitude != 0)
+    {
+        if (decimals - number->decimals > APP_STREAM_DECIMALS_MAX)
+        {
+            return false;
+        }
+        scale = appStreamPowersOf10[decimals - number->decimals];
+        if (magnitude > UINT64_MAX / scale)
+        {
+            return false;
+        }
+        magnitude *= scale;
+    }
+
+    /* -2^63 fits, +2^63 does not */
+    if (magnitude > (uint64_t)INT64_MAX + number->negative)
+    {
+        return false;
+    }
+    *value = number->negative ? (int64_t)(0u - magnitude) : (int64_t)magnitude;
+    return true;
+}
+
+float APP_STREAM_Float(const APP_STREAM_NUMBER * number)
+{
+    float x = (float)number->mantissa;
+
+    if (number->decimals > 0)
+    {
+        x /= appStreamPowersOf10F[number->decimals];
+    }
+    return number->negative ? -x : x;
+}
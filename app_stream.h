@@ -0,0 +1,146 @@
+/*******************************************************************************
+  Number Stream Scanner Header File
+
+  File Name:
+    app_stream.h
+
+  Summary:
+    Picks decimal numbers out of a continuous stream of text.
+
+  Description:
+    A port in streaming mode takes text such as a sensor log, one sample
+    after another with anything in between:
+
+        12.5, -3
+        7;0.25 ...
+
+    A number is an optional sign right before digits, with an optional
+    point: "-3", "+4", "12.5", ".25", "7.".  Every other byte separates
+    numbers, except for the two commands:
+
+        ?       the host asks for the aggregates so far
+        !       the aggregates start over
+
+    Exponents are not understood: "1e5" is the numbers 1 and 5.  A number
+    may be split over any number of reads; the scanner carries it over.
+
+    The scanner knows nothing about arithmetic: the calculator keeps the
+    aggregates (calcFlujo in interfacesP4puntoN.c).
+ *******************************************************************************/
+
+#ifndef _APP_STREAM_H
+#define _APP_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define APP_STREAM_QUERY_CHAR           '?'
+#define APP_STREAM_CLEAR_CHAR           '!'
+
+/* Decimals a number keeps at most, as many as a uint64_t has digits */
+#define APP_STREAM_DECIMALS_MAX         19
+
+typedef enum
+{
+    /* The bytes taken completed nothing */
+    APP_STREAM_NONE = 0,
+
+    /* A number, which is in *number */
+    APP_STREAM_SAMPLE,
+
+    /* APP_STREAM_QUERY_CHAR */
+    APP_STREAM_QUERY,
+
+    /* APP_STREAM_CLEAR_CHAR */
+    APP_STREAM_CLEAR
+
+} APP_STREAM_TOKEN;
+
+typedef struct
+{
+    /* Every digit, without sign or point, as one integer */
+    uint64_t mantissa;
+
+    /* Digits of mantissa after the point.  Once mantissa is full, or after
+     * APP_STREAM_DECIMALS_MAX of them, further ones are dropped */
+    uint8_t decimals;
+
+    bool negative;
+
+    /* Digits before the point that mantissa cannot hold */
+    bool overflow;
+
+} APP_STREAM_NUMBER;
+
+typedef struct
+{
+    /* The number being read, valid while inNumber */
+    APP_STREAM_NUMBER number;
+    bool inNumber;
+
+    /* The point and at least one digit were seen; a sign or a point
+     * without digits is no number */
+    bool point;
+    bool digits;
+
+} APP_STREAM_SCANNER;
+
+// *****************************************************************************
+/* Function:
+    void APP_STREAM_Initialize(APP_STREAM_SCANNER * scanner)
+
+  Summary:
+    Drops any partial number; the next byte starts anew.
+*/
+
+void APP_STREAM_Initialize(APP_STREAM_SCANNER * scanner);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_STREAM_Scan(APP_STREAM_SCANNER * scanner, const uint8_t * data,
+                           size_t length, APP_STREAM_NUMBER * number,
+                           APP_STREAM_TOKEN * token)
+
+  Summary:
+    Takes bytes of the stream up to the end of the next number or command
+    and returns how many it took.  *token tells what that completed.
+
+  Remarks:
+    Takes at least one byte whenever length is not 0, except when a number
+    ends at data[0]: the byte that ends it is left for the next call, so a
+    "12?" gives the number and then the query.  A number at the end of
+    data is only complete once the byte after it arrives.
+*/
+
+size_t APP_STREAM_Scan(APP_STREAM_SCANNER * scanner, const uint8_t * data,
+        size_t length, APP_STREAM_NUMBER * number, APP_STREAM_TOKEN * token);
+
+// *****************************************************************************
+/* Function:
+    bool APP_STREAM_Scaled(const APP_STREAM_NUMBER * number, unsigned decimals,
+                           int64_t * value)
+
+  Summary:
+    The number in units of 10^-decimals, halves rounded away from zero.
+    false when it does not fit an int64_t.
+*/
+
+bool APP_STREAM_Scaled(const APP_STREAM_NUMBER * number, unsigned decimals,
+        int64_t * value);
+
+// *****************************************************************************
+/* Function:
+    float APP_STREAM_Float(const APP_STREAM_NUMBER * number)
+
+  Summary:
+    The number as a float, within two roundings of its exact value.
+
+  Remarks:
+    Takes no double, which the PIC32 only has in software.  An overflow
+    is the caller's to check.
+*/
+
+float APP_STREAM_Float(const APP_STREAM_NUMBER * number);
+
+#endif /* _APP_STREAM_H */
@@ -0,0 +1,102 @@
+/*******************************************************************************
+  CDC Transmit Ring
+
+  File Name:
+    app_txring.c
+
+  Summary:
+    Single-producer/single-consumer byte ring, see app_txring.h.
+
+  Description:
+    head is published with release semantics after the payload is copied and
+    tail after the consumer is done with the bytes, so the two sides may run
+    in different contexts (main loop and USB interrupt) without a lock.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_txring.h"
+
+#define APP_TXRING_MASK                 (APP_TXRING_SIZE - 1)
+
+#if (APP_TXRING_SIZE & APP_TXRING_MASK) != 0
+#error "APP_TXRING_SIZE must be a power of two"
+#endif
+
+void APP_TXRING_Initialize(APP_TXRING * ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+}
+
+size_t APP_TXRING_Count(const APP_TXRING * ring)
+{
+    return (size_t)(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+            __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+}
+
+size_t APP_TXRING_Free(const APP_TXRING * ring)
+{
+    return APP_TXRING_SIZE - APP_TXRING_Count(ring);
+}
+
+bool APP_TXRING_Write(APP_TXRING * ring, const void * data, size_t length)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t offset = head & APP_TXRING_MASK;
+    size_t first;
+
+    if (length > APP_TXRING_SIZE - (size_t)(head - tail))
+    {
+        ring->dropped += length;
+        return false;
+    }
+
+    first = APP_TXRING_SIZE - offset;
+    if (first > length)
+    {
+        first = length;
+    }
+    memcpy(&ring->buffer[offset], data, first);
+    memcpy(&ring->buffer[0], (const uint8_t *)data + first, length - first);
+
+    __atomic_store_n(&ring->head, head + (uint32_t)length, __ATOMIC_RELEASE);
+    return true;
+}
+
+size_t APP_TXRING_Peek(const APP_TXRING * ring, const uint8_t ** data, size_t maxLength)
+{
+    uint32_t tail = ring->tail;
+    size_t count = (size_t)(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail);
+    size_t offset = tail & APP_TXRING_MASK;
+
+    if (count > APP_TXRING_SIZE - offset)
+    {
+        count = APP_TXRING_SIZE - offset;
+    }
+    if (count > maxLength)
+    {
+        count = maxLength;
+    }
+    *data = &ring->buffer[offset];
+    return count;
+}
+
+void APP_TXRING_Copy(const APP_TXRING * ring, size_t offset, void * data, size_t length)
+{
+    size_t start = (ring->tail + offset) & APP_TXRING_MASK;
+    size_t first = APP_TXRING_SIZE - start;
+
+    if (first > length)
+    {
+        first = length;
+    }
+    memcpy(data, &ring->buffer[start], first);
+    memcpy((uint8_t *)data + first, &ring->buffer[0], length - first);
+}
+
+void APP_TXRING_Release(APP_TXRING * ring, size_t length)
+{
+    __atomic_store_n(&ring->tail, ring->tail + (uint32_t)length, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+  CDC Transmit Ring Header File
+
+  File Name:
+    app_txring.h
+
+  Summary:
+    Single-producer/single-consumer byte ring feeding USB_DEVICE_CDC_Write.
+
+  Description:
+    The calculator appends its echo and results to the ring with
+    APP_TXRING_Write() and the writer stage in APP_Tasks drains it in
+    packet sized chunks with APP_TXRING_Peek()/APP_TXRING_Release().  The
+    producer only ever moves head and the consumer only ever moves tail, so
+    neither side needs a lock.  Peeked bytes stay in place until they are
+    released, which lets the CDC driver send straight out of the ring.
+ *******************************************************************************/
+
+#ifndef _APP_TXRING_H
+#define _APP_TXRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Ring capacity in bytes, must be a power of two */
+#ifndef APP_TXRING_SIZE
+#define APP_TXRING_SIZE                 512
+#endif
+
+typedef struct
+{
+    uint8_t buffer[APP_TXRING_SIZE];
+
+    /* Free running indices, wrapped with APP_TXRING_SIZE - 1 on access */
+    volatile uint32_t head;
+    volatile uint32_t tail;
+
+    /* Bytes rejected because the ring was full */
+    uint32_t dropped;
+
+} APP_TXRING;
+
+// *****************************************************************************
+/* Function:
+    void APP_TXRING_Initialize(APP_TXRING * ring)
+
+  Summary:
+    Empties the ring and clears the drop counter.
+*/
+
+void APP_TXRING_Initialize(APP_TXRING * ring);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_TXRING_Count(const APP_TXRING * ring)
+    size_t APP_TXRING_Free(const APP_TXRING * ring)
+
+  Summary:
+    Bytes waiting to be sent / bytes that can still be written.
+*/
+
+size_t APP_TXRING_Count(const APP_TXRING * ring);
+size_t APP_TXRING_Free(const APP_TXRING * ring);
+
+// *****************************************************************************
+/* Function:
+    bool APP_TXRING_Write(APP_TXRING * ring, const void * data, size_t length)
+
+  Summary:
+    Producer side.  Appends length bytes.
+
+  Remarks:
+    All or nothing: if the bytes do not fit nothing is written, the drop
+    counter grows by length and false is returned.
+*/
+
+bool APP_TXRING_Write(APP_TXRING * ring, const void * data, size_t length);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_TXRING_Peek(const APP_TXRING * ring, const uint8_t ** data,
+                           size_t maxLength)
+
+  Summary:
+    Consumer side.  Returns the oldest contiguous run of unsent bytes.
+
+  Description:
+    *data points at the run inside the ring and the return value is its
+    length, at most maxLength.  A run never crosses the end of the buffer,
+    so a wrapped ring takes two peeks to drain.  The bytes stay valid until
+    they are handed back with APP_TXRING_Release().
+*/
+
+size_t APP_TXRING_Peek(const APP_TXRING * ring, const uint8_t ** data, size_t maxLength);
+
+// *****************************************************************************
+/* Function:
+    void APP_TXRING_Copy(const APP_TXRING * ring, size_t offset, void * data,
+                         size_t length)
+
+  Summary:
+    Consumer side.  Copies length unsent bytes, starting offset bytes after
+    the oldest one, without releasing them.
+
+  Remarks:
+    offset + length must not exceed APP_TXRING_Count().  Unlike a peek the
+    copy may cross the end of the buffer.
+*/
+
+void APP_TXRING_Copy(const APP_TXRING * ring, size_t offset, void * data, size_t length);
+
+// *****************************************************************************
+/* Function:
+    void APP_TXRING_Release(APP_TXRING * ring, size_t length)
+
+  Summary:
+    Consumer side.  Frees length bytes previously returned by a peek.
+*/
+
+void APP_TXRING_Release(APP_TXRING * ring, size_t length);
+
+#endif /* _APP_TXRING_H */
@@ -0,0 +1,211 @@
+/*******************************************************************************
+  CDC Transmit Span List
+
+  File Name:
+    app_txspan.c
+
+  Summary:
+    Ordered list of (pointer, length) pieces, see app_txspan.h.
+
+  Description:
+    The NULL spans hold their bytes in the ring in the same order as they
+    appear in the list, so the ring's oldest byte always belongs to the
+    oldest NULL span and no ring offset has to be stored per span.
+ *******************************************************************************/
+
+#include <string.h>
+#include "app_txspan.h"
+
+#define APP_TXSPAN_MASK                 (APP_TXSPAN_DEPTH - 1)
+
+#if (APP_TXSPAN_DEPTH & APP_TXSPAN_MASK) != 0
+#error "APP_TXSPAN_DEPTH must be a power of two"
+#endif
+
+/* Newest span, or NULL when the list is empty */
+static APP_TXSPAN_ENTRY * appTxspanLast(APP_TXSPAN * list)
+{
+    if (list->head == list->tail)
+    {
+        return NULL;
+    }
+    return &list->entry[(list->head - 1) & APP_TXSPAN_MASK];
+}
+
+void APP_TXSPAN_Initialize(APP_TXSPAN * list, APP_TXRING * ring)
+{
+    list->ring = ring;
+    list->head = 0;
+    list->tail = 0;
+    list->offset = 0;
+    list->count = 0;
+    list->dropped = 0;
+}
+
+size_t APP_TXSPAN_Count(const APP_TXSPAN * list)
+{
+    return list->count;
+}
+
+size_t APP_TXSPAN_Free(const APP_TXSPAN * list)
+{
+    return APP_TXSPAN_DEPTH - (size_t)(list->head - list->tail);
+}
+
+bool APP_TXSPAN_Reference(APP_TXSPAN * list, const void * data, size_t length)
+{
+    APP_TXSPAN_ENTRY * last = appTxspanLast(list);
+
+    if (length == 0)
+    {
+        return true;
+    }
+    if (last != NULL && last->data != NULL && last->data + last->length == (const uint8_t *)data)
+    {
+        last->length += (uint32_t)length;
+    }
+    else if (APP_TXSPAN_Free(list) == 0)
+    {
+        list->dropped += length;
+        return false;
+    }
+    else
+    {
+        last = &list->entry[list->head & APP_TXSPAN_MASK];
+        last->data = data;
+        last->length = (uint32_t)length;
+        list->head++;
+    }
+    list->count += length;
+    return true;
+}
+
+bool APP_TXSPAN_Write(APP_TXSPAN * list, const void * data, size_t length)
+{
+    APP_TXSPAN_ENTRY * last = appTxspanLast(list);
+    bool grow = (last != NULL && last->data == NULL);
+
+    if (length == 0)
+    {
+        return true;
+    }
+    if ((!grow && APP_TXSPAN_Free(list) == 0) || !APP_TXRING_Write(list->ring, data, length))
+    {
+        list->dropped += length;
+        return false;
+    }
+    if (grow)
+    {
+        last->length += (uint32_t)length;
+    }
+    else
+    {
+        last = &list->entry[list->head & APP_TXSPAN_MASK];
+        last->data = NULL;
+        last->length = (uint32_t)length;
+        list->head++;
+    }
+    list->count += length;
+    return true;
+}
+
+size_t APP_TXSPAN_Peek(const APP_TXSPAN * list, const uint8_t ** data, size_t maxLength)
+{
+    const APP_TXSPAN_ENTRY * first;
+    size_t count;
+
+    if (list->head == list->tail)
+    {
+        return 0;
+    }
+    first = &list->entry[list->tail & APP_TXSPAN_MASK];
+    count = first->length - list->offset;
+    if (count > maxLength)
+    {
+        count = maxLength;
+    }
+    if (first->data == NULL)
+    {
+        return APP_TXRING_Peek(list->ring, data, count);
+    }
+    *data = first->data + list->offset;
+    return count;
+}
+
+size_t APP_TXSPAN_Gather(const APP_TXSPAN * list, uint8_t * packet, size_t maxLength)
+{
+    const APP_TXSPAN_ENTRY * span;
+    uint32_t n = list->tail;
+    size_t offset = list->offset;
+    size_t ringOffset = 0;
+    size_t count = 0;
+    size_t piece;
+
+    for (; n != list->head && count < maxLength; n++, offset = 0)
+    {
+        span = &list->entry[n & APP_TXSPAN_MASK];
+        piece = span->length - offset;
+        if (piece > maxLength - count)
+        {
+            piece = maxLength - count;
+        }
+        if (span->data == NULL)
+        {
+            APP_TXRING_Copy(list->ring, ringOffset, &packet[count], piece);
+            ringOffset += piece;
+        }
+        else
+        {
+            memcpy(&packet[count], span->data + offset, piece);
+        }
+        count += piece;
+    }
+    return count;
+}
+
+void APP_TXSPAN_Release(APP_TXSPAN * list, size_t length)
+{
+    const APP_TXSPAN_ENTRY * first;
+    size_t piece;
+
+    while (length > 0)
+    {
+        first = &list->entry[list->tail & APP_TXSPAN_MASK];
+        piece = first->length - list->offset;
+        if (piece > length)
+        {
+            piece = length;
+        }
+        if (first->data == NULL)
+        {
+            APP_TXRING_Release(list->ring, piece);
+        }
+        list->offset += (uint32_t)piece;
+        list->count -= piece;
+        length -= piece;
+        if (list->offset == first->length)
+        {
+            list->offset = 0;
+            list->tail++;
+        }
+    }
+}
+
+bool APP_TXSPAN_Holds(const APP_TXSPAN * list, const void * data, size_t length)
+{
+    const APP_TXSPAN_ENTRY * span;
+    uintptr_t start = (uintptr_t)data;
+    uintptr_t end = start + length;
+    uint32_t n;
+
+    for (n = list->tail; n != list->head; n++)
+    {
+        span = &list->entry[n & APP_TXSPAN_MASK];
+        if (span->data != NULL && (uintptr_t)span->data < end &&
+                (uintptr_t)span->data + span->length > start)
+        {
+            return true;
+        }
+    }
+    return false;
+}
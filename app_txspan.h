@@ -0,0 +1,172 @@
+/*******************************************************************************
+  CDC Transmit Span List Header File
+
+  File Name:
+    app_txspan.h
+
+  Summary:
+    Ordered list of (pointer, length) pieces waiting for USB_DEVICE_CDC_Write.
+
+  Description:
+    Most of what the calculator sends back is its own input: every accepted
+    keystroke is echoed.  Instead of copying those bytes into the TX ring,
+    the echo is queued as a span that points at them where they already
+    are, in the CDC read buffer.  Only bytes that do not exist anywhere
+    else (results, or an echo of a byte the caller does not keep) are
+    written into the ring, and a span with a NULL pointer stands for them.
+
+    Adjacent pieces merge: an echo that continues the previous echo span in
+    memory, or ring bytes that follow other ring bytes, only grow the last
+    span.  A read buffer echoed without interruption costs one span.
+
+    The writer sends the oldest piece straight from where it lies, or
+    copies several short pieces into one packet with APP_TXSPAN_Gather().
+    Referenced memory must stay untouched until its span is released;
+    APP_TXSPAN_Holds() tells whether a buffer can be reused.
+
+  Remarks:
+    Producer and consumer must run in the same context (the superloop on
+    the device): growing the last span is not safe against a consumer that
+    retires it at the same time.
+ *******************************************************************************/
+
+#ifndef _APP_TXSPAN_H
+#define _APP_TXSPAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "app_txring.h"
+
+/* Span capacity, must be a power of two */
+#ifndef APP_TXSPAN_DEPTH
+#define APP_TXSPAN_DEPTH                64
+#endif
+
+typedef struct
+{
+    /* Start of the bytes, NULL when they are the next ones in the ring */
+    const uint8_t * data;
+    uint32_t length;
+
+} APP_TXSPAN_ENTRY;
+
+typedef struct
+{
+    APP_TXSPAN_ENTRY entry[APP_TXSPAN_DEPTH];
+
+    /* Ring that holds the bytes of the NULL spans */
+    APP_TXRING * ring;
+
+    /* Free running indices, wrapped with APP_TXSPAN_DEPTH - 1 on access */
+    uint32_t head;
+    uint32_t tail;
+
+    /* Bytes of entry[tail] already released */
+    uint32_t offset;
+
+    /* Bytes in all spans not yet released */
+    size_t count;
+
+    /* Bytes rejected because the list or the ring was full */
+    uint32_t dropped;
+
+} APP_TXSPAN;
+
+// *****************************************************************************
+/* Function:
+    void APP_TXSPAN_Initialize(APP_TXSPAN * list, APP_TXRING * ring)
+
+  Summary:
+    Empties the list and binds it to the ring that stores its copied bytes.
+
+  Remarks:
+    The ring is not touched; it must be empty as well.
+*/
+
+void APP_TXSPAN_Initialize(APP_TXSPAN * list, APP_TXRING * ring);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_TXSPAN_Count(const APP_TXSPAN * list)
+    size_t APP_TXSPAN_Free(const APP_TXSPAN * list)
+
+  Summary:
+    Bytes waiting to be sent / spans that can still be added.
+*/
+
+size_t APP_TXSPAN_Count(const APP_TXSPAN * list);
+size_t APP_TXSPAN_Free(const APP_TXSPAN * list);
+
+// *****************************************************************************
+/* Function:
+    bool APP_TXSPAN_Reference(APP_TXSPAN * list, const void * data, size_t length)
+    bool APP_TXSPAN_Write(APP_TXSPAN * list, const void * data, size_t length)
+
+  Summary:
+    Producer side.  Queues length bytes, by reference or by copying them
+    into the ring.
+
+  Remarks:
+    All or nothing, like APP_TXRING_Write().  A referenced byte must not
+    change until APP_TXSPAN_Holds() says it is no longer held.
+*/
+
+bool APP_TXSPAN_Reference(APP_TXSPAN * list, const void * data, size_t length);
+bool APP_TXSPAN_Write(APP_TXSPAN * list, const void * data, size_t length);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_TXSPAN_Peek(const APP_TXSPAN * list, const uint8_t ** data,
+                           size_t maxLength)
+
+  Summary:
+    Consumer side.  Returns the oldest contiguous run of unsent bytes.
+
+  Description:
+    *data points at the run where it lies, in referenced memory or in the
+    ring, so it can be handed to the CDC driver without a copy.  A run
+    never crosses the end of a span.
+*/
+
+size_t APP_TXSPAN_Peek(const APP_TXSPAN * list, const uint8_t ** data, size_t maxLength);
+
+// *****************************************************************************
+/* Function:
+    size_t APP_TXSPAN_Gather(const APP_TXSPAN * list, uint8_t * packet,
+                             size_t maxLength)
+
+  Summary:
+    Consumer side.  Copies up to maxLength of the oldest unsent bytes,
+    across as many spans as needed, into packet.
+
+  Remarks:
+    Nothing is released; the bytes are sent again by the next peek unless
+    they are handed back with APP_TXSPAN_Release().
+*/
+
+size_t APP_TXSPAN_Gather(const APP_TXSPAN * list, uint8_t * packet, size_t maxLength);
+
+// *****************************************************************************
+/* Function:
+    void APP_TXSPAN_Release(APP_TXSPAN * list, size_t length)
+
+  Summary:
+    Consumer side.  Frees the oldest length bytes, returning ring bytes to
+    the ring and retiring every span that has been sent completely.
+*/
+
+void APP_TXSPAN_Release(APP_TXSPAN * list, size_t length);
+
+// *****************************************************************************
+/* Function:
+    bool APP_TXSPAN_Holds(const APP_TXSPAN * list, const void * data, size_t length)
+
+  Summary:
+    Returns true while an unsent span references any of the length bytes
+    at data.
+*/
+
+bool APP_TXSPAN_Holds(const APP_TXSPAN * list, const void * data, size_t length);
+
+#endif /* _APP_TXSPAN_H */
@@ -0,0 +1,388 @@
+/*******************************************************************************
+  Host Simulation Header File
+
+  File Name:
+    app.h
+
+  Summary:
+    Stand-in for the MPLAB Harmony generated app.h used by the host build.
+
+  Description:
+    The firmware sources (app_port.c, interfacesP4punto1.c,
+    interfacesP4punto2.c) include "app.h", which on the device pulls in the
+    Harmony configuration, the USB device/CDC function driver, the BSP and
+    the system services.  This header provides just enough of those
+    interfaces to compile the application unchanged on a Linux box.  The USB device layer, the CDC function driver,
+    the LEDs, the switch and the system services are implemented by
+    sim_usb.c, which drives the application from a scripted byte stream (see
+    sim.h).
+ *******************************************************************************/
+
+#ifndef _APP_H
+#define _APP_H
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Harmony Stand-ins
+// *****************************************************************************
+// *****************************************************************************
+
+#define CACHE_ALIGN                     __attribute__((aligned(16)))
+
+/* Driver layer */
+typedef enum
+{
+    DRV_IO_INTENT_READ      = 1 << 0,
+    DRV_IO_INTENT_WRITE     = 1 << 1,
+    DRV_IO_INTENT_READWRITE = DRV_IO_INTENT_READ | DRV_IO_INTENT_WRITE
+
+} DRV_IO_INTENT;
+
+/* USB device layer */
+typedef uintptr_t USB_DEVICE_HANDLE;
+
+#define USB_DEVICE_HANDLE_INVALID       ((USB_DEVICE_HANDLE)(-1))
+#define USB_DEVICE_INDEX_0              0
+
+typedef enum
+{
+    USB_SPEED_ERROR = 0,
+    USB_SPEED_HIGH,
+    USB_SPEED_FULL,
+    USB_SPEED_LOW
+
+} USB_SPEED;
+
+typedef enum
+{
+    USB_DEVICE_EVENT_ERROR = 1,
+    USB_DEVICE_EVENT_RESET,
+    USB_DEVICE_EVENT_RESUMED,
+    USB_DEVICE_EVENT_SUSPENDED,
+    USB_DEVICE_EVENT_SOF,
+    USB_DEVICE_EVENT_POWER_DETECTED,
+    USB_DEVICE_EVENT_POWER_REMOVED,
+    USB_DEVICE_EVENT_CONFIGURED,
+    USB_DEVICE_EVENT_DECONFIGURED
+
+} USB_DEVICE_EVENT;
+
+typedef enum
+{
+    USB_DEVICE_CONTROL_STATUS_OK,
+    USB_DEVICE_CONTROL_STATUS_ERROR
+
+} USB_DEVICE_CONTROL_STATUS;
+
+typedef struct
+{
+    uint8_t configurationValue;
+
+} USB_DEVICE_EVENT_DATA_CONFIGURED;
+
+typedef void (*USB_DEVICE_EVENT_HANDLER)
+(
+    USB_DEVICE_EVENT event,
+    void * eventData,
+    uintptr_t context
+);
+
+USB_DEVICE_HANDLE USB_DEVICE_Open(const uint32_t instanceIndex, const DRV_IO_INTENT intent);
+void USB_DEVICE_EventHandlerSet(USB_DEVICE_HANDLE usbDeviceHandle,
+        const USB_DEVICE_EVENT_HANDLER callBackFunc, uintptr_t context);
+void USB_DEVICE_Attach(USB_DEVICE_HANDLE usbDeviceHandle);
+void USB_DEVICE_Detach(USB_DEVICE_HANDLE usbDeviceHandle);
+USB_SPEED USB_DEVICE_ActiveSpeedGet(USB_DEVICE_HANDLE usbDeviceHandle);
+void USB_DEVICE_ControlSend(USB_DEVICE_HANDLE usbDeviceHandle, void * data, size_t length);
+void USB_DEVICE_ControlReceive(USB_DEVICE_HANDLE usbDeviceHandle, void * data, size_t length);
+void USB_DEVICE_ControlStatus(USB_DEVICE_HANDLE usbDeviceHandle,
+        USB_DEVICE_CONTROL_STATUS status);
+
+/* CDC class definitions */
+typedef struct __attribute__((packed))
+{
+    uint32_t dwDTERate;
+    uint8_t bCharFormat;
+    uint8_t bParityType;
+    uint8_t bDataBits;
+
+} USB_CDC_LINE_CODING;
+
+typedef struct
+{
+    unsigned dtr:1;
+    unsigned carrier:1;
+
+} USB_CDC_CONTROL_LINE_STATE;
+
+/* CDC function driver */
+typedef uintptr_t USB_DEVICE_CDC_INDEX;
+typedef uintptr_t USB_DEVICE_CDC_TRANSFER_HANDLE;
+
+#define USB_DEVICE_CDC_INDEX_0                  0
+#define USB_DEVICE_CDC_INDEX_1                  1
+#define USB_DEVICE_CDC_INDEX_2                  2
+#define USB_DEVICE_CDC_INDEX_3                  3
+#define USB_DEVICE_CDC_INSTANCES_NUMBER         4
+
+#define USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID  ((USB_DEVICE_CDC_TRANSFER_HANDLE)(-1))
+
+typedef enum
+{
+    USB_DEVICE_CDC_TRANSFER_FLAGS_DATA_COMPLETE = 1 << 0,
+    USB_DEVICE_CDC_TRANSFER_FLAGS_MORE_DATA_PENDING = 1 << 1
+
+} USB_DEVICE_CDC_TRANSFER_FLAGS;
+
+typedef enum
+{
+    USB_DEVICE_CDC_RESULT_OK = 0,
+    USB_DEVICE_CDC_RESULT_ERROR_TRANSFER_QUEUE_FULL,
+    USB_DEVICE_CDC_RESULT_ERROR_INSTANCE_INVALID,
+    USB_DEVICE_CDC_RESULT_ERROR_INSTANCE_NOT_CONFIGURED,
+    USB_DEVICE_CDC_RESULT_ERROR_PARAMETER_INVALID,
+    USB_DEVICE_CDC_RESULT_ERROR_TRANSFER_SIZE_INVALID,
+    USB_DEVICE_CDC_RESULT_ERROR_ENDPOINT_HALTED,
+    USB_DEVICE_CDC_RESULT_ERROR_TERMINATED_BY_HOST,
+    USB_DEVICE_CDC_RESULT_ERROR
+
+} USB_DEVICE_CDC_RESULT;
+
+typedef enum
+{
+    USB_DEVICE_CDC_EVENT_SET_LINE_CODING,
+    USB_DEVICE_CDC_EVENT_GET_LINE_CODING,
+    USB_DEVICE_CDC_EVENT_SET_CONTROL_LINE_STATE,
+    USB_DEVICE_CDC_EVENT_SEND_BREAK,
+    USB_DEVICE_CDC_EVENT_WRITE_COMPLETE,
+    USB_DEVICE_CDC_EVENT_READ_COMPLETE,
+    USB_DEVICE_CDC_EVENT_SERIAL_STATE_NOTIFICATION_COMPLETE,
+    USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_RECEIVED,
+    USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_SENT,
+    USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_ABORTED
+
+} USB_DEVICE_CDC_EVENT;
+
+typedef enum
+{
+    USB_DEVICE_CDC_EVENT_RESPONSE_NONE = 0
+
+} USB_DEVICE_CDC_EVENT_RESPONSE;
+
+typedef struct
+{
+    USB_DEVICE_CDC_TRANSFER_HANDLE handle;
+    size_t length;
+    USB_DEVICE_CDC_RESULT status;
+
+} USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE, USB_DEVICE_CDC_EVENT_DATA_WRITE_COMPLETE;
+
+typedef struct
+{
+    uint16_t breakDuration;
+
+} USB_DEVICE_CDC_EVENT_DATA_SEND_BREAK;
+
+typedef USB_DEVICE_CDC_EVENT_RESPONSE (*USB_DEVICE_CDC_EVENT_HANDLER)
+(
+    USB_DEVICE_CDC_INDEX instanceIndex,
+    USB_DEVICE_CDC_EVENT event,
+    void * pData,
+    uintptr_t context
+);
+
+USB_DEVICE_CDC_RESULT USB_DEVICE_CDC_EventHandlerSet(USB_DEVICE_CDC_INDEX instanceIndex,
+        USB_DEVICE_CDC_EVENT_HANDLER eventHandler, uintptr_t context);
+USB_DEVICE_CDC_RESULT USB_DEVICE_CDC_Read(USB_DEVICE_CDC_INDEX instanceIndex,
+        USB_DEVICE_CDC_TRANSFER_HANDLE * transferHandle, void * data, size_t size);
+USB_DEVICE_CDC_RESULT USB_DEVICE_CDC_Write(USB_DEVICE_CDC_INDEX instanceIndex,
+        USB_DEVICE_CDC_TRANSFER_HANDLE * transferHandle, const void * data, size_t size,
+        USB_DEVICE_CDC_TRANSFER_FLAGS flags);
+
+/* BSP */
+typedef enum
+{
+    SWITCH_STATE_PRESSED = 0,
+    SWITCH_STATE_RELEASED = 1
+
+} SWITCH_STATE;
+
+void LED_On(void);
+void LED_Off(void);
+void LED2_On(void);
+void LED2_Off(void);
+void LED3_On(void);
+void LED3_Off(void);
+SWITCH_STATE SWITCH_Get(void);
+
+/* System services: timer, interrupts, power saving and the core timer */
+typedef enum
+{
+    SYS_POWER_MODE_IDLE,
+    SYS_POWER_MODE_SLEEP
+
+} SYS_POWER_MODE;
+
+typedef uintptr_t SYS_TMR_HANDLE;
+
+#define SYS_TMR_HANDLE_INVALID          ((SYS_TMR_HANDLE)(-1))
+
+typedef void (*SYS_TMR_CALLBACK)(uintptr_t context, uint32_t currTick);
+
+SYS_TMR_HANDLE SYS_TMR_CallbackPeriodic(uint32_t periodMs, uintptr_t context,
+        SYS_TMR_CALLBACK callback);
+bool SYS_INT_Disable(void);
+void SYS_INT_Enable(void);
+void SYS_DEVCON_PowerModeEnter(SYS_POWER_MODE pwrMode);
+uint32_t _CP0_GET_COUNT(void);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Size of the CDC read and write buffers.  One full speed bulk packet. */
+#define APP_READ_BUFFER_SIZE                    64
+
+/* Switch debounce counts in SOF ticks */
+#define APP_USB_SWITCH_DEBOUNCE_COUNT_FS        150
+#define APP_USB_SWITCH_DEBOUNCE_COUNT_HS        1200
+
+// *****************************************************************************
+/* Application states
+
+  Summary:
+    Application states enumeration
+
+  Description:
+    This enumeration defines the valid application states.  These states
+    determine the behavior of the application at various times.
+*/
+
+typedef enum
+{
+    /* Application's state machine's initial state. */
+    APP_STATE_INIT = 0,
+
+    /* Application waits for device configuration */
+    APP_STATE_WAIT_FOR_CONFIGURATION,
+
+    /* Wait for a character receive */
+    APP_STATE_SCHEDULE_READ,
+
+    /* A character is received from host */
+    APP_STATE_WAIT_FOR_READ_COMPLETE,
+
+    /* Wait for the TX to get completed */
+    APP_STATE_SCHEDULE_WRITE,
+
+    /* Wait for the write to complete */
+    APP_STATE_WAIT_FOR_WRITE_COMPLETE,
+
+    /* Wait for switch press */
+    APP_STATE_CHECK_SWITCH_PRESSED,
+
+    /* Application Error state */
+    APP_STATE_ERROR
+
+} APP_STATES;
+
+
+// *****************************************************************************
+/* Application Data
+
+  Summary:
+    Holds application data
+
+  Description:
+    This structure holds the application's data.
+*/
+
+typedef struct
+{
+    /* Device layer handle returned by device layer open function */
+    USB_DEVICE_HANDLE deviceHandle;
+
+    /* Application's current state */
+    APP_STATES state;
+
+    /* Set Line Coding Data */
+    USB_CDC_LINE_CODING setLineCodingData;
+
+    /* Device configured state */
+    bool isConfigured;
+
+    /* Get Line Coding Data */
+    USB_CDC_LINE_CODING getLineCodingData;
+
+    /* Control Line State */
+    USB_CDC_CONTROL_LINE_STATE controlLineStateData;
+
+    /* Read transfer handle */
+    USB_DEVICE_CDC_TRANSFER_HANDLE readTransferHandle;
+
+    /* Write transfer handle */
+    USB_DEVICE_CDC_TRANSFER_HANDLE writeTransferHandle;
+
+    /* True if a character was read */
+    bool isReadComplete;
+
+    /* True if a character was written*/
+    bool isWriteComplete;
+
+    /* True is switch was pressed */
+    bool isSwitchPressed;
+
+    /* True if the switch press needs to be ignored*/
+    bool ignoreSwitchPress;
+
+    /* Flag determines SOF event occurrence */
+    bool sofEventHasOccurred;
+
+    /* Break data */
+    uint16_t breakData;
+
+    /* Switch debounce timer */
+    unsigned int switchDebounceTimer;
+
+    /* Switch debounce timer count */
+    unsigned int debounceCount;
+
+    /* Application CDC read buffer */
+    uint8_t * cdcReadBuffer;
+
+    /* Application CDC Write buffer */
+    uint8_t * cdcWriteBuffer;
+
+    /* Number of bytes read from Host */
+    uint32_t numBytesRead;
+
+} APP_DATA;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Application Initialization and State Machine Functions
+// *****************************************************************************
+// *****************************************************************************
+
+void APP_Initialize(void);
+void APP_Tasks(void);
+
+#endif /* _APP_H */
+
+/*******************************************************************************
+ End of File
+ */
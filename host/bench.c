@@ -0,0 +1,391 @@
+/*******************************************************************************
+  Host Throughput Benchmark
+
+  File Name:
+    bench.c
+
+  Summary:
+    Drives APP_Tasks() with a scripted expression stream and reports
+    expressions/second, bytes/second and per-expression latency.
+
+  Description:
+    The benchmark is linked against one of the firmware variants (PUNTO=1 or
+    PUNTO=2) and the simulated USB stack.  The host sends the same expression
+    n times on each of -P CDC ports at once.  Latency is measured from the read completion that delivers the
+    '=' of an expression to the write completion that carries the carriage
+    return ending its result.  Simulated ticks are reported next to wall
+    clock time: ticks count USB turnarounds and are independent of the
+    machine running the benchmark.  The superloop runs several times per
+    tick (-k), as it does on the device between two USB frames.  On x86 the
+    time stamp counter gives a cycles-per-input-byte figure for the whole
+    loop, parsing and simulated driver included.  With several ports the
+    spread between the most and the least answered port at the moment the
+    first port finishes shows how evenly APP_Tasks shares the device.
+
+    The firmware's own figures follow: the response time it measures from
+    a read completion to the write that answers it, and, over -i ticks with
+    no input after the run, how many passes of APP_Tasks idled the core.
+    A polling build never idles; the bench_puntoN_event builds should idle
+    on every pass, the ones that take a switch sample tick included.  The
+    bench_puntoN_perf builds finally send the counter dump request and
+    print the report the firmware answers with.
+
+    Usage: bench_puntoN [-n expressions] [-e expression] [-p packetSize]
+                        [-r readTicks] [-w writeTicks] [-k tasksPerTick]
+                        [-P ports] [-i idleTicks]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "app_event.h"
+#include "bench_util.h"
+
+/* Kept by the firmware, see app_event.h */
+extern APP_EVENT_STATS appEventStats;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#endif
+
+#if PUNTO == 2
+#define BENCH_DEFAULT_EXPRESSION        "(1.5*2.25)="
+#else
+#define BENCH_DEFAULT_EXPRESSION        "(12+34)="
+#endif
+
+#define BENCH_RESULT_MAX                64
+
+#if APP_PERF
+/* Byte that asks the firmware for its counters */
+static const uint8_t BENCH_PerfDump[] = { 0x14 };
+#endif
+
+typedef struct
+{
+    /* Time at which each '=' reached the device, per port, consumed in order */
+    uint64_t * sent[USB_DEVICE_CDC_INSTANCES_NUMBER];
+    size_t sentCount[USB_DEVICE_CDC_INSTANCES_NUMBER];
+    size_t answered[USB_DEVICE_CDC_INSTANCES_NUMBER];
+
+    /* Latency of each completed expression in nanoseconds, all ports */
+    uint64_t * latency;
+    size_t results;
+
+    /* Answered count of every port when the first one got all its results */
+    size_t firstDone[USB_DEVICE_CDC_INSTANCES_NUMBER];
+    bool anyDone;
+
+    /* First result as written by the device, for eyeballing correctness */
+    char firstResult[BENCH_RESULT_MAX];
+    size_t firstResultLength;
+    bool firstResultDone;
+
+    /* Expressions per port */
+    size_t expected;
+    unsigned ports;
+
+} BENCH;
+
+static void BENCH_Input(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH * bench = (BENCH *)context;
+    uint64_t now = BENCH_Now();
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (data[i] == '=' && bench->sentCount[index] < bench->expected)
+        {
+            bench->sent[index][bench->sentCount[index]++] = now;
+        }
+    }
+}
+
+static void BENCH_Output(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH * bench = (BENCH *)context;
+    uint64_t now = BENCH_Now();
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (!bench->firstResultDone && (bench->firstResultLength || data[i] == '='))
+        {
+            if (bench->firstResultLength < BENCH_RESULT_MAX - 1)
+            {
+                bench->firstResult[bench->firstResultLength++] = (char)data[i];
+            }
+            bench->firstResultDone = (data[i] == 0x0D);
+        }
+        if (data[i] == 0x0D && bench->answered[index] < bench->sentCount[index])
+        {
+            bench->latency[bench->results++] = now - bench->sent[index][bench->answered[index]++];
+            if (!bench->anyDone && bench->answered[index] == bench->expected)
+            {
+                memcpy(bench->firstDone, bench->answered, sizeof(bench->firstDone));
+                bench->anyDone = true;
+            }
+        }
+    }
+}
+
+#if APP_PERF
+/* Prints the counter report as it arrives, with plain newlines */
+static void BENCH_Report(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (data[i] != 0x0D)
+        {
+            putchar(data[i]);
+        }
+    }
+}
+#endif
+
+static int BENCH_Compare(const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void BENCH_Printable(char * s)
+{
+    for (; *s; s++)
+    {
+        if (*s == 0x0D)
+        {
+            *s = '\0';
+            break;
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const char * expression = BENCH_DEFAULT_EXPRESSION;
+    size_t count = 100000;
+    size_t packetSize = 0;
+    unsigned readTicks = 1;
+    unsigned writeTicks = 1;
+    unsigned tasksPerTick = 8;
+    unsigned ports = 1, p;
+    size_t idleTicks = 1000;
+    uint64_t idleBefore;
+    size_t total, pending, fewest, most;
+    size_t expressionLength;
+    size_t idle = 0;
+    uint8_t * script;
+    uint64_t start, elapsed, sum = 0;
+    uint64_t cycles = 0;
+    const SIM_STATS * stats;
+    BENCH bench;
+    size_t i, k;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:e:p:r:w:k:P:i:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'e': expression = optarg; break;
+            case 'p': packetSize = strtoul(optarg, NULL, 0); break;
+            case 'r': readTicks = strtoul(optarg, NULL, 0); break;
+            case 'w': writeTicks = strtoul(optarg, NULL, 0); break;
+            case 'k': tasksPerTick = strtoul(optarg, NULL, 0); break;
+            case 'P': ports = strtoul(optarg, NULL, 0); break;
+            case 'i': idleTicks = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n expressions] [-e expression] "
+                        "[-p packetSize] [-r readTicks] [-w writeTicks] [-k tasksPerTick] "
+                        "[-P ports] [-i idleTicks]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (ports == 0 || ports > USB_DEVICE_CDC_INSTANCES_NUMBER)
+    {
+        fprintf(stderr, "ports must be 1..%d\n", USB_DEVICE_CDC_INSTANCES_NUMBER);
+        return 2;
+    }
+    total = count * ports;
+
+    expressionLength = strlen(expression);
+    script = malloc(expressionLength * count);
+    memset(&bench, 0, sizeof(bench));
+    bench.expected = count;
+    bench.ports = ports;
+    bench.latency = calloc(total, sizeof(uint64_t));
+    if (script == NULL || bench.latency == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (p = 0; p < ports; p++)
+    {
+        bench.sent[p] = calloc(count, sizeof(uint64_t));
+        if (bench.sent[p] == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < count; i++)
+    {
+        memcpy(script + i * expressionLength, expression, expressionLength);
+    }
+
+    SIM_Reset();
+    SIM_LatencySet(readTicks, writeTicks);
+    SIM_CDC_InputHandlerSet(BENCH_Input, (uintptr_t)&bench);
+    SIM_CDC_OutputHandlerSet(BENCH_Output, (uintptr_t)&bench);
+    APP_Initialize();
+    SIM_Attach();
+
+    /* Bring the device up before the clock starts */
+    for (i = 0; i < 16; i++)
+    {
+        APP_Tasks();
+        SIM_Poll();
+    }
+    for (p = 0; p < ports; p++)
+    {
+        SIM_CDC_ScriptSet(p, script, expressionLength * count, packetSize);
+    }
+
+    start = BENCH_Now();
+#ifdef BENCH_CYCLES
+    cycles = BENCH_CYCLES();
+#endif
+    while (bench.results < total)
+    {
+        size_t before = bench.results;
+
+        for (k = 0; k < tasksPerTick; k++)
+        {
+            APP_Tasks();
+        }
+        SIM_Poll();
+
+        /* Stop if the device has consumed everything and stopped answering */
+        for (p = 0, pending = 0; p < ports; p++)
+        {
+            pending += SIM_CDC_Pending(p);
+        }
+        if (bench.results == before && pending == 0)
+        {
+            if (++idle > 1000)
+            {
+                break;
+            }
+        }
+        else
+        {
+            idle = 0;
+        }
+    }
+#ifdef BENCH_CYCLES
+    cycles = BENCH_CYCLES() - cycles;
+#endif
+    elapsed = BENCH_Now() - start;
+    stats = SIM_StatsGet();
+
+    for (i = 0; i < bench.results; i++)
+    {
+        sum += bench.latency[i];
+    }
+    qsort(bench.latency, bench.results, sizeof(uint64_t), BENCH_Compare);
+    BENCH_Printable(bench.firstResult);
+
+    printf("variant            punto%d\n", PUNTO);
+    printf("expression         %s  ->  %s\n", expression, bench.firstResult);
+    printf("expressions        %zu sent, %zu answered\n", total, bench.results);
+    if (ports > 1)
+    {
+        for (p = 0, fewest = count, most = 0; p < ports; p++)
+        {
+            fewest = (bench.firstDone[p] < fewest) ? bench.firstDone[p] : fewest;
+            most = (bench.firstDone[p] > most) ? bench.firstDone[p] : most;
+        }
+        printf("ports              %u, answered %zu..%zu when the first finished\n",
+                ports, fewest, most);
+    }
+    printf("bytes              %llu in, %llu out\n",
+            (unsigned long long)stats->bytesIn, (unsigned long long)stats->bytesOut);
+    printf("transfers          %llu reads, %llu writes\n",
+            (unsigned long long)stats->reads, (unsigned long long)stats->writes);
+    printf("elapsed            %.3f ms\n", elapsed / 1e6);
+    printf("throughput         %.0f expr/s, %.0f bytes/s\n",
+            bench.results * 1e9 / elapsed, stats->bytesIn * 1e9 / elapsed);
+    if (cycles && stats->bytesIn)
+    {
+        printf("cycles             %.1f per input byte\n", (double)cycles / stats->bytesIn);
+    }
+    printf("sim ticks          %llu (%.2f per expression, %llu read stall)\n",
+            (unsigned long long)stats->ticks,
+            bench.results ? (double)stats->ticks / bench.results : 0.0,
+            (unsigned long long)stats->readStallTicks);
+    if (bench.results)
+    {
+        printf("latency (us)       avg %.3f  p50 %.3f  p99 %.3f  max %.3f\n",
+                sum / 1e3 / bench.results,
+                bench.latency[bench.results / 2] / 1e3,
+                bench.latency[(bench.results * 99) / 100] / 1e3,
+                bench.latency[bench.results - 1] / 1e3);
+    }
+    if (appEventStats.responses)
+    {
+        printf("device response    avg %.3f  max %.3f us (read completion to write), %u responses\n",
+                appEventStats.latencySum / 1e3 / appEventStats.responses,
+                appEventStats.latencyMax / 1e3, appEventStats.responses);
+    }
+
+    /* Nothing left to send: how much of the time does the device sleep */
+    idleBefore = stats->idleEntries;
+    for (i = 0; i < idleTicks; i++)
+    {
+        for (k = 0; k < tasksPerTick; k++)
+        {
+            APP_Tasks();
+        }
+        SIM_Poll();
+    }
+    if (idleTicks && tasksPerTick)
+    {
+        printf("idle               %llu of %zu passes idled the core over %zu ticks\n",
+                (unsigned long long)(stats->idleEntries - idleBefore),
+                idleTicks * tasksPerTick, idleTicks);
+    }
+
+#if APP_PERF
+    /* Counters in core timer counts, nanoseconds in the host build */
+    SIM_CDC_OutputHandlerSet(BENCH_Report, 0);
+    SIM_CDC_ScriptSet(0, BENCH_PerfDump, sizeof(BENCH_PerfDump), 0);
+    for (i = 0; i < 64; i++)
+    {
+        for (k = 0; k < tasksPerTick; k++)
+        {
+            APP_Tasks();
+        }
+        SIM_Poll();
+    }
+#endif
+
+    free(script);
+    for (p = 0; p < ports; p++)
+    {
+        free(bench.sent[p]);
+    }
+    free(bench.latency);
+
+    return (bench.results == total) ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+/*******************************************************************************
+  Bignum Benchmark
+
+  File Name:
+    bench_bignum.c
+
+  Summary:
+    Times punto1 in bignum mode on 100, 1000 and 10000 digit operands.
+
+  Description:
+    For every operand size and operator a batch of random expressions
+    "(a op b)=" is fed through calcStep(), with the ring drained and
+    calcFlush() called as APP_PortTasks would, so the time includes reading
+    the digits, the arithmetic and streaming the result out.  Divisors have
+    half as many digits as dividends so quotients are long too.
+
+    Every printed result is then checked against schoolbook arithmetic on
+    one decimal digit per byte, which shares no code with app_bignum.c:
+    sums, differences and products directly, quotients q of a / b through
+    q * b <= a < (q + 1) * b.
+
+    Built with CALC_BIGNUM, CALC_BIG_DIGITOS=10000 and APP_BATCH_MODE.
+
+    Usage: bench_bignum [-n scale]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "app.h"
+#include "interfacesP4punto1.h"
+#include "bench_util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0
+#endif
+
+#if !CALC_BIGNUM
+#error "bench_bignum needs CALC_BIGNUM=1"
+#endif
+
+/* Decimal reference number, least significant digit first */
+typedef struct
+{
+    uint8_t * digit;
+    size_t length;          /* No leading zeros, zero has length 0 */
+
+} BENCH_NUMBER;
+
+static BENCH_NUMBER BENCH_Alloc(size_t capacity)
+{
+    BENCH_NUMBER n;
+
+    n.digit = calloc(capacity + 1, 1);
+    n.length = 0;
+    if (n.digit == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return n;
+}
+
+static void BENCH_Trim(BENCH_NUMBER * n)
+{
+    while (n->length > 0 && n->digit[n->length - 1] == 0)
+    {
+        n->length--;
+    }
+}
+
+static int BENCH_Compare(const BENCH_NUMBER * a, const BENCH_NUMBER * b)
+{
+    size_t i;
+
+    if (a->length != b->length)
+    {
+        return (a->length < b->length) ? -1 : 1;
+    }
+    for (i = a->length; i-- > 0; )
+    {
+        if (a->digit[i] != b->digit[i])
+        {
+            return (a->digit[i] < b->digit[i]) ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void BENCH_Add(BENCH_NUMBER * r, const BENCH_NUMBER * a, const BENCH_NUMBER * b)
+{
+    size_t length = (a->length > b->length) ? a->length : b->length, i;
+    unsigned carry = 0, s;
+
+    for (i = 0; i < length; i++)
+    {
+        s = ((i < a->length) ? a->digit[i] : 0) + ((i < b->length) ? b->digit[i] : 0) + carry;
+        r->digit[i] = (uint8_t)(s % 10);
+        carry = s / 10;
+    }
+    r->digit[length] = (uint8_t)carry;
+    r->length = length + 1;
+    BENCH_Trim(r);
+}
+
+/* r = a - b with a >= b */
+static void BENCH_Sub(BENCH_NUMBER * r, const BENCH_NUMBER * a, const BENCH_NUMBER * b)
+{
+    int borrow = 0, d;
+    size_t i;
+
+    for (i = 0; i < a->length; i++)
+    {
+        d = a->digit[i] - ((i < b->length) ? b->digit[i] : 0) - borrow;
+        borrow = (d < 0);
+        r->digit[i] = (uint8_t)(borrow ? d + 10 : d);
+    }
+    r->length = a->length;
+    BENCH_Trim(r);
+}
+
+static void BENCH_Mul(BENCH_NUMBER * r, const BENCH_NUMBER * a, const BENCH_NUMBER * b, uint32_t * work)
+{
+    size_t i, j;
+    uint32_t carry;
+
+    memset(work, 0, (a->length + b->length + 1) * sizeof(uint32_t));
+    for (i = 0; i < a->length; i++)
+    {
+        for (j = 0; j < b->length; j++)
+        {
+            work[i + j] += (uint32_t)a->digit[i] * b->digit[j];
+        }
+        /* Keep every column below 2^32 */
+        if ((i & 1023) == 1023)
+        {
+            for (j = 0, carry = 0; j < a->length + b->length; j++)
+            {
+                work[j] += carry;
+                carry = work[j] / 10;
+                work[j] %= 10;
+            }
+        }
+    }
+    for (j = 0, carry = 0; j < a->length + b->length; j++)
+    {
+        work[j] += carry;
+        carry = work[j] / 10;
+        r->digit[j] = (uint8_t)(work[j] % 10);
+    }
+    r->length = a->length + b->length;
+    BENCH_Trim(r);
+}
+
+/* Random number of exactly digits digits */
+static void BENCH_Make(BENCH_NUMBER * n, size_t digits, uint32_t * seed)
+{
+    size_t i;
+
+    for (i = 0; i < digits; i++)
+    {
+        n->digit[i] = (uint8_t)(BENCH_Random(seed) % 10);
+    }
+    if (digits > 0 && n->digit[digits - 1] == 0)
+    {
+        n->digit[digits - 1] = 1;
+    }
+    n->length = digits;
+}
+
+static char * BENCH_Write(char * p, const BENCH_NUMBER * n)
+{
+    size_t i;
+
+    if (n->length == 0)
+    {
+        *p++ = '0';
+    }
+    for (i = n->length; i-- > 0; )
+    {
+        *p++ = (char)('0' + n->digit[i]);
+    }
+    return p;
+}
+
+/* Reads a printed result, "=-123\r" */
+static bool BENCH_Read(const char ** p, const char * end, BENCH_NUMBER * n, bool * negative)
+{
+    const char * start;
+    size_t i, digits;
+
+    if (*p >= end || **p != '=')
+    {
+        return false;
+    }
+    (*p)++;
+    *negative = (*p < end && **p == '-');
+    *p += *negative;
+    start = *p;
+    while (*p < end && **p >= '0' && **p <= '9')
+    {
+        (*p)++;
+    }
+    if (*p == start || *p >= end || **p != 0x0D)
+    {
+        return false;
+    }
+    digits = (size_t)(*p - start);
+    for (i = 0; i < digits; i++)
+    {
+        n->digit[i] = (uint8_t)(start[digits - 1 - i] - '0');
+    }
+    n->length = digits;
+    BENCH_Trim(n);
+    (*p)++;
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    static const size_t sizes[3] = { 100, 1000, 10000 };
+    static const size_t counts[3] = { 2000, 100, 4 };
+    static const char operators[4] = { '+', '-', '*', '/' };
+    static CALC_SESSION session;
+    static APP_TXRING ring;
+    size_t scale = 1, count, digits, i, k, length, outLength, chunk;
+    uint32_t seed = 0x2545F491u;
+    BENCH_NUMBER * a, * b, r, t, u;
+    char * stream, * out, * p;
+    const char * q;
+    const uint8_t * data;
+    uint32_t * work;
+    uint64_t start, elapsed, cycles;
+    bool negative, ok;
+    int s, o, opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': scale = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n scale]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (scale == 0)
+    {
+        fprintf(stderr, "scale must be nonzero\n");
+        return 2;
+    }
+
+    printf("%-8s %-3s %6s %14s %16s\n", "digits", "op", "exprs", "us per expr", "cycles per expr");
+    for (s = 0; s < 3; s++)
+    {
+        digits = sizes[s];
+        count = counts[s] * scale;
+        a = malloc(count * sizeof(BENCH_NUMBER));
+        b = malloc(count * sizeof(BENCH_NUMBER));
+        stream = malloc(count * (2 * digits + 4));
+        out = malloc(count * (2 * digits + 4));
+        work = malloc((2 * digits + 1) * sizeof(uint32_t));
+        r = BENCH_Alloc(2 * digits + 1);
+        t = BENCH_Alloc(2 * digits + 1);
+        u = BENCH_Alloc(2 * digits + 1);
+        if (a == NULL || b == NULL || stream == NULL || out == NULL || work == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (i = 0; i < count; i++)
+        {
+            a[i] = BENCH_Alloc(digits);
+            b[i] = BENCH_Alloc(digits);
+        }
+
+        for (o = 0; o < 4; o++)
+        {
+            p = stream;
+            for (i = 0; i < count; i++)
+            {
+                BENCH_Make(&a[i], digits, &seed);
+                BENCH_Make(&b[i], (operators[o] == '/') ? digits / 2 : digits, &seed);
+                *p++ = '(';
+                p = BENCH_Write(p, &a[i]);
+                *p++ = operators[o];
+                p = BENCH_Write(p, &b[i]);
+                *p++ = ')';
+                *p++ = '=';
+            }
+            length = (size_t)(p - stream);
+
+            /* Timed: parse, compute and stream every result out */
+            APP_TXRING_Initialize(&ring);
+            calcSessionInit(&session, &ring, false);
+            outLength = 0;
+            start = BENCH_Now();
+            cycles = BENCH_CYCLES();
+            for (k = 0; k < length; k++)
+            {
+                calcStep(&session, stream[k]);
+                do
+                {
+                    while ((chunk = APP_TXRING_Peek(&ring, &data, APP_TXRING_SIZE)) != 0)
+                    {
+                        memcpy(out + outLength, data, chunk);
+                        outLength += chunk;
+                        APP_TXRING_Release(&ring, chunk);
+                    }
+                } while (calcFlush(&session));
+            }
+            cycles = BENCH_CYCLES() - cycles;
+            elapsed = BENCH_Now() - start;
+            while ((chunk = APP_TXRING_Peek(&ring, &data, APP_TXRING_SIZE)) != 0)
+            {
+                memcpy(out + outLength, data, chunk);
+                outLength += chunk;
+                APP_TXRING_Release(&ring, chunk);
+            }
+
+            /* Check every result with the decimal reference */
+            q = out;
+            for (i = 0; i < count; i++)
+            {
+                ok = BENCH_Read(&q, out + outLength, &r, &negative);
+                if (ok)
+                {
+                    switch (operators[o])
+                    {
+                        case '+':
+                            BENCH_Add(&t, &a[i], &b[i]);
+                            ok = !negative && BENCH_Compare(&r, &t) == 0;
+                            break;
+                        case '-':
+                            if (BENCH_Compare(&a[i], &b[i]) >= 0)
+                            {
+                                BENCH_Sub(&t, &a[i], &b[i]);
+                                ok = !negative;
+                            }
+                            else
+                            {
+                                BENCH_Sub(&t, &b[i], &a[i]);
+                                ok = negative;
+                            }
+                            ok = ok && BENCH_Compare(&r, &t) == 0;
+                            break;
+                        case '*':
+                            BENCH_Mul(&t, &a[i], &b[i], work);
+                            ok = !negative && BENCH_Compare(&r, &t) == 0;
+                            break;
+                        default:
+                            /* 0 <= a - q * b < b */
+                            BENCH_Mul(&t, &r, &b[i], work);
+                            ok = !negative && BENCH_Compare(&t, &a[i]) <= 0;
+                            if (ok)
+                            {
+                                BENCH_Sub(&u, &a[i], &t);
+                                ok = BENCH_Compare(&u, &b[i]) < 0;
+                            }
+                            break;
+                    }
+                }
+                if (!ok)
+                {
+                    printf("wrong result for expression %zu of %zu digits with '%c'\n", i, digits, operators[o]);
+                    return 1;
+                }
+            }
+            if (q != out + outLength || ring.dropped != 0)
+            {
+                printf("unexpected output after %zu digit '%c' results\n", digits, operators[o]);
+                return 1;
+            }
+
+            printf("%-8zu %-3c %6zu %14.2f", digits, operators[o], count, elapsed / 1e3 / (double)count);
+            if (cycles)
+            {
+                printf(" %16.0f", (double)cycles / (double)count);
+            }
+            printf("\n");
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            free(a[i].digit);
+            free(b[i].digit);
+        }
+        free(r.digit);
+        free(t.digit);
+        free(u.digit);
+        free(work);
+        free(out);
+        free(stream);
+        free(b);
+        free(a);
+    }
+    printf("all results verified\n");
+    return 0;
+}
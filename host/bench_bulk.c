@@ -0,0 +1,459 @@
+/*******************************************************************************
+  Bulk Request Benchmark
+
+  File Name:
+    bench_bulk.c
+
+  Summary:
+    The kernels of app_bulk.h against a plain loop, then n operations as
+    one request frame each against the same ones as bulk requests.
+
+  Description:
+    The kernel part runs every operator of both kernels over the same
+    array of operands, which begins with the edge values (INT32_MIN, -1,
+    0, INT32_MAX, ...), and reports elements per second of wall clock for
+    the kernel and for a one element at a time loop written here.  Every
+    result of the kernel must equal that loop's, bit for bit, and a
+    division by 0 must give -1 throughout.
+
+    The protocol part sends n operations on port 0 switched to the binary
+    protocol, +, -, * and / in quarters with one scalar each: once as n
+    request frames and once as four bulk requests of n / 4 operands.  Both
+    streams travel in full 64 byte packets.  For each path the benchmark
+    reports the bytes moved, transfers, simulated ticks and operations per
+    second, and checks every result against the plain loop.
+
+    Usage: bench_bulk_puntoN [-n operations] [-r kernelRepeats] [-k tasksPerTick]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "app_frame.h"
+#include "app_bulk.h"
+#include "bench_util.h"
+
+/* APP_FRAME_DTE_RATE of the firmware */
+#define BENCH_FRAME_RATE                314159
+
+#define BENCH_PACKET                    64
+
+/* Operands of the kernel part */
+#define BENCH_KERNEL_COUNT              4096
+
+#if PUNTO == 2
+#define BENCH_FORMAT                    APP_FRAME_FLOAT32
+#else
+#define BENCH_FORMAT                    APP_FRAME_INT32
+#endif
+
+typedef struct
+{
+    /* What the results must read, packed as on the wire */
+    const uint8_t * expected;
+    size_t count;
+
+    size_t results;
+    size_t errors;
+
+    /* A response or a result split over two packets */
+    uint8_t frame[APP_FRAME_RESPONSE_MAX];
+    size_t frameLength;
+
+    /* Results the last bulk header announced and not received yet */
+    size_t pending;
+
+} BENCH_BULK;
+
+typedef struct
+{
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t transfers;
+    uint64_t ticks;
+    uint64_t elapsed;
+    size_t results;
+    size_t errors;
+
+} BENCH_RUN;
+
+static uint32_t benchSeed = 12345;
+
+static int32_t BENCH_Int32(unsigned op, int32_t a, int32_t b)
+{
+    switch (op)
+    {
+        case 0: return (int32_t)((uint32_t)a + (uint32_t)b);
+        case 1: return (int32_t)((uint32_t)a - (uint32_t)b);
+        case 2: return (int32_t)((uint32_t)a * (uint32_t)b);
+        default:
+            if (b == 0)
+            {
+                return -1;
+            }
+            return (b == -1) ? (int32_t)(0u - (uint32_t)a) : a / b;
+    }
+}
+
+static float BENCH_Float32(unsigned op, float a, float b)
+{
+    switch (op)
+    {
+        case 0: return a + b;
+        case 1: return a - b;
+        case 2: return a * b;
+        default: return (b == 0) ? -1.0f : a / b;
+    }
+}
+
+/* The plain loop, one operand at a time */
+static void BENCH_Reference(bool isFloat, unsigned op, uint32_t scalar, const uint8_t * in,
+        uint8_t * out, size_t count)
+{
+    uint32_t bits;
+    int32_t a, b;
+    float x, y;
+    size_t k;
+
+    for (k = 0; k < count; k++)
+    {
+        memcpy(&bits, &in[4 * k], 4);
+        if (isFloat)
+        {
+            memcpy(&x, &bits, 4);
+            memcpy(&y, &scalar, 4);
+            x = BENCH_Float32(op, x, y);
+            memcpy(&bits, &x, 4);
+        }
+        else
+        {
+            a = (int32_t)bits;
+            b = (int32_t)scalar;
+            bits = (uint32_t)BENCH_Int32(op, a, b);
+        }
+        memcpy(&out[4 * k], &bits, 4);
+    }
+}
+
+static void BENCH_Kernel(bool isFloat, unsigned op, uint32_t scalar, const uint8_t * in,
+        uint8_t * out, size_t count)
+{
+    float f;
+
+    if (isFloat)
+    {
+        memcpy(&f, &scalar, 4);
+        APP_BULK_Float32(op, f, in, out, count);
+    }
+    else
+    {
+        APP_BULK_Int32(op, (int32_t)scalar, in, out, count);
+    }
+}
+
+/* Every operator of one kernel over in, some scalars each; returns the
+ * results that differ from the plain loop's */
+static size_t BENCH_Kernels(bool isFloat, const uint8_t * in, unsigned repeats)
+{
+    static const int32_t scalarsInt[] = { 7, -1, 0, INT32_MIN, 1000003 };
+    static const float scalarsFloat[] = { 7.0f, -1.0f, 0.0f, 0.001f, 1e30f };
+    static uint8_t out[4 * BENCH_KERNEL_COUNT], ref[4 * BENCH_KERNEL_COUNT];
+    uint64_t elapsed[2] = { 0, 0 }, start;
+    size_t errors = 0, k;
+    unsigned op, s, r;
+    uint32_t scalar;
+
+    for (op = 0; op < 4; op++)
+    {
+        for (s = 0; s < 5; s++)
+        {
+            if (isFloat)
+            {
+                memcpy(&scalar, &scalarsFloat[s], 4);
+            }
+            else
+            {
+                scalar = (uint32_t)scalarsInt[s];
+            }
+
+            start = BENCH_Now();
+            for (r = 0; r < repeats; r++)
+            {
+                BENCH_Kernel(isFloat, op, scalar, in, out, BENCH_KERNEL_COUNT);
+            }
+            elapsed[0] += BENCH_Now() - start;
+
+            start = BENCH_Now();
+            for (r = 0; r < repeats; r++)
+            {
+                BENCH_Reference(isFloat, op, scalar, in, ref, BENCH_KERNEL_COUNT);
+            }
+            elapsed[1] += BENCH_Now() - start;
+
+            for (k = 0; k < BENCH_KERNEL_COUNT; k++)
+            {
+                errors += (memcmp(&out[4 * k], &ref[4 * k], 4) != 0);
+            }
+        }
+    }
+
+    printf("%-7s kernel    %12.0f elements/s\n", isFloat ? "float" : "int32",
+            20.0 * repeats * BENCH_KERNEL_COUNT * 1e9 / elapsed[0]);
+    printf("%-7s one by one %11.0f elements/s\n", isFloat ? "float" : "int32",
+            20.0 * repeats * BENCH_KERNEL_COUNT * 1e9 / elapsed[1]);
+    return errors;
+}
+
+static void BENCH_Check(BENCH_BULK * bench, const uint8_t * result)
+{
+    if (bench->results < bench->count &&
+            memcmp(result, &bench->expected[4 * bench->results], 4) != 0)
+    {
+        bench->errors++;
+    }
+    bench->results++;
+}
+
+/* n request frames: each response carries one result */
+static void BENCH_Frames(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH_BULK * bench = (BENCH_BULK *)context;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        bench->frame[bench->frameLength++] = data[i];
+        if (bench->frameLength == 8)
+        {
+            if (bench->frame[0] != 7 || (bench->frame[3] & 0x0F) != APP_FRAME_OK)
+            {
+                bench->errors++;
+            }
+            BENCH_Check(bench, &bench->frame[4]);
+            bench->frameLength = 0;
+        }
+    }
+}
+
+/* Bulk requests: a header announcing the results, then the results */
+static void BENCH_Bulk(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH_BULK * bench = (BENCH_BULK *)context;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        bench->frame[bench->frameLength++] = data[i];
+        if (bench->pending > 0 && bench->frameLength == 4)
+        {
+            BENCH_Check(bench, bench->frame);
+            bench->pending--;
+            bench->frameLength = 0;
+        }
+        else if (bench->pending == 0 && bench->frameLength == 8)
+        {
+            if (bench->frame[0] != 7 || bench->frame[3] != (APP_FRAME_BULK | (BENCH_FORMAT << 4)))
+            {
+                bench->errors++;
+            }
+            bench->pending = (size_t)bench->frame[4] | ((size_t)bench->frame[5] << 8) |
+                    ((size_t)bench->frame[6] << 16) | ((size_t)bench->frame[7] << 24);
+            bench->frameLength = 0;
+        }
+    }
+}
+
+static size_t BENCH_Put(uint8_t * data, uint64_t value, size_t width)
+{
+    size_t k;
+
+    for (k = 0; k < width; k++)
+    {
+        data[k] = (uint8_t)(value >> (8 * k));
+    }
+    return width;
+}
+
+static void BENCH_Run(BENCH_RUN * run, BENCH_BULK * bench, bool bulk,
+        const uint8_t * script, size_t scriptLength, unsigned tasksPerTick)
+{
+    const SIM_STATS * stats;
+    size_t idle = 0, i, before;
+    unsigned k;
+
+    bench->results = 0;
+    bench->errors = 0;
+    bench->frameLength = 0;
+    bench->pending = 0;
+
+    SIM_Reset();
+    SIM_CDC_OutputHandlerSet(bulk ? BENCH_Bulk : BENCH_Frames, (uintptr_t)bench);
+    APP_Initialize();
+    SIM_Attach();
+    for (i = 0; i < 16; i++)
+    {
+        APP_Tasks();
+        SIM_Poll();
+    }
+    SIM_CDC_LineCodingSet(0, BENCH_FRAME_RATE);
+    SIM_CDC_ScriptSet(0, script, scriptLength, BENCH_PACKET);
+    stats = SIM_StatsGet();
+    run->ticks = stats->ticks;
+
+    run->elapsed = BENCH_Now();
+    while (bench->results < bench->count && idle < 1000)
+    {
+        before = bench->results;
+        for (k = 0; k < tasksPerTick; k++)
+        {
+            APP_Tasks();
+        }
+        SIM_Poll();
+        idle = (bench->results == before && SIM_CDC_Pending(0) == 0) ? idle + 1 : 0;
+    }
+    run->elapsed = BENCH_Now() - run->elapsed;
+    run->ticks = stats->ticks - run->ticks;
+    run->bytesIn = stats->bytesIn;
+    run->bytesOut = stats->bytesOut;
+    run->transfers = stats->reads + stats->writes;
+    run->results = bench->results;
+    run->errors = bench->errors;
+}
+
+int main(int argc, char ** argv)
+{
+    static const int32_t edges[] = { INT32_MIN, INT32_MIN + 1, -65536, -7, -1, 0, 1, 7,
+            65535, INT32_MAX - 1, INT32_MAX };
+    static uint8_t kernelIn[2][4 * BENCH_KERNEL_COUNT];
+    size_t count = 100000, quarter, kernelErrors, i, k;
+    unsigned tasksPerTick = 8, repeats = 200;
+    uint8_t * operands, * expected, * frames, * bulk;
+    size_t framesLength = 0, bulkLength = 0;
+    uint32_t scalars[4], bits;
+    BENCH_BULK bench;
+    BENCH_RUN run[2];
+    unsigned op;
+    float f;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:k:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'r': repeats = strtoul(optarg, NULL, 0); break;
+            case 'k': tasksPerTick = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n operations] [-r kernelRepeats] [-k tasksPerTick]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    if (count < 4 || repeats == 0 || tasksPerTick == 0)
+    {
+        fprintf(stderr, "operations must be 4 or more, repeats and tasksPerTick nonzero\n");
+        return 2;
+    }
+
+    /* The edge values first, then random ones; floats of every magnitude */
+    for (k = 0; k < BENCH_KERNEL_COUNT; k++)
+    {
+        bits = (k < sizeof(edges) / sizeof(edges[0])) ? (uint32_t)edges[k] :
+                BENCH_Random(&benchSeed);
+        memcpy(&kernelIn[0][4 * k], &bits, 4);
+        f = (float)(int32_t)bits / (float)(1u << (BENCH_Random(&benchSeed) % 31));
+        memcpy(&kernelIn[1][4 * k], &f, 4);
+    }
+    printf("variant            punto%d\n", PUNTO);
+    kernelErrors = BENCH_Kernels(false, kernelIn[0], repeats);
+    kernelErrors += BENCH_Kernels(true, kernelIn[1], repeats);
+    printf("kernel mismatches  %zu\n", kernelErrors);
+
+    /* The operations, as request frames and as four bulk requests */
+    count -= count % 4;
+    quarter = count / 4;
+    operands = malloc(count * 4);
+    expected = malloc(count * 4);
+    frames = malloc(count * APP_FRAME_REQUEST_MAX);
+    bulk = malloc(count * 4 + 4 * APP_FRAME_REQUEST_MAX);
+    if (operands == NULL || expected == NULL || frames == NULL || bulk == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (op = 0; op < 4; op++)
+    {
+#if PUNTO == 2
+        f = (float)(int32_t)(BENCH_Random(&benchSeed) % 1999 + 1) / 8.0f;
+        memcpy(&scalars[op], &f, 4);
+#else
+        scalars[op] = BENCH_Random(&benchSeed) % 999 + 1;
+#endif
+    }
+    for (i = 0; i < count; i++)
+    {
+        /* Keeps the products of punto1's calcOpera clear of overflow */
+#if PUNTO == 2
+        f = (float)((int32_t)(BENCH_Random(&benchSeed) % 2000001) - 1000000) / 64.0f;
+        memcpy(&bits, &f, 4);
+#else
+        bits = (uint32_t)((int32_t)(BENCH_Random(&benchSeed) % 2000001) - 1000000);
+#endif
+        memcpy(&operands[4 * i], &bits, 4);
+    }
+    for (op = 0; op < 4; op++)
+    {
+        BENCH_Reference(PUNTO == 2, op, scalars[op], &operands[4 * op * quarter],
+                &expected[4 * op * quarter], quarter);
+
+        bulk[bulkLength++] = 3 + 4 + 4;
+        bulkLength += BENCH_Put(&bulk[bulkLength], op, 2);
+        bulk[bulkLength++] = (uint8_t)(op | APP_FRAME_BULK | (BENCH_FORMAT << 4));
+        bulkLength += BENCH_Put(&bulk[bulkLength], scalars[op], 4);
+        bulkLength += BENCH_Put(&bulk[bulkLength], quarter, 4);
+        memcpy(&bulk[bulkLength], &operands[4 * op * quarter], 4 * quarter);
+        bulkLength += 4 * quarter;
+
+        for (i = op * quarter; i < (op + 1) * quarter; i++)
+        {
+            frames[framesLength++] = 3 + 2 * 4;
+            framesLength += BENCH_Put(&frames[framesLength], (uint16_t)i, 2);
+            frames[framesLength++] = (uint8_t)(op | (BENCH_FORMAT << 4));
+            memcpy(&frames[framesLength], &operands[4 * i], 4);
+            framesLength += 4;
+            framesLength += BENCH_Put(&frames[framesLength], scalars[op], 4);
+        }
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    bench.expected = expected;
+    bench.count = count;
+    BENCH_Run(&run[0], &bench, false, frames, framesLength, tasksPerTick);
+    BENCH_Run(&run[1], &bench, true, bulk, bulkLength, tasksPerTick);
+
+    printf("operations         %zu, + - * / in quarters\n", count);
+    printf("                   %16s %16s\n", "frames", "bulk");
+    printf("answered           %16zu %16zu\n", run[0].results, run[1].results);
+    printf("wrong              %16zu %16zu\n", run[0].errors, run[1].errors);
+    printf("bytes in           %16llu %16llu\n",
+            (unsigned long long)run[0].bytesIn, (unsigned long long)run[1].bytesIn);
+    printf("bytes out          %16llu %16llu\n",
+            (unsigned long long)run[0].bytesOut, (unsigned long long)run[1].bytesOut);
+    printf("transfers          %16llu %16llu\n",
+            (unsigned long long)run[0].transfers, (unsigned long long)run[1].transfers);
+    printf("sim ticks          %16llu %16llu\n",
+            (unsigned long long)run[0].ticks, (unsigned long long)run[1].ticks);
+    printf("throughput (op/s)  %16.0f %16.0f\n",
+            run[0].results * 1e9 / run[0].elapsed, run[1].results * 1e9 / run[1].elapsed);
+
+    free(operands);
+    free(expected);
+    free(frames);
+    free(bulk);
+
+    return (kernelErrors == 0 && run[0].results == count && run[1].results == count &&
+            run[0].errors == 0 && run[1].errors == 0) ? 0 : 1;
+}
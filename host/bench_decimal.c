@@ -0,0 +1,351 @@
+/*******************************************************************************
+  Decimal Arithmetic Benchmark
+
+  File Name:
+    bench_decimal.c
+
+  Summary:
+    Compares the accuracy and cost of the float and fixed point punto2.
+
+  Description:
+    Generates random expressions "(a op b)=" whose operands have up to four
+    integer digits, up to three decimals and a random sign, runs them
+    through calcStep() and reads the printed results back.  Every result is
+    compared with the exact quotient or product rounded (half away from
+    zero) to CALC_DECIMALES decimals, computed here with 128 bit integers.
+    Reports how many results are exact, the largest and mean error in units
+    of the last printed decimal, and cycles and ns per expression.
+
+    Build it twice, plain and with -DCALC_PUNTO_FIJO=1, to compare the two
+    paths; both are built with APP_BATCH_MODE so only results are printed.
+
+    The session looks its results up in a result cache (app_rcache.h), whose
+    hits and misses are reported; -c runs without it.  -r d draws the
+    expressions at random from only d different ones, the way polling
+    clients repeat themselves.
+
+    Usage: bench_decimal_punto2[_fijo] [-n expressions] [-r distinct] [-s seed]
+                                       [-c] [-v]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "app.h"
+#include "interfacesP4punto2.h"
+#include "app_format.h"
+#include "bench_util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0
+#endif
+
+/* Operands are generated in thousandths */
+#define BENCH_OPERAND_SCALE             1000
+#define BENCH_OPERAND_LIMIT             10000000
+
+/* Longest expression: "(-9999.999*-9999.999)=" */
+#define BENCH_MAX_EXPRESSION            24
+
+typedef struct
+{
+    size_t offset;          /* Where the expression starts in the stream */
+    int64_t expected;       /* Exact result in units of 10^-CALC_DECIMALES */
+    int64_t actual;
+    bool valid;             /* actual parsed as a number, not inf or nan */
+
+} BENCH_RESULT;
+
+static __int128 BENCH_Power10(unsigned n)
+{
+    __int128 p = 1;
+
+    while (n-- > 0)
+    {
+        p *= 10;
+    }
+    return p;
+}
+
+/* numerator / denominator rounded half away from zero, denominator > 0 */
+static int64_t BENCH_Round(__int128 numerator, __int128 denominator)
+{
+    __int128 magnitude = (numerator < 0) ? -numerator : numerator;
+    __int128 q = (2 * magnitude + denominator) / (2 * denominator);
+
+    return (int64_t)((numerator < 0) ? -q : q);
+}
+
+/* A random operand in thousandths, written the way a user would type it */
+static int32_t BENCH_Operand(uint32_t * seed, char ** p)
+{
+    uint32_t r = BENCH_Random(seed);
+    int32_t value = (int32_t)(BENCH_Random(seed) % BENCH_OPERAND_LIMIT);
+    unsigned decimals = r % 4;
+    int32_t integer, fraction;
+
+    /* Cut to the chosen number of decimals, and mostly keep it short */
+    if ((r >> 2) % 2)
+    {
+        value %= 100000;
+    }
+    value -= value % (int32_t)BENCH_Power10(3 - decimals);
+
+    integer = value / BENCH_OPERAND_SCALE;
+    fraction = value % BENCH_OPERAND_SCALE;
+    if ((r >> 3) % 4 == 0)
+    {
+        *(*p)++ = '-';
+        value = -value;
+    }
+    *p += sprintf(*p, "%d", (int)integer);
+    if (decimals != 0)
+    {
+        *p += sprintf(*p, ".%0*d", (int)decimals, (int)(fraction / (int32_t)BENCH_Power10(3 - decimals)));
+    }
+    return value;
+}
+
+/* Parses "-123.456000" into units of 10^-CALC_DECIMALES */
+static bool BENCH_Parse(const char * text, size_t length, int64_t * value)
+{
+    bool negative = false, point = false;
+    int64_t n = 0;
+    unsigned decimals = 0;
+    size_t i = 0;
+
+    if (length > 0 && text[0] == '-')
+    {
+        negative = true;
+        i++;
+    }
+    if (i == length)
+    {
+        return false;
+    }
+    for (; i < length; i++)
+    {
+        if (text[i] == '.' && !point)
+        {
+            point = true;
+        }
+        else if (text[i] >= '0' && text[i] <= '9' && n < INT64_MAX / 10)
+        {
+            n = n * 10 + (text[i] - '0');
+            decimals += point;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if (decimals != CALC_DECIMALES)
+    {
+        return false;
+    }
+    *value = negative ? -n : n;
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    static const char operators[4] = { '+', '-', '*', '/' };
+    size_t count = 200000, distinct = 0, i, length = 0, outLength = 0, exact = 0, invalid = 0;
+    uint32_t seed = 0x2545F491u;
+    bool verbose = false, cached = true;
+    char * stream, * out, * p, * line, * end;
+    BENCH_RESULT * results;
+    CALC_SESSION session;
+    APP_TXRING ring;
+    static APP_RCACHE cache;
+    const uint8_t * data;
+    uint64_t start, elapsed, cycles, error, maxError = 0;
+    double errorSum = 0;
+    size_t chunk;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:s:cv")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'r': distinct = strtoul(optarg, NULL, 0); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'c': cached = false; break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-n expressions] [-r distinct] [-s seed] [-c] [-v]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (count == 0 || seed == 0)
+    {
+        fprintf(stderr, "expressions and seed must be nonzero\n");
+        return 2;
+    }
+
+    stream = malloc(count * BENCH_MAX_EXPRESSION + 1);
+    out = malloc(count * (APP_FORMAT_FLOAT_MAX_LENGTH + 2));
+    results = malloc(count * sizeof(BENCH_RESULT));
+    if (stream == NULL || out == NULL || results == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* Expressions and their exact results.  a op b with a = A/1000 and
+     * b = B/1000 is numerator/denominator below, scaled to the decimals the
+     * calculator prints. */
+    p = stream;
+    for (i = 0; i < count; i++)
+    {
+        __int128 scale = BENCH_Power10(CALC_DECIMALES), numerator, denominator;
+        int32_t a, b;
+        char op;
+
+        /* Past the first distinct ones, repeat one of them */
+        if (distinct != 0 && i >= distinct)
+        {
+            const BENCH_RESULT * again = &results[BENCH_Random(&seed) % distinct];
+            size_t n = (size_t)(strchr(stream + again->offset, '=') - (stream + again->offset)) + 1;
+
+            results[i].offset = (size_t)(p - stream);
+            results[i].expected = again->expected;
+            memcpy(p, stream + again->offset, n);
+            p += n;
+            continue;
+        }
+
+        op = operators[BENCH_Random(&seed) % 4];
+        results[i].offset = (size_t)(p - stream);
+        *p++ = '(';
+        a = BENCH_Operand(&seed, &p);
+        *p++ = op;
+        do
+        {
+            char * mark = p;
+
+            b = BENCH_Operand(&seed, &p);
+            if (op == '/' && b == 0)
+            {
+                p = mark;
+            }
+        } while (op == '/' && b == 0);
+        *p++ = ')';
+        *p++ = '=';
+
+        switch (op)
+        {
+            case '+': numerator = (__int128)(a + b) * scale; denominator = BENCH_OPERAND_SCALE; break;
+            case '-': numerator = (__int128)(a - b) * scale; denominator = BENCH_OPERAND_SCALE; break;
+            case '*': numerator = (__int128)a * b * scale; denominator = BENCH_OPERAND_SCALE * BENCH_OPERAND_SCALE; break;
+            default:
+                numerator = (__int128)a * scale * ((b < 0) ? -1 : 1);
+                denominator = (b < 0) ? -b : b;
+                break;
+        }
+        results[i].expected = BENCH_Round(numerator, denominator);
+    }
+    length = (size_t)(p - stream);
+    *p = 0;
+
+    /* The timed part: every byte through the state machine, draining the
+     * ring whenever it is half full as the USB writer would */
+    APP_TXRING_Initialize(&ring);
+    calcSessionInit(&session, &ring, false);
+    APP_RCACHE_Initialize(&cache);
+    calcSessionCache(&session, cached ? &cache : NULL);
+    start = BENCH_Now();
+    cycles = BENCH_CYCLES();
+    for (i = 0; i < length; i++)
+    {
+        calcStep(&session, stream[i]);
+        if (APP_TXRING_Count(&ring) > APP_TXRING_SIZE / 2)
+        {
+            while ((chunk = APP_TXRING_Peek(&ring, &data, APP_TXRING_SIZE)) != 0)
+            {
+                memcpy(out + outLength, data, chunk);
+                outLength += chunk;
+                APP_TXRING_Release(&ring, chunk);
+            }
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    elapsed = BENCH_Now() - start;
+    while ((chunk = APP_TXRING_Peek(&ring, &data, APP_TXRING_SIZE)) != 0)
+    {
+        memcpy(out + outLength, data, chunk);
+        outLength += chunk;
+        APP_TXRING_Release(&ring, chunk);
+    }
+    if (ring.dropped != 0)
+    {
+        printf("%u bytes dropped\n", (unsigned)ring.dropped);
+        return 1;
+    }
+
+    /* One "=result\r" per expression */
+    line = out;
+    for (i = 0; i < count; i++)
+    {
+        end = memchr(line, 0x0D, (size_t)(out + outLength - line));
+        if (end == NULL || line[0] != '=')
+        {
+            printf("only %zu of %zu results printed\n", i, count);
+            return 1;
+        }
+        results[i].valid = BENCH_Parse(line + 1, (size_t)(end - line - 1), &results[i].actual);
+        if (!results[i].valid)
+        {
+            invalid++;
+        }
+        else
+        {
+            error = (uint64_t)((results[i].actual > results[i].expected) ?
+                    results[i].actual - results[i].expected : results[i].expected - results[i].actual);
+            exact += (error == 0);
+            errorSum += (double)error;
+            if (error > maxError)
+            {
+                maxError = error;
+            }
+        }
+        if (verbose && (!results[i].valid || results[i].actual != results[i].expected))
+        {
+            const char * e = stream + results[i].offset;
+
+            printf("%.*s%.*s  expected %lld\n", (int)(strchr(e, '=') - e), e,
+                    (int)(end - line), line, (long long)results[i].expected);
+        }
+        line = end + 1;
+    }
+
+    printf("variant            punto2 %s, %d decimals\n", CALC_PUNTO_FIJO ? "fixed point" : "float", CALC_DECIMALES);
+    printf("expressions        %zu (%zu bytes)", count, length);
+    if (distinct != 0)
+    {
+        printf(", %zu different", (distinct < count) ? distinct : count);
+    }
+    printf("\n");
+    printf("exact              %zu (%.2f%%), %zu not a number\n", exact, 100.0 * exact / count, invalid);
+    printf("error              max %llu, mean %.3f units of the last decimal\n",
+            (unsigned long long)maxError, (count > invalid) ? errorSum / (double)(count - invalid) : 0.0);
+    if (cycles)
+    {
+        printf("cycles             %.1f per expression\n", (double)cycles / (double)count);
+    }
+    printf("time               %.1f ns per expression\n", (double)elapsed / (double)count);
+    if (CALC_CACHE && cached)
+    {
+        printf("result cache       %u hits, %u misses, %d sets\n",
+                (unsigned)cache.hits, (unsigned)cache.misses, APP_RCACHE_SETS);
+    }
+
+    free(results);
+    free(out);
+    free(stream);
+    return 0;
+}
@@ -0,0 +1,273 @@
+/*******************************************************************************
+  Compound Expression Benchmark
+
+  File Name:
+    bench_expr.c
+
+  Summary:
+    The same arithmetic as compound expressions and as one round trip per
+    operation, side by side.
+
+  Description:
+    n random formulas of -o binary operations each, with precedence, nested
+    parentheses and (punto2) unary minus, are typed on port 0 one at a time:
+    the next formula is only sent once the result of the previous one came
+    back, the way a client that needs the result works.  Then the same
+    number of operations is sent as plain "(a op b)=" expressions, again
+    waiting for each result.  For both the benchmark reports round trips,
+    bytes moved, simulated ticks (USB turnarounds) and operations per
+    second of wall clock.
+
+    Every formula is also evaluated here, in the same order and with the
+    same arithmetic as the firmware (int with -1 for a division by zero,
+    or float), and its printed result must match exactly.  A divisor is
+    always a literal between 1 and 99, so neither build divides by zero.
+    In punto1 one more formula divides INT32_MIN by -1, which must be
+    answered with INT32_MIN instead of trapping; punto2's float has no
+    such edge.
+
+    Usage: bench_expr_puntoN [-n formulas] [-o operations] [-k tasksPerTick]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "app_format.h"
+#include "bench_util.h"
+
+#define BENCH_EXPRESSION_MAX            512
+
+#if PUNTO != 2
+/* INT32_MIN / -1, with literals that fit */
+#define BENCH_EDGE                      "(((0-2147483647)-1)/(0-1))="
+#endif
+
+#if PUNTO == 2
+typedef float BENCH_VALUE;
+#else
+typedef int32_t BENCH_VALUE;
+#endif
+
+static uint32_t benchSeed = 12345;
+
+static BENCH_VALUE BENCH_Apply(char op, BENCH_VALUE a, BENCH_VALUE b)
+{
+#if PUNTO == 2
+    switch (op)
+    {
+        case '+': return a + b;
+        case '-': return a - b;
+        case '*': return a * b;
+        default: return b ? a / b : -1;
+    }
+#else
+    /* int32_t wraps on the device, unsigned does here without UB */
+    switch (op)
+    {
+        case '+': return (int32_t)((uint32_t)a + (uint32_t)b);
+        case '-': return (int32_t)((uint32_t)a - (uint32_t)b);
+        case '*': return (int32_t)((uint32_t)a * (uint32_t)b);
+        default: return (b == -1) ? (int32_t)(0u - (uint32_t)a) : b ? a / b : -1;
+    }
+#endif
+}
+
+static unsigned BENCH_Precedence(char op)
+{
+    return (op == '*' || op == '/') ? 2 : 1;
+}
+
+/* Writes a random expression of ops binary operations at *p and returns
+ * its value.  *top is its outermost operator, 0 for a bare operand. */
+static BENCH_VALUE BENCH_Formula(char ** p, unsigned ops, char * top)
+{
+    static const char operators[4] = { '+', '-', '*', '/' };
+    BENCH_VALUE a = 0, b = 0;
+    char buffer[2][BENCH_EXPRESSION_MAX], * q, childTop;
+    unsigned left, side;
+    bool paren;
+    char op;
+
+    if (ops == 0)
+    {
+        *top = 0;
+#if PUNTO == 2
+        if (BENCH_Random(&benchSeed) % 8 == 0)
+        {
+            a = (BENCH_VALUE)(BENCH_Random(&benchSeed) % 999 + 1);
+            *p += sprintf(*p, "-%d", (int)a);
+            return -a;
+        }
+#endif
+        a = (BENCH_VALUE)(BENCH_Random(&benchSeed) % 999 + 1);
+        *p += sprintf(*p, "%d", (int)a);
+        return a;
+    }
+
+    op = operators[BENCH_Random(&benchSeed) % 4];
+    left = (op == '/') ? ops - 1 : BENCH_Random(&benchSeed) % ops;
+    *top = op;
+
+    /* Each side into its own buffer, then wrapped if precedence or chance
+     * wants parentheses: the right side of a left associative operator
+     * needs them at equal precedence already */
+    for (side = 0; side < 2; side++)
+    {
+        q = buffer[side];
+        if (side == 0)
+        {
+            a = BENCH_Formula(&q, left, &childTop);
+        }
+        else if (op == '/')
+        {
+            b = (BENCH_VALUE)(BENCH_Random(&benchSeed) % 99 + 1);
+            q += sprintf(q, "%d", (int)b);
+            childTop = 0;
+        }
+        else
+        {
+            b = BENCH_Formula(&q, ops - 1 - left, &childTop);
+        }
+        paren = childTop != 0 && (BENCH_Precedence(childTop) < BENCH_Precedence(op) ||
+                (side == 1 && BENCH_Precedence(childTop) == BENCH_Precedence(op)) ||
+                BENCH_Random(&benchSeed) % 3 == 0);
+#if PUNTO == 2
+        if (paren && BENCH_Random(&benchSeed) % 6 == 0)
+        {
+            *(*p)++ = '-';
+            if (side == 0)
+            {
+                a = -a;
+            }
+            else
+            {
+                b = -b;
+            }
+        }
+#endif
+        *p += sprintf(*p, paren ? "(%s)" : "%s", buffer[side]);
+        if (side == 0)
+        {
+            *(*p)++ = op;
+        }
+    }
+    return BENCH_Apply(op, a, b);
+}
+
+static size_t BENCH_Text(char * buffer, BENCH_VALUE value)
+{
+#if PUNTO == 2
+    return APP_FORMAT_Float(buffer, value, 6);
+#else
+    return APP_FORMAT_Int(buffer, value);
+#endif
+}
+
+int main(int argc, char ** argv)
+{
+    static const char operators[4] = { '+', '-', '*', '/' };
+    size_t count = 2000, i;
+    unsigned operations = 8, tasksPerTick = 8, j;
+    char expression[BENCH_EXPRESSION_MAX], expected[APP_FORMAT_FLOAT_MAX_LENGTH + 2], top;
+    BENCH_RESULTS bench;
+    BENCH_SIM_RUN run[2], edge;
+    BENCH_VALUE value, a, b;
+    double total;
+    char * p;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:o:k:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'o': operations = strtoul(optarg, NULL, 0); break;
+            case 'k': tasksPerTick = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n formulas] [-o operations] [-k tasksPerTick]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (operations == 0 || operations > 12 || tasksPerTick == 0)
+    {
+        fprintf(stderr, "operations must be 1 to 12, tasksPerTick nonzero\n");
+        return 2;
+    }
+    /* Both clients do every operation once */
+    total = (double)count * operations;
+
+    /* Compound: one formula per round trip */
+    memset(&bench, 0, sizeof(bench));
+    BENCH_Start(&run[0], BENCH_ResultOutput, (uintptr_t)&bench, tasksPerTick);
+    for (i = 0; i < count; i++)
+    {
+        p = expression;
+        *p++ = '(';
+        value = BENCH_Formula(&p, operations, &top);
+        p += sprintf(p, ")=");
+        expected[BENCH_Text(expected, value)] = 0;
+        BENCH_RoundTrip(&run[0], &bench, expression, expected, tasksPerTick);
+        if (i == 0)
+        {
+            printf("example            %s%s\n", expression, expected);
+        }
+    }
+    BENCH_Stop(&run[0], bench.results, bench.errors);
+
+    /* Binary: one operation per round trip */
+    memset(&bench, 0, sizeof(bench));
+    BENCH_Start(&run[1], BENCH_ResultOutput, (uintptr_t)&bench, tasksPerTick);
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < operations; j++)
+        {
+            char op = operators[BENCH_Random(&benchSeed) % 4];
+
+            a = (BENCH_VALUE)(BENCH_Random(&benchSeed) % 999 + 1);
+            b = (BENCH_VALUE)(BENCH_Random(&benchSeed) % 99 + 1);
+            sprintf(expression, "(%d%c%d)=", (int)a, op, (int)b);
+            expected[BENCH_Text(expected, BENCH_Apply(op, a, b))] = 0;
+            BENCH_RoundTrip(&run[1], &bench, expression, expected, tasksPerTick);
+        }
+    }
+    BENCH_Stop(&run[1], bench.results, bench.errors);
+
+#ifdef BENCH_EDGE
+    memset(&bench, 0, sizeof(bench));
+    BENCH_Start(&edge, BENCH_ResultOutput, (uintptr_t)&bench, tasksPerTick);
+    value = BENCH_Apply('/', BENCH_Apply('-', BENCH_Apply('-', 0, 2147483647), 1), BENCH_Apply('-', 0, 1));
+    expected[BENCH_Text(expected, value)] = 0;
+    BENCH_RoundTrip(&edge, &bench, BENCH_EDGE, expected, tasksPerTick);
+    BENCH_Stop(&edge, bench.results, bench.errors);
+#else
+    memset(&edge, 0, sizeof(edge));
+    edge.results = 1;
+#endif
+
+    printf("variant            punto%d\n", PUNTO);
+    printf("formulas           %zu of %u operations\n", count, operations);
+    printf("                   %16s %16s\n", "compound", "binary");
+    printf("round trips        %16llu %16llu\n",
+            (unsigned long long)run[0].roundTrips, (unsigned long long)run[1].roundTrips);
+    printf("answered           %16zu %16zu\n", run[0].results, run[1].results);
+    printf("wrong              %16zu %16zu\n", run[0].errors, run[1].errors);
+    printf("bytes in           %16llu %16llu\n",
+            (unsigned long long)run[0].bytesIn, (unsigned long long)run[1].bytesIn);
+    printf("bytes out          %16llu %16llu\n",
+            (unsigned long long)run[0].bytesOut, (unsigned long long)run[1].bytesOut);
+#ifdef BENCH_EDGE
+    printf("INT32_MIN / -1     %s%s %s\n", BENCH_EDGE, expected,
+            (edge.results == 1 && edge.errors == 0) ? "ok" : "WRONG");
+#endif
+    printf("sim ticks          %16llu %16llu\n",
+            (unsigned long long)run[0].ticks, (unsigned long long)run[1].ticks);
+    printf("ticks per op       %16.2f %16.2f\n",
+            (double)run[0].ticks / total, (double)run[1].ticks / total);
+    printf("throughput (op/s)  %16.0f %16.0f\n",
+            total * 1e9 / run[0].elapsed, total * 1e9 / run[1].elapsed);
+
+    return (run[0].results == run[0].roundTrips && run[1].results == run[1].roundTrips &&
+            run[0].errors == 0 && run[1].errors == 0 &&
+            edge.results == 1 && edge.errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+/*******************************************************************************
+  Float Formatter Benchmark
+
+  File Name:
+    bench_float.c
+
+  Summary:
+    Checks APP_FORMAT_Float against printf and times the two.
+
+  Description:
+    APP_FORMAT_Float must print exactly what printf("%.*f") prints.  The
+    special values, range edges and rounding ties are checked for every
+    number of decimals, then random bit patterns with random decimals.  With
+    -x every one of the 2^32 float bit patterns is formatted with -d
+    decimals and compared, split over -t threads; on one core this takes
+    tens of minutes.
+
+    Timing uses -d decimals on two sets of values:
+
+      typical   results of a+b, a-b, a*b and a/b for short decimal operands
+      full      uniformly distributed finite bit patterns, mostly huge or
+                tiny magnitudes
+
+    Usage: bench_float [-n values] [-d decimals] [-x] [-t threads]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "app_format.h"
+#include "bench_util.h"
+
+#define BENCH_MAX_THREADS               64
+
+typedef struct
+{
+    pthread_t thread;
+    uint64_t first;
+    uint64_t last;
+    unsigned decimals;
+    uint64_t mismatches;
+
+} BENCH_SLICE;
+
+__attribute__((noinline)) static size_t formatFast(char * buffer, float value, unsigned decimals)
+{
+    return APP_FORMAT_Float(buffer, value, decimals);
+}
+
+__attribute__((noinline)) static size_t formatPrintf(char * buffer, float value, unsigned decimals)
+{
+    return (size_t)snprintf(buffer, APP_FORMAT_FLOAT_MAX_LENGTH + 1, "%.*f", (int)decimals, (double)value);
+}
+
+static float BENCH_Float(uint32_t bits)
+{
+    float value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static bool BENCH_Check(float value, unsigned decimals, bool verbose)
+{
+    char expected[APP_FORMAT_FLOAT_MAX_LENGTH + 1];
+    char actual[APP_FORMAT_FLOAT_MAX_LENGTH + 1];
+    size_t length = APP_FORMAT_Float(actual, value, decimals);
+    uint32_t bits;
+
+    formatPrintf(expected, value, decimals);
+    if (length != strlen(expected) || memcmp(actual, expected, length) != 0)
+    {
+        if (verbose)
+        {
+            memcpy(&bits, &value, sizeof(bits));
+            printf("mismatch at 0x%08x with %u decimals: got \"%.*s\", printf \"%s\"\n",
+                    bits, decimals, (int)length, actual, expected);
+        }
+        return false;
+    }
+    return true;
+}
+
+static void * BENCH_Slice(void * arg)
+{
+    BENCH_SLICE * slice = arg;
+    uint64_t bits;
+
+    for (bits = slice->first; bits < slice->last; bits++)
+    {
+        if (!BENCH_Check(BENCH_Float((uint32_t)bits), slice->decimals, slice->mismatches == 0))
+        {
+            slice->mismatches++;
+        }
+    }
+    return NULL;
+}
+
+static double BENCH_Run(size_t (*format)(char *, float, unsigned), const float * values,
+        size_t count, unsigned decimals, unsigned * checksum)
+{
+    char buffer[APP_FORMAT_FLOAT_MAX_LENGTH + 1];
+    uint64_t start = BENCH_Now();
+    unsigned sum = 0;
+    size_t i, length;
+
+    for (i = 0; i < count; i++)
+    {
+        length = format(buffer, values[i], decimals);
+        sum += (unsigned)length + (unsigned char)buffer[length - 1];
+    }
+    *checksum = sum;
+    return (double)(BENCH_Now() - start) / count;
+}
+
+int main(int argc, char ** argv)
+{
+    static const char * names[2] = { "typical", "full" };
+    static const float edges[] =
+    {
+        0.0f, 1.0f, 0.5f, 1.5f, 2.5f, 0.125f, 0.375f, 9.5f, 99.5f, 0.0625f,
+        0.1f, 0.2f, 0.3f, 1e-10f, 5e-10f, 4.9999997e-10f, 1e9f, 4294967296.0f,
+        8388608.0f, 16777216.0f, 3.375f, 1.0f / 3.0f, 2.0f / 3.0f, 999999.9999f,
+        FLT_MAX, FLT_MIN, FLT_TRUE_MIN, FLT_EPSILON, INFINITY, NAN
+    };
+    size_t count = 1u << 20;
+    uint32_t seed = 0x2545F491u;
+    unsigned decimals = 6, threads = 1, d, t;
+    bool exhaustive = false;
+    float * streams[2];
+    unsigned fastSum, printfSum;
+    double fastNs, printfNs;
+    uint64_t mismatches = 0;
+    BENCH_SLICE slices[BENCH_MAX_THREADS];
+    size_t i;
+    int s, opt;
+
+    while ((opt = getopt(argc, argv, "n:d:xt:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'd': decimals = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'x': exhaustive = true; break;
+            case 't': threads = (unsigned)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n values] [-d decimals] [-x] [-t threads]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (decimals > APP_FORMAT_FLOAT_MAX_DECIMALS || threads == 0 || threads > BENCH_MAX_THREADS)
+    {
+        fprintf(stderr, "decimals must be 0..%d, threads 1..%d\n",
+                APP_FORMAT_FLOAT_MAX_DECIMALS, BENCH_MAX_THREADS);
+        return 2;
+    }
+
+    for (d = 0; d <= APP_FORMAT_FLOAT_MAX_DECIMALS; d++)
+    {
+        for (i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+        {
+            if (!BENCH_Check(edges[i], d, true) || !BENCH_Check(-edges[i], d, true))
+            {
+                return 1;
+            }
+        }
+    }
+
+    for (s = 0; s < 2; s++)
+    {
+        streams[s] = malloc(count * sizeof(float));
+        if (streams[s] == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < count; i++)
+    {
+        uint32_t r = BENCH_Random(&seed);
+        float a = (float)(BENCH_Random(&seed) % 10000) / 100.0f;
+        float b = (float)(BENCH_Random(&seed) % 10000 + 1) / 100.0f;
+
+        switch (r % 4)
+        {
+            case 0: streams[0][i] = a + b; break;
+            case 1: streams[0][i] = a - b; break;
+            case 2: streams[0][i] = a * b; break;
+            default: streams[0][i] = a / b; break;
+        }
+        streams[1][i] = BENCH_Float(((r >> 23) & 0xFF) == 0xFF ? r & 0xBF800000u : r);
+        if (!BENCH_Check(BENCH_Float(r), r % (APP_FORMAT_FLOAT_MAX_DECIMALS + 1), true) ||
+                !BENCH_Check(streams[0][i], decimals, true))
+        {
+            return 1;
+        }
+    }
+    printf("edges and %zu random values agree with printf for 0..%d decimals\n",
+            count, APP_FORMAT_FLOAT_MAX_DECIMALS);
+
+    if (exhaustive)
+    {
+        uint64_t start = BENCH_Now();
+
+        for (t = 0; t < threads; t++)
+        {
+            slices[t].first = (1ull << 32) * t / threads;
+            slices[t].last = (1ull << 32) * (t + 1) / threads;
+            slices[t].decimals = decimals;
+            slices[t].mismatches = 0;
+            if (pthread_create(&slices[t].thread, NULL, BENCH_Slice, &slices[t]) != 0)
+            {
+                fprintf(stderr, "cannot start thread %u\n", t);
+                return 1;
+            }
+        }
+        for (t = 0; t < threads; t++)
+        {
+            pthread_join(slices[t].thread, NULL);
+            mismatches += slices[t].mismatches;
+        }
+        if (mismatches != 0)
+        {
+            printf("%llu of 2^32 floats differ from printf\n", (unsigned long long)mismatches);
+            return 1;
+        }
+        printf("all 2^32 floats match printf with %u decimals (%.1f s)\n",
+                decimals, (BENCH_Now() - start) / 1e9);
+    }
+
+    printf("%-8s %12s %12s %8s   (%u decimals)\n", "values", "printf ns", "exact ns", "speedup", decimals);
+    for (s = 0; s < 2; s++)
+    {
+        printfNs = BENCH_Run(formatPrintf, streams[s], count, decimals, &printfSum);
+        fastNs = BENCH_Run(formatFast, streams[s], count, decimals, &fastSum);
+        if (fastSum != printfSum)
+        {
+            printf("checksum mismatch on %s values\n", names[s]);
+            return 1;
+        }
+        printf("%-8s %12.2f %12.2f %7.2fx\n", names[s], printfNs, fastNs, printfNs / fastNs);
+        free(streams[s]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*******************************************************************************
+  Integer Formatter Benchmark
+
+  File Name:
+    bench_format.c
+
+  Summary:
+    Checks APP_FORMAT_Int and times it against the loops it replaced.
+
+  Description:
+    formatRef is the punto1 state 8 formatting as it shipped, one loop
+    counting digits and one emitting them with a division per digit in
+    each, minus its off-by-one so the outputs can be compared.
+    APP_FORMAT_Int is first compared with snprintf("%d") on the range edges
+    (INT32_MIN, INT32_MAX, every power of ten and its neighbours) and on
+    random values, and APP_FORMAT_Unsigned with "%u" on the same bits.  With -x every int32_t is checked against a decimal
+    counter that is stepped alongside, which takes a couple of minutes.
+    Then the three are timed on
+
+      full      uniformly distributed int32_t
+      small     0..999, what a hand typed expression usually yields
+
+    formatRef negates with -1*res, which overflows on INT32_MIN, so that
+    value is left out of its stream.
+
+    Usage: bench_format [-n values] [-x]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_format.h"
+#include "bench_util.h"
+
+__attribute__((noinline)) static size_t formatRef(char * auxString, int32_t res)
+{
+    int i, negativoFlag, digitosCont, auxRes;
+
+    if (res<0) {
+        negativoFlag=1;
+        res=-1*res;
+    } else {
+        negativoFlag=0;
+    }
+    auxRes=res;
+    digitosCont=0;
+    do {
+        auxRes/=10;
+        digitosCont++;
+    } while(auxRes);
+    i=digitosCont-1;
+    do {
+        auxString[negativoFlag+i]='0'+(res%10);
+        res/=10;
+    } while(--i>=0);
+    if (negativoFlag) {
+        auxString[0]='-';
+    }
+    return (size_t)(digitosCont+negativoFlag);
+}
+
+__attribute__((noinline)) static size_t formatFast(char * buffer, int32_t value)
+{
+    return APP_FORMAT_Int(buffer, value);
+}
+
+__attribute__((noinline)) static size_t formatPrintf(char * buffer, int32_t value)
+{
+    return (size_t)snprintf(buffer, APP_FORMAT_INT_MAX_LENGTH + 1, "%d", (int)value);
+}
+
+static bool BENCH_Check(int32_t value)
+{
+    char expected[APP_FORMAT_INT_MAX_LENGTH + 1];
+    char actual[APP_FORMAT_INT_MAX_LENGTH + 1];
+    size_t length = APP_FORMAT_Int(actual, value);
+
+    snprintf(expected, sizeof(expected), "%d", (int)value);
+    if (length != strlen(expected) || memcmp(actual, expected, length) != 0)
+    {
+        printf("mismatch at %d: got \"%.*s\"\n", (int)value, (int)length, actual);
+        return false;
+    }
+
+    /* The same bits unsigned, negative values land above INT32_MAX */
+    length = APP_FORMAT_Unsigned(actual, (uint32_t)value);
+    snprintf(expected, sizeof(expected), "%u", (unsigned)(uint32_t)value);
+    if (length != strlen(expected) || memcmp(actual, expected, length) != 0)
+    {
+        printf("mismatch at %uu: got \"%.*s\"\n", (unsigned)(uint32_t)value, (int)length, actual);
+        return false;
+    }
+    return true;
+}
+
+/* Walks m = 0 .. 2^31 with a decimal counter and checks m and -m */
+static bool BENCH_Exhaustive(void)
+{
+    char counter[APP_FORMAT_INT_MAX_LENGTH + 1] = "0";
+    char actual[APP_FORMAT_INT_MAX_LENGTH + 1];
+    size_t digits = 1, length;
+    uint64_t m;
+    int k;
+
+    for (m = 0; m <= 0x80000000u; m++)
+    {
+        if (m <= INT32_MAX)
+        {
+            length = APP_FORMAT_Int(actual, (int32_t)m);
+            if (length != digits || memcmp(actual, counter, digits) != 0)
+            {
+                printf("mismatch at %llu\n", (unsigned long long)m);
+                return false;
+            }
+        }
+        if (m != 0)
+        {
+            length = APP_FORMAT_Int(actual, (int32_t)(0u - (uint32_t)m));
+            if (length != digits + 1 || actual[0] != '-' || memcmp(actual + 1, counter, digits) != 0)
+            {
+                printf("mismatch at -%llu\n", (unsigned long long)m);
+                return false;
+            }
+        }
+
+        for (k = (int)digits - 1; k >= 0 && counter[k] == '9'; k--)
+        {
+            counter[k] = '0';
+        }
+        if (k >= 0)
+        {
+            counter[k]++;
+        }
+        else
+        {
+            memmove(counter + 1, counter, digits);
+            counter[0] = '1';
+            digits++;
+        }
+    }
+    return true;
+}
+
+static double BENCH_Run(size_t (*format)(char *, int32_t), const int32_t * values,
+        size_t count, unsigned * checksum)
+{
+    char buffer[APP_FORMAT_INT_MAX_LENGTH + 1];
+    uint64_t start = BENCH_Now();
+    unsigned sum = 0;
+    size_t i, length;
+
+    for (i = 0; i < count; i++)
+    {
+        length = format(buffer, values[i]);
+        sum += (unsigned)length + (unsigned char)buffer[length - 1];
+    }
+    *checksum = sum;
+    return (double)(BENCH_Now() - start) / count;
+}
+
+int main(int argc, char ** argv)
+{
+    static const char * names[2] = { "full", "small" };
+    static const int32_t edges[] = { INT32_MIN, INT32_MIN + 1, INT32_MAX, INT32_MAX - 1, 0, -1 };
+    size_t count = 4u << 20;
+    uint32_t seed = 0x2545F491u;
+    bool exhaustive = false;
+    int32_t * streams[2];
+    unsigned refSum, fastSum, printfSum;
+    double refNs, fastNs, printfNs;
+    int32_t power;
+    size_t i;
+    int s, opt;
+
+    while ((opt = getopt(argc, argv, "n:x")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'x': exhaustive = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-n values] [-x]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for (i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+    {
+        if (!BENCH_Check(edges[i]))
+        {
+            return 1;
+        }
+    }
+    for (power = 1; ; power *= 10)
+    {
+        if (!BENCH_Check(power) || !BENCH_Check(power - 1) || !BENCH_Check(power + 1) ||
+                !BENCH_Check(-power) || !BENCH_Check(-power + 1) || !BENCH_Check(-power - 1))
+        {
+            return 1;
+        }
+        if (power > INT32_MAX / 10)
+        {
+            break;
+        }
+    }
+
+    for (s = 0; s < 2; s++)
+    {
+        streams[s] = malloc(count * sizeof(int32_t));
+        if (streams[s] == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < count; i++)
+    {
+        uint32_t r = BENCH_Random(&seed);
+
+        streams[0][i] = (r == 0x80000000u) ? 0 : (int32_t)r;
+        streams[1][i] = (int32_t)(r % 1000);
+        if (!BENCH_Check((int32_t)r))
+        {
+            return 1;
+        }
+    }
+    printf("edges and %zu random values agree with snprintf\n", count);
+
+    if (exhaustive)
+    {
+        uint64_t start = BENCH_Now();
+
+        if (!BENCH_Exhaustive())
+        {
+            return 1;
+        }
+        printf("all 2^32 int32_t values correct (%.1f s)\n", (BENCH_Now() - start) / 1e9);
+    }
+
+    printf("%-8s %12s %12s %12s %8s\n", "values", "loops ns", "pairs ns", "printf ns", "speedup");
+    for (s = 0; s < 2; s++)
+    {
+        refNs = BENCH_Run(formatRef, streams[s], count, &refSum);
+        fastNs = BENCH_Run(formatFast, streams[s], count, &fastSum);
+        printfNs = BENCH_Run(formatPrintf, streams[s], count, &printfSum);
+        if (refSum != fastSum || fastSum != printfSum)
+        {
+            printf("checksum mismatch on %s values\n", names[s]);
+            return 1;
+        }
+        printf("%-8s %12.2f %12.2f %12.2f %7.2fx\n", names[s], refNs, fastNs, printfNs, refNs / fastNs);
+        free(streams[s]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,369 @@
+/*******************************************************************************
+  Binary Protocol Benchmark
+
+  File Name:
+    bench_frame.c
+
+  Summary:
+    The same calculations through the keystroke protocol and through binary
+    request frames, side by side.
+
+  Description:
+    n operations, +, -, * and / in turn on pseudo random operands, are sent
+    on port 0 twice: once typed as "(a+b)=" and echoed back, and once as
+    request frames after the port was switched with SET LINE CODING.  Both
+    streams travel in full 64 byte packets.  For each path the benchmark
+    reports the bytes moved each way, transfers, simulated ticks, wall
+    clock throughput and, on x86, cycles per operation.  Every result of
+    both paths is checked against the same arithmetic done here.
+
+    Last a few divisions at the edges of int32_t, INT32_MIN / -1 among
+    them, go as frames alone: punto1 has no negative literals to type.
+
+    Usage: bench_frame_puntoN [-n operations] [-k tasksPerTick]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "app_frame.h"
+#include "app_format.h"
+#include "bench_util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#endif
+
+/* APP_FRAME_DTE_RATE of the firmware */
+#define BENCH_FRAME_RATE                314159
+
+#define BENCH_PACKET                    64
+
+#if PUNTO == 2
+#define BENCH_FORMAT                    APP_FRAME_FLOAT32
+#else
+#define BENCH_FORMAT                    APP_FRAME_INT32
+#endif
+
+typedef struct
+{
+    uint8_t op;
+    int32_t a;
+    int32_t b;
+
+} BENCH_OP;
+
+typedef struct
+{
+    const BENCH_OP * ops;
+    size_t count;
+
+    /* Results seen and how many of them were wrong */
+    size_t results;
+    size_t errors;
+
+    /* Keystrokes: the text after '=' of the result being received */
+    char text[APP_FORMAT_FLOAT_MAX_LENGTH + 2];
+    size_t textLength;
+    bool inResult;
+
+    /* Frames: a response split over two packets */
+    uint8_t frame[APP_FRAME_RESPONSE_MAX];
+    size_t frameLength;
+
+} BENCH_FRAME;
+
+typedef struct
+{
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t transfers;
+    uint64_t ticks;
+    uint64_t elapsed;
+    uint64_t cycles;
+    size_t results;
+    size_t errors;
+
+} BENCH_RUN;
+
+/* The result the firmware should give, as the binary protocol carries it */
+static APP_FRAME_VALUE BENCH_Expected(const BENCH_OP * op)
+{
+    APP_FRAME_VALUE value;
+
+#if PUNTO == 2
+    float a = (float)op->a, b = (float)op->b;
+
+    value.f = (op->op == 0) ? a + b : (op->op == 1) ? a - b : (op->op == 2) ? a * b : a / b;
+#else
+    /* INT32_MIN / -1 wraps around to INT32_MIN, as 0 - INT32_MIN does */
+    value.i = (op->op == 0) ? op->a + op->b : (op->op == 1) ? op->a - op->b :
+            (op->op == 2) ? op->a * op->b :
+            (op->b == -1) ? (int32_t)(0u - (uint32_t)op->a) : op->a / op->b;
+#endif
+    return value;
+}
+
+/* The same result as the keystroke protocol prints it, without '=' */
+static size_t BENCH_ExpectedText(char * buffer, const BENCH_OP * op)
+{
+    APP_FRAME_VALUE value = BENCH_Expected(op);
+
+#if PUNTO == 2
+    return APP_FORMAT_Float(buffer, value.f, 6);
+#else
+    return APP_FORMAT_Int(buffer, value.i);
+#endif
+}
+
+static void BENCH_Keystrokes(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH_FRAME * bench = (BENCH_FRAME *)context;
+    char expected[APP_FORMAT_FLOAT_MAX_LENGTH + 2];
+    size_t i, n;
+
+    for (i = 0; i < length; i++)
+    {
+        if (data[i] == '=')
+        {
+            bench->inResult = true;
+            bench->textLength = 0;
+        }
+        else if (bench->inResult && data[i] == 0x0D)
+        {
+            bench->inResult = false;
+            if (bench->results < bench->count)
+            {
+                n = BENCH_ExpectedText(expected, &bench->ops[bench->results]);
+                if (n != bench->textLength || memcmp(expected, bench->text, n) != 0)
+                {
+                    bench->errors++;
+                }
+            }
+            bench->results++;
+        }
+        else if (bench->inResult && bench->textLength < sizeof(bench->text))
+        {
+            bench->text[bench->textLength++] = (char)data[i];
+        }
+    }
+}
+
+static void BENCH_Frames(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH_FRAME * bench = (BENCH_FRAME *)context;
+    APP_FRAME_VALUE expected;
+    uint8_t response[APP_FRAME_RESPONSE_MAX];
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        bench->frame[bench->frameLength++] = data[i];
+        if (bench->frameLength < sizeof(bench->frame) &&
+                (bench->frameLength < 4 || bench->frameLength < (size_t)bench->frame[0] + 1))
+        {
+            continue;
+        }
+        if (bench->results < bench->count)
+        {
+            expected = BENCH_Expected(&bench->ops[bench->results]);
+            APP_FRAME_Encode(response, (uint16_t)bench->results, APP_FRAME_OK, BENCH_FORMAT, &expected);
+            if (bench->frameLength != (size_t)response[0] + 1 ||
+                    memcmp(response, bench->frame, bench->frameLength) != 0)
+            {
+                bench->errors++;
+            }
+        }
+        bench->results++;
+        bench->frameLength = 0;
+    }
+}
+
+static size_t BENCH_Put(uint8_t * data, uint64_t value, size_t width)
+{
+    size_t k;
+
+    for (k = 0; k < width; k++)
+    {
+        data[k] = (uint8_t)(value >> (8 * k));
+    }
+    return width;
+}
+
+/* One request frame, returns its length */
+static size_t BENCH_Request(uint8_t * frame, uint16_t id, const BENCH_OP * op)
+{
+    size_t length = 0;
+#if PUNTO == 2
+    float a = (float)op->a, b = (float)op->b;
+    uint32_t bits;
+#endif
+
+    frame[length++] = 3 + 2 * 4;
+    length += BENCH_Put(&frame[length], id, 2);
+    frame[length++] = (uint8_t)(op->op | (BENCH_FORMAT << 4));
+#if PUNTO == 2
+    memcpy(&bits, &a, sizeof(bits));
+    length += BENCH_Put(&frame[length], bits, 4);
+    memcpy(&bits, &b, sizeof(bits));
+    length += BENCH_Put(&frame[length], bits, 4);
+#else
+    length += BENCH_Put(&frame[length], (uint32_t)op->a, 4);
+    length += BENCH_Put(&frame[length], (uint32_t)op->b, 4);
+#endif
+    return length;
+}
+
+static void BENCH_Run(BENCH_RUN * run, BENCH_FRAME * bench, bool framed,
+        const uint8_t * script, size_t scriptLength, unsigned tasksPerTick)
+{
+    const SIM_STATS * stats;
+    size_t idle = 0, i, before;
+    unsigned k;
+
+    bench->results = 0;
+    bench->errors = 0;
+    bench->inResult = false;
+    bench->frameLength = 0;
+
+    SIM_Reset();
+    SIM_CDC_OutputHandlerSet(framed ? BENCH_Frames : BENCH_Keystrokes, (uintptr_t)bench);
+    APP_Initialize();
+    SIM_Attach();
+    for (i = 0; i < 16; i++)
+    {
+        APP_Tasks();
+        SIM_Poll();
+    }
+    if (framed)
+    {
+        SIM_CDC_LineCodingSet(0, BENCH_FRAME_RATE);
+    }
+    SIM_CDC_ScriptSet(0, script, scriptLength, BENCH_PACKET);
+    stats = SIM_StatsGet();
+    run->ticks = stats->ticks;
+
+    run->elapsed = BENCH_Now();
+#ifdef BENCH_CYCLES
+    run->cycles = BENCH_CYCLES();
+#endif
+    while (bench->results < bench->count && idle < 1000)
+    {
+        before = bench->results;
+        for (k = 0; k < tasksPerTick; k++)
+        {
+            APP_Tasks();
+        }
+        SIM_Poll();
+        idle = (bench->results == before && SIM_CDC_Pending(0) == 0) ? idle + 1 : 0;
+    }
+#ifdef BENCH_CYCLES
+    run->cycles = BENCH_CYCLES() - run->cycles;
+#endif
+    run->elapsed = BENCH_Now() - run->elapsed;
+    run->ticks = stats->ticks - run->ticks;
+    run->bytesIn = stats->bytesIn;
+    run->bytesOut = stats->bytesOut;
+    run->transfers = stats->reads + stats->writes;
+    run->results = bench->results;
+    run->errors = bench->errors;
+}
+
+int main(int argc, char ** argv)
+{
+    static const char opChar[4] = { '+', '-', '*', '/' };
+    static const BENCH_OP edges[] =
+    {
+        { 3, INT32_MIN, -1 }, { 3, INT32_MIN, 1 }, { 3, INT32_MAX, -1 }, { 3, -7, 2 }
+    };
+    size_t count = 100000;
+    unsigned tasksPerTick = 8;
+    uint8_t * keys, * frames;
+    size_t keysLength = 0, framesLength = 0;
+    BENCH_OP * ops;
+    BENCH_FRAME bench;
+    BENCH_RUN run[2], edge;
+    uint32_t seed = 12345;
+    size_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:k:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'k': tasksPerTick = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n operations] [-k tasksPerTick]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    /* Ids are 16 bits, so the bench checks them modulo 65536 */
+    ops = malloc(count * sizeof(BENCH_OP));
+    keys = malloc(count * 16);
+    frames = malloc(count * APP_FRAME_REQUEST_MAX);
+    if (ops == NULL || keys == NULL || frames == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ops[i].op = (uint8_t)(i % 4);
+        ops[i].a = (int32_t)(BENCH_Random(&seed) % 100000);
+        ops[i].b = (int32_t)(BENCH_Random(&seed) % 999) + 1;
+        keysLength += (size_t)sprintf((char *)&keys[keysLength], "(%d%c%d)=",
+                (int)ops[i].a, opChar[ops[i].op], (int)ops[i].b);
+        framesLength += BENCH_Request(&frames[framesLength], (uint16_t)i, &ops[i]);
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    bench.ops = ops;
+    bench.count = count;
+    BENCH_Run(&run[0], &bench, false, keys, keysLength, tasksPerTick);
+    BENCH_Run(&run[1], &bench, true, frames, framesLength, tasksPerTick);
+
+    for (i = 0, framesLength = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+    {
+        framesLength += BENCH_Request(&frames[framesLength], (uint16_t)i, &edges[i]);
+    }
+    bench.ops = edges;
+    bench.count = sizeof(edges) / sizeof(edges[0]);
+    BENCH_Run(&edge, &bench, true, frames, framesLength, tasksPerTick);
+
+    printf("variant            punto%d\n", PUNTO);
+    printf("operations         %zu, + - * / in turn\n", count);
+    printf("                   %16s %16s\n", "keystrokes", "frames");
+    printf("answered           %16zu %16zu\n", run[0].results, run[1].results);
+    printf("wrong              %16zu %16zu\n", run[0].errors, run[1].errors);
+    printf("bytes in           %16llu %16llu\n",
+            (unsigned long long)run[0].bytesIn, (unsigned long long)run[1].bytesIn);
+    printf("bytes out          %16llu %16llu\n",
+            (unsigned long long)run[0].bytesOut, (unsigned long long)run[1].bytesOut);
+    printf("transfers          %16llu %16llu\n",
+            (unsigned long long)run[0].transfers, (unsigned long long)run[1].transfers);
+    printf("sim ticks          %16llu %16llu\n",
+            (unsigned long long)run[0].ticks, (unsigned long long)run[1].ticks);
+    printf("throughput (op/s)  %16.0f %16.0f\n",
+            run[0].results * 1e9 / run[0].elapsed, run[1].results * 1e9 / run[1].elapsed);
+    printf("int32_t edges      %zu of %zu frames right\n",
+            edge.results - edge.errors, sizeof(edges) / sizeof(edges[0]));
+    if (run[0].cycles && run[1].cycles && run[0].results && run[1].results)
+    {
+        printf("cycles per op      %16.1f %16.1f\n",
+                (double)run[0].cycles / run[0].results, (double)run[1].cycles / run[1].results);
+    }
+
+    free(ops);
+    free(keys);
+    free(frames);
+
+    return (run[0].results == count && run[1].results == count &&
+            run[0].errors == 0 && run[1].errors == 0 &&
+            edge.results == sizeof(edges) / sizeof(edges[0]) && edge.errors == 0) ? 0 : 1;
+}
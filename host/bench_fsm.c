@@ -0,0 +1,193 @@
+/*******************************************************************************
+  FSM Step Benchmark
+
+  File Name:
+    bench_fsm.c
+
+  Summary:
+    Measures the per-byte cost of the calculator state machine alone.
+
+  Description:
+    Feeds a long expression stream straight into calcStep(), the step that
+    APP_Tasks runs for every received byte, with no USB simulation in the
+    way.  Every thread owns a CALC_SESSION and a TX ring of its own and runs
+    the whole stream through it; the ring is emptied whenever it is half
+    full so output never stalls or drops.  All threads must end with the
+    same output count and ring contents, which checks that sessions share
+    no state.  Runs of digits inside an operand go through calcDigitos, as
+    APP_PortTasks does, unless -s asks for one calcStep per byte.  Reports
+    cycles per byte on x86 and ns per byte everywhere.
+
+    Usage: bench_fsm_puntoN [-n expressions] [-e expression] [-t threads] [-s]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "app.h"
+#if PUNTO == 2
+#include "interfacesP4punto2.h"
+#else
+#include "interfacesP4punto1.h"
+#endif
+#include "bench_util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()                  __rdtsc()
+#else
+#define BENCH_CYCLES()                  0
+#endif
+
+#if PUNTO == 2
+#define BENCH_DEFAULT_EXPRESSION        "(1.5*2.25)="
+#endif
+#ifndef BENCH_DEFAULT_EXPRESSION
+#define BENCH_DEFAULT_EXPRESSION        "(12+34)="
+#endif
+
+#define BENCH_MAX_THREADS               64
+
+typedef struct
+{
+    pthread_t thread;
+    const char * stream;
+    size_t length;
+    bool digitRuns;
+    CALC_SESSION session;
+    APP_TXRING ring;
+    uint64_t cycles;
+    uint64_t outputBytes;
+
+} BENCH_WORKER;
+
+
+static void * BENCH_Worker(void * arg)
+{
+    BENCH_WORKER * worker = arg;
+    uint64_t cycles;
+    size_t i, taken;
+
+    APP_TXRING_Initialize(&worker->ring);
+    calcSessionInit(&worker->session, &worker->ring, false);
+
+    cycles = BENCH_CYCLES();
+    for (i = 0; i < worker->length; i += taken)
+    {
+        taken = 0;
+        if (worker->digitRuns && (unsigned char)(worker->stream[i] - '0') <= 9)
+        {
+            taken = calcDigitos(&worker->session, &worker->stream[i], worker->length - i);
+        }
+        if (taken == 0)
+        {
+            calcStep(&worker->session, worker->stream[i]);
+            taken = 1;
+        }
+        if (APP_TXRING_Count(&worker->ring) > APP_TXRING_SIZE / 2)
+        {
+            worker->outputBytes += APP_TXRING_Count(&worker->ring);
+            APP_TXRING_Release(&worker->ring, APP_TXRING_Count(&worker->ring));
+        }
+#if CALC_BIGNUM
+        while (calcFlush(&worker->session))
+        {
+            worker->outputBytes += APP_TXRING_Count(&worker->ring);
+            APP_TXRING_Release(&worker->ring, APP_TXRING_Count(&worker->ring));
+        }
+#endif
+    }
+    worker->cycles = BENCH_CYCLES() - cycles;
+    return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+    static BENCH_WORKER workers[BENCH_MAX_THREADS];
+    const char * expression = BENCH_DEFAULT_EXPRESSION;
+    size_t count = 2000000;
+    size_t expressionLength, length, i;
+    uint64_t start, cycles, elapsed;
+    unsigned threads = 1, t;
+    bool digitRuns = true;
+    uint32_t dropped = 0;
+    char * stream;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:e:t:s")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'e': expression = optarg; break;
+            case 't': threads = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 's': digitRuns = false; break;
+            default:
+                fprintf(stderr, "usage: %s [-n expressions] [-e expression] [-t threads] [-s]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (threads == 0 || threads > BENCH_MAX_THREADS)
+    {
+        fprintf(stderr, "threads must be 1..%d\n", BENCH_MAX_THREADS);
+        return 2;
+    }
+
+    expressionLength = strlen(expression);
+    length = expressionLength * count;
+    stream = malloc(length);
+    if (stream == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        memcpy(stream + i * expressionLength, expression, expressionLength);
+    }
+
+    start = BENCH_Now();
+    for (t = 0; t < threads; t++)
+    {
+        workers[t].stream = stream;
+        workers[t].length = length;
+        workers[t].digitRuns = digitRuns;
+        if (pthread_create(&workers[t].thread, NULL, BENCH_Worker, &workers[t]) != 0)
+        {
+            fprintf(stderr, "cannot start thread %u\n", t);
+            return 1;
+        }
+    }
+    cycles = 0;
+    for (t = 0; t < threads; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        cycles += workers[t].cycles;
+        dropped += workers[t].ring.dropped;
+        workers[t].outputBytes += APP_TXRING_Count(&workers[t].ring);
+        if (workers[t].outputBytes != workers[0].outputBytes ||
+                memcmp(workers[t].ring.buffer, workers[0].ring.buffer, APP_TXRING_SIZE) != 0)
+        {
+            printf("session %u output differs from session 0\n", t);
+            return 1;
+        }
+    }
+    elapsed = BENCH_Now() - start;
+
+    printf("variant            punto%d\n", PUNTO);
+    printf("expression         %s x %zu (%zu bytes) per session\n", expression, count, length);
+    printf("digit runs         %s\n", digitRuns ? "calcDigitos" : "off, calcStep per byte");
+    printf("sessions           %u threads, identical output (%llu bytes each)\n",
+            threads, (unsigned long long)workers[0].outputBytes);
+    if (cycles && threads == 1)
+    {
+        printf("cycles             %.1f per byte\n", (double)cycles / ((double)length * threads));
+    }
+    printf("time               %.2f ns per byte, %.0f expr/s\n",
+            (double)elapsed / ((double)length * threads), (double)count * threads * 1e9 / elapsed);
+    printf("dropped            %u bytes\n", (unsigned)dropped);
+
+    free(stream);
+    return 0;
+}
@@ -0,0 +1,319 @@
+/*******************************************************************************
+  Grammar Blob Benchmark
+
+  File Name:
+    bench_grammar.c
+
+  Summary:
+    The state machine stepped with the tables compiled in against the same
+    tables loaded from a grammar blob, and a blob of one's own uploaded
+    over CDC.
+
+  Description:
+    calcGramaticaBlob packs the tables compiled in; the blob is checked
+    and loaded in place, and broken copies of it must be turned down with
+    the right APP_GRAMMAR_STATUS.  Then a long expression stream goes
+    through calcStep twice, once per grammar, each time in a session of
+    its own: both must produce the same output, and the time per byte of
+    each is reported.
+
+    Last comes port 0 at the grammar bit rate.  A header that gives a
+    length of 0 must be answered with an error.  Then the blob gets one
+    more byte in a class (',' as the decimal point in punto2, '[' and ']'
+    as parentheses in punto1) and is uploaded in 7 byte packets.  Back
+    at keystrokes an expression written with the new bytes must give the
+    result of the one written as usual, and a blob with a bad CRC must be
+    answered with an error.
+
+    Usage: bench_grammar_puntoN [-n expressions] [-r repeats]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+#if PUNTO == 2
+#include "interfacesP4punto2.h"
+#else
+#include "interfacesP4punto1.h"
+#endif
+#include "bench_util.h"
+
+/* APP_GRAMMAR_DTE_RATE of the firmware */
+#define BENCH_GRAMMAR_RATE              161803
+#define BENCH_KEYSTROKES_RATE           9600
+
+#define BENCH_PACKET                    7
+#define BENCH_OUTPUT_MAX                4096
+
+#if PUNTO == 2
+#define BENCH_EXPRESSION                "(12.5*3)=x:=(4/0.5)=(x+ans)=((1+2)*3)=(7-x)="
+#define BENCH_USUAL                     "(1.5*3)="
+#define BENCH_REMAPPED                  "(1,5*3)="
+#else
+#define BENCH_EXPRESSION                "(12*3)=x:=(40/5)=(x+ans)=((1+2)*3)=(7-x)="
+#define BENCH_USUAL                     "(12*3)="
+#define BENCH_REMAPPED                  "[12*3]="
+#endif
+
+typedef struct
+{
+    uint8_t bytes[BENCH_OUTPUT_MAX];
+    size_t length;
+
+} BENCH_OUTPUT;
+
+static void BENCH_Crc(uint8_t * blob, size_t length)
+{
+    uint32_t crc = APP_GRAMMAR_Crc32(blob, length - APP_GRAMMAR_CRC_SIZE);
+
+    blob[length - 4] = (uint8_t)crc;
+    blob[length - 3] = (uint8_t)(crc >> 8);
+    blob[length - 2] = (uint8_t)(crc >> 16);
+    blob[length - 1] = (uint8_t)(crc >> 24);
+}
+
+/* A broken copy of blob must load with status */
+static bool BENCH_Rejects(const uint8_t * blob, size_t length, size_t offset,
+        uint8_t value, bool fixCrc, size_t loadLength, APP_GRAMMAR_STATUS status)
+{
+    static uint8_t copy[CALC_GRAMATICA_LARGO];
+    APP_GRAMMAR grammar = { NULL, NULL };
+    APP_GRAMMAR_STATUS got;
+
+    memcpy(copy, blob, length);
+    copy[offset] = value;
+    if (fixCrc)
+    {
+        BENCH_Crc(copy, length);
+    }
+    got = calcGramaticaCarga(&grammar, copy, loadLength);
+    if (got != status || grammar.classes != NULL)
+    {
+        printf("byte %zu = %u: status %d, %d expected\n", offset, value, (int)got, (int)status);
+        return false;
+    }
+    return true;
+}
+
+/* Steps the whole stream with one byte per calcStep; returns ns */
+static uint64_t BENCH_Run(const APP_GRAMMAR * grammar, const char * stream, size_t length,
+        uint32_t * hash, uint64_t * outputBytes)
+{
+    static CALC_SESSION session;
+    static APP_TXRING ring;
+    const uint8_t * data;
+    uint64_t start;
+    size_t i, n;
+
+    APP_TXRING_Initialize(&ring);
+    calcSessionInit(&session, &ring, false);
+    calcSessionGramatica(&session, grammar);
+    *hash = 2166136261u;
+    *outputBytes = 0;
+
+    start = BENCH_Now();
+    for (i = 0; i <= length; i++)
+    {
+        if (i < length)
+        {
+            calcStep(&session, stream[i]);
+        }
+        if (APP_TXRING_Count(&ring) > APP_TXRING_SIZE / 2 || i == length)
+        {
+            while ((n = APP_TXRING_Peek(&ring, &data, APP_TXRING_SIZE)) > 0)
+            {
+                *outputBytes += n;
+                APP_TXRING_Release(&ring, n);
+                while (n-- > 0)
+                {
+                    *hash = (*hash ^ *data++) * 16777619u;
+                }
+            }
+        }
+    }
+    return BENCH_Now() - start;
+}
+
+static void BENCH_Output(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH_OUTPUT * output = (BENCH_OUTPUT *)context;
+
+    if (index == 0 && output->length + length <= sizeof(output->bytes))
+    {
+        memcpy(&output->bytes[output->length], data, length);
+        output->length += length;
+    }
+}
+
+/* Sends data to port 0 in packets of packet bytes until a CR comes back;
+ * returns the line, without the echo before its '=' */
+static const char * BENCH_Ask(BENCH_OUTPUT * output, const void * data, size_t length,
+        size_t packet)
+{
+    static char line[BENCH_OUTPUT_MAX];
+    size_t idle = 0, k, from;
+    unsigned t;
+    char * equals;
+
+    output->length = 0;
+    SIM_CDC_ScriptSet(0, data, length, packet);
+    while (memchr(output->bytes, 0x0D, output->length) == NULL && idle < 1000)
+    {
+        for (t = 0; t < 8; t++)
+        {
+            APP_Tasks();
+        }
+        SIM_Poll();
+        idle = (SIM_CDC_Pending(0) == 0) ? idle + 1 : 0;
+    }
+    for (k = 0; k < output->length && output->bytes[k] != 0x0D; k++)
+    {
+        line[k] = (char)output->bytes[k];
+    }
+    line[k] = 0;
+    equals = strchr(line, '=');
+    from = (equals == NULL) ? 0 : (size_t)(equals - line);
+    return &line[from];
+}
+
+int main(int argc, char ** argv)
+{
+    static uint8_t blob[CALC_GRAMATICA_LARGO], custom[CALC_GRAMATICA_LARGO];
+    uint8_t zeroLength[APP_GRAMMAR_HEADER_SIZE + 6];
+    static BENCH_OUTPUT output;
+    const size_t classes = APP_GRAMMAR_HEADER_SIZE;
+    size_t count = 200000, repeats = 5, length, expressionLength, i, r;
+    uint64_t elapsed[2] = { UINT64_MAX, UINT64_MAX }, t, outputBytes[2];
+    uint32_t hash[2];
+    APP_GRAMMAR grammar, broken;
+    APP_GRAMMAR_STATUS status;
+    char usual[BENCH_OUTPUT_MAX], remapped[BENCH_OUTPUT_MAX], rejected[BENCH_OUTPUT_MAX];
+    char * stream;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'r': repeats = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n expressions] [-r repeats]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (count == 0 || repeats == 0)
+    {
+        fprintf(stderr, "expressions and repeats must be nonzero\n");
+        return 2;
+    }
+
+    /* The tables compiled in, as a blob, loaded where they are */
+    length = calcGramaticaBlob(blob, sizeof(blob));
+    status = calcGramaticaCarga(&grammar, blob, length);
+    if (length != CALC_GRAMATICA_LARGO || status != APP_GRAMMAR_OK ||
+            grammar.classes != &blob[classes] || (const uint8_t *)grammar.steps != &blob[classes + 256])
+    {
+        printf("blob of %zu bytes: status %d, not loaded in place\n", length, (int)status);
+        return 1;
+    }
+    ok = ok && APP_GRAMMAR_Crc32((const uint8_t *)"123456789", 9) == 0xCBF43926u;
+    ok = ok && BENCH_Rejects(blob, length, 4, blob[4], false, length - 1, APP_GRAMMAR_TRUNCATED);
+    ok = ok && BENCH_Rejects(blob, length, 0, 'X', false, length, APP_GRAMMAR_BAD_MAGIC);
+    ok = ok && BENCH_Rejects(blob, length, 4, APP_GRAMMAR_VERSION + 1, true, length, APP_GRAMMAR_BAD_VERSION);
+    ok = ok && BENCH_Rejects(blob, length, classes + '(', 0, false, length, APP_GRAMMAR_BAD_CRC);
+    ok = ok && BENCH_Rejects(blob, length, 5, blob[5] ^ 3, true, length, APP_GRAMMAR_WRONG_SET);
+    ok = ok && BENCH_Rejects(blob, length, classes + 'q', 200, true, length, APP_GRAMMAR_BAD_CLASS);
+    /* State 0, class 0 stays in state 0 with no action */
+    ok = ok && BENCH_Rejects(blob, length, classes + 256, 250, true, length, APP_GRAMMAR_BAD_STEP);
+    ok = ok && BENCH_Rejects(blob, length, classes + 257, 250, true, length, APP_GRAMMAR_BAD_STEP);
+    /* A header that gives a length of 0 */
+    memcpy(custom, blob, length);
+    custom[8] = 0;
+    custom[9] = 0;
+    ok = ok && calcGramaticaCarga(&broken, custom, length) == APP_GRAMMAR_TRUNCATED;
+    if (!ok)
+    {
+        return 1;
+    }
+
+    /* The same stream with either grammar */
+    expressionLength = strlen(BENCH_EXPRESSION);
+    stream = malloc(expressionLength * count);
+    if (stream == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        memcpy(&stream[i * expressionLength], BENCH_EXPRESSION, expressionLength);
+    }
+    for (r = 0; r < repeats; r++)
+    {
+        t = BENCH_Run(NULL, stream, expressionLength * count, &hash[0], &outputBytes[0]);
+        elapsed[0] = (t < elapsed[0]) ? t : elapsed[0];
+        t = BENCH_Run(&grammar, stream, expressionLength * count, &hash[1], &outputBytes[1]);
+        elapsed[1] = (t < elapsed[1]) ? t : elapsed[1];
+    }
+    ok = hash[0] == hash[1] && outputBytes[0] == outputBytes[1] && outputBytes[0] > 0;
+
+    /* A grammar of one's own, over CDC */
+    memcpy(custom, blob, length);
+#if PUNTO == 2
+    custom[classes + ','] = custom[classes + '.'];
+#else
+    custom[classes + '['] = custom[classes + '('];
+    custom[classes + ']'] = custom[classes + ')'];
+#endif
+    BENCH_Crc(custom, length);
+
+    SIM_Reset();
+    SIM_CDC_OutputHandlerSet(BENCH_Output, (uintptr_t)&output);
+    APP_Initialize();
+    SIM_Attach();
+    for (i = 0; i < 128; i++)
+    {
+        APP_Tasks();
+        if (i % 8 == 0)
+        {
+            SIM_Poll();
+        }
+    }
+    strcpy(usual, BENCH_Ask(&output, BENCH_USUAL, strlen(BENCH_USUAL), BENCH_PACKET));
+
+    /* A length of 0 is answered and the rest of its read dropped, so it
+     * comes in one packet */
+    SIM_CDC_LineCodingSet(0, BENCH_GRAMMAR_RATE);
+    memcpy(zeroLength, blob, sizeof(zeroLength));
+    zeroLength[8] = 0;
+    zeroLength[9] = 0;
+    ok = ok && strcmp(BENCH_Ask(&output, zeroLength, sizeof(zeroLength), sizeof(zeroLength)), "grammar error 1") == 0;
+    ok = ok && strcmp(BENCH_Ask(&output, custom, length, BENCH_PACKET), "grammar ok") == 0;
+    SIM_CDC_LineCodingSet(0, BENCH_KEYSTROKES_RATE);
+    strcpy(remapped, BENCH_Ask(&output, BENCH_REMAPPED, strlen(BENCH_REMAPPED), BENCH_PACKET));
+
+    custom[classes + 'q'] ^= 1;
+    SIM_CDC_LineCodingSet(0, BENCH_GRAMMAR_RATE);
+    strcpy(rejected, BENCH_Ask(&output, custom, length, BENCH_PACKET));
+    ok = ok && strcmp(usual, remapped) == 0 && usual[0] == '=' &&
+            strcmp(rejected, "grammar error 4") == 0;
+
+    printf("variant            punto%d\n", PUNTO);
+    printf("blob               %zu bytes, loaded in place\n", length);
+    printf("broken blobs       turned down with the right status\n");
+    printf("expression         %s x %zu\n", BENCH_EXPRESSION, count);
+    printf("output             %s (%llu bytes, hash %08x)\n",
+            (hash[0] == hash[1]) ? "identical" : "DIFFERS",
+            (unsigned long long)outputBytes[0], (unsigned)hash[0]);
+    printf("compiled in        %.2f ns per byte\n", (double)elapsed[0] / (expressionLength * count));
+    printf("loaded blob        %.2f ns per byte\n", (double)elapsed[1] / (expressionLength * count));
+    printf("uploaded           %s %s, as %s %s\n", BENCH_REMAPPED, remapped, BENCH_USUAL, usual);
+    printf("bad CRC upload     %s\n", rejected);
+
+    free(stream);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+/*******************************************************************************
+  Result Register Benchmark
+
+  File Name:
+    bench_regs.c
+
+  Summary:
+    Chained calculations that send the previous result back as digits,
+    against the same chains through "ans" and named registers.
+
+  Description:
+    n chains of -l steps each are typed on port 0, one expression per round
+    trip.  A chain starts from a small literal and every step applies +, -
+    or * with a random operand to the result of the step before, then the
+    last step takes away the start value again.  The client either sends
+    the result it received back as text,
+
+        "(1234567.000000*3)="  ...  "(3703704.000000-7)="
+
+    or keeps it in the calculator: the start value goes to register k with
+    "k:=(x+0)=", every step reads "ans" and the last one "(ans-k)=".  The
+    values stay integers below 2^24, so punto2's float is exact and both
+    clients get identical results, checked here against the same
+    arithmetic.  Start values repeat, so part of the steps are answered by
+    the result cache and still have to leave their value in "ans".
+
+    For both clients the benchmark reports the bytes moved, simulated ticks
+    and operations per second of wall clock.  In punto1 the registers also
+    carry INT32_MIN and -1 into one division, which must be answered with
+    INT32_MIN instead of trapping; punto2's float has no such edge.
+
+    Usage: bench_regs_puntoN [-n chains] [-l steps] [-k tasksPerTick]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "app_format.h"
+#include "bench_util.h"
+
+#define BENCH_EXPRESSION_MAX            64
+
+/* Values stay below this, exact in a float */
+#define BENCH_VALUE_MAX                 4000000
+
+#if PUNTO != 2
+/* INT32_MIN / -1 through the registers, each step with what it answers */
+static const char * const benchEdge[][2] =
+{
+    { "(0-2147483647)=", "-2147483647" },
+    { "m:=(ans-1)=", "-2147483648" },
+    { "n:=(0-1)=", "-1" },
+    { "(m/n)=", "-2147483648" }
+};
+#endif
+
+#if PUNTO == 2
+typedef float BENCH_VALUE;
+#else
+typedef int32_t BENCH_VALUE;
+#endif
+
+static uint32_t benchSeed;
+
+static size_t BENCH_Text(char * buffer, BENCH_VALUE value)
+{
+#if PUNTO == 2
+    return APP_FORMAT_Float(buffer, value, 6);
+#else
+    return APP_FORMAT_Int(buffer, value);
+#endif
+}
+
+/* Next step of a chain: multiplies while that keeps the value small, else
+ * adds or takes away, but never below zero: punto1 has no negative
+ * operands to send the result back as */
+static char BENCH_Step(BENCH_VALUE x, int32_t * b)
+{
+    if (x < BENCH_VALUE_MAX / 10 && BENCH_Random(&benchSeed) % 3 == 0)
+    {
+        *b = (int32_t)(BENCH_Random(&benchSeed) % 8) + 2;
+        return '*';
+    }
+    *b = (int32_t)(BENCH_Random(&benchSeed) % 999) + 1;
+    if (x > BENCH_VALUE_MAX / 2)
+    {
+        return '-';
+    }
+    return (BENCH_Random(&benchSeed) % 2 && x >= (BENCH_VALUE)*b) ? '-' : '+';
+}
+
+static BENCH_VALUE BENCH_Apply(char op, BENCH_VALUE a, int32_t b)
+{
+    switch (op)
+    {
+        case '+': return a + (BENCH_VALUE)b;
+        case '-': return a - (BENCH_VALUE)b;
+        default: return a * (BENCH_VALUE)b;
+    }
+}
+
+/* Every chain once, with the previous result as text or from the registers */
+static void BENCH_Chains(BENCH_SIM_RUN * run, size_t count, unsigned steps,
+        unsigned tasksPerTick, bool registers)
+{
+    char expression[BENCH_EXPRESSION_MAX], expected[APP_FORMAT_FLOAT_MAX_LENGTH + 2];
+    char previous[APP_FORMAT_FLOAT_MAX_LENGTH + 2];
+    BENCH_RESULTS bench;
+    BENCH_VALUE start, x;
+    size_t i;
+    unsigned j;
+    int32_t b;
+    char op;
+
+    /* Both clients get the same chains */
+    benchSeed = 12345;
+    memset(&bench, 0, sizeof(bench));
+    BENCH_Start(run, BENCH_ResultOutput, (uintptr_t)&bench, tasksPerTick);
+    for (i = 0; i < count; i++)
+    {
+        start = x = (BENCH_VALUE)(BENCH_Random(&benchSeed) % 50 + 1);
+        sprintf(expression, registers ? "k:=(%d+0)=" : "(%d+0)=", (int)start);
+        previous[BENCH_Text(previous, x)] = 0;
+        BENCH_RoundTrip(run, &bench, expression, previous, tasksPerTick);
+
+        for (j = 0; j < steps; j++)
+        {
+            if (j + 1 < steps)
+            {
+                op = BENCH_Step(x, &b);
+                x = BENCH_Apply(op, x, b);
+                if (registers)
+                {
+                    sprintf(expression, "(ans%c%d)=", op, (int)b);
+                }
+                else
+                {
+                    sprintf(expression, "(%s%c%d)=", previous, op, (int)b);
+                }
+            }
+            else
+            {
+                x = x - start;
+                if (registers)
+                {
+                    strcpy(expression, "(ans-k)=");
+                }
+                else
+                {
+                    sprintf(expression, "(%s-%d)=", previous, (int)start);
+                }
+            }
+            expected[BENCH_Text(expected, x)] = 0;
+            BENCH_RoundTrip(run, &bench, expression, expected, tasksPerTick);
+            strcpy(previous, expected);
+        }
+    }
+    BENCH_Stop(run, bench.results, bench.errors);
+}
+
+int main(int argc, char ** argv)
+{
+    size_t count = 1000;
+    unsigned steps = 16, tasksPerTick = 8;
+    BENCH_SIM_RUN run[2], edge;
+#if PUNTO != 2
+    BENCH_RESULTS bench;
+    size_t i;
+#endif
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:k:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'l': steps = strtoul(optarg, NULL, 0); break;
+            case 'k': tasksPerTick = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n chains] [-l steps] [-k tasksPerTick]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (steps == 0 || tasksPerTick == 0)
+    {
+        fprintf(stderr, "steps and tasksPerTick must be nonzero\n");
+        return 2;
+    }
+
+    BENCH_Chains(&run[0], count, steps, tasksPerTick, false);
+    BENCH_Chains(&run[1], count, steps, tasksPerTick, true);
+
+#if PUNTO != 2
+    memset(&bench, 0, sizeof(bench));
+    BENCH_Start(&edge, BENCH_ResultOutput, (uintptr_t)&bench, tasksPerTick);
+    for (i = 0; i < sizeof(benchEdge) / sizeof(benchEdge[0]); i++)
+    {
+        BENCH_RoundTrip(&edge, &bench, benchEdge[i][0], benchEdge[i][1], tasksPerTick);
+    }
+    BENCH_Stop(&edge, bench.results, bench.errors);
+#else
+    memset(&edge, 0, sizeof(edge));
+#endif
+
+    printf("variant            punto%d\n", PUNTO);
+    printf("chains             %zu of %u steps\n", count, steps);
+    printf("                   %16s %16s\n", "literal", "registers");
+    printf("round trips        %16llu %16llu\n",
+            (unsigned long long)run[0].roundTrips, (unsigned long long)run[1].roundTrips);
+    printf("answered           %16zu %16zu\n", run[0].results, run[1].results);
+    printf("wrong              %16zu %16zu\n", run[0].errors, run[1].errors);
+    printf("bytes in           %16llu %16llu\n",
+            (unsigned long long)run[0].bytesIn, (unsigned long long)run[1].bytesIn);
+    printf("bytes in per step  %16.2f %16.2f\n",
+            (double)run[0].bytesIn / run[0].roundTrips, (double)run[1].bytesIn / run[1].roundTrips);
+    printf("bytes out          %16llu %16llu\n",
+            (unsigned long long)run[0].bytesOut, (unsigned long long)run[1].bytesOut);
+#if PUNTO != 2
+    printf("INT32_MIN / -1     (m/n)=%s %s\n", benchEdge[3][1],
+            (edge.results == edge.roundTrips && edge.errors == 0) ? "ok" : "WRONG");
+#endif
+    printf("sim ticks          %16llu %16llu\n",
+            (unsigned long long)run[0].ticks, (unsigned long long)run[1].ticks);
+    printf("throughput (op/s)  %16.0f %16.0f\n",
+            run[0].roundTrips * 1e9 / run[0].elapsed, run[1].roundTrips * 1e9 / run[1].elapsed);
+
+    return (run[0].results == run[0].roundTrips && run[1].results == run[1].roundTrips &&
+            run[0].errors == 0 && run[1].errors == 0 &&
+            edge.results == edge.roundTrips && edge.errors == 0) ? 0 : 1;
+}
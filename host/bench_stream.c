@@ -0,0 +1,238 @@
+/*******************************************************************************
+  Streaming Aggregates Benchmark
+
+  File Name:
+    bench_stream.c
+
+  Summary:
+    A log of samples summed with one "(ans+x)=" round trip each, against
+    the same log streamed to a port in streaming mode and one '?' at the
+    end.
+
+  Description:
+    n samples, like the readings of a sensor, go to port 0 twice.  Once as
+    keystrokes, "(x+0)=" and then "(ans+x)=" or "(ans-x)=" per sample,
+    each waiting for its result.  Once after the port was switched to the
+    streaming protocol with SET LINE CODING: the samples one per line in
+    full 64 byte packets and a '?' after the last one, whose report is the
+    only output.  punto1 takes integers, punto2 numbers with three
+    decimals.
+
+    The report must give the exact count, min and max.  punto1's sum and
+    mean must be exact; punto2's float sum, compensated, must be within one
+    ulp of the exact sum of the samples as converted, which is printed next
+    to the error of the plain float sum the round trips ended with.  For
+    both paths the benchmark reports the bytes moved, transfers, simulated
+    ticks and samples per second of wall clock.
+
+    Usage: bench_stream_puntoN [-n samples] [-k tasksPerTick]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "bench_util.h"
+
+/* APP_STREAM_DTE_RATE of the firmware */
+#define BENCH_STREAM_RATE               271828
+
+#define BENCH_PACKET                    64
+#define BENCH_TEXT_MAX                  512
+
+typedef struct
+{
+    /* Text after the last '=', or the report */
+    char text[BENCH_TEXT_MAX];
+    size_t textLength;
+
+    /* Echo comes before the '=' of every result */
+    bool keystrokes;
+    size_t results;
+
+} BENCH_STREAM;
+
+static uint32_t benchSeed = 12345;
+
+/* A sample in thousandths for punto2, in units for punto1 */
+static int32_t BENCH_Sample(void)
+{
+#if PUNTO == 2
+    return (int32_t)(BENCH_Random(&benchSeed) % 200001) - 50000;
+#else
+    return (int32_t)(BENCH_Random(&benchSeed) % 2001) - 500;
+#endif
+}
+
+static int BENCH_Text(char * buffer, int32_t sample)
+{
+#if PUNTO == 2
+    return sprintf(buffer, "%s%d.%03d", (sample < 0) ? "-" : "", abs(sample) / 1000, abs(sample) % 1000);
+#else
+    return sprintf(buffer, "%d", (int)sample);
+#endif
+}
+
+/* The sample as the firmware converts it */
+static double BENCH_Value(int32_t sample)
+{
+#if PUNTO == 2
+    float x = (float)abs(sample) / 1e3f;
+
+    return (sample < 0) ? -x : x;
+#else
+    return sample;
+#endif
+}
+
+/* Results of the keystrokes and the streaming report both end in CR */
+static void BENCH_Output(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH_STREAM * bench = (BENCH_STREAM *)context;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (data[i] == '=' && bench->keystrokes)
+        {
+            bench->textLength = 0;
+        }
+        else if (data[i] == 0x0D)
+        {
+            bench->text[bench->textLength] = 0;
+            bench->results++;
+            bench->textLength = 0;
+        }
+        else if (bench->textLength + 1 < sizeof(bench->text))
+        {
+            bench->text[bench->textLength++] = (char)data[i];
+        }
+    }
+}
+
+/* Value of "name=" in the report, NAN if it is not there */
+static double BENCH_Field(const char * report, const char * name)
+{
+    char key[16];
+    const char * p;
+
+    sprintf(key, "%s=", name);
+    p = strstr(report, key);
+    return (p == NULL) ? NAN : strtod(p + strlen(key), NULL);
+}
+
+int main(int argc, char ** argv)
+{
+    size_t count = 20000, i, scriptLength = 0;
+    unsigned tasksPerTick = 8;
+    char expression[48], text[24], report[BENCH_TEXT_MAX];
+    int32_t * samples, minimum = INT32_MAX, maximum = INT32_MIN;
+    double exact = 0, value, sum, mean, roundTripSum, tolerance;
+    float plain = 0;
+    uint8_t * script;
+    BENCH_STREAM bench;
+    BENCH_SIM_RUN run[2];
+    bool ok;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:k:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 'k': tasksPerTick = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n samples] [-k tasksPerTick]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (count == 0 || tasksPerTick == 0)
+    {
+        fprintf(stderr, "samples and tasksPerTick must be nonzero\n");
+        return 2;
+    }
+
+    samples = malloc(count * sizeof(int32_t));
+    script = malloc(count * 16 + 2);
+    if (samples == NULL || script == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        samples[i] = BENCH_Sample();
+        minimum = (samples[i] < minimum) ? samples[i] : minimum;
+        maximum = (samples[i] > maximum) ? samples[i] : maximum;
+        value = BENCH_Value(samples[i]);
+        exact += value;
+        plain += (float)value;
+        scriptLength += (size_t)BENCH_Text((char *)&script[scriptLength], samples[i]);
+        script[scriptLength++] = '\n';
+    }
+    script[scriptLength++] = '?';
+
+    /* One round trip per sample, the sum kept in "ans" */
+    memset(&bench, 0, sizeof(bench));
+    bench.keystrokes = true;
+    BENCH_Start(&run[0], BENCH_Output, (uintptr_t)&bench, tasksPerTick);
+    for (i = 0; i < count; i++)
+    {
+        BENCH_Text(text, abs(samples[i]));
+        sprintf(expression, (i == 0) ? "(%s%s+0)=" : "(ans%s%s)=",
+                (samples[i] < 0) ? "-" : (i == 0) ? "" : "+", text);
+        SIM_CDC_ScriptSet(0, (const uint8_t *)expression, strlen(expression), BENCH_PACKET);
+        BENCH_Wait(&bench.results, i + 1, tasksPerTick);
+    }
+    BENCH_Stop(&run[0], bench.results, 0);
+    roundTripSum = strtod(bench.text, NULL);
+
+    /* The whole log and one question */
+    memset(&bench, 0, sizeof(bench));
+    BENCH_Start(&run[1], BENCH_Output, (uintptr_t)&bench, tasksPerTick);
+    SIM_CDC_LineCodingSet(0, BENCH_STREAM_RATE);
+    SIM_CDC_ScriptSet(0, script, scriptLength, BENCH_PACKET);
+    BENCH_Wait(&bench.results, 1, tasksPerTick);
+    BENCH_Stop(&run[1], bench.results, 0);
+    strcpy(report, bench.text);
+
+    sum = BENCH_Field(report, "sum");
+    mean = BENCH_Field(report, "mean");
+#if PUNTO == 2
+    /* One float ulp of the sum, and the printed rounding to 10^-6 */
+    tolerance = ldexp(1.0, ilogb(exact) - 23) + 1e-6;
+#else
+    tolerance = 0;
+#endif
+    ok = BENCH_Field(report, "n") == (double)count && BENCH_Field(report, "skip") == 0 &&
+            fabs(BENCH_Field(report, "min") - BENCH_Value(minimum)) <= 1e-6 &&
+            fabs(BENCH_Field(report, "max") - BENCH_Value(maximum)) <= 1e-6 &&
+            fabs(sum - exact) <= tolerance &&
+            fabs(mean - exact / count) <= tolerance / count + 1e-6;
+
+    printf("variant            punto%d\n", PUNTO);
+    printf("samples            %zu\n", count);
+    printf("report             %s\n", report);
+    printf("exact sum          %.6f\n", exact);
+    printf("error of the sum   %16.6f (streamed) %16.6f (round trips) %16.6f (plain float)\n",
+            sum - exact, roundTripSum - exact, (double)plain - exact);
+    printf("                   %16s %16s\n", "round trips", "stream");
+    printf("answered           %16zu %16zu\n", run[0].results, run[1].results);
+    printf("bytes in           %16llu %16llu\n",
+            (unsigned long long)run[0].bytesIn, (unsigned long long)run[1].bytesIn);
+    printf("bytes out          %16llu %16llu\n",
+            (unsigned long long)run[0].bytesOut, (unsigned long long)run[1].bytesOut);
+    printf("transfers          %16llu %16llu\n",
+            (unsigned long long)run[0].transfers, (unsigned long long)run[1].transfers);
+    printf("sim ticks          %16llu %16llu\n",
+            (unsigned long long)run[0].ticks, (unsigned long long)run[1].ticks);
+    printf("throughput (smp/s) %16.0f %16.0f\n",
+            count * 1e9 / run[0].elapsed, count * 1e9 / run[1].elapsed);
+
+    free(samples);
+    free(script);
+
+    return (ok && run[0].results == count && run[1].results == 1) ? 0 : 1;
+}
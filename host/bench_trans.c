@@ -0,0 +1,173 @@
+/*******************************************************************************
+  Character Class Benchmark
+
+  File Name:
+    bench_trans.c
+
+  Summary:
+    Compares the table driven calcTrans against the branchy original.
+
+  Description:
+    calcTransRef is the calcTrans each variant shipped before the 256 entry
+    tblTrans: a digit range check, a switch on the operators and a reverse
+    scan over chrTrans, plus the range check for the register letters and
+    ':' added since.  Both are first compared on every byte value, then
+    timed over three streams:
+
+      random    uniformly distributed bytes
+      invalid   bytes that match nothing, the longest path through the scan
+      mixed     random picks from every class, defeating branch prediction
+
+    Usage: bench_trans_puntoN [-n bytes]
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "app.h"
+#if PUNTO == 2
+#include "interfacesP4punto2.h"
+#else
+#include "interfacesP4punto1.h"
+#endif
+#include "bench_util.h"
+
+extern int chrTrans[];
+int calcTrans(char ch);
+
+#if PUNTO == 2
+__attribute__((noinline)) static int calcTransRef(char ch)
+{
+    int tr = 0;
+
+    if ((ch >= '0') && (ch <= '9'))
+        return(5);
+    switch (ch)
+    {
+        case '+':
+        case '*':
+        case '/':
+            return(6);
+    }
+    if (ch == '-')
+        return(7);
+    if (CALC_REGISTROS && (ch >= 'a') && (ch <= 'z'))
+        return(8);
+    if (CALC_REGISTROS && ch == ':')
+        return(9);
+    for (tr = 4; tr > 0; tr--)
+        if (ch == chrTrans[tr])
+            break;
+    return(tr);
+}
+
+static const char mixedSet[] = "0123456789+*/-().=x: \x1b";
+#else
+__attribute__((noinline)) static int calcTransRef(char ch)
+{
+    int tran = 0;
+
+    if ((ch >= '0') && (ch <= '9'))
+        return(6);
+    switch (ch)
+    {
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+            return(7);
+    }
+    if (CALC_REGISTROS && (ch >= 'a') && (ch <= 'z'))
+        return(8);
+    if (CALC_REGISTROS && ch == ':')
+        return(9);
+    for (tran = 5; tran > 0; tran--)
+        if (ch == chrTrans[tran])
+            break;
+    return(tran);
+}
+
+static const char mixedSet[] = "0123456789+*/-()=x: \x08\x1b";
+#endif
+
+static double BENCH_Run(int (*classify)(char), const char * data, size_t length,
+        unsigned * checksum)
+{
+    uint64_t start = BENCH_Now();
+    unsigned sum = 0;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        sum += (unsigned)classify(data[i]);
+    }
+    *checksum = sum;
+    return (double)(BENCH_Now() - start) / length;
+}
+
+int main(int argc, char ** argv)
+{
+    size_t length = 16u << 20;
+    uint32_t seed = 0x2545F491u;
+    const char * names[3] = { "random", "invalid", "mixed" };
+    char * streams[3];
+    unsigned refSum, tblSum;
+    double refNs, tblNs;
+    size_t i;
+    int s, opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        if (opt != 'n')
+        {
+            fprintf(stderr, "usage: %s [-n bytes]\n", argv[0]);
+            return 2;
+        }
+        length = strtoul(optarg, NULL, 0);
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        if (calcTrans((char)i) != calcTransRef((char)i))
+        {
+            printf("mismatch at byte 0x%02zx: table %d, reference %d\n",
+                    i, calcTrans((char)i), calcTransRef((char)i));
+            return 1;
+        }
+    }
+
+    for (s = 0; s < 3; s++)
+    {
+        streams[s] = malloc(length);
+        if (streams[s] == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    for (i = 0; i < length; i++)
+    {
+        uint32_t r = BENCH_Random(&seed);
+
+        streams[0][i] = (char)r;
+        streams[1][i] = (char)('A' + r % 26);
+        streams[2][i] = mixedSet[r % (sizeof(mixedSet) - 1)];
+    }
+
+    printf("variant punto%d, all 256 byte values agree, %zu bytes per stream\n", PUNTO, length);
+    printf("%-10s %12s %12s %8s\n", "stream", "ref ns/B", "table ns/B", "speedup");
+    for (s = 0; s < 3; s++)
+    {
+        refNs = BENCH_Run(calcTransRef, streams[s], length, &refSum);
+        tblNs = BENCH_Run(calcTrans, streams[s], length, &tblSum);
+        if (refSum != tblSum)
+        {
+            printf("checksum mismatch on %s stream\n", names[s]);
+            return 1;
+        }
+        printf("%-10s %12.3f %12.3f %7.2fx\n", names[s], refNs, tblNs, refNs / tblNs);
+        free(streams[s]);
+    }
+
+    return 0;
+}
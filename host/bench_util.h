@@ -0,0 +1,184 @@
+/*******************************************************************************
+  Benchmark Helpers Header File
+
+  File Name:
+    bench_util.h
+
+  Summary:
+    The wall clock and random numbers of the bench_*.c programs, and the
+    round trips of those that drive the simulator.
+
+  Description:
+    Each program is a single translation unit, so the helpers are inline
+    here instead of in a file every Makefile rule would have to link.
+
+    A program that includes sim.h before this file also gets BENCH_Start,
+    BENCH_Wait and BENCH_Stop around a run on port 0, counted in a
+    BENCH_SIM_RUN, and BENCH_RoundTrip to check each "=...CR" result the
+    calculator prints against the one expected in a BENCH_RESULTS.
+ *******************************************************************************/
+
+#ifndef _BENCH_UTIL_H
+#define _BENCH_UTIL_H
+
+#include <stdint.h>
+#include <time.h>
+
+/* Nanoseconds of the monotonic clock */
+static inline uint64_t BENCH_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift32: the next number of the sequence *state is in. A state of 0
+ * stays 0, so seeds must be nonzero */
+static inline uint32_t BENCH_Random(uint32_t * state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (*state = x);
+}
+
+#ifdef _SIM_H
+
+#include "app_format.h"
+
+/* What one run moved and took, from BENCH_Start to BENCH_Stop */
+typedef struct
+{
+    uint64_t roundTrips;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t transfers;
+    uint64_t ticks;
+    uint64_t elapsed;
+    size_t results;
+    size_t errors;
+
+} BENCH_SIM_RUN;
+
+typedef struct
+{
+    /* Text of the result after the '=' */
+    char text[APP_FORMAT_FLOAT_MAX_LENGTH + 2];
+    size_t textLength;
+    bool inResult;
+
+    /* What the result being received must read */
+    const char * expected;
+    size_t expectedLength;
+
+    size_t results;
+    size_t errors;
+
+} BENCH_RESULTS;
+
+/* Output handler with a BENCH_RESULTS as context */
+static inline void BENCH_ResultOutput(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, uintptr_t context)
+{
+    BENCH_RESULTS * bench = (BENCH_RESULTS *)context;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        /* The echo of "k:=" starts one too, the result's '=' starts over */
+        if (data[i] == '=')
+        {
+            bench->inResult = true;
+            bench->textLength = 0;
+        }
+        else if (bench->inResult && data[i] == 0x0D)
+        {
+            bench->inResult = false;
+            if (bench->textLength != bench->expectedLength ||
+                    memcmp(bench->text, bench->expected, bench->textLength) != 0)
+            {
+                bench->errors++;
+            }
+            bench->results++;
+        }
+        else if (bench->inResult && bench->textLength < sizeof(bench->text))
+        {
+            bench->text[bench->textLength++] = (char)data[i];
+        }
+    }
+}
+
+/* Powers up a fresh device with handler watching what it sends and lets
+ * it enumerate, tasksPerTick APP_Tasks calls to every tick */
+static inline void BENCH_Start(BENCH_SIM_RUN * run, SIM_DATA_HANDLER handler, uintptr_t context,
+        unsigned tasksPerTick)
+{
+    unsigned k;
+
+    memset(run, 0, sizeof(*run));
+    SIM_Reset();
+    SIM_CDC_OutputHandlerSet(handler, context);
+    APP_Initialize();
+    SIM_Attach();
+    for (k = 0; k < 16 * tasksPerTick; k++)
+    {
+        APP_Tasks();
+        if (k % tasksPerTick == 0)
+        {
+            SIM_Poll();
+        }
+    }
+    run->ticks = SIM_StatsGet()->ticks;
+    run->elapsed = BENCH_Now();
+}
+
+/* Runs until the handler has counted *results up to target, or port 0
+ * had nothing in flight for 1000 ticks; false in that case */
+static inline bool BENCH_Wait(const size_t * results, size_t target, unsigned tasksPerTick)
+{
+    size_t idle = 0;
+    unsigned k;
+
+    while (*results < target && idle < 1000)
+    {
+        for (k = 0; k < tasksPerTick; k++)
+        {
+            APP_Tasks();
+        }
+        SIM_Poll();
+        idle = (SIM_CDC_Pending(0) == 0) ? idle + 1 : 0;
+    }
+    return *results >= target;
+}
+
+/* Types one expression, in packets of 64 bytes, and waits for its result;
+ * false if none came */
+static inline bool BENCH_RoundTrip(BENCH_SIM_RUN * run, BENCH_RESULTS * bench,
+        const char * expression, const char * expected, unsigned tasksPerTick)
+{
+    bench->expected = expected;
+    bench->expectedLength = strlen(expected);
+    SIM_CDC_ScriptSet(0, (const uint8_t *)expression, strlen(expression), 64);
+    run->roundTrips++;
+    return BENCH_Wait(&bench->results, bench->results + 1, tasksPerTick);
+}
+
+static inline void BENCH_Stop(BENCH_SIM_RUN * run, size_t results, size_t errors)
+{
+    const SIM_STATS * stats = SIM_StatsGet();
+
+    run->elapsed = BENCH_Now() - run->elapsed;
+    run->ticks = stats->ticks - run->ticks;
+    run->bytesIn = stats->bytesIn;
+    run->bytesOut = stats->bytesOut;
+    run->transfers = stats->reads + stats->writes;
+    run->results = results;
+    run->errors = errors;
+}
+
+#endif /* _SIM_H */
+
+#endif /* _BENCH_UTIL_H */
@@ -0,0 +1,462 @@
+/*******************************************************************************
+  Offline Log Evaluator
+
+  File Name:
+    calc_batch.c
+
+  Summary:
+    Runs a captured calculator log through the firmware grammar on all cores.
+
+  Description:
+    The log is memory mapped and cut into chunks of about -c bytes.  Every
+    cut is placed right after an '=', so a chunk normally starts where the
+    device would be idle, waiting for '('.  Worker threads evaluate chunks
+    with a CALC_SESSION of their own (the same mtzTrans and actions the
+    firmware runs, built with APP_BATCH_MODE so only results are produced)
+    and collect each chunk's output separately.
+
+    Chunks are handed out by work stealing: every worker starts with an
+    equal contiguous range of chunk numbers and takes from its front; a
+    worker that runs dry steals the back half of another worker's range.
+
+    The main thread writes the outputs strictly in input order.  A chunk was
+    evaluated assuming the session before it was idle.  If the previous
+    chunk actually ended inside an expression (an '=' that did not complete
+    one), the chunk is evaluated again, in order, starting from the real
+    session, so the output is byte for byte what one session reading the
+    whole log would produce.
+
+    The registers are carried the same way.  A chunk that names none of a
+    to z (nor "ans") leaves them as they were, except that each result it
+    printed went to ans, so its end session takes the real registers from
+    the one before.  A chunk that names one while the real registers are
+    not those of a fresh session is evaluated again, in order.
+
+    Usage: calc_batch_puntoN [-t threads] [-c chunkBytes] [-o output] log
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "app.h"
+#if PUNTO == 2
+#include "interfacesP4punto2.h"
+#else
+#include "interfacesP4punto1.h"
+#endif
+
+#define BATCH_MAX_THREADS               256
+#define BATCH_DEFAULT_CHUNK             (1u << 20)
+
+typedef struct
+{
+    const char * data;
+    size_t length;
+
+    /* Results produced by the chunk */
+    char * out;
+    size_t outLength;
+    size_t outCapacity;
+
+    /* Session after the last byte of the chunk */
+    CALC_SESSION end;
+
+#if CALC_REGISTROS
+    /* A letter somewhere in the chunk, which may name a register */
+    bool names;
+#endif
+
+    /* Set with release semantics once out and end are final */
+    int done;
+
+} BATCH_CHUNK;
+
+typedef struct
+{
+    /* Chunk numbers [lo, hi) still to do, packed as lo | hi << 32 so the
+     * owner and thieves can update the range with one compare and swap */
+    uint64_t range __attribute__((aligned(64)));
+
+    pthread_t thread;
+    unsigned id;
+    uint64_t steals;
+    APP_TXRING ring;
+
+} BATCH_WORKER;
+
+static BATCH_CHUNK * chunks;
+static size_t chunkCount;
+static BATCH_WORKER * workers;
+static unsigned workerCount;
+
+static uint64_t BATCH_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t BATCH_Range(uint32_t lo, uint32_t hi)
+{
+    return (uint64_t)lo | ((uint64_t)hi << 32);
+}
+
+/* Appends everything waiting in the ring to the chunk output */
+static void BATCH_Drain(APP_TXRING * ring, BATCH_CHUNK * chunk)
+{
+    const uint8_t * data;
+    size_t count;
+
+    while ((count = APP_TXRING_Peek(ring, &data, APP_TXRING_SIZE)) != 0)
+    {
+        if (chunk->outLength + count > chunk->outCapacity)
+        {
+            chunk->outCapacity = 2 * (chunk->outLength + count);
+            chunk->out = realloc(chunk->out, chunk->outCapacity);
+            if (chunk->out == NULL)
+            {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+        }
+        memcpy(chunk->out + chunk->outLength, data, count);
+        chunk->outLength += count;
+        APP_TXRING_Release(ring, count);
+    }
+}
+
+/* Runs a chunk from the given session and records where it ended */
+static void BATCH_Evaluate(BATCH_CHUNK * chunk, CALC_SESSION * session, APP_TXRING * ring)
+{
+    size_t i, taken;
+
+    APP_TXRING_Initialize(ring);
+    session->tx = ring;
+    chunk->outLength = 0;
+
+    for (i = 0; i < chunk->length; i += taken)
+    {
+        taken = 0;
+        if ((unsigned char)(chunk->data[i] - '0') <= 9)
+        {
+            taken = calcDigitos(session, &chunk->data[i], chunk->length - i);
+        }
+        if (taken == 0)
+        {
+            calcStep(session, chunk->data[i]);
+            taken = 1;
+        }
+        if (APP_TXRING_Count(ring) > APP_TXRING_SIZE / 2)
+        {
+            BATCH_Drain(ring, chunk);
+        }
+#if CALC_BIGNUM
+        while (calcFlush(session))
+        {
+            BATCH_Drain(ring, chunk);
+        }
+#endif
+    }
+    BATCH_Drain(ring, chunk);
+    chunk->end = *session;
+}
+
+#if CALC_REGISTROS
+static bool BATCH_Names(const BATCH_CHUNK * chunk)
+{
+    size_t i;
+
+    for (i = 0; i < chunk->length; i++)
+    {
+        if ((unsigned char)(chunk->data[i] - 'a') < 26)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+/* Owner side: next chunk from the front of the worker's own range */
+static bool BATCH_Take(BATCH_WORKER * worker, uint32_t * index)
+{
+    uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+    uint32_t lo, hi;
+
+    do
+    {
+        lo = (uint32_t)range;
+        hi = (uint32_t)(range >> 32);
+        if (lo >= hi)
+        {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&worker->range, &range, BATCH_Range(lo + 1, hi),
+            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    *index = lo;
+    return true;
+}
+
+/* Thief side: moves the back half of a victim's range to the worker's own,
+ * which is empty at this point so no other thread is modifying it */
+static bool BATCH_Steal(BATCH_WORKER * worker, BATCH_WORKER * victim)
+{
+    uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+    uint32_t lo, hi, split;
+
+    do
+    {
+        lo = (uint32_t)range;
+        hi = (uint32_t)(range >> 32);
+        if (lo >= hi)
+        {
+            return false;
+        }
+        split = hi - (hi - lo + 1) / 2;
+    } while (!__atomic_compare_exchange_n(&victim->range, &range, BATCH_Range(lo, split),
+            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    __atomic_store_n(&worker->range, BATCH_Range(split, hi), __ATOMIC_RELEASE);
+    worker->steals++;
+    return true;
+}
+
+static void * BATCH_Worker(void * arg)
+{
+    BATCH_WORKER * worker = arg;
+    CALC_SESSION session;
+    uint32_t index;
+    unsigned n;
+
+    for (;;)
+    {
+        while (BATCH_Take(worker, &index))
+        {
+            calcSessionInit(&session, &worker->ring, false);
+#if CALC_REGISTROS
+            chunks[index].names = BATCH_Names(&chunks[index]);
+#endif
+            BATCH_Evaluate(&chunks[index], &session, &worker->ring);
+            __atomic_store_n(&chunks[index].done, 1, __ATOMIC_RELEASE);
+        }
+
+        for (n = 1; n < workerCount; n++)
+        {
+            if (BATCH_Steal(worker, &workers[(worker->id + n) % workerCount]))
+            {
+                break;
+            }
+        }
+        if (n == workerCount)
+        {
+            return NULL;
+        }
+    }
+}
+
+/* Cuts the log right after the first '=' at or past every chunkSize bytes */
+static size_t BATCH_Split(const char * data, size_t length, size_t chunkSize, BATCH_CHUNK * out)
+{
+    size_t start = 0, count = 0;
+    const char * equal;
+
+    while (start < length)
+    {
+        size_t end = length;
+
+        if (length - start > chunkSize)
+        {
+            equal = memchr(data + start + chunkSize - 1, '=', length - start - chunkSize + 1);
+            if (equal != NULL)
+            {
+                end = (size_t)(equal - data) + 1;
+            }
+        }
+        if (out != NULL)
+        {
+            memset(&out[count], 0, sizeof(out[count]));
+            out[count].data = data + start;
+            out[count].length = end - start;
+        }
+        count++;
+        start = end;
+    }
+    return count;
+}
+
+int main(int argc, char ** argv)
+{
+    const char * outputName = NULL;
+    size_t chunkSize = BATCH_DEFAULT_CHUNK;
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned threads = (online > 0) ? (unsigned)online : 1;
+    APP_TXRING fixRing;
+    CALC_SESSION session;
+#if CALC_REGISTROS
+    CALC_SESSION fresh;
+    bool redo;
+#endif
+    uint64_t start, elapsed, steals = 0;
+    size_t i, k, results = 0, fixups = 0;
+    struct stat st;
+    const char * data;
+    FILE * output = stdout;
+    unsigned t;
+    int fd, opt;
+
+    while ((opt = getopt(argc, argv, "t:c:o:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': threads = (unsigned)strtoul(optarg, NULL, 0); break;
+            case 'c': chunkSize = strtoul(optarg, NULL, 0); break;
+            case 'o': outputName = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-t threads] [-c chunkBytes] [-o output] log\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc - 1 || threads == 0 || threads > BATCH_MAX_THREADS || chunkSize == 0)
+    {
+        fprintf(stderr, "usage: %s [-t threads 1..%d] [-c chunkBytes] [-o output] log\n",
+                argv[0], BATCH_MAX_THREADS);
+        return 2;
+    }
+
+    fd = open(argv[optind], O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    data = "";
+    if (st.st_size > 0)
+    {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            perror("mmap");
+            return 1;
+        }
+        madvise((void *)data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    }
+    if (outputName != NULL && (output = fopen(outputName, "wb")) == NULL)
+    {
+        perror(outputName);
+        return 1;
+    }
+
+    start = BATCH_Now();
+
+    chunkCount = BATCH_Split(data, (size_t)st.st_size, chunkSize, NULL);
+    if (chunkCount > UINT32_MAX)
+    {
+        fprintf(stderr, "too many chunks, raise -c\n");
+        return 1;
+    }
+    chunks = malloc((chunkCount ? chunkCount : 1) * sizeof(BATCH_CHUNK));
+    workers = aligned_alloc(64, threads * sizeof(BATCH_WORKER));
+    if (chunks == NULL || workers == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    BATCH_Split(data, (size_t)st.st_size, chunkSize, chunks);
+
+    workerCount = threads;
+    for (t = 0; t < threads; t++)
+    {
+        memset(&workers[t], 0, sizeof(workers[t]));
+        workers[t].id = t;
+        workers[t].range = BATCH_Range((uint32_t)(chunkCount * t / threads),
+                (uint32_t)(chunkCount * (t + 1) / threads));
+    }
+    for (t = 0; t < threads; t++)
+    {
+        if (pthread_create(&workers[t].thread, NULL, BATCH_Worker, &workers[t]) != 0)
+        {
+            fprintf(stderr, "cannot start thread %u\n", t);
+            return 1;
+        }
+    }
+
+    /* Emit in input order, redoing any chunk whose predecessor did not end
+     * idle.  State 0 resets every operand on the next '(', so a session in
+     * state 0 behaves like a fresh one but for its registers. */
+    calcSessionInit(&session, &fixRing, false);
+#if CALC_REGISTROS
+    fresh = session;
+#endif
+    for (i = 0; i < chunkCount; i++)
+    {
+        BATCH_CHUNK * chunk = &chunks[i];
+
+        while (!__atomic_load_n(&chunk->done, __ATOMIC_ACQUIRE))
+        {
+            sched_yield();
+        }
+#if CALC_REGISTROS
+        redo = (session.edo != 0) || (chunk->names &&
+                memcmp(session.registros, fresh.registros, sizeof(session.registros)) != 0);
+        if (redo)
+#else
+        if (session.edo != 0)
+#endif
+        {
+            BATCH_Evaluate(chunk, &session, &fixRing);
+            fixups++;
+        }
+#if CALC_REGISTROS
+        else if (!chunk->names)
+        {
+            /* Only results are printed, and every one of them went to ans */
+            if (chunk->outLength != 0)
+            {
+                session.registros[CALC_ANS] = chunk->end.registros[CALC_ANS];
+            }
+            memcpy(chunk->end.registros, session.registros, sizeof(session.registros));
+        }
+#endif
+        session = chunk->end;
+
+        fwrite(chunk->out, 1, chunk->outLength, output);
+        for (k = 0; k < chunk->outLength; k++)
+        {
+            results += (chunk->out[k] == 0x0D);
+        }
+        free(chunk->out);
+    }
+    fflush(output);
+
+    for (t = 0; t < threads; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        steals += workers[t].steals;
+    }
+    elapsed = BATCH_Now() - start;
+
+    fprintf(stderr, "variant            punto%d\n", PUNTO);
+    fprintf(stderr, "input              %llu bytes, %zu chunks of ~%zu bytes\n",
+            (unsigned long long)st.st_size, chunkCount, chunkSize);
+    fprintf(stderr, "results            %zu\n", results);
+    fprintf(stderr, "threads            %u, %llu steals, %zu chunks redone in order\n",
+            threads, (unsigned long long)steals, fixups);
+    fprintf(stderr, "elapsed            %.3f ms, %.1f MB/s\n",
+            elapsed / 1e6, elapsed ? st.st_size * 1e3 / elapsed : 0.0);
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+    free(workers);
+    free(chunks);
+    return 0;
+}
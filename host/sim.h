@@ -0,0 +1,110 @@
+/*******************************************************************************
+  Host Simulation Control Interface
+
+  File Name:
+    sim.h
+
+  Summary:
+    Controls the simulated USB device used by the host build.
+
+  Description:
+    sim_usb.c implements the Harmony USB device layer, the CDC function driver
+    and the BSP entry points declared in the host app.h.  The functions below
+    let a test driver feed a scripted byte stream into each CDC port, observe
+    what the application writes back and advance simulated bus time.
+
+    Time is counted in ticks of one millisecond, a full speed frame.  Every
+    call to SIM_Poll() is one tick: it runs the system timer callbacks that
+    are due, raises a SOF event, completes at most one read and one write
+    per CDC port whose latency has expired and then returns.  A typical driver loop is
+
+        APP_Initialize();
+        SIM_Attach();
+        while (!done)
+        {
+            APP_Tasks();
+            SIM_Poll();
+        }
+ *******************************************************************************/
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#include "app.h"
+
+/* Maximum number of transfers the CDC driver queues per direction and port */
+#define SIM_CDC_QUEUE_DEPTH             8
+
+typedef struct
+{
+    /* Number of SIM_Poll() calls since SIM_Reset() */
+    uint64_t ticks;
+
+    /* Completed transfers */
+    uint64_t reads;
+    uint64_t writes;
+
+    /* Payload bytes moved in each direction */
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+
+    /* Ticks in which script data was available but no read was queued */
+    uint64_t readStallTicks;
+
+    /* Times the application idled the core (SYS_DEVCON_PowerModeEnter) */
+    uint64_t idleEntries;
+
+} SIM_STATS;
+
+/* Called for every completed transfer with the bytes that crossed the bus */
+typedef void (*SIM_DATA_HANDLER)
+(
+    USB_DEVICE_CDC_INDEX index,
+    const uint8_t * data,
+    size_t length,
+    uintptr_t context
+);
+
+/* Restores power-on state: no host attached, empty scripts, zero stats */
+void SIM_Reset(void);
+
+/* Raises VBUS; the device is configured on the next SIM_Poll() */
+void SIM_Attach(void);
+
+/* Advances simulated time by one tick */
+void SIM_Poll(void);
+
+/* Sets the number of ticks a queued read or write needs to complete */
+void SIM_LatencySet(unsigned readTicks, unsigned writeTicks);
+
+/* Sets the byte stream the host sends on a port.  Each read receives at most
+   packetSize bytes.  A packetSize of zero ends every packet after an '=' so
+   each expression travels in its own transfer, as a line based terminal
+   would send it.  The data must stay valid until it has been consumed. */
+void SIM_CDC_ScriptSet(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, size_t packetSize);
+
+/* The host sets the port's line coding (SET LINE CODING) to dteRate bits
+   per second, 8N1.  The control transfer completes at once. */
+void SIM_CDC_LineCodingSet(USB_DEVICE_CDC_INDEX index, uint32_t dteRate);
+
+/* Bytes of the script not yet delivered plus transfers still in flight */
+size_t SIM_CDC_Pending(USB_DEVICE_CDC_INDEX index);
+
+/* Observers for data delivered to (input) and sent by (output) the device */
+void SIM_CDC_InputHandlerSet(SIM_DATA_HANDLER handler, uintptr_t context);
+void SIM_CDC_OutputHandlerSet(SIM_DATA_HANDLER handler, uintptr_t context);
+
+/* Suspends or resumes the bus: no SOF and no transfers while suspended.
+   The system timer keeps running. */
+void SIM_SuspendSet(bool suspended);
+
+/* Forces the state returned by SWITCH_Get() */
+void SIM_SwitchSet(bool pressed);
+
+/* Bit n set when LED n+1 is on */
+unsigned SIM_LedsGet(void);
+
+const SIM_STATS * SIM_StatsGet(void);
+
+#endif /* _SIM_H */
@@ -0,0 +1,584 @@
+/*******************************************************************************
+  Host Simulation of the Harmony USB Device Stack
+
+  File Name:
+    sim_usb.c
+
+  Summary:
+    Scripted USB device layer, CDC function driver and BSP for the host build.
+
+  Description:
+    Transfers are queued exactly like the Harmony CDC function driver queues
+    them: USB_DEVICE_CDC_Read() and USB_DEVICE_CDC_Write() return immediately
+    with a transfer handle and completion is reported later through the
+    registered CDC event handler.  Completion happens in SIM_Poll(), which
+    plays the role of the USB interrupt.  Written data is captured at
+    completion time, so an application that touches a buffer while its
+    transfer is still in flight sends corrupted data, as it would on the bus.
+ *******************************************************************************/
+
+#include <time.h>
+
+#include "sim.h"
+
+typedef struct
+{
+    USB_DEVICE_CDC_TRANSFER_HANDLE handle;
+    uint8_t * readData;
+    const uint8_t * writeData;
+    size_t size;
+    uint64_t due;
+
+} SIM_TRANSFER;
+
+typedef struct
+{
+    SIM_TRANSFER items[SIM_CDC_QUEUE_DEPTH];
+    unsigned head;
+    unsigned count;
+
+} SIM_QUEUE;
+
+typedef struct
+{
+    USB_DEVICE_CDC_EVENT_HANDLER handler;
+    uintptr_t context;
+
+    const uint8_t * script;
+    size_t scriptLength;
+    size_t scriptPos;
+    size_t packetSize;
+
+    SIM_QUEUE reads;
+    SIM_QUEUE writes;
+
+} SIM_CDC_PORT;
+
+/* Periodic callbacks of the system timer service */
+#define SIM_TIMERS                      4
+
+typedef struct
+{
+    SYS_TMR_CALLBACK callback;
+    uintptr_t context;
+    uint32_t period;
+    uint64_t due;
+
+} SIM_TIMER;
+
+static struct
+{
+    USB_DEVICE_EVENT_HANDLER deviceHandler;
+    uintptr_t deviceContext;
+    bool opened;
+    bool powered;
+    bool attached;
+    bool configured;
+
+    SIM_CDC_PORT ports[USB_DEVICE_CDC_INSTANCES_NUMBER];
+    USB_DEVICE_CDC_TRANSFER_HANDLE nextHandle;
+
+    unsigned readLatency;
+    unsigned writeLatency;
+
+    SIM_DATA_HANDLER inputHandler;
+    uintptr_t inputContext;
+    SIM_DATA_HANDLER outputHandler;
+    uintptr_t outputContext;
+
+    bool suspended;
+    bool switchPressed;
+    unsigned leds;
+
+    SIM_TIMER timers[SIM_TIMERS];
+    unsigned timerCount;
+
+    /* Where the data stage of the current control transfer goes */
+    void * controlData;
+    size_t controlLength;
+
+    SIM_STATS stats;
+
+} sim;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static SIM_TRANSFER * SIM_QueuePush(SIM_QUEUE * queue)
+{
+    SIM_TRANSFER * transfer;
+
+    if (queue->count == SIM_CDC_QUEUE_DEPTH)
+    {
+        return NULL;
+    }
+    transfer = &queue->items[(queue->head + queue->count) % SIM_CDC_QUEUE_DEPTH];
+    queue->count++;
+    return transfer;
+}
+
+static SIM_TRANSFER * SIM_QueueFront(SIM_QUEUE * queue)
+{
+    return (queue->count ? &queue->items[queue->head] : NULL);
+}
+
+static void SIM_QueuePop(SIM_QUEUE * queue)
+{
+    queue->head = (queue->head + 1) % SIM_CDC_QUEUE_DEPTH;
+    queue->count--;
+}
+
+static size_t SIM_PacketLength(const SIM_CDC_PORT * port, size_t size)
+{
+    size_t left = port->scriptLength - port->scriptPos;
+    size_t length;
+
+    if (port->packetSize)
+    {
+        length = port->packetSize;
+    }
+    else
+    {
+        const uint8_t * end = memchr(port->script + port->scriptPos, '=', left);
+        length = end ? (size_t)(end - (port->script + port->scriptPos)) + 1 : left;
+    }
+    if (length > left)
+    {
+        length = left;
+    }
+    if (length > size)
+    {
+        length = size;
+    }
+    return length;
+}
+
+static void SIM_CDC_Service(USB_DEVICE_CDC_INDEX index)
+{
+    SIM_CDC_PORT * port = &sim.ports[index];
+    SIM_TRANSFER * transfer;
+    USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE readData;
+    USB_DEVICE_CDC_EVENT_DATA_WRITE_COMPLETE writeData;
+    bool scriptPending = (port->scriptPos < port->scriptLength);
+
+    transfer = SIM_QueueFront(&port->reads);
+    if (transfer == NULL && scriptPending)
+    {
+        sim.stats.readStallTicks++;
+    }
+    if (transfer != NULL && scriptPending && sim.stats.ticks >= transfer->due)
+    {
+        readData.handle = transfer->handle;
+        readData.length = SIM_PacketLength(port, transfer->size);
+        readData.status = USB_DEVICE_CDC_RESULT_OK;
+        memcpy(transfer->readData, port->script + port->scriptPos, readData.length);
+        port->scriptPos += readData.length;
+        SIM_QueuePop(&port->reads);
+
+        sim.stats.reads++;
+        sim.stats.bytesIn += readData.length;
+        if (sim.inputHandler != NULL)
+        {
+            sim.inputHandler(index, transfer->readData, readData.length, sim.inputContext);
+        }
+        if (port->handler != NULL)
+        {
+            port->handler(index, USB_DEVICE_CDC_EVENT_READ_COMPLETE, &readData, port->context);
+        }
+    }
+
+    transfer = SIM_QueueFront(&port->writes);
+    if (transfer != NULL && sim.stats.ticks >= transfer->due)
+    {
+        writeData.handle = transfer->handle;
+        writeData.length = transfer->size;
+        writeData.status = USB_DEVICE_CDC_RESULT_OK;
+        SIM_QueuePop(&port->writes);
+
+        sim.stats.writes++;
+        sim.stats.bytesOut += writeData.length;
+        if (sim.outputHandler != NULL)
+        {
+            sim.outputHandler(index, transfer->writeData, writeData.length, sim.outputContext);
+        }
+        if (port->handler != NULL)
+        {
+            port->handler(index, USB_DEVICE_CDC_EVENT_WRITE_COMPLETE, &writeData, port->context);
+        }
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Simulation Control
+// *****************************************************************************
+// *****************************************************************************
+
+void SIM_Reset(void)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.readLatency = 1;
+    sim.writeLatency = 1;
+    sim.nextHandle = 1;
+}
+
+void SIM_Attach(void)
+{
+    sim.powered = true;
+}
+
+void SIM_Poll(void)
+{
+    USB_DEVICE_EVENT_DATA_CONFIGURED configuredData;
+    USB_DEVICE_CDC_INDEX index;
+    unsigned t;
+
+    sim.stats.ticks++;
+
+    /* The timer runs whatever the bus does */
+    for (t = 0; t < sim.timerCount; t++)
+    {
+        if (sim.timers[t].due <= sim.stats.ticks)
+        {
+            sim.timers[t].due += sim.timers[t].period;
+            sim.timers[t].callback(sim.timers[t].context, (uint32_t)sim.stats.ticks);
+        }
+    }
+
+    if (sim.deviceHandler == NULL)
+    {
+        return;
+    }
+    if (sim.powered && !sim.attached)
+    {
+        sim.deviceHandler(USB_DEVICE_EVENT_POWER_DETECTED, NULL, sim.deviceContext);
+        return;
+    }
+    if (sim.attached && !sim.configured)
+    {
+        sim.configured = true;
+        sim.deviceHandler(USB_DEVICE_EVENT_RESET, NULL, sim.deviceContext);
+        configuredData.configurationValue = 1;
+        sim.deviceHandler(USB_DEVICE_EVENT_CONFIGURED, &configuredData, sim.deviceContext);
+        return;
+    }
+    if (!sim.configured || sim.suspended)
+    {
+        return;
+    }
+
+    sim.deviceHandler(USB_DEVICE_EVENT_SOF, NULL, sim.deviceContext);
+
+    for (index = 0; index < USB_DEVICE_CDC_INSTANCES_NUMBER; index++)
+    {
+        SIM_CDC_Service(index);
+    }
+}
+
+void SIM_SuspendSet(bool suspended)
+{
+    if (suspended != sim.suspended && sim.configured && sim.deviceHandler != NULL)
+    {
+        sim.deviceHandler(suspended ? USB_DEVICE_EVENT_SUSPENDED : USB_DEVICE_EVENT_RESUMED,
+                NULL, sim.deviceContext);
+    }
+    sim.suspended = suspended;
+}
+
+void SIM_CDC_LineCodingSet(USB_DEVICE_CDC_INDEX index, uint32_t dteRate)
+{
+    SIM_CDC_PORT * port = &sim.ports[index];
+    USB_CDC_LINE_CODING coding = { dteRate, 0, 0, 8 };
+
+    if (!sim.configured || port->handler == NULL)
+    {
+        return;
+    }
+
+    /* Setup stage: the application names its buffer for the data stage */
+    sim.controlData = NULL;
+    port->handler(index, USB_DEVICE_CDC_EVENT_SET_LINE_CODING, NULL, port->context);
+    if (sim.controlData == NULL)
+    {
+        return;
+    }
+    memcpy(sim.controlData, &coding,
+            (sim.controlLength < sizeof(coding)) ? sim.controlLength : sizeof(coding));
+    sim.controlData = NULL;
+    port->handler(index, USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_RECEIVED, NULL, port->context);
+}
+
+void SIM_LatencySet(unsigned readTicks, unsigned writeTicks)
+{
+    sim.readLatency = readTicks;
+    sim.writeLatency = writeTicks;
+}
+
+void SIM_CDC_ScriptSet(USB_DEVICE_CDC_INDEX index, const uint8_t * data,
+        size_t length, size_t packetSize)
+{
+    SIM_CDC_PORT * port = &sim.ports[index];
+
+    port->script = data;
+    port->scriptLength = length;
+    port->scriptPos = 0;
+    port->packetSize = packetSize;
+}
+
+size_t SIM_CDC_Pending(USB_DEVICE_CDC_INDEX index)
+{
+    const SIM_CDC_PORT * port = &sim.ports[index];
+
+    return (port->scriptLength - port->scriptPos) + port->writes.count;
+}
+
+void SIM_CDC_InputHandlerSet(SIM_DATA_HANDLER handler, uintptr_t context)
+{
+    sim.inputHandler = handler;
+    sim.inputContext = context;
+}
+
+void SIM_CDC_OutputHandlerSet(SIM_DATA_HANDLER handler, uintptr_t context)
+{
+    sim.outputHandler = handler;
+    sim.outputContext = context;
+}
+
+void SIM_SwitchSet(bool pressed)
+{
+    sim.switchPressed = pressed;
+}
+
+unsigned SIM_LedsGet(void)
+{
+    return sim.leds;
+}
+
+const SIM_STATS * SIM_StatsGet(void)
+{
+    return &sim.stats;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: USB Device Layer
+// *****************************************************************************
+// *****************************************************************************
+
+USB_DEVICE_HANDLE USB_DEVICE_Open(const uint32_t instanceIndex, const DRV_IO_INTENT intent)
+{
+    (void)intent;
+
+    if (instanceIndex != USB_DEVICE_INDEX_0)
+    {
+        return USB_DEVICE_HANDLE_INVALID;
+    }
+    sim.opened = true;
+    return (USB_DEVICE_HANDLE)1;
+}
+
+void USB_DEVICE_EventHandlerSet(USB_DEVICE_HANDLE usbDeviceHandle,
+        const USB_DEVICE_EVENT_HANDLER callBackFunc, uintptr_t context)
+{
+    (void)usbDeviceHandle;
+
+    sim.deviceHandler = callBackFunc;
+    sim.deviceContext = context;
+}
+
+void USB_DEVICE_Attach(USB_DEVICE_HANDLE usbDeviceHandle)
+{
+    (void)usbDeviceHandle;
+
+    sim.attached = true;
+}
+
+void USB_DEVICE_Detach(USB_DEVICE_HANDLE usbDeviceHandle)
+{
+    (void)usbDeviceHandle;
+
+    sim.attached = false;
+    sim.configured = false;
+}
+
+USB_SPEED USB_DEVICE_ActiveSpeedGet(USB_DEVICE_HANDLE usbDeviceHandle)
+{
+    (void)usbDeviceHandle;
+
+    return USB_SPEED_FULL;
+}
+
+void USB_DEVICE_ControlSend(USB_DEVICE_HANDLE usbDeviceHandle, void * data, size_t length)
+{
+    (void)usbDeviceHandle;
+    (void)data;
+    (void)length;
+}
+
+void USB_DEVICE_ControlReceive(USB_DEVICE_HANDLE usbDeviceHandle, void * data, size_t length)
+{
+    (void)usbDeviceHandle;
+
+    sim.controlData = data;
+    sim.controlLength = length;
+}
+
+void USB_DEVICE_ControlStatus(USB_DEVICE_HANDLE usbDeviceHandle,
+        USB_DEVICE_CONTROL_STATUS status)
+{
+    (void)usbDeviceHandle;
+    (void)status;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: USB CDC Function Driver
+// *****************************************************************************
+// *****************************************************************************
+
+USB_DEVICE_CDC_RESULT USB_DEVICE_CDC_EventHandlerSet(USB_DEVICE_CDC_INDEX instanceIndex,
+        USB_DEVICE_CDC_EVENT_HANDLER eventHandler, uintptr_t context)
+{
+    if (instanceIndex >= USB_DEVICE_CDC_INSTANCES_NUMBER)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_INSTANCE_INVALID;
+    }
+    sim.ports[instanceIndex].handler = eventHandler;
+    sim.ports[instanceIndex].context = context;
+    return USB_DEVICE_CDC_RESULT_OK;
+}
+
+USB_DEVICE_CDC_RESULT USB_DEVICE_CDC_Read(USB_DEVICE_CDC_INDEX instanceIndex,
+        USB_DEVICE_CDC_TRANSFER_HANDLE * transferHandle, void * data, size_t size)
+{
+    SIM_TRANSFER * transfer;
+
+    *transferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+    if (instanceIndex >= USB_DEVICE_CDC_INSTANCES_NUMBER)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_INSTANCE_INVALID;
+    }
+    if (!sim.configured)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_INSTANCE_NOT_CONFIGURED;
+    }
+    if (size == 0)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_TRANSFER_SIZE_INVALID;
+    }
+    transfer = SIM_QueuePush(&sim.ports[instanceIndex].reads);
+    if (transfer == NULL)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_TRANSFER_QUEUE_FULL;
+    }
+    transfer->handle = sim.nextHandle++;
+    transfer->readData = data;
+    transfer->writeData = NULL;
+    transfer->size = size;
+    transfer->due = sim.stats.ticks + sim.readLatency;
+    *transferHandle = transfer->handle;
+    return USB_DEVICE_CDC_RESULT_OK;
+}
+
+USB_DEVICE_CDC_RESULT USB_DEVICE_CDC_Write(USB_DEVICE_CDC_INDEX instanceIndex,
+        USB_DEVICE_CDC_TRANSFER_HANDLE * transferHandle, const void * data, size_t size,
+        USB_DEVICE_CDC_TRANSFER_FLAGS flags)
+{
+    SIM_TRANSFER * transfer;
+
+    (void)flags;
+
+    *transferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
+    if (instanceIndex >= USB_DEVICE_CDC_INSTANCES_NUMBER)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_INSTANCE_INVALID;
+    }
+    if (!sim.configured)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_INSTANCE_NOT_CONFIGURED;
+    }
+    transfer = SIM_QueuePush(&sim.ports[instanceIndex].writes);
+    if (transfer == NULL)
+    {
+        return USB_DEVICE_CDC_RESULT_ERROR_TRANSFER_QUEUE_FULL;
+    }
+    transfer->handle = sim.nextHandle++;
+    transfer->readData = NULL;
+    transfer->writeData = data;
+    transfer->size = size;
+    transfer->due = sim.stats.ticks + sim.writeLatency;
+    *transferHandle = transfer->handle;
+    return USB_DEVICE_CDC_RESULT_OK;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Board Support
+// *****************************************************************************
+// *****************************************************************************
+
+void LED_On(void)   { sim.leds |= 1u; }
+void LED_Off(void)  { sim.leds &= ~1u; }
+void LED2_On(void)  { sim.leds |= 2u; }
+void LED2_Off(void) { sim.leds &= ~2u; }
+void LED3_On(void)  { sim.leds |= 4u; }
+void LED3_Off(void) { sim.leds &= ~4u; }
+
+SWITCH_STATE SWITCH_Get(void)
+{
+    return (sim.switchPressed ? SWITCH_STATE_PRESSED : SWITCH_STATE_RELEASED);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: System Services
+// *****************************************************************************
+// *****************************************************************************
+
+SYS_TMR_HANDLE SYS_TMR_CallbackPeriodic(uint32_t periodMs, uintptr_t context,
+        SYS_TMR_CALLBACK callback)
+{
+    SIM_TIMER * timer;
+
+    if (sim.timerCount == SIM_TIMERS || periodMs == 0 || callback == NULL)
+    {
+        return SYS_TMR_HANDLE_INVALID;
+    }
+    timer = &sim.timers[sim.timerCount];
+    timer->callback = callback;
+    timer->context = context;
+    timer->period = periodMs;
+    timer->due = sim.stats.ticks + periodMs;
+    return (SYS_TMR_HANDLE)sim.timerCount++;
+}
+
+/* Handlers only run inside SIM_Poll(), never in the middle of APP_Tasks, so
+   there is nothing to mask.  Idling returns at once: the next SIM_Poll()
+   stands for the interrupt that would wake the core. */
+bool SYS_INT_Disable(void)
+{
+    return true;
+}
+
+void SYS_INT_Enable(void)
+{
+}
+
+void SYS_DEVCON_PowerModeEnter(SYS_POWER_MODE pwrMode)
+{
+    (void)pwrMode;
+
+    sim.stats.idleEntries++;
+}
+
+/* The core timer, counting nanoseconds on the host */
+uint32_t _CP0_GET_COUNT(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
@@ -1,830 +1,841 @@
-/*******************************************************************************
-  MPLAB Harmony Application Source File
-  
-  Company:
-    Microchip Technology Inc.
-  
-  File Name:
-    app.c
-
-  Summary:
-    This file contains the source code for the MPLAB Harmony application.
-
-  Description:
-    This file contains the source code for the MPLAB Harmony application.  It 
-    implements the logic of the application's state machine and it may call 
-    API routines of other MPLAB Harmony modules in the system, such as drivers,
-    system services, and middleware.  However, it does not call any of the
-    system interfaces (such as the "Initialize" and "Tasks" functions) of any of
-    the modules in the system or make any assumptions about when those functions
-    are called.  That is the responsibility of the configuration-specific system
-    files.
- *******************************************************************************/
-
-// DOM-IGNORE-BEGIN
-/*******************************************************************************
-* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
-*
-* Subject to your compliance with these terms, you may use Microchip software
-* and any derivatives exclusively with Microchip products. It is your
-* responsibility to comply with third party license terms applicable to your
-* use of third party software (including open source software) that may
-* accompany Microchip software.
-*
-* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
-* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
-* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
-* PARTICULAR PURPOSE.
-*
-* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
-* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
-* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
-* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
-* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
-* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
-* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
- *******************************************************************************/
-// DOM-IGNORE-END
-
-
-// *****************************************************************************
-// *****************************************************************************
-// Section: Included Files 
-// *****************************************************************************
-// *****************************************************************************
-
 #include "app.h"
+#include "interfacesP4punto1.h"
+#include "app_format.h"
+#include "app_bignum.h"
+#include "app_digits.h"
+#include "app_frame.h"
+#include "app_expr.h"
+#include "app_bulk.h"
+#include "app_stream.h"
 #include <string.h>
 
+//app_port.c usa el CALC_SESSION de la variante que dice PUNTO, ver app_port.h
+#if !defined(PUNTO) || PUNTO != 1
+#error "interfacesP4punto1.c va con PUNTO=1"
+#endif
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Global Data Definitions
-// *****************************************************************************
-// *****************************************************************************
-
-uint8_t CACHE_ALIGN switchPromptUSB[] = "\r\nPUSH BUTTON PRESSED";
-uint8_t CACHE_ALIGN miString[] = "                                 ";
-
-uint8_t CACHE_ALIGN cdcReadBuffer[APP_READ_BUFFER_SIZE];
-uint8_t CACHE_ALIGN cdcWriteBuffer[APP_READ_BUFFER_SIZE];
-
-
-// *****************************************************************************
-/* Application Data
+//Modo batch: no se hace eco de las teclas, sólo se encola el "=resultado" de
+//cada expresión. Para hosts que mandan muchas expresiones por paquete
+#ifndef APP_BATCH_MODE
+#define APP_BATCH_MODE 0
+#endif
 
-  Summary:
-    Holds application data
+#define TRANS_COUNT 10
+#define EDO_COUNT 17
 
-  Description:
-    This structure holds the application's data.
-
-  Remarks:
-    This structure should be initialized by the APP_Initialize function.
-    
-    Application strings and buffers are be defined outside this structure.
-*/
-
-APP_DATA appData;
-
-
-// *****************************************************************************
-// *****************************************************************************
-// Section: Application Callback Functions
-// *****************************************************************************
-// *****************************************************************************
+//Estado del modo expresión: ahí el FSM sólo clasifica y accExpresion compila
+#define EDO_EXPRESION 9
 
+//Estados de los registros: la letra de "x:=", un registro como primer o
+//segundo operando y, tras "an", la espera de la 's' de ans
+#define EDO_DESTINO 10
+#define EDO_REGISTRO_A 13
+#define EDO_REGISTRO_B 15
 
+int startIndex = 0, endIndex = 0; 
 
-/*******************************************************
- * USB CDC Device Events - Application Event Handler
- *******************************************************/
+bool estoyListo = false;
+int cuantosDigitosVan = 0;
 
-USB_DEVICE_CDC_EVENT_RESPONSE APP_USBDeviceCDCEventHandler
-(
-    USB_DEVICE_CDC_INDEX index,
-    USB_DEVICE_CDC_EVENT event,
-    void * pData,
-    uintptr_t userData
-)
-{
-    APP_DATA * appDataObject;
-    USB_CDC_CONTROL_LINE_STATE * controlLineStateData;
-    USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE * eventDataRead;
-    
-    appDataObject = (APP_DATA *)userData;
 
-    switch(event)
-    {
-        case USB_DEVICE_CDC_EVENT_GET_LINE_CODING:
+//Caracteres con transición propia. chrTrans y tblTrans salen de esta lista,
+//así la tabla de calcTrans no se puede desincronizar de chrTrans
+#define CHR_TRANS(X)	X(1,'(') X(2,')') X(3,'=') X(4,8) X(5,27)
+#define DIGITOS(X)		X(6,'0') X(6,'1') X(6,'2') X(6,'3') X(6,'4') \
+						X(6,'5') X(6,'6') X(6,'7') X(6,'8') X(6,'9')
+#define OPERADORES(X)	X(7,'+') X(7,'-') X(7,'*') X(7,'/')
+#define LETRAS(X)		X(8,'a') X(8,'b') X(8,'c') X(8,'d') X(8,'e') X(8,'f') X(8,'g') \
+						X(8,'h') X(8,'i') X(8,'j') X(8,'k') X(8,'l') X(8,'m') X(8,'n') \
+						X(8,'o') X(8,'p') X(8,'q') X(8,'r') X(8,'s') X(8,'t') X(8,'u') \
+						X(8,'v') X(8,'w') X(8,'x') X(8,'y') X(8,'z')
+//Sin CALC_REGISTROS las letras y ':' son inválidas y sus columnas no se usan
+#if CALC_REGISTROS
+#define REGISTROS(X)	LETRAS(X) X(9,':')
+#else
+#define REGISTROS(X)
+#endif
+#define CHR_ENTRADA(tr,ch)	ch,
+#define TBL_ENTRADA(tr,ch)	[(ch)]=(tr),
 
-            /* This means the host wants to know the current line
-             * coding. This is a control transfer request. Use the
-             * USB_DEVICE_ControlSend() function to send the data to
-             * host.  */
+int chrTrans[TRANS_COUNT]=
+					{ 0, CHR_TRANS(CHR_ENTRADA) 6 , 7, 'a', ':' };
+//Transición de cada uno de los 256 valores de byte, 0 = inválida
+const uint8_t tblTrans[256]=
+					{ CHR_TRANS(TBL_ENTRADA) DIGITOS(TBL_ENTRADA) OPERADORES(TBL_ENTRADA) REGISTROS(TBL_ENTRADA) };
+
+//Acción que ejecuta cada estado al entrar a él
+enum Accion{ACC_NINGUNA,ACC_ABRE,ACC_DIGITO_A,ACC_OPERADOR,ACC_DIGITO_B,ACC_CIERRA,ACC_RESULTADO,ACC_CANCELA,
+			ACC_EXPRESION,ACC_ECO,ACC_DESTINO,ACC_REGISTRO,ACC_PARCIAL,ACC_COUNT};
+#define ACCION(ed)	((ed)==1 ? ACC_ABRE : \
+					 ((ed)==2 || (ed)==3) ? ACC_DIGITO_A : \
+					 (ed)==4 ? ACC_OPERADOR : \
+					 ((ed)==5 || (ed)==6) ? ACC_DIGITO_B : \
+					 (ed)==7 ? ACC_CIERRA : \
+					 (ed)==8 ? ACC_RESULTADO : \
+					 (ed)==99 ? ACC_CANCELA : \
+					 (ed)==EDO_EXPRESION ? ACC_EXPRESION : \
+					 ((ed)==11 || (ed)==12) ? ACC_ECO : \
+					 (ed)==EDO_DESTINO ? ACC_DESTINO : \
+					 ((ed)==EDO_REGISTRO_A || (ed)==EDO_REGISTRO_B) ? ACC_REGISTRO : \
+					 ((ed)==14 || (ed)==16) ? ACC_PARCIAL : ACC_NINGUNA)
+
+//Cada casilla guarda el siguiente estado y la acción a ejecutar; si el estado
+//no cambia la acción es ACC_NINGUNA. La primera columna (transición inválida)
+//de cada fila es el propio estado, así que no hace falta validarla aparte.
+//Es el paso de app_grammar.h, así la tabla tiene la forma de un blob
+typedef APP_GRAMMAR_STEP PASO;
+#define P(ed,sig)	{ (sig), ((sig)!=(ed)) ? ACCION(sig) : ACC_NINGUNA }
+#define FILA(t0,t1,t2,t3,t4,t5,t6,t7,t8,t9) \
+					{ P(t0,t0),P(t0,t1),P(t0,t2),P(t0,t3),P(t0,t4),P(t0,t5),P(t0,t6),P(t0,t7), \
+					  P(t0,t8),P(t0,t9) }
+//Casilla que sin CALC_EXPRESIONES ignora el byte y con él pasa al modo expresión
+#define EXPR(ed)	(CALC_EXPRESIONES ? EDO_EXPRESION : (ed))
+//En el modo expresión todo byte válido va a accExpresion, aunque no cambie de estado
+#define PASO_EXPR	{ EDO_EXPRESION, ACC_EXPRESION }
+
+const PASO mtzTrans[EDO_COUNT][TRANS_COUNT]={
+					FILA( 0, 1 , 0 , 0 , 0 , 0 , 0 , 0 , 10, 0 ),
+					FILA( 1, EXPR(1) , 1 , 1 , 99, 99, 2 , 1 , 13, 1 ),
+					FILA( 2, 2 , 2 , 2 , 99, 99, 3 , 4 , 2 , 2 ),
+					FILA( 3, 2 , 2 , 2 , 99, 99, 2 , 2 , 2 , 2 ),
+					FILA( 4, EXPR(4) , 4 , 4 , 99, 99, 5 , 4 , 15, 4 ),
+					FILA( 5, 5 , 7 , 5 , 99, 99, 6 , EXPR(5) , 5 , 5 ),
+					FILA( 6, 5 , 5 , 5 , 99, 99, 5 , 5 , 5 , 5 ),
+					FILA( 7, 7 , 7 , 8 , 99, 99, 7 , 7 , 7 , 7 ),
+					FILA( 8, 0 , 0 , 0 , 0 , 0 , 0 , 0 , 0 , 0 ),
+					{ P(9,9), PASO_EXPR, PASO_EXPR, PASO_EXPR, P(9,99), P(9,99), PASO_EXPR, PASO_EXPR,
+					  PASO_EXPR, P(9,9) },	//EXPRESION
+					FILA( 10, 1 , 10, 10, 99, 99, 10, 10, 10, 11),	//DESTINO
+					FILA( 11, 1 , 11, 12, 99, 99, 11, 11, 11, 11),
+					FILA( 12, 1 , 12, 12, 99, 99, 12, 12, 10, 12),
+					FILA( 13, 13, 13, 13, 99, 99, 13, 4 , 14, 13),	//REGISTRO A
+					FILA( 14, 14, 14, 14, 99, 99, 14, 14, 13, 14),
+					FILA( 15, 15, 7 , 15, 99, 99, 15, EXPR(15) , 16, 15),	//REGISTRO B
+					FILA( 16, 16, 16, 16, 99, 99, 16, 16, 15, 16)};	//EXPRESION
+
+void miPrintf(CALC_SESSION *ses, const char* s, int cont) {
+#if APP_BATCH_MODE
+    (void)s;	//Sin eco en modo batch
+    (void)cont;
+#else
+    if (ses->spans==NULL)
+        APP_TXRING_Write(ses->tx, s, cont);	//El writer de APP_Tasks lo manda por USB
+    else if (s==&ses->chr)
+        APP_TXSPAN_Write(ses->spans, s, cont);	//La copia en la sesión no dura, va al ring
+    else
+        APP_TXSPAN_Reference(ses->spans, s, cont);	//Eco sin copiar: apunta al buffer de lectura
+#endif
+}
 
-            USB_DEVICE_ControlSend(appDataObject->deviceHandle,
-                    &appDataObject->getLineCodingData, sizeof(USB_CDC_LINE_CODING));
+void miResultado(CALC_SESSION *ses, const char* s, int cont) {
+    if (ses->spans==NULL)
+        APP_TXRING_Write(ses->tx, s, cont);	//Los resultados siempre se mandan
+    else
+        APP_TXSPAN_Write(ses->spans, s, cont);	//Sólo el resultado se copia
+}
+                
 
-            break;
+//Aritmética del resultado, común al FSM y al protocolo binario
+int calcOpera(enum Oper oper, int a, int b) {
+	switch(oper) {
+		case Suma:
+				return(a+b);
+		case Resta:
+				return(a-b);
+		case Mult:
+				return(a*b);
+		case Div:
+		default:
+				if (b==-1)
+					return((int)(0u-(unsigned)a));	//Como la resta: INT32_MIN/-1 da INT32_MIN, en C sería indefinido
+				return(b ? a/b : -1);
+	}
+}
 
-        case USB_DEVICE_CDC_EVENT_SET_LINE_CODING:
+uint8_t calcPeticion(const APP_FRAME_REQUEST *pet, APP_FRAME_VALUE *res) {
+	res->d=0;
+	if (pet->status!=APP_FRAME_OK)
+		return(pet->status);
+	if (pet->format!=APP_FRAME_INT32)
+		return(APP_FRAME_UNSUPPORTED);	//Sólo enteros, como el FSM
+	res->i=calcOpera((enum Oper)pet->op,pet->a.i,pet->b.i);
+	return((pet->op==Div && pet->b.i==0) ? APP_FRAME_DIV_ZERO : APP_FRAME_OK);
+}
 
-            /* This means the host wants to set the line coding.
-             * This is a control transfer request. Use the
-             * USB_DEVICE_ControlReceive() function to receive the
-             * data from the host */
+uint8_t calcLoteEstado(const APP_FRAME_REQUEST *pet) {
+	if (pet->status!=APP_FRAME_OK)
+		return(pet->status);
+	if (pet->format!=APP_FRAME_INT32)
+		return(APP_FRAME_UNSUPPORTED);
+	return((pet->op==Div && pet->b.i==0) ? APP_FRAME_DIV_ZERO : APP_FRAME_OK);
+}
 
-            USB_DEVICE_ControlReceive(appDataObject->deviceHandle,
-                    &appDataObject->setLineCodingData, sizeof(USB_CDC_LINE_CODING));
+void calcLote(const APP_FRAME_REQUEST *pet, const uint8_t *operandos, uint8_t *resultados, size_t n) {
+	if (pet->status!=APP_FRAME_OK && pet->status!=APP_FRAME_DIV_ZERO) {
+		memset(resultados,0,n*APP_FRAME_Width(pet->format));
+		return;
+	}
+	APP_BULK_Int32(pet->op,pet->b.i,operandos,resultados,n);
+}
 
-            break;
+void calcFlujoInicia(CALC_FLUJO *flujo) {
+	flujo->n=0;
+	flujo->descartes=0;
+	flujo->suma=0;
+	flujo->min=INT32_MAX;	//Así la primera muestra es mínimo y máximo
+	flujo->max=INT32_MIN;
+}
 
-        case USB_DEVICE_CDC_EVENT_SET_CONTROL_LINE_STATE:
+void calcFlujoSuma(CALC_FLUJO *flujo, const APP_STREAM_NUMBER *num) {
+	int64_t x;
+	if (!APP_STREAM_Scaled(num,0,&x) || x<INT32_MIN || x>INT32_MAX) {
+		flujo->descartes++;
+		return;
+	}
+	flujo->suma+=x;
+	if (x<flujo->min)
+		flujo->min=(int32_t)x;
+	if (x>flujo->max)
+		flujo->max=(int32_t)x;
+	flujo->n++;
+}
 
-            /* This means the host is setting the control line state.
-             * Read the control line state. We will accept this request
-             * for now. */
+//Copia la etiqueta de un campo del reporte y regresa su largo
+size_t calcEtiqueta(char *aux, const char *etiqueta) {
+	size_t largo=strlen(etiqueta);
+	memcpy(aux,etiqueta,largo);
+	return(largo);
+}
 
-            controlLineStateData = (USB_CDC_CONTROL_LINE_STATE *)pData;
-            appDataObject->controlLineStateData.dtr = controlLineStateData->dtr;
-            appDataObject->controlLineStateData.carrier = controlLineStateData->carrier;
+size_t calcFlujoReporte(const CALC_FLUJO *flujo, char *aux) {
+	int64_t n=(int64_t)flujo->n, media;
+	size_t largo=calcEtiqueta(aux,"n=");
+	largo+=APP_FORMAT_Fixed(&aux[largo],n,0);
+	if (n>0) {
+		//Cociente y residuo por separado, la suma por 10^6 podría desbordar
+		media=flujo->suma/n*1000000+flujo->suma%n*1000000/n;
+		largo+=calcEtiqueta(&aux[largo]," sum=");
+		largo+=APP_FORMAT_Fixed(&aux[largo],flujo->suma,0);
+		largo+=calcEtiqueta(&aux[largo]," min=");
+		largo+=APP_FORMAT_Int(&aux[largo],flujo->min);
+		largo+=calcEtiqueta(&aux[largo]," max=");
+		largo+=APP_FORMAT_Int(&aux[largo],flujo->max);
+		largo+=calcEtiqueta(&aux[largo]," mean=");
+		largo+=APP_FORMAT_Fixed(&aux[largo],media,CALC_FLUJO_DECIMALES);
+	}
+	largo+=calcEtiqueta(&aux[largo]," skip=");
+	largo+=APP_FORMAT_Fixed(&aux[largo],(int64_t)flujo->descartes,0);
+	aux[largo++]=0x0D;
+	return(largo);
+}
 
-            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
+int calcTrans(char ch) {
+	return(tblTrans[(uint8_t)ch]);	//Una sola lectura por byte
+}
 
-            break;
+int sigEdo(int ed, int tran) {
+	return(mtzTrans[ed][tran].next);
+}
 
-        case USB_DEVICE_CDC_EVENT_SEND_BREAK:
+//Juego de acciones de esta variante, el que su blob de gramática nombra
+#define CALC_JUEGO 1
 
-            /* This means that the host is requesting that a break of the
-             * specified duration be sent. Read the break duration */
+//Las tablas de arriba como gramática, la que usa una sesión recién iniciada
+const APP_GRAMMAR calcGramatica={ tblTrans, &mtzTrans[0][0] };
 
-            appDataObject->breakData = ((USB_DEVICE_CDC_EVENT_DATA_SEND_BREAK *)pData)->breakDuration;
-            
-            /* Complete the control transfer by sending a ZLP  */
-            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
-            
-            break;
+//Lo que un blob debe cumplir para esta variante. Los dígitos, el resultado y
+//la cancelación fijan ellos el estado de continuidad, así que el siguiente
+//estado de sus casillas no se usa (la cancelación lleva 99)
+const APP_GRAMMAR_RULES calcReglas={ CALC_JUEGO, EDO_COUNT, TRANS_COUNT, ACC_COUNT,
+	  (1ul<<ACC_DIGITO_A)|(1ul<<ACC_DIGITO_B)|(1ul<<ACC_RESULTADO)|(1ul<<ACC_CANCELA) };
 
-        case USB_DEVICE_CDC_EVENT_READ_COMPLETE:
+#if CALC_GRAMATICA_LARGO!=APP_GRAMMAR_SIZE(EDO_COUNT,TRANS_COUNT)
+#error "CALC_GRAMATICA_LARGO no corresponde a EDO_COUNT y TRANS_COUNT"
+#endif
 
-            /* This means that the host has sent some data*/
-            eventDataRead = (USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE *)pData;
-            
-            if(eventDataRead->status != USB_DEVICE_CDC_RESULT_ERROR)
-            {
-                appDataObject->isReadComplete = true;
-                
-                appDataObject->numBytesRead = eventDataRead->length; 
-            }
-            break;
+APP_GRAMMAR_STATUS calcGramaticaCarga(APP_GRAMMAR *gramatica, const uint8_t *blob, size_t largo) {
+	return(APP_GRAMMAR_Load(gramatica,blob,largo,&calcReglas));	//Sin copiar: apunta al blob
+}
 
-        case USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_RECEIVED:
+size_t calcGramaticaBlob(uint8_t *blob, size_t tam) {
+	return(APP_GRAMMAR_Encode(blob,tam,&calcGramatica,&calcReglas));
+}
 
-            /* The data stage of the last control transfer is
-             * complete. For now we accept all the data */
+#if CALC_BIGNUM
+//Un dígito más del operando. Se juntan de 9 en 9 y cada lote completo entra
+//como un limb, en orden de lectura (el más significativo primero)
+void calcBigDigito(CALC_SESSION *ses, CALC_BIG *x) {
+	if (x->largo==0 && ses->lote==0 && ses->chr=='0')
+		return;		//Los ceros a la izquierda no ocupan lugar
+	ses->lote=ses->lote*10+(uint32_t)(ses->chr-'0');
+	if (++ses->loteDigitos==APP_BIGNUM_BASE_DIGITS) {
+		if (x->largo<CALC_BIG_LIMBS)
+			x->limb[x->largo++]=ses->lote;
+		else
+			ses->desborde=true;
+		ses->lote=0;
+		ses->loteDigitos=0;
+	}
+}
 
-            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
-            break;
+//Termina el operando: voltea los limbs al orden de app_bignum y mete el lote
+//incompleto de k dígitos con una sola pasada x*10^k+lote
+void calcBigCierra(CALC_SESSION *ses, CALC_BIG *x) {
+	uint32_t i, aux, escala=1;
+	int k;
+	for (i=0; i<x->largo/2; i++) {
+		aux=x->limb[i];
+		x->limb[i]=x->limb[x->largo-1-i];
+		x->limb[x->largo-1-i]=aux;
+	}
+	for (k=0; k<ses->loteDigitos; k++)
+		escala*=10;
+	x->largo=(uint32_t)APP_BIGNUM_MulSmall(x->limb,x->limb,x->largo,escala,ses->lote);
+	if (x->largo>CALC_BIG_LIMBS)
+		ses->desborde=true;
+	ses->lote=0;
+	ses->loteDigitos=0;
+}
+#endif
+
+bool calcFlush(CALC_SESSION *ses) {
+#if CALC_BIGNUM
+	char aux[APP_BIGNUM_BASE_DIGITS];
+	while (ses->pendiente) {
+		if (APP_TXRING_Free(ses->tx) < sizeof(aux) || (ses->spans!=NULL && APP_TXSPAN_Free(ses->spans)==0))
+			return(true);	//Se sigue cuando el writer haga lugar
+		if (ses->salida>=0) {
+			miResultado(ses,aux,(int)APP_FORMAT_Padded(aux,ses->res[ses->salida],APP_BIGNUM_BASE_DIGITS));
+			ses->salida--;
+		} else {
+			aux[0]=0x0D; //Carriage return
+			miResultado(ses,aux,1);
+			ses->pendiente=false;
+		}
+	}
+#endif
+	return(false);
+}
 
-        case USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_SENT:
+//Operador de '+', '-', '*' o '/'
+enum Oper calcOperador(char ch) {
+	switch (ch) {
+		case'-':
+			return(Resta);
+		case'*':
+			return(Mult);
+		case'/':
+			return(Div);
+		default:
+			return(Suma);
+	}
+}
 
-            /* This means the GET LINE CODING function data is valid. We don't
-             * do much with this data in this demo. */
-            break;
+#if !CALC_BIGNUM
+//"=resultado\r" en aux, que necesita APP_FORMAT_INT_MAX_LENGTH+2 bytes.
+//Regresa cuántos son
+size_t calcFormatea(char *aux, int res) {
+    size_t largo;
+    aux[0]='=';
+    largo=APP_FORMAT_Int(&aux[1],res);	//Una pasada, dos dígitos por división
+    aux[1+largo]=0x0D; //Carriage return
+    return(largo+2);
+}
+#endif
+
+#if CALC_REGISTROS
+//Un resultado queda en ans y, si antes se tecleó "x:=", también en x
+void calcGuarda(CALC_SESSION *ses, int res) {
+	ses->registros[CALC_ANS]=res;
+	if (ses->destino)
+		ses->registros[ses->destino-'a']=res;
+	ses->destino=0;
+}
+#endif
 
-        case USB_DEVICE_CDC_EVENT_WRITE_COMPLETE:
+//Acciones. Cada una se ejecuta al entrar a su estado y regresa el estado de continuidad
 
-            /* This means that the data write got completed. We can schedule
-             * the next read. */
+int accNinguna(CALC_SESSION *ses, int ed) {
+	return(ed);
+}
 
-            appDataObject->isWriteComplete = true;
-            break;
+int accEco(CALC_SESSION *ses, int ed) {
+	miPrintf(ses,ses->eco,1);
+	return(ed);
+}
 
-        default:
-            break;
+int accAbre(CALC_SESSION *ses, int ed) {
+    if (ses->leds) {
+        //BSP_LEDOff( APP_USB_LED_1);
+        //BSP_LEDOff( APP_USB_LED_2);
+        //BSP_LEDOff( APP_USB_LED_3);
+        LED_Off();
+        LED2_Off();
+        LED3_Off();
     }
 
-    return USB_DEVICE_CDC_EVENT_RESPONSE_NONE;
+#if CALC_BIGNUM
+    ses->acum1.largo=0;
+    ses->lote=0;
+    ses->loteDigitos=0;
+    ses->desborde=false;
+#else
+    ses->acum1=0;
+#endif
+#if CALC_REGISTROS
+	if (ses->edoAnt!=12)
+		ses->destino=0;		//Un "x:" sin su '=' no cuenta
+#endif
+	miPrintf(ses,ses->eco,1);
+	return(ed);
 }
 
-/***********************************************
- * Application USB Device Layer Event Handler.
- ***********************************************/
-void APP_USBDeviceEventHandler 
-(
-    USB_DEVICE_EVENT event, 
-    void * eventData, 
-    uintptr_t context 
-)
-{
-    USB_DEVICE_EVENT_DATA_CONFIGURED *configuredEventData;
-
-    switch(event)
-    {
-        case USB_DEVICE_EVENT_SOF:
-
-            /* This event is used for switch debounce. This flag is reset
-             * by the switch process routine. */
-            appData.sofEventHasOccurred = true;
-            
-            break;
-
-        case USB_DEVICE_EVENT_RESET:
-
-            /* Update LED to show reset state */
-            LED_Off();
-
-            appData.isConfigured = false;
-
-            break;
+int accDigitoA(CALC_SESSION *ses, int ed) {
+	miPrintf(ses,ses->eco,1);
+#if CALC_BIGNUM
+	calcBigDigito(ses,&ses->acum1);
+#else
+	ses->acum1*=10;
+	ses->acum1+=(ses->chr-'0');
+#endif
+	return(2);
+}
 
-        case USB_DEVICE_EVENT_CONFIGURED:
+int accOperador(CALC_SESSION *ses, int ed) {
+    if (ses->leds) {
+        LED_On();
 
-            /* Check the configuration. We only support configuration 1 */
-            configuredEventData = (USB_DEVICE_EVENT_DATA_CONFIGURED*)eventData;
-            
-            if ( configuredEventData->configurationValue == 1)
-            {
-                /* Update LED to show configured state */
-                LED_On();
-                
-                /* Register the CDC Device application event handler here.
-                 * Note how the appData object pointer is passed as the
-                 * user data */
-
-                USB_DEVICE_CDC_EventHandlerSet(USB_DEVICE_CDC_INDEX_0, APP_USBDeviceCDCEventHandler, (uintptr_t)&appData);
-
-                /* Mark that the device is now configured */
-                appData.isConfigured = true;
-            }
-            
-            break;
-
-        case USB_DEVICE_EVENT_POWER_DETECTED:
-
-            /* VBUS was detected. We can attach the device */
-            USB_DEVICE_Attach(appData.deviceHandle);
-            
-            break;
-
-        case USB_DEVICE_EVENT_POWER_REMOVED:
-            
-            /* VBUS is not available. We can detach the device */
-            USB_DEVICE_Detach(appData.deviceHandle);
-            
-            appData.isConfigured = false;
-            
-            LED_Off();
-            
-            break;
-
-        case USB_DEVICE_EVENT_SUSPENDED:
-
-            /* Switch LED to show suspended state */
-            LED_Off();
-            
-            break;
-
-        case USB_DEVICE_EVENT_RESUMED:
-        case USB_DEVICE_EVENT_ERROR:
-        default:
-            
-            break;
+        //BSP_LEDOn(  APP_USB_LED_1);
+        LED2_Off();
+        //BSP_LEDOff( APP_USB_LED_2);
+        LED3_Off();
+        //BSP_LEDOff( APP_USB_LED_3);
     }
+	miPrintf(ses,ses->eco,1);
+	ses->oper=calcOperador(ses->chr);
+#if CALC_BIGNUM
+	calcBigCierra(ses,&ses->acum1);
+	ses->acum2.largo=0;
+#else
+	ses->acum2=0;	//Preparar la entrada al estado 5
+#endif
+	return(ed);
 }
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Application Local Functions
-// *****************************************************************************
-// *****************************************************************************
-
-void APP_ProcessSwitchPress(void)
-{
-    /* This function checks if the switch is pressed and then
-     * debounces the switch press*/
-    
-    if(SWITCH_STATE_PRESSED == (SWITCH_Get()))
-    {
-        if(appData.ignoreSwitchPress)
-        {
-            /* This means the key press is in progress */
-            if(appData.sofEventHasOccurred)
-            {
-                /* A timer event has occurred. Update the debounce timer */
-                appData.switchDebounceTimer ++;
-                appData.sofEventHasOccurred = false;
-                
-                if (USB_DEVICE_ActiveSpeedGet(appData.deviceHandle) == USB_SPEED_FULL)
-                {
-                    appData.debounceCount = APP_USB_SWITCH_DEBOUNCE_COUNT_FS;
-                }
-                else if (USB_DEVICE_ActiveSpeedGet(appData.deviceHandle) == USB_SPEED_HIGH)
-                {
-                    appData.debounceCount = APP_USB_SWITCH_DEBOUNCE_COUNT_HS;
-                }
-                if(appData.switchDebounceTimer == appData.debounceCount)
-                {
-                    /* Indicate that we have valid switch press. The switch is
-                     * pressed flag will be cleared by the application tasks
-                     * routine. We should be ready for the next key press.*/
-                    appData.isSwitchPressed = true;
-                    appData.switchDebounceTimer = 0;
-                    appData.ignoreSwitchPress = false;
-                }
-            }
-        }
-        else
-        {
-            /* We have a fresh key press */
-            appData.ignoreSwitchPress = true;
-            appData.switchDebounceTimer = 0;
-        }
-    }
-    else
-    {
-        /* No key press. Reset all the indicators. */
-        appData.ignoreSwitchPress = false;
-        appData.switchDebounceTimer = 0;
-        appData.sofEventHasOccurred = false;
+int accDigitoB(CALC_SESSION *ses, int ed) {
+    if (ses->leds) {
+        LED_Off();
+        LED2_On();
+        LED3_Off();
+        //BSP_LEDOff( APP_USB_LED_1);
+        //BSP_LEDOn(  APP_USB_LED_2);
+        //BSP_LEDOff( APP_USB_LED_3);
     }
+	miPrintf(ses,ses->eco,1);
+#if CALC_BIGNUM
+	calcBigDigito(ses,&ses->acum2);
+#else
+	ses->acum2*=10;
+	ses->acum2+=(ses->chr-'0');
+#endif
+	return(5);
 }
 
-/*****************************************************
- * This function is called in every step of the
- * application state machine.
- *****************************************************/
-
-bool APP_StateReset(void)
-{
-    /* This function returns true if the device
-     * was reset  */
-
-    bool retVal;
-
-    if(appData.isConfigured == false)
-    {
-        appData.state = APP_STATE_WAIT_FOR_CONFIGURATION;
-        appData.readTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-        appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-        appData.isReadComplete = true;
-        appData.isWriteComplete = true;
-        retVal = true;
-    }
-    else
-    {
-        retVal = false;
+int accCierra(CALC_SESSION *ses, int ed) {
+    if (ses->leds) {
+        LED_Off();
+        LED2_Off();
+        LED3_On();
+        //BSP_LEDOff( APP_USB_LED_1);
+        //BSP_LEDOff( APP_USB_LED_2);
+        //BSP_LEDOn(  APP_USB_LED_3);
     }
-
-    return(retVal);
+	miPrintf(ses,ses->eco,1);
+	return(ed);
 }
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Application Initialization and State Machine Functions
-// *****************************************************************************
-// *****************************************************************************
-
-/*******************************************************************************
-  Function:
-    void APP_Initialize(void)
-
-  Remarks:
-    See prototype in app.h.
- */
-
-void APP_Initialize(void)
-{
-    /* Place the App state machine in its initial state. */
-    appData.state = APP_STATE_INIT;
-    
-    /* Device Layer Handle  */
-    appData.deviceHandle = USB_DEVICE_HANDLE_INVALID ;
-
-    /* Device configured status */
-    appData.isConfigured = false;
-
-    /* Initial get line coding state */
-    appData.getLineCodingData.dwDTERate = 9600;
-    appData.getLineCodingData.bParityType = 0;
-    appData.getLineCodingData.bParityType = 0;
-    appData.getLineCodingData.bDataBits = 8;
-
-    /* Read Transfer Handle */
-    appData.readTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-
-    /* Write Transfer Handle */
-    appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-
-    /* Initialize the read complete flag */
-    appData.isReadComplete = true;
-
-    /*Initialize the write complete flag*/
-    appData.isWriteComplete = true;
-
-    /* Initialize Ignore switch flag */
-    appData.ignoreSwitchPress = false;
-
-    /* Reset the switch debounce counter */
-    appData.switchDebounceTimer = 0;
-
-    /* Reset other flags */
-    appData.sofEventHasOccurred = false;
-    
-    /* To know status of Switch */
-    appData.isSwitchPressed = false;
-
-    /* Set up the read buffer */
-    appData.cdcReadBuffer = &cdcReadBuffer[0];
-
-    /* Set up the read buffer */
-    appData.cdcWriteBuffer = &cdcWriteBuffer[0];       
+int accResultado(CALC_SESSION *ses, int ed) {
+#if CALC_BIGNUM
+    CALC_BIG *a=&ses->acum1, *b=&ses->acum2;
+    bool negativo=false;
+#else
+    int res=0;
+#endif
+    size_t largo;
+    char auxString[APP_FORMAT_INT_MAX_LENGTH+2];	//'=', dígitos y CR
+#if CALC_CACHE
+    const uint8_t *copia;
+    uint64_t valor;
+#endif
+    if (ses->leds) {
+        LED_On();
+        LED2_On();
+        LED3_On();
+        //BSP_LEDOn( APP_USB_LED_1);
+        //BSP_LEDOn( APP_USB_LED_2);
+        //BSP_LEDOn( APP_USB_LED_3);
+    }
+#if CALC_BIGNUM
+	calcBigCierra(ses,b);
+    auxString[0]='=';
+	if (ses->desborde) {
+		memcpy(&auxString[1],"overflow",8);
+		auxString[9]=0x0D;
+		miResultado(ses,&auxString[0],10);
+		return(0);
+	}
+	switch(ses->oper) {
+		case Suma:
+				ses->resLargo=APP_BIGNUM_Add(ses->res,a->limb,a->largo,b->limb,b->largo);
+				break;
+		case Resta:
+				if (APP_BIGNUM_Compare(a->limb,a->largo,b->limb,b->largo)>=0) {
+					ses->resLargo=APP_BIGNUM_Sub(ses->res,a->limb,a->largo,b->limb,b->largo);
+				} else {
+					ses->resLargo=APP_BIGNUM_Sub(ses->res,b->limb,b->largo,a->limb,a->largo);
+					negativo=true;
+				}
+				break;
+		case Mult:
+				ses->resLargo=APP_BIGNUM_Mul(ses->res,a->limb,a->largo,b->limb,b->largo);
+				break;
+		case Div:
+				if (b->largo) {
+					ses->resLargo=APP_BIGNUM_Div(ses->res,a->limb,a->largo,b->limb,b->largo);
+				} else {
+					ses->res[0]=1;	//-1 como en la versión int
+					ses->resLargo=1;
+					negativo=true;
+				}
+				break;
+	}
+	//El limb más alto va sin ceros a la izquierda, el resto lo imprime calcFlush
+	largo=1;
+	if (negativo)
+		auxString[largo++]='-';
+	largo+=APP_FORMAT_Int(&auxString[largo],(int32_t)(ses->resLargo ? ses->res[ses->resLargo-1] : 0));
+	miResultado(ses,&auxString[0],largo);
+	ses->salida=(int)ses->resLargo-2;
+	ses->pendiente=true;
+	calcFlush(ses);
+#else
+#if CALC_CACHE
+	if (ses->cache!=NULL) {
+		copia=APP_RCACHE_Lookup(ses->cache,ses->oper,(uint32_t)ses->acum1,(uint32_t)ses->acum2,&largo,&valor);
+		if (copia!=NULL) {
+			miResultado(ses,(const char *)copia,(int)largo);	//Ni aritmética ni formato
+#if CALC_REGISTROS
+			calcGuarda(ses,(int)(uint32_t)valor);
+#endif
+			return(0);
+		}
+	}
+#endif
+	res=calcOpera(ses->oper,ses->acum1,ses->acum2);
+	//printf("%d\n",res);
+    largo=calcFormatea(auxString,res);
+    miResultado(ses,&auxString[0],largo);
+#if CALC_CACHE
+	if (ses->cache!=NULL)
+		APP_RCACHE_Insert(ses->cache,ses->oper,(uint32_t)ses->acum1,(uint32_t)ses->acum2,(uint32_t)res,auxString,largo);
+#endif
+#if CALC_REGISTROS
+	calcGuarda(ses,res);
+#endif
+#endif
+	return(0);
 }
 
+int accCancela(CALC_SESSION *ses, int ed) {
+	//printf("\n<<<Captura cancelada>>>\n");
+#if CALC_REGISTROS
+	ses->destino=0;		//También se olvida un "x:=" pendiente
+#endif
+	return(0);	//Estado aceptor, rompe la rutina y marca estado de salida
+}
 
-/******************************************************************************
-  Function:
-    void APP_Tasks(void)
-
-  Remarks:
-    See prototype in app.h.
- */
-
-
-#define TRANS_COUNT 8
-#define EDO_COUNT 9
-
-char chr=0;
-int acum1=0;
-int acum2=0;
-int res=0;
-enum Oper{Suma,Resta,Mult,Div};
-enum Oper oper;
-int edo=0;
-int edoAnt=0;
-int trans=0;
-int startIndex = 0, endIndex = 0; 
-char numeroLeido[10];
-char numeroAEscribir[11];
-int miStringCont = 0;
-int miPrintf_flag = 0;
-
-bool estoyListo = false;
-int cuantosDigitosVan = 0;
-char auxString[] = "                                 ";
-
-
-int chrTrans[TRANS_COUNT]=
-					{ 0,'(',')','=',  8, 27, 6 , 7};
-int mtzTrans[EDO_COUNT][TRANS_COUNT]={
-					{ 0, 1 , 0 , 0 , 0 , 0 , 0 , 0},
-					{ 1, 1 , 1 , 1 , 99, 99, 2 , 1},
-					{ 2, 2 , 2 , 2 , 99, 99, 3 , 4},
-					{ 3, 2 , 2 , 2 , 99, 99, 2 , 2},
-					{ 4, 4 , 4 , 4 , 99, 99, 5 , 4},
-					{ 5, 5 , 7 , 5 , 99, 99, 6 , 5},
-					{ 6, 5 , 5 , 5 , 99, 99, 5 , 5},
-					{ 7, 7 , 7 , 8 , 99, 99, 7 , 7},
-					{ 8, 0 , 0 , 0 , 0 , 0 , 0 , 0}};
-
-void miPrintf(char* s, int cont) {
-    int i;
-    for (i=0;i<cont;i++)
-        miString[i]=s[i];
-    miPrintf_flag=1;
-    miStringCont=cont;
+#if CALC_REGISTROS
+//"x:" antes del '(' elige el registro que además de ans recibe el resultado
+int accDestino(CALC_SESSION *ses, int ed) {
+	if ((unsigned)(ses->chr-'a')>=26)
+		return(ses->edoAnt);	//Una gramática cargada puede poner otros bytes con las letras
+	ses->destino=ses->chr;
+	miPrintf(ses,ses->eco,1);
+	return(ed);
 }
-                
 
-int calcTrans(char ch) {
-	int tran=0;
-	if ((ch>='0')&&(ch<='9'))	//Digito
-		return(6);
-	switch (ch) {
-		case'+':
-		case'-':
-		case'*':
-		case'/':
-				return(7);
+//Un registro en lugar de los dígitos de un operando. La 'a' ya es un
+//registro completo; tras "an" (ed+1) sólo la 's' de ans se acepta
+int accRegistro(CALC_SESSION *ses, int ed) {
+	int *acum=(ed==EDO_REGISTRO_A) ? &ses->acum1 : &ses->acum2;
+	if (ses->edoAnt==ed+1) {
+		if (ses->chr!='s')
+			return(ses->edoAnt);	//Se ignora sin eco
+		*acum=ses->registros[CALC_ANS];
+	} else {
+		if ((unsigned)(ses->chr-'a')>=26)
+			return(ses->edoAnt);	//No es letra, ver accDestino
+		*acum=ses->registros[ses->chr-'a'];
 	}
-	for (tran=5;tran>0;tran--)
-		if (ch==chrTrans[tran])
-			break;
-	return(tran);
+	if (ed==EDO_REGISTRO_B && ses->leds) {
+		LED_Off();
+		LED2_On();
+		LED3_Off();
+	}
+	ses->nombre=ses->chr;
+	miPrintf(ses,ses->eco,1);
+	return(ed);
 }
 
-int sigEdo(int ed, int tran) {
-	return(mtzTrans[ed][tran]);
+//Segunda letra de un nombre, sólo puede ser la 'n' de "ans"
+int accParcial(CALC_SESSION *ses, int ed) {
+	if (ses->nombre!='a' || ses->chr!='n')
+		return(ses->edoAnt);
+	miPrintf(ses,ses->eco,1);
+	return(ed);
 }
-
-int ejecutaEdo(int ed) {
-    static int i=0;
-    static int negativoFlag=0;
-    static int digitosCont=0;
-    static int auxRes=0;
-	switch(ed) {
-		case 0:
+#else
+#define accDestino accNinguna
+#define accRegistro accNinguna
+#define accParcial accNinguna
+#endif
+
+#if CALC_EXPRESIONES
+//Parte del operando que se está tecleando en el modo expresión: sus dígitos
+//o el nombre de un registro, incompleto tras "an"
+enum Literal{LIT_NINGUNO,LIT_ENTERO,LIT_NOMBRE,LIT_PARCIAL};
+
+//Máquina de pila del bytecode de app_expr, con la aritmética de calcOpera
+int calcEvalua(CALC_SESSION *ses) {
+	int pila[APP_EXPR_STACK_MAX];
+	const uint8_t *codigo=ses->expr.code;
+	int cima=-1;
+	unsigned k;
+	for (k=0; k<ses->expr.length; k++) {
+		switch (codigo[k]) {
+			case APP_EXPR_PUSH:
+				pila[++cima]=ses->operandos[codigo[++k]];
 				break;
-		case 1:
-                //BSP_LEDOff( APP_USB_LED_1);
-                //BSP_LEDOff( APP_USB_LED_2);
-                //BSP_LEDOff( APP_USB_LED_3);
-                LED_Off();
-                LED2_Off();
-                LED3_Off();
-
-                acum1=0;
-				miPrintf(&chr,1);
+			case APP_EXPR_NEG:
+				pila[cima]=-pila[cima];
 				break;
-		case 2:
-				miPrintf(&chr,1);
-				acum1*=10;
-				acum1+=(chr-'0');
+			default:
+				cima--;
+				pila[cima]=calcOpera((enum Oper)codigo[k],pila[cima],pila[cima+1]);
 				break;
-		case 3:
-				miPrintf(&chr,1);
-				acum1*=10;
-				acum1+=(chr-'0');
-				return(2);
-		case 4:
-                LED_On();
-
-                //BSP_LEDOn(  APP_USB_LED_1);
-                LED2_Off();
-                //BSP_LEDOff( APP_USB_LED_2);
-                LED3_Off();
-                //BSP_LEDOff( APP_USB_LED_3);
-				miPrintf(&chr,1);
-				switch (chr) {
-					case'+':
-							oper=Suma;
-							break;
-					case'-':
-							oper=Resta;
-							break;
-					case'*':
-							oper=Mult;
-							break;
-					case'/':
-							oper=Div;
-							break;
-				}
-				acum2=0;	//Preparar la entrada al estado 4
+		}
+	}
+	return(pila[0]);
+}
+
+//Al pasar al modo expresión, lo que el FSM ya leyó ("(", "(a op" o
+//"(a op b", donde b puede ser un registro) se entrega al compilador como si
+//se tecleara de nuevo
+void calcEscala(CALC_SESSION *ses) {
+	APP_EXPR *expr=&ses->expr;
+	uint8_t k;
+	APP_EXPR_Initialize(expr);
+	APP_EXPR_Open(expr);
+	ses->literal=LIT_NINGUNO;
+	if (ses->edoAnt==1)
+		return;
+	APP_EXPR_Operand(expr,&k);
+	ses->operandos[k]=ses->acum1;
+	APP_EXPR_Operator(expr,ses->oper);
+	if (ses->edoAnt==5 || ses->edoAnt==EDO_REGISTRO_B) {
+		APP_EXPR_Operand(expr,&k);
+		ses->operandos[k]=ses->acum2;
+	}
+}
+
+//Modo expresión: el FSM sólo clasifica el byte y aquí se compila. Un byte
+//que no cabe donde llega se ignora sin eco, como en los demás estados.
+//Retroceso y ESC cancelan desde la tabla
+int accExpresion(CALC_SESSION *ses, int ed) {
+	bool acepta=false;
+	int res;
+	char auxString[APP_FORMAT_INT_MAX_LENGTH+2];
+	if (ses->edoAnt!=EDO_EXPRESION)
+		calcEscala(ses);
+	switch (ses->clases[(uint8_t)ses->chr]) {
+		case 1:	//(
+			acepta=APP_EXPR_Open(&ses->expr);
+			break;
+		case 2:	//)
+			if (ses->literal!=LIT_PARCIAL && APP_EXPR_Close(&ses->expr)) {
+				ses->literal=LIT_NINGUNO;
+				acepta=true;
+			}
+			break;
+		case 3:	//=, sólo con la expresión completa; no lleva eco, el resultado empieza con '='
+			if (!APP_EXPR_End(&ses->expr))
 				break;
-		case 5:
-                LED_Off();
-                LED2_On();
-                LED3_Off();
-                //BSP_LEDOff( APP_USB_LED_1);
-                //BSP_LEDOn(  APP_USB_LED_2);
-                //BSP_LEDOff( APP_USB_LED_3);
-				miPrintf(&chr,1);
-				acum2*=10;
-				acum2=(chr-'0');
+			if (ses->leds) {
+				LED_On();
+				LED2_On();
+				LED3_On();
+			}
+			res=calcEvalua(ses);
+			miResultado(ses,auxString,(int)calcFormatea(auxString,res));
+#if CALC_REGISTROS
+			calcGuarda(ses,res);
+#endif
+			return(0);
+		case 6:	//Dígito
+			if (ses->literal>=LIT_NOMBRE)
 				break;
-		case 6:
-				miPrintf(&chr,1);
-				acum2*=10;
-				acum2+=(chr-'0');
-				return(5);
-		case 7:
-                LED_Off();
-                LED2_Off();
-                LED3_On();
-                //BSP_LEDOff( APP_USB_LED_1);
-                //BSP_LEDOff( APP_USB_LED_2);
-                //BSP_LEDOn(  APP_USB_LED_3);
-				miPrintf(&chr,1);
+			if (ses->literal==LIT_NINGUNO) {
+				if (!APP_EXPR_Operand(&ses->expr,&ses->ranura))
+					break;
+				ses->operandos[ses->ranura]=0;
+				ses->literal=LIT_ENTERO;
+			}
+			ses->operandos[ses->ranura]*=10;
+			ses->operandos[ses->ranura]+=(ses->chr-'0');
+			acepta=true;
+			break;
+		case 7:	//Operador; sin signo, como en el FSM
+			if (ses->literal!=LIT_PARCIAL && !ses->expr.operandDue && ses->expr.open>0 &&	//Tras el ')' exterior sólo queda el '='
+					APP_EXPR_Operator(&ses->expr,calcOperador(ses->chr))) {
+				ses->literal=LIT_NINGUNO;
+				acepta=true;
+			}
+			break;
+#if CALC_REGISTROS
+		case 8:	//Letra: un registro como operando; "ans" se completa letra por letra
+			if (ses->literal==LIT_NINGUNO) {
+				if ((unsigned)(ses->chr-'a')>=26 || !APP_EXPR_Operand(&ses->expr,&ses->ranura))
+					break;	//No es letra, ver accDestino
+				ses->operandos[ses->ranura]=ses->registros[ses->chr-'a'];
+				ses->literal=LIT_NOMBRE;
+			} else if (ses->literal==LIT_NOMBRE && ses->nombre=='a' && ses->chr=='n') {
+				ses->literal=LIT_PARCIAL;
+			} else if (ses->literal==LIT_PARCIAL && ses->chr=='s') {
+				ses->operandos[ses->ranura]=ses->registros[CALC_ANS];
+				ses->literal=LIT_NOMBRE;
+			} else {
 				break;
-		case 8:
-                LED_On();
-                LED2_On();
-                LED3_On();
-                //BSP_LEDOn( APP_USB_LED_1);
-                //BSP_LEDOn( APP_USB_LED_2);
-                //BSP_LEDOn( APP_USB_LED_3);
-				switch(oper) {
-					case Suma:
-							res=acum1+acum2;
-							break;
-					case Resta:
-							res=acum1-acum2;
-							break;
-					case Mult:
-							res=acum1*acum2;
-							break;
-					case Div:
-							if (acum2)
-								res=acum1/acum2;
-							else
-								res=-1;
-							break;
-				}
-				//printf("%d\n",res);
-                if (res<0) {
-                    negativoFlag=1;
-                    res=-1*res;
-                } else {
-                    negativoFlag=0;
-                }
-                auxRes=res;
-                digitosCont=0;
-                do {
-                    auxRes/=10;
-                    digitosCont++;
-                } while(auxRes);
-                i=digitosCont;
-                do {
-                    auxString[negativoFlag+i]='0'+(res%10);
-                    res/=10;
-                } while(--i>=0);
-                auxString[0]='=';
-                if (negativoFlag) {
-                    auxString[1]='-';
-                }
-                auxString[digitosCont+1+negativoFlag]=0x0D; //Carriage return
-                miPrintf(&auxString[0],digitosCont+1+negativoFlag+1);
-				return(0);
-		case 99:
-				//printf("\n<<<Captura cancelada>>>\n");
-				return(0);	//Estado aceptor, rompe la rutina y marca estado de salida
+			}
+			ses->nombre=ses->chr;
+			acepta=true;
+			break;
+#endif
 	}
-	return(edo);	//Para estados no aceptores regresar el estado ejecutado
-}
-
-
-void APP_Tasks(void)
-{
-    /* Update the application state machine based
-     * on the current state */
-    int i;
-    
-    switch(appData.state)
-    {
-        case APP_STATE_INIT:
-
-            /* Open the device layer */
-            appData.deviceHandle = USB_DEVICE_Open( USB_DEVICE_INDEX_0, DRV_IO_INTENT_READWRITE );
-
-            if(appData.deviceHandle != USB_DEVICE_HANDLE_INVALID)
-            {
-                /* Register a callback with device layer to get event notification (for end point 0) */
-                USB_DEVICE_EventHandlerSet(appData.deviceHandle, APP_USBDeviceEventHandler, 0);
-
-                appData.state = APP_STATE_WAIT_FOR_CONFIGURATION;
-            }
-            else
-            {
-                /* The Device Layer is not ready to be opened. We should try
-                 * again later. */
-            }
-
-            break;
-
-        case APP_STATE_WAIT_FOR_CONFIGURATION:
-
-            /* Check if the device was configured */
-            if(appData.isConfigured)
-            {
-                /* If the device is configured then lets start reading */
-                appData.state = APP_STATE_SCHEDULE_READ;
-            }
-            
-            break;
-
-        case APP_STATE_SCHEDULE_READ:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            /* If a read is complete, then schedule a read
-             * else wait for the current read to complete */
-
-            appData.state = APP_STATE_WAIT_FOR_READ_COMPLETE;
-            if(appData.isReadComplete == true)
-            {
-                appData.isReadComplete = false;
-                appData.readTransferHandle =  USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-
-                USB_DEVICE_CDC_Read (USB_DEVICE_CDC_INDEX_0,
-                        &appData.readTransferHandle, appData.cdcReadBuffer,
-                        APP_READ_BUFFER_SIZE);
-                
-                if(appData.readTransferHandle == USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID)
-                {
-                    appData.state = APP_STATE_ERROR;
-                    break;
-                }
-            }
-
-            break;
-
-        case APP_STATE_WAIT_FOR_READ_COMPLETE:
-        case APP_STATE_CHECK_SWITCH_PRESSED:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            APP_ProcessSwitchPress();
-
-            /* Check if a character was received or a switch was pressed.
-             * The isReadComplete flag gets updated in the CDC event handler. */
-
-            if(appData.isReadComplete || appData.isSwitchPressed)
-            {
-                appData.state = APP_STATE_SCHEDULE_WRITE;
-            }
-
-            break;
-
-
-        case APP_STATE_SCHEDULE_WRITE:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            /* Setup the write */
-
-            appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-            appData.isWriteComplete = false;
-            appData.state = APP_STATE_WAIT_FOR_WRITE_COMPLETE;
-
-            if(appData.isSwitchPressed)
-            {
-                /* If the switch was pressed, then send the switch prompt*/
-                appData.isSwitchPressed = false;
-                USB_DEVICE_CDC_Write(USB_DEVICE_CDC_INDEX_0,
-                        &appData.writeTransferHandle, switchPromptUSB, sizeof(switchPromptUSB),
-                        USB_DEVICE_CDC_TRANSFER_FLAGS_DATA_COMPLETE);
-            }
-            else
-            {
-                /* Else echo each received character by adding 1 */
-                for(i = 0; i < appData.numBytesRead; i++)
-                {   
-                   
-                    
-                    if((appData.cdcReadBuffer[i] != 0x0A) && (appData.cdcReadBuffer[i] != 0x0D) /*&& (appData.cdcReadBuffer[i] >= '0' && appData.cdcReadBuffer[i] <= '9')*/ )
-                    {
-                        
-                        //appData.readBuffer[i] = appData.readBuffer[i] + 1;
-                        chr=appData.cdcReadBuffer[i];
-                        trans=calcTrans(chr);	//Calcular la transición según la entrada del teclado
-                        if (trans) {			//Validar por transición valida (la transición 0 es inválida)
-                            edoAnt=edo;					//Guardar el estado anterior
-                            edo=sigEdo(edoAnt,trans);	//Calcular el siguiente estado
-                            if (edoAnt!=edo)			//Solo si hay cambio de estado hay que ...
-                                edo=ejecutaEdo(edo);	// ... ejecutar el nuevo estado y asignar estado de continuidad
-                        }
-                        
-              
-                  
-                    } 
-                    
-                }
-                if (miPrintf_flag) {
-                    USB_DEVICE_CDC_Write(USB_DEVICE_CDC_INDEX_0, &appData.writeTransferHandle,
-                                            miString, miStringCont, USB_DEVICE_CDC_TRANSFER_FLAGS_DATA_COMPLETE);
-                    miPrintf_flag=0;
-                    miStringCont=0;
-                }
-              
-            }
-
-            break;
-
-        case APP_STATE_WAIT_FOR_WRITE_COMPLETE:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            /* Check if a character was sent. The isWriteComplete
-             * flag gets updated in the CDC event handler */
-
-            if(appData.isWriteComplete == true)
-            {
-                appData.state = APP_STATE_SCHEDULE_READ;
-            }
-
-            break;
-
-        case APP_STATE_ERROR:
-        default:
-            
-            break;
-    }
+	if (acepta)
+		miPrintf(ses,ses->eco,1);
+	return(ed);
+}
+#else
+#define accExpresion accNinguna
+#endif
+
+int (* const accion[ACC_COUNT])(CALC_SESSION *, int)={
+	accNinguna, accAbre, accDigitoA, accOperador,
+	accDigitoB, accCierra, accResultado, accCancela, accExpresion,
+	accEco, accDestino, accRegistro, accParcial };
+
+void calcSessionInit(CALC_SESSION *ses, APP_TXRING *tx, bool leds) {
+	memset(ses,0,sizeof(*ses));		//Estado 0, esperando '('
+	ses->tx=tx;
+	ses->leds=leds;
+	ses->clases=calcGramatica.classes;
+	ses->pasos=calcGramatica.steps;
+}
+
+void calcSessionSpans(CALC_SESSION *ses, APP_TXSPAN *spans) {
+	ses->spans=spans;
+}
+
+void calcSessionCache(CALC_SESSION *ses, APP_RCACHE *cache) {
+#if CALC_CACHE
+	ses->cache=cache;
+#else
+	(void)ses;
+	(void)cache;
+#endif
 }
 
-/*******************************************************************************
- End of File
- */
+void calcSessionGramatica(CALC_SESSION *ses, const APP_GRAMMAR *gramatica) {
+	if (gramatica==NULL)
+		gramatica=&calcGramatica;
+	ses->clases=gramatica->classes;
+	ses->pasos=gramatica->steps;
+	ses->edo=0;		//Esperando '(' como tras calcSessionInit
+}
+
+void calcStep(CALC_SESSION *ses, char ch) {
+	ses->chr=ch;
+	calcStepRef(ses,&ses->chr);	//El eco sale de la copia en la sesión
+}
+
+void calcStepRef(CALC_SESSION *ses, const char *p) {
+	const PASO *paso;
+	int trans;
+	ses->chr=*p;
+	ses->eco=p;
+	trans=ses->clases[(uint8_t)ses->chr];	//Calcular la transición según la entrada del teclado (0 si es inválida)
+	paso=&ses->pasos[ses->edo*TRANS_COUNT+trans];	//Siguiente estado y acción en una sola lectura
+	ses->edoAnt=ses->edo;			//Guardar el estado anterior
+	ses->edo=accion[paso->action](ses,paso->next);	//Ejecutar la acción del nuevo estado y asignar estado de continuidad
+}
 
+//Desde cuántos dígitos conviene convertir la corrida en bloque
+#define CALC_CORRIDA_MIN 4
+
+//Atajo para números largos: en los estados 2 y 5 (ya dentro de un operando,
+//también de un literal del modo expresión) cada dígito sólo hace acum*10+dígito,
+//así que la corrida completa se busca y convierte de una vez y la máquina de
+//estados sigue en el primer no dígito
+size_t calcDigitos(CALC_SESSION *ses, const char *data, size_t length) {
+	size_t largo, k;
+#if !CALC_BIGNUM
+	int *acum;
+#endif
+	if (ses->pasos!=calcGramatica.steps)
+		return(0);	//Con una gramática cargada el atajo no vale, cada byte va al FSM
+#if CALC_EXPRESIONES
+	if (ses->edo==EDO_EXPRESION && ses->literal!=LIT_ENTERO)
+		return(0);
+	if (ses->edo!=2 && ses->edo!=5 && ses->edo!=EDO_EXPRESION)
+#else
+	if (ses->edo!=2 && ses->edo!=5)
+#endif
+		return(0);
+	largo=APP_DIGITS_Span(data,length);
+#if !APP_BATCH_MODE
+	if (ses->spans==NULL && largo>APP_TXRING_Free(ses->tx))
+		largo=APP_TXRING_Free(ses->tx);	//El eco tiene que caber completo
+#endif
+	if (largo==0)
+		return(0);
+	if (ses->edo==5 && ses->leds) {
+		LED_Off();
+		LED2_On();
+		LED3_Off();
+	}
+	miPrintf(ses,data,(int)largo);
+#if CALC_BIGNUM
+	for (k=0; k<largo; k++) {
+		ses->chr=data[k];
+		calcBigDigito(ses,(ses->edo==2) ? &ses->acum1 : &ses->acum2);
+	}
+#else
+	acum=(ses->edo==2) ? &ses->acum1 : &ses->acum2;
+#if CALC_EXPRESIONES
+	if (ses->edo==EDO_EXPRESION)
+		acum=&ses->operandos[ses->ranura];	//El literal del modo expresión
+#endif
+	if (largo<CALC_CORRIDA_MIN) {
+		for (k=0; k<largo; k++) {
+			*acum*=10;
+			*acum+=(data[k]-'0');
+		}
+	} else {
+		//Mismo desborde que dígito por dígito: se trunca a 32 bits al final
+		*acum=(int)(uint32_t)APP_DIGITS_Accumulate((uint32_t)*acum,data,largo);
+	}
+#endif
+	ses->chr=data[largo-1];
+	ses->edoAnt=ses->edo;
+	return(largo);
+}
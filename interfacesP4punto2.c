@@ -1,826 +1,1068 @@
 #include "app.h"
-#include <cmath>
-
-
-// *****************************************************************************
-// *****************************************************************************
-// Section: Global Data Definitions
-// *****************************************************************************
-// *****************************************************************************
-
-uint8_t CACHE_ALIGN switchPromptUSB[] = "\r\nPUSH BUTTON PRESSED";
-
-uint8_t CACHE_ALIGN cdcReadBuffer[APP_READ_BUFFER_SIZE];
-uint8_t CACHE_ALIGN cdcWriteBuffer[APP_READ_BUFFER_SIZE];
+#include "interfacesP4punto2.h"
+#include "app_format.h"
+#include "app_digits.h"
+#include "app_frame.h"
+#include "app_expr.h"
+#include "app_bulk.h"
+#include "app_stream.h"
+#include <string.h>
+#include <float.h>
+
+//app_port.c usa el CALC_SESSION de la variante que dice PUNTO, ver app_port.h
+#if !defined(PUNTO) || PUNTO != 2
+#error "interfacesP4punto2.c va con PUNTO=2"
+#endif
+
+//Modo batch: no se hace eco de las teclas, sólo se encola el "=resultado" de
+//cada expresión. Para hosts que mandan muchas expresiones por paquete
+#ifndef APP_BATCH_MODE
+#define APP_BATCH_MODE 0
+#endif
+
+#define TRANS_COUNT 10
+#define EDO_COUNT 26
+
+//Estado del modo expresión: ahí el FSM sólo clasifica y accExpresion compila
+#define EDO_EXPRESION 18
+
+//Estados de los registros: la letra de "x:=", un registro como primer o
+//segundo operando y, tras "an", la espera de la 's' de ans
+#define EDO_DESTINO 19
+#define EDO_REGISTRO_A 22
+#define EDO_REGISTRO_B 24
+
+#if CALC_PUNTO_FIJO
+#if CALC_DECIMALES > 9
+#error "CALC_PUNTO_FIJO admite a lo más 9 decimales"
+#endif
+//Valor de un resultado que se imprimió inf, no cabe en CALC_LIMITE
+#define CALC_DESBORDE	INT64_MIN
+//Uno en unidades de 10^-CALC_DECIMALES
+#define CALC_UNO		((CALC_PESO)((CALC_DECIMALES>0?10:1)*(CALC_DECIMALES>1?10:1)*(CALC_DECIMALES>2?10:1)* \
+						             (CALC_DECIMALES>3?10:1)*(CALC_DECIMALES>4?10:1)*(CALC_DECIMALES>5?10:1)* \
+						             (CALC_DECIMALES>6?10:1)*(CALC_DECIMALES>7?10:1)*(CALC_DECIMALES>8?10:1)))
+//Operandos y resultados se mantienen bajo 10^17, así el residuo*10 de la
+//división nunca desborda 64 bits
+#define CALC_LIMITE		((uint64_t)100000000000000000ull)
+#else
+#define CALC_UNO		1
+#endif
 
+int startIndex = 0, endIndex = 0; 
 
-// *****************************************************************************
-/* Application Data
 
-  Summary:
-    Holds application data
+//Caracteres con transición propia. chrTrans y tblTrans salen de esta lista,
+//así la tabla de calcTrans no se puede desincronizar de chrTrans
+#define CHR_TRANS(X)	X(1,'(') X(2,')') X(3,'=') X(4,'.')
+#define DIGITOS(X)		X(5,'0') X(5,'1') X(5,'2') X(5,'3') X(5,'4') \
+						X(5,'5') X(5,'6') X(5,'7') X(5,'8') X(5,'9')
+#define OPERADORES(X)	X(6,'+') X(6,'*') X(6,'/')
+#define MENOS(X)		X(7,'-')
+#define LETRAS(X)		X(8,'a') X(8,'b') X(8,'c') X(8,'d') X(8,'e') X(8,'f') X(8,'g') \
+						X(8,'h') X(8,'i') X(8,'j') X(8,'k') X(8,'l') X(8,'m') X(8,'n') \
+						X(8,'o') X(8,'p') X(8,'q') X(8,'r') X(8,'s') X(8,'t') X(8,'u') \
+						X(8,'v') X(8,'w') X(8,'x') X(8,'y') X(8,'z')
+//Sin CALC_REGISTROS las letras y ':' son inválidas y sus columnas no se usan
+#if CALC_REGISTROS
+#define REGISTROS(X)	LETRAS(X) X(9,':')
+#else
+#define REGISTROS(X)
+#endif
+#define CHR_ENTRADA(tr,ch)	ch,
+#define TBL_ENTRADA(tr,ch)	[(ch)]=(tr),
 
-  Description:
-    This structure holds the application's data.
+int chrTrans[TRANS_COUNT]=
+					{ 0, CHR_TRANS(CHR_ENTRADA) 5 , 16, MENOS(CHR_ENTRADA) 'a', ':' };
+//Transición de cada uno de los 256 valores de byte, 0 = inválida
+const uint8_t tblTrans[256]=
+					{ CHR_TRANS(TBL_ENTRADA) DIGITOS(TBL_ENTRADA) OPERADORES(TBL_ENTRADA) MENOS(TBL_ENTRADA)
+					  REGISTROS(TBL_ENTRADA) };
+
+//Acción que ejecuta cada estado al entrar a él
+enum Accion{ACC_NINGUNA,ACC_ECO,ACC_ABRE,ACC_NEGATIVO_A,ACC_DIGITO_A,ACC_DECIMAL_A,ACC_OPERADOR,
+			ACC_NEGATIVO_B,ACC_DIGITO_B,ACC_DECIMAL_B,ACC_CIERRA,ACC_RESULTADO,ACC_EXPRESION,
+			ACC_DESTINO,ACC_REGISTRO,ACC_PARCIAL,ACC_COUNT};
+#define ACCION(ed)	((ed)==1 ? ACC_ABRE : \
+					 (ed)==2 ? ACC_NEGATIVO_A : \
+					 ((ed)==3 || (ed)==4) ? ACC_DIGITO_A : \
+					 ((ed)==5 || (ed)==20 || (ed)==21) ? ACC_ECO : \
+					 ((ed)==7 || (ed)==16) ? ACC_DECIMAL_A : \
+					 (ed)==8 ? ACC_OPERADOR : \
+					 (ed)==9 ? ACC_NEGATIVO_B : \
+					 ((ed)==10 || (ed)==11) ? ACC_DIGITO_B : \
+					 ((ed)==13 || (ed)==15) ? ACC_DECIMAL_B : \
+					 ((ed)==12 || (ed)==14) ? ACC_CIERRA : \
+					 (ed)==99 ? ACC_RESULTADO : \
+					 (ed)==EDO_EXPRESION ? ACC_EXPRESION : \
+					 (ed)==EDO_DESTINO ? ACC_DESTINO : \
+					 ((ed)==EDO_REGISTRO_A || (ed)==EDO_REGISTRO_B) ? ACC_REGISTRO : \
+					 ((ed)==23 || (ed)==25) ? ACC_PARCIAL : ACC_NINGUNA)
+
+//Cada casilla guarda el siguiente estado y la acción a ejecutar; si el estado
+//no cambia la acción es ACC_NINGUNA. La primera columna (transición inválida)
+//de cada fila es el propio estado, así que no hace falta validarla aparte.
+//Es el paso de app_grammar.h, así la tabla tiene la forma de un blob
+typedef APP_GRAMMAR_STEP PASO;
+#define P(ed,sig)	{ (sig), ((sig)!=(ed)) ? ACCION(sig) : ACC_NINGUNA }
+#define FILA(t0,t1,t2,t3,t4,t5,t6,t7,t8,t9) \
+					{ P(t0,t0),P(t0,t1),P(t0,t2),P(t0,t3),P(t0,t4),P(t0,t5),P(t0,t6),P(t0,t7), \
+					  P(t0,t8),P(t0,t9) }
+//Casilla que sin CALC_EXPRESIONES ignora el byte y con él pasa al modo expresión
+#define EXPR(ed)	(CALC_EXPRESIONES ? EDO_EXPRESION : (ed))
+//En el modo expresión todo byte válido va a accExpresion, aunque no cambie de estado
+#define PASO_EXPR	{ EDO_EXPRESION, ACC_EXPRESION }
+
+const PASO mtzTrans[EDO_COUNT][TRANS_COUNT]={
+					FILA( 0 , 1 , 0 , 0 , 0 , 0 , 0 , 0 , 19 , 0 ),
+                    FILA( 1 , EXPR(1) , 1 , 1 , 1 , 3 , 1 , 2 , 22 , 1 ),
+                    FILA( 2 , EXPR(2) , 2 , 2 , 2 , 3 , 2 , 2 , 22 , 2 ),
+					FILA( 3 , 3 , 3 , 3 , 5 , 4 , 8 , 8 , 3 , 3 ),
+					FILA( 4 , 3 , 3 , 3 , 3 , 3 , 3 , 3 , 3 , 3 ),
+					FILA( 5 , 5 , 5 , 5 , 5 , 16 , 5 , 5 , 5 , 5 ),
+					FILA( 6 , 6 , 6 , 6 , 6 , 6 , 6 , 6 , 6 , 6 ),
+					FILA( 7 , 16 , 16 , 16 , 16 , 16 , 16 , 16 , 16 , 16 ),
+					FILA( 8 , EXPR(8) , 8 , 8 , 8 , 10 , 8 , 9 , 24 , 8 ),
+                    FILA( 9 , EXPR(9) , 9 , 9 , 9 , 10 , 9 , 9 , 24 , 9 ),
+					FILA( 10 , 10 , 14 , 10 , 12 , 11 , EXPR(10) , EXPR(10) , 10 , 10 ),
+					FILA( 11 , 10 , 10 , 10 , 10 , 10 , 10 , 10 , 10 , 10 ),
+					FILA( 12 , 12 , 12 , 12 , 12 , 13 , 12 , 12 , 12 , 12 ),
+					FILA( 13 , 13 , 14 , 13 , 13 , 15 , EXPR(13) , EXPR(13) , 13 , 13 ),
+					FILA( 14 , 14 , 14 , 99 , 14 , 14 , 14 , 14 , 14 , 14 ),
+					FILA( 15 , 13 , 13 , 13 , 13 , 13 , 13 , 13 , 13 , 13 ),
+					FILA( 16 , 16 , 16 , 16 , 16 , 7 , 8 , 8 , 16 , 16 ),//DIVISION
+					FILA( 17 , 17 , 17 , 17 , 17 , 17 , 17 , 17 , 17 , 17 ),
+					{ P(18,18), PASO_EXPR, PASO_EXPR, PASO_EXPR, PASO_EXPR, PASO_EXPR, PASO_EXPR, PASO_EXPR,
+					  PASO_EXPR, P(18,18) },	//EXPRESION
+					FILA( 19 , 1 , 19 , 19 , 19 , 19 , 19 , 19 , 19 , 20 ),//DESTINO
+					FILA( 20 , 1 , 20 , 21 , 20 , 20 , 20 , 20 , 20 , 20 ),
+					FILA( 21 , 1 , 21 , 21 , 21 , 21 , 21 , 21 , 19 , 21 ),
+					FILA( 22 , 22 , 22 , 22 , 22 , 22 , 8 , 8 , 23 , 22 ),//REGISTRO A
+					FILA( 23 , 23 , 23 , 23 , 23 , 23 , 23 , 23 , 22 , 23 ),
+					FILA( 24 , 24 , 14 , 24 , 24 , 24 , EXPR(24) , EXPR(24) , 25 , 24 ),//REGISTRO B
+					FILA( 25 , 25 , 25 , 25 , 25 , 25 , 25 , 25 , 24 , 25 )
+                    };
 
-  Remarks:
-    This structure should be initialized by the APP_Initialize function.
-    
-    Application strings and buffers are be defined outside this structure.
-*/
+void miPrintf(CALC_SESSION *ses, const char* s, int cont) {
+#if APP_BATCH_MODE
+    (void)s;	//Sin eco en modo batch
+    (void)cont;
+#else
+    if (ses->spans==NULL)
+        APP_TXRING_Write(ses->tx, s, cont);	//El writer de APP_Tasks lo manda por USB
+    else if (s==&ses->chr)
+        APP_TXSPAN_Write(ses->spans, s, cont);	//La copia en la sesión no dura, va al ring
+    else
+        APP_TXSPAN_Reference(ses->spans, s, cont);	//Eco sin copiar: apunta al buffer de lectura
+#endif
+}
 
-APP_DATA appData;
+void miResultado(CALC_SESSION *ses, const char* s, int cont) {
+    if (ses->spans==NULL)
+        APP_TXRING_Write(ses->tx, s, cont);	//Los resultados siempre se mandan
+    else
+        APP_TXSPAN_Write(ses->spans, s, cont);	//Sólo el resultado se copia
+}
 
+int calcTrans(char ch) {
+	return(tblTrans[(uint8_t)ch]);	//Una sola lectura por byte
+}
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Application Callback Functions
-// *****************************************************************************
-// *****************************************************************************
+int sigEdo(int estado, int tr) {
+	return(mtzTrans[estado][tr].next);
+}
 
+//Juego de acciones de esta variante, el que su blob de gramática nombra
+#define CALC_JUEGO 2
 
+//Las tablas de arriba como gramática, la que usa una sesión recién iniciada
+const APP_GRAMMAR calcGramatica={ tblTrans, &mtzTrans[0][0] };
 
-/*******************************************************
- * USB CDC Device Events - Application Event Handler
- *******************************************************/
+//Lo que un blob debe cumplir para esta variante. Los dígitos, el punto y el
+//resultado fijan ellos el estado de continuidad, así que el siguiente estado
+//de sus casillas no se usa (el resultado lleva 99)
+const APP_GRAMMAR_RULES calcReglas={ CALC_JUEGO, EDO_COUNT, TRANS_COUNT, ACC_COUNT,
+	  (1ul<<ACC_DIGITO_A)|(1ul<<ACC_DECIMAL_A)|(1ul<<ACC_DIGITO_B)|
+	  (1ul<<ACC_DECIMAL_B)|(1ul<<ACC_RESULTADO) };
 
-USB_DEVICE_CDC_EVENT_RESPONSE APP_USBDeviceCDCEventHandler
-(
-    USB_DEVICE_CDC_INDEX index,
-    USB_DEVICE_CDC_EVENT event,
-    void * pData,
-    uintptr_t userData
-)
-{
-    APP_DATA * appDataObject;
-    USB_CDC_CONTROL_LINE_STATE * controlLineStateData;
-    USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE * eventDataRead;
-    
-    appDataObject = (APP_DATA *)userData;
+#if CALC_GRAMATICA_LARGO!=APP_GRAMMAR_SIZE(EDO_COUNT,TRANS_COUNT)
+#error "CALC_GRAMATICA_LARGO no corresponde a EDO_COUNT y TRANS_COUNT"
+#endif
 
-    switch(event)
-    {
-        case USB_DEVICE_CDC_EVENT_GET_LINE_CODING:
+APP_GRAMMAR_STATUS calcGramaticaCarga(APP_GRAMMAR *gramatica, const uint8_t *blob, size_t largo) {
+	return(APP_GRAMMAR_Load(gramatica,blob,largo,&calcReglas));	//Sin copiar: apunta al blob
+}
 
-            /* This means the host wants to know the current line
-             * coding. This is a control transfer request. Use the
-             * USB_DEVICE_ControlSend() function to send the data to
-             * host.  */
+size_t calcGramaticaBlob(uint8_t *blob, size_t tam) {
+	return(APP_GRAMMAR_Encode(blob,tam,&calcGramatica,&calcReglas));
+}
 
-            USB_DEVICE_ControlSend(appDataObject->deviceHandle,
-                    &appDataObject->getLineCodingData, sizeof(USB_CDC_LINE_CODING));
+//Cada resultado cabe en CALC_SALIDA_MAX, nunca queda uno a medias
+bool calcFlush(CALC_SESSION *ses) {
+	return(false);
+}
 
-            break;
+#if CALC_PUNTO_FIJO
+//Agrega un dígito entero al operando; si ya no cabe lo marca como desbordado
+CALC_NUMERO calcDigitoFijo(CALC_SESSION *ses, CALC_NUMERO n) {
+	if ((uint64_t)n >= CALC_LIMITE/10) {
+		ses->desborde=true;
+		return(n);
+	}
+	return(n*10+(CALC_NUMERO)(ses->chr-'0')*CALC_UNO);
+}
 
-        case USB_DEVICE_CDC_EVENT_SET_LINE_CODING:
+//Producto exacto redondeado a CALC_DECIMALES (mitades hacia afuera). Con
+//a=ai+af y b=bi+bf (partes entera y fraccionaria) ningún término pasa de 64 bits
+bool calcMultFijo(CALC_NUMERO a, CALC_NUMERO b, CALC_NUMERO *res) {
+	uint64_t ua=(a<0) ? 0u-(uint64_t)a : (uint64_t)a;
+	uint64_t ub=(b<0) ? 0u-(uint64_t)b : (uint64_t)b;
+	uint64_t ai=ua/CALC_UNO, af=ua%CALC_UNO;
+	uint64_t bi=ub/CALC_UNO, bf=ub%CALC_UNO;
+	uint64_t bajo, p;
+	if (ai && (bi > CALC_LIMITE/CALC_UNO/ai))
+		return(false);
+	bajo=af*bf;
+	p=ai*bi*CALC_UNO+ai*bf+af*bi+bajo/CALC_UNO+(2*(bajo%CALC_UNO)>=CALC_UNO);
+	if (p>=CALC_LIMITE)
+		return(false);
+	*res=((a<0)!=(b<0)) ? -(CALC_NUMERO)p : (CALC_NUMERO)p;
+	return(true);
+}
 
-            /* This means the host wants to set the line coding.
-             * This is a control transfer request. Use the
-             * USB_DEVICE_ControlReceive() function to receive the
-             * data from the host */
+//Cociente por división larga, un decimal a la vez, redondeado (mitades hacia afuera)
+bool calcDivFijo(CALC_NUMERO a, CALC_NUMERO b, CALC_NUMERO *res) {
+	uint64_t ua=(a<0) ? 0u-(uint64_t)a : (uint64_t)a;
+	uint64_t ub=(b<0) ? 0u-(uint64_t)b : (uint64_t)b;
+	uint64_t q=ua/ub, r=ua%ub;
+	int k;
+	if (q>=CALC_LIMITE/CALC_UNO)
+		return(false);
+	for (k=0; k<CALC_DECIMALES; k++) {
+		r*=10;
+		q=q*10+r/ub;
+		r%=ub;
+	}
+	q+=(2*r>=ub);
+	*res=((a<0)!=(b<0)) ? -(CALC_NUMERO)q : (CALC_NUMERO)q;
+	return(true);
+}
 
-            USB_DEVICE_ControlReceive(appDataObject->deviceHandle,
-                    &appDataObject->setLineCodingData, sizeof(USB_CDC_LINE_CODING));
+//Si un valor cumple |x| < CALC_LIMITE, lo que calcMultFijo y calcDivFijo suponen
+bool calcCabe(CALC_NUMERO x) {
+	return((x<0 ? 0u-(uint64_t)x : (uint64_t)x)<CALC_LIMITE);
+}
+#endif
+
+//Aritmética del resultado, común al FSM y al protocolo binario. Regresa false
+//si el resultado no cabe, lo que sólo pasa en punto fijo
+bool calcOpera(enum Oper oper, CALC_NUMERO a, CALC_NUMERO b, CALC_NUMERO *res) {
+	*res=0;
+	switch(oper) {
+		case Suma:
+				*res=a+b;
+				break;
+		case Resta:
+				*res=a-b;
+				break;
+		case Mult:
+#if CALC_PUNTO_FIJO
+				return(calcMultFijo(a,b,res));
+#else
+				*res=a*b;
+#endif
+				break;
+		case Div:
+				if (b)
+#if CALC_PUNTO_FIJO
+					return(calcDivFijo(a,b,res));
+#else
+					*res=a/b;
+#endif
+				else
+					*res=-1*CALC_UNO;
+				break;
+	}
+	return(true);
+}
 
-            break;
+#if CALC_CACHE
+//Bits de un operando, llave de la caché de resultados
+uint64_t calcClave(CALC_NUMERO x) {
+#if CALC_PUNTO_FIJO
+	return((uint64_t)x);
+#else
+	uint32_t bits;
+	memcpy(&bits,&x,sizeof(bits));
+	return(bits);
+#endif
+}
 
-        case USB_DEVICE_CDC_EVENT_SET_CONTROL_LINE_STATE:
+//Operando o resultado de unos bits que dio calcClave
+CALC_NUMERO calcValor(uint64_t clave) {
+#if CALC_PUNTO_FIJO
+	return((CALC_NUMERO)clave);
+#else
+	uint32_t bits=(uint32_t)clave;
+	CALC_NUMERO x;
+	memcpy(&x,&bits,sizeof(x));
+	return(x);
+#endif
+}
+#endif
+
+uint8_t calcPeticion(const APP_FRAME_REQUEST *pet, APP_FRAME_VALUE *res) {
+	CALC_NUMERO a, b, r;
+	res->d=0;
+	if (pet->status!=APP_FRAME_OK)
+		return(pet->status);
+#if CALC_PUNTO_FIJO
+	//El cable lleva APP_FRAME_DECIMALS decimales, sin reescalar
+	if (pet->format!=APP_FRAME_DECIMAL || CALC_DECIMALES!=APP_FRAME_DECIMALS)
+		return(APP_FRAME_UNSUPPORTED);
+	a=pet->a.d;
+	b=pet->b.d;
+	if (!calcCabe(a) || !calcCabe(b))
+		return(APP_FRAME_OVERFLOW);	//Como un operando tecleado demasiado largo
+	if (!calcOpera((enum Oper)pet->op,a,b,&r))
+		return(APP_FRAME_OVERFLOW);
+	res->d=r;
+#else
+	if (pet->format!=APP_FRAME_FLOAT32)
+		return(APP_FRAME_UNSUPPORTED);
+	a=pet->a.f;
+	b=pet->b.f;
+	calcOpera((enum Oper)pet->op,a,b,&r);
+	res->f=r;
+#endif
+	return((pet->op==Div && b==0) ? APP_FRAME_DIV_ZERO : APP_FRAME_OK);
+}
 
-            /* This means the host is setting the control line state.
-             * Read the control line state. We will accept this request
-             * for now. */
+uint8_t calcLoteEstado(const APP_FRAME_REQUEST *pet) {
+	if (pet->status!=APP_FRAME_OK)
+		return(pet->status);
+#if CALC_PUNTO_FIJO
+	if (pet->format!=APP_FRAME_DECIMAL || CALC_DECIMALES!=APP_FRAME_DECIMALS)
+		return(APP_FRAME_UNSUPPORTED);
+	if (!calcCabe(pet->b.d))
+		return(APP_FRAME_OVERFLOW);
+	return((pet->op==Div && pet->b.d==0) ? APP_FRAME_DIV_ZERO : APP_FRAME_OK);
+#else
+	if (pet->format!=APP_FRAME_FLOAT32)
+		return(APP_FRAME_UNSUPPORTED);
+	return((pet->op==Div && pet->b.f==0) ? APP_FRAME_DIV_ZERO : APP_FRAME_OK);
+#endif
+}
 
-            controlLineStateData = (USB_CDC_CONTROL_LINE_STATE *)pData;
-            appDataObject->controlLineStateData.dtr = controlLineStateData->dtr;
-            appDataObject->controlLineStateData.carrier = controlLineStateData->carrier;
+void calcLote(const APP_FRAME_REQUEST *pet, const uint8_t *operandos, uint8_t *resultados, size_t n) {
+#if CALC_PUNTO_FIJO
+	CALC_NUMERO a, r;
+	size_t k;
+#endif
+	if (pet->status!=APP_FRAME_OK && pet->status!=APP_FRAME_DIV_ZERO) {
+		memset(resultados,0,n*APP_FRAME_Width(pet->format));
+		return;
+	}
+#if CALC_PUNTO_FIJO
+	//Sin SIMD: cada operando se revisa y pasa por la aritmética exacta
+	for (k=0; k<n; k++) {
+		memcpy(&a,&operandos[8*k],sizeof(a));
+		if (!calcCabe(a) || !calcOpera((enum Oper)pet->op,a,pet->b.d,&r))
+			r=APP_FRAME_DECIMAL_OVERFLOW;
+		memcpy(&resultados[8*k],&r,sizeof(r));
+	}
+#else
+	APP_BULK_Float32(pet->op,pet->b.f,operandos,resultados,n);
+#endif
+}
 
-            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
+//Operador de '+', '-', '*' o '/'
+enum Oper calcOperador(char ch) {
+	switch (ch) {
+		case'-':
+			return(Resta);
+		case'*':
+			return(Mult);
+		case'/':
+			return(Div);
+		default:
+			return(Suma);
+	}
+}
 
-            break;
+//"=resultado\r" en aux, que necesita APP_FORMAT_FLOAT_MAX_LENGTH+2 bytes.
+//Regresa cuántos son
+size_t calcFormatea(char *aux, CALC_NUMERO res, bool desborde) {
+    size_t largo;
+    aux[0]='=';
+#if CALC_PUNTO_FIJO
+    if (desborde) {
+        memcpy(&aux[1],"inf",3);	//Como lo imprimiría la versión float
+        largo=3;
+    } else {
+        largo=APP_FORMAT_Fixed(&aux[1],res,CALC_DECIMALES);	//Sin conversión a float
+    }
+#else
+    (void)desborde;	//Con float un desborde ya es inf
+    largo=APP_FORMAT_Float(&aux[1],res,CALC_DECIMALES);	//Sin printf ni aritmética float
+#endif
+    aux[1+largo]=0x0D; //Carriage return
+    return(largo+2);
+}
 
-        case USB_DEVICE_CDC_EVENT_SEND_BREAK:
+void calcFlujoInicia(CALC_FLUJO *flujo) {
+	flujo->n=0;
+	flujo->descartes=0;
+	flujo->suma=0;
+#if CALC_PUNTO_FIJO
+	flujo->desborde=false;
+	flujo->min=INT64_MAX;	//Así la primera muestra es mínimo y máximo
+	flujo->max=INT64_MIN;
+#else
+	flujo->compensacion=0;
+	flujo->min=FLT_MAX;
+	flujo->max=-FLT_MAX;
+#endif
+}
 
-            /* This means that the host is requesting that a break of the
-             * specified duration be sent. Read the break duration */
+void calcFlujoSuma(CALC_FLUJO *flujo, const APP_STREAM_NUMBER *num) {
+	CALC_NUMERO x;
+#if CALC_PUNTO_FIJO
+	if (!APP_STREAM_Scaled(num,CALC_DECIMALES,&x) || !calcCabe(x)) {
+		flujo->descartes++;
+		return;
+	}
+	if ((x>0 && flujo->suma>INT64_MAX-x) || (x<0 && flujo->suma<INT64_MIN-x))
+		flujo->desborde=true;
+	else
+		flujo->suma+=x;
+#else
+	float y, t;
+	if (num->overflow) {
+		flujo->descartes++;
+		return;
+	}
+	x=APP_STREAM_Float(num);
+	//Kahan: compensacion guarda lo que el redondeo de la suma se comió y
+	//entra en la siguiente muestra. Sin -ffast-math, que lo simplificaría a 0
+	y=x-flujo->compensacion;
+	t=flujo->suma+y;
+	flujo->compensacion=(t-flujo->suma)-y;
+	flujo->suma=t;
+#endif
+	if (x<flujo->min)
+		flujo->min=x;
+	if (x>flujo->max)
+		flujo->max=x;
+	flujo->n++;
+}
 
-            appDataObject->breakData = ((USB_DEVICE_CDC_EVENT_DATA_SEND_BREAK *)pData)->breakDuration;
-            
-            /* Complete the control transfer by sending a ZLP  */
-            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
-            
-            break;
+//Copia la etiqueta de un campo del reporte y regresa su largo
+size_t calcEtiqueta(char *aux, const char *etiqueta) {
+	size_t largo=strlen(etiqueta);
+	memcpy(aux,etiqueta,largo);
+	return(largo);
+}
 
-        case USB_DEVICE_CDC_EVENT_READ_COMPLETE:
+//Un valor del reporte como se imprime un resultado, sin '=' ni CR
+size_t calcCampo(char *aux, CALC_NUMERO x, bool desborde) {
+	char campo[APP_FORMAT_FLOAT_MAX_LENGTH+2];
+	size_t largo=calcFormatea(campo,x,desborde)-2;
+	memcpy(aux,&campo[1],largo);
+	return(largo);
+}
 
-            /* This means that the host has sent some data*/
-            eventDataRead = (USB_DEVICE_CDC_EVENT_DATA_READ_COMPLETE *)pData;
-            
-            if(eventDataRead->status != USB_DEVICE_CDC_RESULT_ERROR)
-            {
-                appDataObject->isReadComplete = true;
-                
-                appDataObject->numBytesRead = eventDataRead->length; 
-            }
-            break;
+size_t calcFlujoReporte(const CALC_FLUJO *flujo, char *aux) {
+	CALC_NUMERO media;
+	bool desborde=false;
+	size_t largo=calcEtiqueta(aux,"n=");
+	largo+=APP_FORMAT_Fixed(&aux[largo],(int64_t)flujo->n,0);
+	if (flujo->n>0) {
+#if CALC_PUNTO_FIJO
+		//Redondeada con las mitades hacia afuera, como calcDivFijo
+		int64_t n=(int64_t)flujo->n, r=flujo->suma%n;
+		media=flujo->suma/n;
+		if (2*(uint64_t)(r<0 ? -r : r)>=(uint64_t)n)
+			media+=(r<0) ? -1 : 1;
+		desborde=flujo->desborde;
+#else
+		media=flujo->suma/(float)flujo->n;
+#endif
+		largo+=calcEtiqueta(&aux[largo]," sum=");
+		largo+=calcCampo(&aux[largo],flujo->suma,desborde);
+		largo+=calcEtiqueta(&aux[largo]," min=");
+		largo+=calcCampo(&aux[largo],flujo->min,false);
+		largo+=calcEtiqueta(&aux[largo]," max=");
+		largo+=calcCampo(&aux[largo],flujo->max,false);
+		largo+=calcEtiqueta(&aux[largo]," mean=");
+		largo+=calcCampo(&aux[largo],media,desborde);
+	}
+	largo+=calcEtiqueta(&aux[largo]," skip=");
+	largo+=APP_FORMAT_Fixed(&aux[largo],(int64_t)flujo->descartes,0);
+	aux[largo++]=0x0D;
+	return(largo);
+}
 
-        case USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_RECEIVED:
+#if CALC_REGISTROS
+//Un resultado queda en ans y, si antes se tecleó "x:=", también en x. En punto
+//fijo uno que no cabe en CALC_LIMITE (o se imprimió inf) no se guarda
+void calcGuarda(CALC_SESSION *ses, CALC_NUMERO res) {
+	char destino=ses->destino;
+	ses->destino=0;
+#if CALC_PUNTO_FIJO
+	if (!calcCabe(res))
+		return;
+#endif
+	ses->registros[CALC_ANS]=res;
+	if (destino)
+		ses->registros[destino-'a']=res;
+}
+#endif
 
-            /* The data stage of the last control transfer is
-             * complete. For now we accept all the data */
+//Acciones. Cada una se ejecuta al entrar a su estado y regresa el estado de continuidad
 
-            USB_DEVICE_ControlStatus(appDataObject->deviceHandle, USB_DEVICE_CONTROL_STATUS_OK);
-            break;
+int accNinguna(CALC_SESSION *ses, int estado) {
+	return(estado);
+}
 
-        case USB_DEVICE_CDC_EVENT_CONTROL_TRANSFER_DATA_SENT:
+int accEco(CALC_SESSION *ses, int estado) {
+	miPrintf(ses,ses->eco,1);
+	return(estado);
+}
 
-            /* This means the GET LINE CODING function data is valid. We don't
-             * do much with this data in this demo. */
-            break;
+int accAbre(CALC_SESSION *ses, int estado) {
+    if (ses->leds) {
+        //BSP_LEDOff( APP_USB_LED_1);
+        //BSP_LEDOff( APP_USB_LED_2);
+        //BSP_LEDOff( APP_USB_LED_3);
+        LED_Off();
+        LED2_Off();
+        LED3_Off();
+    }
+	ses->numeroA=0;
+#if CALC_REGISTROS
+	if (ses->edoAnt!=21)
+		ses->destino=0;		//Un "x:" sin su '=' no cuenta
+#endif
+#if CALC_PUNTO_FIJO
+    ses->producto = CALC_UNO;
+    ses->desborde = false;
+#else
+    ses->producto = 1.0;
+#endif
+    ses->numeroAEsNegativo = 0;
+    ses->numeroBEsNegativo = 0;
+	miPrintf(ses,ses->eco,1);
+	return(estado);
+}
 
-        case USB_DEVICE_CDC_EVENT_WRITE_COMPLETE:
+int accNegativoA(CALC_SESSION *ses, int estado) {
+    miPrintf(ses,ses->eco,1);
+    ses->numeroAEsNegativo = 1;
+    return(estado);
+}
 
-            /* This means that the data write got completed. We can schedule
-             * the next read. */
+int accDigitoA(CALC_SESSION *ses, int estado) {
+	miPrintf(ses,ses->eco,1);
+#if CALC_PUNTO_FIJO
+	ses->numeroA=calcDigitoFijo(ses,ses->numeroA);
+#else
+	ses->numeroA*=10;
+	ses->numeroA+=(ses->chr-'0');
+#endif
+	return(3);
+}
 
-            appDataObject->isWriteComplete = true;
-            break;
+int accDecimalA(CALC_SESSION *ses, int estado) {
+	miPrintf(ses,ses->eco,1);
+#if CALC_PUNTO_FIJO
+	ses->producto/=10;	//Los decimales de más pesan 0 y se ignoran
+#else
+	ses->producto*=(float)0.1;
+#endif
+	ses->numeroA+=(ses->chr-'0')*ses->producto;
+	return 16;
+}
 
-        default:
-            break;
-    }
+int accOperador(CALC_SESSION *ses, int estado) {
+    if (ses->leds) {
+        LED_On();
 
-    return USB_DEVICE_CDC_EVENT_RESPONSE_NONE;
-}
-
-/***********************************************
- * Application USB Device Layer Event Handler.
- ***********************************************/
-void APP_USBDeviceEventHandler 
-(
-    USB_DEVICE_EVENT event, 
-    void * eventData, 
-    uintptr_t context 
-)
-{
-    USB_DEVICE_EVENT_DATA_CONFIGURED *configuredEventData;
-
-    switch(event)
-    {
-        case USB_DEVICE_EVENT_SOF:
-
-            /* This event is used for switch debounce. This flag is reset
-             * by the switch process routine. */
-            appData.sofEventHasOccurred = true;
-            
-            break;
-
-        case USB_DEVICE_EVENT_RESET:
-
-            /* Update LED to show reset state */
-            LED_Off();
-
-            appData.isConfigured = false;
-
-            break;
-
-        case USB_DEVICE_EVENT_CONFIGURED:
-
-            /* Check the configuration. We only support configuration 1 */
-            configuredEventData = (USB_DEVICE_EVENT_DATA_CONFIGURED*)eventData;
-            
-            if ( configuredEventData->configurationValue == 1)
-            {
-                /* Update LED to show configured state */
-                LED_On();
-                
-                /* Register the CDC Device application event handler here.
-                 * Note how the appData object pointer is passed as the
-                 * user data */
-
-                USB_DEVICE_CDC_EventHandlerSet(USB_DEVICE_CDC_INDEX_0, APP_USBDeviceCDCEventHandler, (uintptr_t)&appData);
-
-                /* Mark that the device is now configured */
-                appData.isConfigured = true;
-            }
-            
-            break;
-
-        case USB_DEVICE_EVENT_POWER_DETECTED:
-
-            /* VBUS was detected. We can attach the device */
-            USB_DEVICE_Attach(appData.deviceHandle);
-            
-            break;
-
-        case USB_DEVICE_EVENT_POWER_REMOVED:
-            
-            /* VBUS is not available. We can detach the device */
-            USB_DEVICE_Detach(appData.deviceHandle);
-            
-            appData.isConfigured = false;
-            
-            LED_Off();
-            
-            break;
-
-        case USB_DEVICE_EVENT_SUSPENDED:
-
-            /* Switch LED to show suspended state */
-            LED_Off();
-            
-            break;
-
-        case USB_DEVICE_EVENT_RESUMED:
-        case USB_DEVICE_EVENT_ERROR:
-        default:
-            
-            break;
+        //BSP_LEDOn(  APP_USB_LED_1);
+        LED2_Off();
+        //BSP_LEDOff( APP_USB_LED_2);
+        LED3_Off();
+        //BSP_LEDOff( APP_USB_LED_3);
     }
+	miPrintf(ses,ses->eco,1);
+	ses->oper=calcOperador(ses->chr);
+	ses->numeroB = 0;
+#if CALC_PUNTO_FIJO
+	ses->producto = CALC_UNO;
+#else
+	ses->producto = 1.0; //perparar la entrada pero ahora es en otro estado
+#endif
+	return(estado);
 }
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Application Local Functions
-// *****************************************************************************
-// *****************************************************************************
+int accNegativoB(CALC_SESSION *ses, int estado) {
+    miPrintf(ses,ses->eco,1);
+    ses->numeroBEsNegativo = 1;
+    return(estado);
+}
 
-void APP_ProcessSwitchPress(void)
-{
-    /* This function checks if the switch is pressed and then
-     * debounces the switch press*/
-    
-    if(SWITCH_STATE_PRESSED == (SWITCH_Get()))
-    {
-        if(appData.ignoreSwitchPress)
-        {
-            /* This means the key press is in progress */
-            if(appData.sofEventHasOccurred)
-            {
-                /* A timer event has occurred. Update the debounce timer */
-                appData.switchDebounceTimer ++;
-                appData.sofEventHasOccurred = false;
-                
-                if (USB_DEVICE_ActiveSpeedGet(appData.deviceHandle) == USB_SPEED_FULL)
-                {
-                    appData.debounceCount = APP_USB_SWITCH_DEBOUNCE_COUNT_FS;
-                }
-                else if (USB_DEVICE_ActiveSpeedGet(appData.deviceHandle) == USB_SPEED_HIGH)
-                {
-                    appData.debounceCount = APP_USB_SWITCH_DEBOUNCE_COUNT_HS;
-                }
-                if(appData.switchDebounceTimer == appData.debounceCount)
-                {
-                    /* Indicate that we have valid switch press. The switch is
-                     * pressed flag will be cleared by the application tasks
-                     * routine. We should be ready for the next key press.*/
-                    appData.isSwitchPressed = true;
-                    appData.switchDebounceTimer = 0;
-                    appData.ignoreSwitchPress = false;
-                }
-            }
-        }
-        else
-        {
-            /* We have a fresh key press */
-            appData.ignoreSwitchPress = true;
-            appData.switchDebounceTimer = 0;
-        }
-    }
-    else
-    {
-        /* No key press. Reset all the indicators. */
-        appData.ignoreSwitchPress = false;
-        appData.switchDebounceTimer = 0;
-        appData.sofEventHasOccurred = false;
+int accDigitoB(CALC_SESSION *ses, int estado) {
+    if (ses->leds) {
+        LED_Off();
+        LED2_On();
+        LED3_Off();
+        //BSP_LEDOff( APP_USB_LED_1);
+        //BSP_LEDOn(  APP_USB_LED_2);
+        //BSP_LEDOff( APP_USB_LED_3);
     }
+	miPrintf(ses,ses->eco,1);
+#if CALC_PUNTO_FIJO
+	ses->numeroB=calcDigitoFijo(ses,ses->numeroB);
+#else
+	ses->numeroB*=10;
+	ses->numeroB+=(ses->chr-'0');
+#endif
+	return(10); //antes estado 5
 }
 
-/*****************************************************
- * This function is called in every step of the
- * application state machine.
- *****************************************************/
-
-bool APP_StateReset(void)
-{
-    /* This function returns true if the device
-     * was reset  */
-
-    bool retVal;
+int accDecimalB(CALC_SESSION *ses, int estado) {
+	miPrintf(ses,ses->eco,1);
+#if CALC_PUNTO_FIJO
+	ses->producto/=10;
+#else
+	ses->producto*=0.1;
+#endif
+	ses->numeroB+=(ses->chr-'0')*ses->producto;
+	return 13;
+}
 
-    if(appData.isConfigured == false)
-    {
-        appData.state = APP_STATE_WAIT_FOR_CONFIGURATION;
-        appData.readTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-        appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-        appData.isReadComplete = true;
-        appData.isWriteComplete = true;
-        retVal = true;
+int accCierra(CALC_SESSION *ses, int estado) {
+    if (ses->leds) {
+        LED_Off();
+        LED2_Off();
+        LED3_On();
+        //BSP_LEDOff( APP_USB_LED_1);
+        //BSP_LEDOff( APP_USB_LED_2);
+        //BSP_LEDOn(  APP_USB_LED_3);
     }
-    else
-    {
-        retVal = false;
-    }
-
-    return(retVal);
+	miPrintf(ses,ses->eco,1);
+	return(estado);
 }
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Application Initialization and State Machine Functions
-// *****************************************************************************
-// *****************************************************************************
-
-/*******************************************************************************
-  Function:
-    void APP_Initialize(void)
-
-  Remarks:
-    See prototype in app.h.
- */
-
-void APP_Initialize(void)
-{
-    /* Place the App state machine in its initial state. */
-    appData.state = APP_STATE_INIT;
+int accResultado(CALC_SESSION *ses, int estado) {
+    CALC_NUMERO res=0;
+    size_t largo;
+#if CALC_PUNTO_FIJO
+    bool desborde=ses->desborde;
+#endif
+    char auxString[APP_FORMAT_FLOAT_MAX_LENGTH+2];	//'=', número y CR
+#if CALC_CACHE
+    const uint8_t *copia;
+    unsigned clave;
+    uint64_t valor;
+#endif
     
-    /* Device Layer Handle  */
-    appData.deviceHandle = USB_DEVICE_HANDLE_INVALID ;
-
-    /* Device configured status */
-    appData.isConfigured = false;
-
-    /* Initial get line coding state */
-    appData.getLineCodingData.dwDTERate = 9600;
-    appData.getLineCodingData.bParityType = 0;
-    appData.getLineCodingData.bParityType = 0;
-    appData.getLineCodingData.bDataBits = 8;
-
-    /* Read Transfer Handle */
-    appData.readTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-
-    /* Write Transfer Handle */
-    appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-
-    /* Initialize the read complete flag */
-    appData.isReadComplete = true;
-
-    /*Initialize the write complete flag*/
-    appData.isWriteComplete = true;
-
-    /* Initialize Ignore switch flag */
-    appData.ignoreSwitchPress = false;
-
-    /* Reset the switch debounce counter */
-    appData.switchDebounceTimer = 0;
-
-    /* Reset other flags */
-    appData.sofEventHasOccurred = false;
-    
-    /* To know status of Switch */
-    appData.isSwitchPressed = false;
+    if (ses->leds) {
+        LED_On();
+        LED2_On();
+        LED3_On();
+        //BSP_LEDOn( APP_USB_LED_1);
+        //BSP_LEDOn( APP_USB_LED_2);
+        //BSP_LEDOn( APP_USB_LED_3);                                
+    }
+    if(ses->numeroAEsNegativo){
+        ses->numeroA = ses->numeroA * -1;
+    }
 
-    /* Set up the read buffer */
-    appData.cdcReadBuffer = &cdcReadBuffer[0];
+    if(ses->numeroBEsNegativo){
+        ses->numeroB = ses->numeroB * -1;
+    }
 
-    /* Set up the read buffer */
-    appData.cdcWriteBuffer = &cdcWriteBuffer[0];       
+#if CALC_CACHE
+	//Un operando desbordado imprime inf, va aparte en la llave
+#if CALC_PUNTO_FIJO
+	clave=(unsigned)ses->oper|(desborde ? 4u : 0u);
+#else
+	clave=(unsigned)ses->oper;
+#endif
+	if (ses->cache!=NULL) {
+		copia=APP_RCACHE_Lookup(ses->cache,clave,calcClave(ses->numeroA),calcClave(ses->numeroB),&largo,&valor);
+		if (copia!=NULL) {
+			miResultado(ses,(const char *)copia,(int)largo);	//Ni aritmética ni formato
+#if CALC_REGISTROS
+			calcGuarda(ses,calcValor(valor));
+#endif
+			return(0);
+		}
+	}
+#endif
+#if CALC_PUNTO_FIJO
+	desborde|=!calcOpera(ses->oper,ses->numeroA,ses->numeroB,&res);
+	if (desborde)
+		res=CALC_DESBORDE;
+#else
+	calcOpera(ses->oper,ses->numeroA,ses->numeroB,&res);
+#endif
+	//printf("%d\n",res);
+#if CALC_PUNTO_FIJO
+    largo=calcFormatea(auxString,res,desborde);
+#else
+    largo=calcFormatea(auxString,res,false);
+#endif
+    miResultado(ses,&auxString[0],largo);
+#if CALC_CACHE
+	if (ses->cache!=NULL)
+		APP_RCACHE_Insert(ses->cache,clave,calcClave(ses->numeroA),calcClave(ses->numeroB),calcClave(res),auxString,largo);
+#endif
+#if CALC_REGISTROS
+	calcGuarda(ses,res);
+#endif
+	return(0);	//Estado aceptor, rompe la rutina y marca estado de salida
 }
 
+#if CALC_REGISTROS
+//"x:" antes del '(' elige el registro que además de ans recibe el resultado
+int accDestino(CALC_SESSION *ses, int estado) {
+	if ((unsigned)(ses->chr-'a')>=26)
+		return(ses->edoAnt);	//Una gramática cargada puede poner otros bytes con las letras
+	ses->destino=ses->chr;
+	miPrintf(ses,ses->eco,1);
+	return(estado);
+}
 
-/******************************************************************************
-  Function:
-    void APP_Tasks(void)
-
-  Remarks:
-    See prototype in app.h.
- */
-
-
-#define TRANS_COUNT 8
-#define EDO_COUNT 18
-
-char chr=0;
-float numeroA=0.0;
-float numeroB=0.0;
-float res=0.0;
-float producto=1.0;
-enum Oper{Suma,Resta,Mult,Div};
-enum Oper oper;
-int startIndex = 0, endIndex = 0; 
-char numeroLeido[10];
-char numeroAEscribir[11];
-int edo=0;
-int edoAnt=0;
-int trans=0;
-int miPrintf_flag=0;
-int cuentaString=0;
-char otroString[] = "                                 ";
-int numeroAEsNegativo = 0;
-int numeroBEsNegativo = 0;
-uint8_t CACHE_ALIGN miString[] = "                                 ";
-
-
-int chrTrans[TRANS_COUNT]=
-					{ 0,'(',')','=', '.', 5 , 16, '-'};
-int mtzTrans[EDO_COUNT][TRANS_COUNT]={
-					{ 0 , 1 , 0 , 0 , 0 , 0 , 0 , 0 },
-                    { 1 , 1 , 1 , 1 , 1 , 3 , 1 , 2 },
-                    { 2 , 2 , 2 , 2 , 2 , 3 , 2 , 2 },
-					{ 3 , 3 , 3 , 3 , 5 , 4 , 3 , 3 },
-					{ 4 , 3 , 3 , 3 , 3 , 3 , 3 , 3 },
-					{ 5 , 5 , 5 , 5 , 5 , 16 , 5 , 5 },
-					{ 16 , 16 , 16 , 16 , 16 , 7 , 8 , 8 },//DIVISION
-					{ 7 , 16 , 16 , 16 , 16 , 16 , 16 , 16 },
-					{ 8 , 8 , 8 , 8 , 8 , 10 , 8 , 9 },
-                    { 9 , 9 , 9 , 9 , 9 , 10 , 9 , 9 },
-					{ 10 , 10 , 10 , 10 , 12 , 11 , 10 , 10 },
-					{ 11 , 10 , 10 , 10 , 10 , 10 , 10 , 10 },
-					{ 12 , 12 , 12 , 12 , 12 , 13 , 12 , 12 },
-					{ 13 , 13 , 14 , 13 , 13 , 14 , 13 , 13 },
-					{ 14 , 13 , 13 , 13 , 13 , 13 , 13 , 13 },
-					{ 14 , 14 , 14 , 99 , 14 , 14 , 14 , 14 },
-					{ 99 , 0 , 0 , 0 , 0 , 0 , 0 , 0 },
-                    };
-
-void miPrintf(char* s, int cont) {
-    int i;
-    for (i=0;i<cont;i++)
-        miString[i]=s[i];
-    miPrintf_flag=1;
-    cuentaString=cont;
+//Un registro en lugar de los dígitos de un operando. La 'a' ya es un
+//registro completo; tras "an" (estado+1) sólo la 's' de ans se acepta
+int accRegistro(CALC_SESSION *ses, int estado) {
+	CALC_NUMERO *numero=(estado==EDO_REGISTRO_A) ? &ses->numeroA : &ses->numeroB;
+	if (ses->edoAnt==estado+1) {
+		if (ses->chr!='s')
+			return(ses->edoAnt);	//Se ignora sin eco
+		*numero=ses->registros[CALC_ANS];
+	} else {
+		if ((unsigned)(ses->chr-'a')>=26)
+			return(ses->edoAnt);	//No es letra, ver accDestino
+		*numero=ses->registros[ses->chr-'a'];
+	}
+	if (estado==EDO_REGISTRO_B && ses->leds) {
+		LED_Off();
+		LED2_On();
+		LED3_Off();
+	}
+	ses->nombre=ses->chr;
+	miPrintf(ses,ses->eco,1);
+	return(estado);
 }
 
-int calcTrans(char ch) {
-	int tr=0;
-	if ((ch>='0')&&(ch<='9'))	//Digito
-		return(5);
-	switch (ch) {
-		case'+':
-		case'*':
-		case'/':
-		    return(16);
+//Segunda letra de un nombre, sólo puede ser la 'n' de "ans"
+int accParcial(CALC_SESSION *ses, int estado) {
+	if (ses->nombre!='a' || ses->chr!='n')
+		return(ses->edoAnt);
+	miPrintf(ses,ses->eco,1);
+	return(estado);
+}
+#else
+#define accDestino accNinguna
+#define accRegistro accNinguna
+#define accParcial accNinguna
+#endif
+
+#if CALC_EXPRESIONES
+//Parte del operando que se está tecleando en el modo expresión: sus dígitos
+//o el nombre de un registro, incompleto tras "an"
+enum Literal{LIT_NINGUNO,LIT_ENTERO,LIT_PUNTO,LIT_DECIMAL,LIT_NOMBRE,LIT_PARCIAL};
+
+//Máquina de pila del bytecode de app_expr, con la aritmética de calcOpera.
+//Regresa false si algún resultado no cupo (sólo en punto fijo)
+bool calcEvalua(CALC_SESSION *ses, CALC_NUMERO *res) {
+	CALC_NUMERO pila[APP_EXPR_STACK_MAX];
+	const uint8_t *codigo=ses->expr.code;
+	int cima=-1;
+	bool cabe=true;
+	unsigned k;
+	for (k=0; k<ses->expr.length; k++) {
+		switch (codigo[k]) {
+			case APP_EXPR_PUSH:
+				pila[++cima]=ses->operandos[codigo[++k]];
+				break;
+			case APP_EXPR_NEG:
+				pila[cima]=-pila[cima];
+				break;
+			default:
+				cima--;
+				if (!calcOpera((enum Oper)codigo[k],pila[cima],pila[cima+1],&pila[cima]))
+					cabe=false;
+#if CALC_PUNTO_FIJO
+				if (!calcCabe(pila[cima]))
+					cabe=false;	//El siguiente producto o división ya no sería exacto
+#endif
+				break;
+		}
 	}
-    if(ch == '-') return(7);
-	for (tr=4;tr>0;tr--)
-		if (ch==chrTrans[tr])
-			break;
-	return(tr);
+	*res=pila[0];
+	return(cabe);
 }
 
-int sigEdo(int estado, int tr) {
-	return(mtzTrans[estado][tr]);
+//Al pasar al modo expresión, lo que el FSM ya leyó ("(", "(-", "(a op",
+//"(a op -" o "(a op b", donde b puede ser un registro) se entrega al
+//compilador como si se tecleara de nuevo
+void calcEscala(CALC_SESSION *ses) {
+	APP_EXPR *expr=&ses->expr;
+	uint8_t k;
+	APP_EXPR_Initialize(expr);
+	APP_EXPR_Open(expr);
+	ses->literal=LIT_NINGUNO;
+	if (ses->edoAnt==2) {
+		APP_EXPR_Negate(expr);
+		return;
+	}
+	if (ses->edoAnt==1)
+		return;
+	if (ses->numeroAEsNegativo)
+		APP_EXPR_Negate(expr);
+	APP_EXPR_Operand(expr,&k);
+	ses->operandos[k]=ses->numeroA;
+	APP_EXPR_Operator(expr,ses->oper);
+	if (ses->numeroBEsNegativo)
+		APP_EXPR_Negate(expr);
+	if (ses->edoAnt==10 || ses->edoAnt==13 || ses->edoAnt==EDO_REGISTRO_B) {
+		APP_EXPR_Operand(expr,&k);
+		ses->operandos[k]=ses->numeroB;
+	}
 }
 
-int ejecutaEdo(int estado) { //como la avenida del estado xd
-    static int negativoFlag=0;
-    static int digitosCont=0;
-    static int auxRes=0;
-    
-	switch(estado) {
-		case 0:
+//Modo expresión: el FSM sólo clasifica el byte y aquí se compila. Un byte
+//que no cabe donde llega se ignora sin eco, como en los demás estados
+int accExpresion(CALC_SESSION *ses, int estado) {
+	CALC_NUMERO res, *numero;
+	bool acepta=false, cabe;
+	size_t largo;
+	char auxString[APP_FORMAT_FLOAT_MAX_LENGTH+2];
+	if (ses->edoAnt!=EDO_EXPRESION)
+		calcEscala(ses);
+	switch (ses->clases[(uint8_t)ses->chr]) {
+		case 1:	//(
+			acepta=APP_EXPR_Open(&ses->expr);
 			break;
-		case 1:
-            //BSP_LEDOff( APP_USB_LED_1);
-            //BSP_LEDOff( APP_USB_LED_2);
-            //BSP_LEDOff( APP_USB_LED_3);
-            LED_Off();
-            LED2_Off();
-            LED3_Off();
-			numeroA=0.0;
-            producto = 1.0;
-            numeroAEsNegativo = 0;
-            numeroBEsNegativo = 0;
-			miPrintf(&chr,1);
-			break;
-        case 2:
-            miPrintf(&chr,1);
-            numeroAEsNegativo = 1;
-            break;
-		case 3:
-		case 4:
-			miPrintf(&chr,1);
-			numeroA*=10;
-			numeroA+=(chr-'0');
-			return(3);
-			break;
-		case 5:
-			miPrintf(&chr,1);
+		case 2:	//)
+			if (ses->literal!=LIT_PUNTO && ses->literal!=LIT_PARCIAL && APP_EXPR_Close(&ses->expr)) {
+				ses->literal=LIT_NINGUNO;
+				acepta=true;
+			}
 			break;
-		case 16:
-		case 7:
-			miPrintf(&chr,1);
-			producto*=(float)0.1;
-			numeroA+=(chr-'0')*producto;
-			return 16;
+		case 3:	//=, sólo con la expresión completa; no lleva eco, el resultado empieza con '='
+			if (!APP_EXPR_End(&ses->expr))
+				break;
+			if (ses->leds) {
+				LED_On();
+				LED2_On();
+				LED3_On();
+			}
+			cabe=calcEvalua(ses,&res);
+#if CALC_PUNTO_FIJO
+			cabe=cabe && !ses->desborde;
+			if (!cabe)
+				res=CALC_DESBORDE;
+#endif
+			largo=calcFormatea(auxString,res,!cabe);
+			miResultado(ses,auxString,(int)largo);
+#if CALC_REGISTROS
+			calcGuarda(ses,res);
+#endif
+			return(0);
+		case 4:	//Punto decimal
+			if (ses->literal==LIT_ENTERO) {
+				ses->literal=LIT_PUNTO;
+				acepta=true;
+			}
 			break;
-		case 8:
-            LED_On();
-
-            //BSP_LEDOn(  APP_USB_LED_1);
-            LED2_Off();
-            //BSP_LEDOff( APP_USB_LED_2);
-            LED3_Off();
-            //BSP_LEDOff( APP_USB_LED_3);
-            miPrintf(&chr,1);
-			miPrintf(&chr,1);
-			switch (chr) {
-				case'+':
-					oper=Suma;
-					break;
-				case'-':
-					oper=Resta;
-					break;
-				case'*':
-					oper=Mult;
-					break;
-				case'/':
-					oper=Div;
+		case 5:	//Dígito
+			if (ses->literal>=LIT_NOMBRE)
+				break;
+			if (ses->literal==LIT_NINGUNO) {
+				if (!APP_EXPR_Operand(&ses->expr,&ses->ranura))
 					break;
+				ses->operandos[ses->ranura]=0;
+				ses->literal=LIT_ENTERO;
+#if CALC_PUNTO_FIJO
+				ses->producto=CALC_UNO;
+#else
+				ses->producto=1.0;
+#endif
 			}
-			numeroB = 0.0;
-			producto = 1.0; //perparar la entrada pero ahora es en otro estado
-			break;
-        case 9:
-
-            miPrintf(&chr,1);
-            numeroBEsNegativo = 1;
-            break;
-		case 10:
-		case 11:
-            LED_Off();
-            LED2_On();
-            LED3_Off();
-            //BSP_LEDOff( APP_USB_LED_1);
-            //BSP_LEDOn(  APP_USB_LED_2);
-            //BSP_LEDOff( APP_USB_LED_3);
-			miPrintf(&chr,1);
-			numeroB*=10;
-			numeroB+=(chr-'0');
-			return(10); //antes estado 5
-			break;
-		case 12:
-            LED_Off();
-            LED2_Off();
-            LED3_On();
-            //BSP_LEDOff( APP_USB_LED_1);
-            //BSP_LEDOff( APP_USB_LED_2);
-            //BSP_LEDOn(  APP_USB_LED_3);
-			miPrintf(&chr,1);
-			break;
-		case 14:
-			miPrintf(&chr,1);
-			producto*=0.1;
-			numeroB+=(chr-'0')*producto;
-			return 13;
+			numero=&ses->operandos[ses->ranura];
+			if (ses->literal==LIT_ENTERO) {
+#if CALC_PUNTO_FIJO
+				*numero=calcDigitoFijo(ses,*numero);
+#else
+				*numero*=10;
+				*numero+=(ses->chr-'0');
+#endif
+			} else {
+#if CALC_PUNTO_FIJO
+				ses->producto/=10;
+#else
+				ses->producto*=(float)0.1;
+#endif
+				*numero+=(ses->chr-'0')*ses->producto;
+				ses->literal=LIT_DECIMAL;
+			}
+			acepta=true;
 			break;
-		case 14:
-                LED_Off();
-                LED2_Off();
-                LED3_On();
-                //BSP_LEDOff( APP_USB_LED_1);
-                //BSP_LEDOff( APP_USB_LED_2);
-                //BSP_LEDOn(  APP_USB_LED_3);
-				miPrintf(&chr,1);
+		case 6:	//+ * /
+		case 7:	//-, resta o signo
+			if (ses->literal==LIT_PUNTO || ses->literal==LIT_PARCIAL)
 				break;
-		case 99:
-				LED_On();
-                LED2_On();
-                LED3_On();
-                //BSP_LEDOn( APP_USB_LED_1);
-                //BSP_LEDOn( APP_USB_LED_2);
-                //BSP_LEDOn( APP_USB_LED_3);                                
-                if(numeroAEsNegativo){
-                    numeroA = numeroA * -1;
-                }
-
-                if(numeroBEsNegativo){
-                    numeroB = numeroB * -1;
-                }
-                 
-				switch(oper) {
-					case Suma:
-							res=numeroA+numeroB;
-							break;
-					case Resta:
-							res=numeroA-numeroB;
-							break;
-					case Mult:
-							res=numeroA*numeroB;
-							break;
-					case Div:
-							if (numeroB)
-								res=numeroA/numeroB;
-							else
-								res=-1;
-							break;
-				}
-				//printf("%d\n",res);
-                if (res<0) {
-                    negativoFlag=1;
-                } else {
-                    negativoFlag=0;
-                }
-                auxRes=res;
-                digitosCont=0;
-                do {
-                    auxRes/=10;
-                    digitosCont++;
-                } while(auxRes);
-                i=digitosCont;
-                do {
-                    auxString[negativoFlag+i]='0'+fmod(res,10);
-                    res/=10;
-                } while(--i>=0);
-                auxString[0]='=';
-                if (negativoFlag) {
-                    auxString[1]='-';
-                }
-                //agregar que imprima los puntos para float y el float
-                snprintf(otroString, sizeof(otroString), "=%f", res);
-                otroString[digitosCont+3+negativoFlag]=0x0D; //Carriage return
-                miPrintf(&otroString[0],digitosCont+3+negativoFlag+1);
-				return(0);
-		case 99://ya entra
-        				//printf("\n<<<Captura cancelada>>>\n");
-				return(0);	//Estado aceptor, rompe la rutina y marca estado de salida
+			if (ses->expr.operandDue)
+				acepta=(ses->chr=='-') && APP_EXPR_Negate(&ses->expr);
+			else if (ses->expr.open>0)	//Tras el ')' exterior sólo queda el '='
+				acepta=APP_EXPR_Operator(&ses->expr,calcOperador(ses->chr));
+			if (acepta)
+				ses->literal=LIT_NINGUNO;
+			break;
+#if CALC_REGISTROS
+		case 8:	//Letra: un registro como operando; "ans" se completa letra por letra
+			if (ses->literal==LIT_NINGUNO) {
+				if ((unsigned)(ses->chr-'a')>=26 || !APP_EXPR_Operand(&ses->expr,&ses->ranura))
+					break;	//No es letra, ver accDestino
+				ses->operandos[ses->ranura]=ses->registros[ses->chr-'a'];
+				ses->literal=LIT_NOMBRE;
+			} else if (ses->literal==LIT_NOMBRE && ses->nombre=='a' && ses->chr=='n') {
+				ses->literal=LIT_PARCIAL;
+			} else if (ses->literal==LIT_PARCIAL && ses->chr=='s') {
+				ses->operandos[ses->ranura]=ses->registros[CALC_ANS];
+				ses->literal=LIT_NOMBRE;
+			} else {
 				break;
+			}
+			ses->nombre=ses->chr;
+			acepta=true;
+			break;
+#endif
 	}
-	return(estado);	//Para estados no aceptores regresar el estado ejecutado
+	if (acepta)
+		miPrintf(ses,ses->eco,1);
+	return(estado);
+}
+#endif
+
+#if !CALC_EXPRESIONES
+#define accExpresion accNinguna
+#endif
+
+int (* const accion[ACC_COUNT])(CALC_SESSION *, int)={
+	accNinguna, accEco, accAbre, accNegativoA, accDigitoA, accDecimalA, accOperador,
+	accNegativoB, accDigitoB, accDecimalB, accCierra, accResultado, accExpresion,
+	accDestino, accRegistro, accParcial };
+
+void calcSessionInit(CALC_SESSION *ses, APP_TXRING *tx, bool leds) {
+	memset(ses,0,sizeof(*ses));		//Estado 0, esperando '('
+	ses->tx=tx;
+	ses->leds=leds;
+	ses->clases=calcGramatica.classes;
+	ses->pasos=calcGramatica.steps;
+}
+
+void calcSessionSpans(CALC_SESSION *ses, APP_TXSPAN *spans) {
+	ses->spans=spans;
 }
 
+void calcSessionCache(CALC_SESSION *ses, APP_RCACHE *cache) {
+#if CALC_CACHE
+	ses->cache=cache;
+#else
+	(void)ses;
+	(void)cache;
+#endif
+}
 
+void calcSessionGramatica(CALC_SESSION *ses, const APP_GRAMMAR *gramatica) {
+	if (gramatica==NULL)
+		gramatica=&calcGramatica;
+	ses->clases=gramatica->classes;
+	ses->pasos=gramatica->steps;
+	ses->edo=0;		//Esperando '(' como tras calcSessionInit
+}
 
-void APP_Tasks(void)
-{
-    /* Update the application state machine based
-     * on the current state */
-    int i;
-    
-    switch(appData.state)
-    {
-        case APP_STATE_INIT:
-
-            /* Open the device layer */
-            appData.deviceHandle = USB_DEVICE_Open( USB_DEVICE_INDEX_0, DRV_IO_INTENT_READWRITE );
-
-            if(appData.deviceHandle != USB_DEVICE_HANDLE_INVALID)
-            {
-                /* Register a callback with device layer to get event notification (for end point 0) */
-                USB_DEVICE_EventHandlerSet(appData.deviceHandle, APP_USBDeviceEventHandler, 0);
-
-                appData.state = APP_STATE_WAIT_FOR_CONFIGURATION;
-            }
-            else
-            {
-                /* The Device Layer is not ready to be opened. We should try
-                 * again later. */
-            }
-
-            break;
-
-        case APP_STATE_WAIT_FOR_CONFIGURATION:
-
-            /* Check if the device was configured */
-            if(appData.isConfigured)
-            {
-                /* If the device is configured then lets start reading */
-                appData.state = APP_STATE_SCHEDULE_READ;
-            }
-            
-            break;
-
-        case APP_STATE_SCHEDULE_READ:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            /* If a read is complete, then schedule a read
-             * else wait for the current read to complete */
-
-            appData.state = APP_STATE_WAIT_FOR_READ_COMPLETE;
-            if(appData.isReadComplete == true)
-            {
-                appData.isReadComplete = false;
-                appData.readTransferHandle =  USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-
-                USB_DEVICE_CDC_Read (USB_DEVICE_CDC_INDEX_0,
-                        &appData.readTransferHandle, appData.cdcReadBuffer,
-                        APP_READ_BUFFER_SIZE);
-                
-                if(appData.readTransferHandle == USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID)
-                {
-                    appData.state = APP_STATE_ERROR;
-                    break;
-                }
-            }
-
-            break;
-
-        case APP_STATE_WAIT_FOR_READ_COMPLETE:
-        case APP_STATE_CHECK_SWITCH_PRESSED:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            APP_ProcessSwitchPress();
-
-            /* Check if a character was received or a switch was pressed.
-             * The isReadComplete flag gets updated in the CDC event handler. */
-
-            if(appData.isReadComplete || appData.isSwitchPressed)
-            {
-                appData.state = APP_STATE_SCHEDULE_WRITE;
-            }
-
-            break;
-
-
-        case APP_STATE_SCHEDULE_WRITE:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            /* Setup the write */
-
-            appData.writeTransferHandle = USB_DEVICE_CDC_TRANSFER_HANDLE_INVALID;
-            appData.isWriteComplete = false;
-            appData.state = APP_STATE_WAIT_FOR_WRITE_COMPLETE;
-
-            if(appData.isSwitchPressed)
-            {
-                /* If the switch was pressed, then send the switch prompt*/
-                appData.isSwitchPressed = false;
-                USB_DEVICE_CDC_Write(USB_DEVICE_CDC_INDEX_0,
-                        &appData.writeTransferHandle, switchPromptUSB, sizeof(switchPromptUSB),
-                        USB_DEVICE_CDC_TRANSFER_FLAGS_DATA_COMPLETE);
-            }
-            else
-            {
-                /* Else echo each received character by adding 1 */
-                for(i = 0; i < appData.numBytesRead; i++)
-                {
-                    if((appData.cdcReadBuffer[i] != 0x0A) && (appData.cdcReadBuffer[i] != 0x0D))
-                    {
-                        //appData.cdcWriteBuffer[i] = appData.cdcReadBuffer[i] + 1;
-                        chr=appData.cdcReadBuffer[i];
-                        trans=calcTrans(chr);	//Calcular la transici�n seg�n la entrada del teclado
-                        if (trans) {			//Validar por transici�n valida (la transici�n 0 es inv�lida)
-                            edoAnt=edo;					//Guardar el estado anterior
-                            edo=sigEdo(edoAnt,trans);	//Calcular el siguiente estado
-                            if (edoAnt!=edo)			//Solo si hay cambio de estado hay que ...
-                                edo=ejecutaEdo(edo);	// ... ejecutar el nuevo estado y asignar estado de continuidad
-                        }
-                    }
-                }
-                
-                if (miPrintf_flag) {
-                    USB_DEVICE_CDC_Write(USB_DEVICE_CDC_INDEX_0, &appData.writeTransferHandle,
-                                            miString, cuentaString, USB_DEVICE_CDC_TRANSFER_FLAGS_DATA_COMPLETE);
-                    miPrintf_flag=0;
-                    cuentaString=0;
-                }
-                
-                /*
-                USB_DEVICE_CDC_Write(USB_DEVICE_CDC_INDEX_0,
-                        &appData.writeTransferHandle,
-                        appData.cdcWriteBuffer, appData.numBytesRead,
-                        USB_DEVICE_CDC_TRANSFER_FLAGS_DATA_COMPLETE);
-                 */
-            }
-
-            break;
-
-        case APP_STATE_WAIT_FOR_WRITE_COMPLETE:
-
-            if(APP_StateReset())
-            {
-                break;
-            }
-
-            /* Check if a character was sent. The isWriteComplete
-             * flag gets updated in the CDC event handler */
-
-            if(appData.isWriteComplete == true)
-            {
-                appData.state = APP_STATE_SCHEDULE_READ;
-            }
-
-            break;
-
-        case APP_STATE_ERROR:
-        default:
-            
-            break;
-    }
+void calcStep(CALC_SESSION *ses, char ch) {
+	ses->chr=ch;
+	calcStepRef(ses,&ses->chr);	//El eco sale de la copia en la sesión
 }
 
-/*******************************************************************************
- End of File
- */
+void calcStepRef(CALC_SESSION *ses, const char *p) {
+	const PASO *paso;
+	int trans;
+	ses->chr=*p;
+	ses->eco=p;
+	trans=ses->clases[(uint8_t)ses->chr];	//Calcular la transición según la entrada del teclado (0 si es inválida)
+	paso=&ses->pasos[ses->edo*TRANS_COUNT+trans];	//Siguiente estado y acción en una sola lectura
+	ses->edoAnt=ses->edo;			//Guardar el estado anterior
+	ses->edo=accion[paso->action](ses,paso->next);	//Ejecutar la acción del nuevo estado y asignar estado de continuidad
+}
 
+//Desde cuántos dígitos conviene convertir la corrida en bloque
+#define CALC_CORRIDA_MIN 4
+
+//Atajo para números largos: en los estados 3 y 10 (parte entera de un
+//operando, también la de un literal del modo expresión) cada dígito sólo hace
+//numero*10+dígito, así que la corrida completa se busca de una vez y la
+//máquina de estados sigue en el primer no dígito
+size_t calcDigitos(CALC_SESSION *ses, const char *data, size_t length) {
+	CALC_NUMERO *numero;
+	size_t largo, k;
+#if !CALC_PUNTO_FIJO
+	uint64_t entero;
+#endif
+	if (ses->pasos!=calcGramatica.steps)
+		return(0);	//Con una gramática cargada el atajo no vale, cada byte va al FSM
+	if (ses->edo==3)
+		numero=&ses->numeroA;
+	else if (ses->edo==10)
+		numero=&ses->numeroB;
+#if CALC_EXPRESIONES
+	else if (ses->edo==EDO_EXPRESION && ses->literal==LIT_ENTERO)
+		numero=&ses->operandos[ses->ranura];
+#endif
+	else
+		return(0);
+	largo=APP_DIGITS_Span(data,length);
+#if !APP_BATCH_MODE
+	if (ses->spans==NULL && largo>APP_TXRING_Free(ses->tx))
+		largo=APP_TXRING_Free(ses->tx);	//El eco tiene que caber completo
+#endif
+	if (largo==0)
+		return(0);
+	if (ses->edo==10 && ses->leds) {
+		LED_Off();
+		LED2_On();
+		LED3_Off();
+	}
+	miPrintf(ses,data,(int)largo);
+#if CALC_PUNTO_FIJO
+	for (k=0; k<largo; k++) {
+		ses->chr=data[k];
+		*numero=calcDigitoFijo(ses,*numero);
+	}
+#else
+	//Mientras el resultado quepa en los 24 bits de la mantisa cada paso float
+	//es exacto y convertir la corrida entera da el mismo número
+	entero=1u<<24;
+	if (*numero<16777216.0f && largo>=CALC_CORRIDA_MIN && largo<=8)
+		entero=APP_DIGITS_Accumulate((uint64_t)*numero,data,largo);
+	if (entero<(1u<<24)) {
+		*numero=(float)entero;
+	} else {
+		for (k=0; k<largo; k++) {
+			*numero*=10;
+			*numero+=(data[k]-'0');
+		}
+	}
+#endif
+	ses->chr=data[largo-1];
+	ses->edoAnt=ses->edo;
+	return(largo);
+}
@@ -0,0 +1,383 @@
+/*******************************************************************************
+  Calculator Session Header File
+
+  File Name:
+    interfacesP4punto2.h
+
+  Summary:
+    Reentrant state of the punto2 calculator.
+
+  Description:
+    Everything the state machine carries from one byte to the next lives in a
+    CALC_SESSION instead of in globals, so the same engine can serve any
+    number of independent streams at once: one per CDC instance on the
+    device, one per worker thread on the host.  A session only touches its
+    own fields and the TX ring it was bound to.
+ *******************************************************************************/
+
+#ifndef _INTERFACESP4PUNTO2_H
+#define _INTERFACESP4PUNTO2_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "app_txring.h"
+#include "app_txspan.h"
+#include "app_frame.h"
+#include "app_rcache.h"
+#include "app_expr.h"
+#include "app_stream.h"
+#include "app_format.h"
+#include "app_grammar.h"
+
+enum Oper{Suma,Resta,Mult,Div};
+
+//Decimales con que se imprime el resultado, de 0 a APP_FORMAT_FLOAT_MAX_DECIMALS
+#ifndef CALC_DECIMALES
+#define CALC_DECIMALES 6
+#endif
+
+//Punto fijo: los operandos se guardan como enteros de 64 bits en unidades de
+//10^-CALC_DECIMALES y se opera sin float. Con 0 se usa float como siempre
+#ifndef CALC_PUNTO_FIJO
+#define CALC_PUNTO_FIJO 0
+#endif
+
+//Caché de resultados: una expresión repetida se contesta con los bytes que ya
+//se imprimieron, sin dividir ni formatear. Su tamaño es APP_RCACHE_SETS
+#ifndef CALC_CACHE
+#define CALC_CACHE 1
+#endif
+
+//Expresiones compuestas: un '(' anidado o un segundo operador pasan de la
+//forma "(a op b)=" al compilador de app_expr, con precedencia y paréntesis.
+//Con 0 esos bytes se ignoran como siempre
+#ifndef CALC_EXPRESIONES
+#define CALC_EXPRESIONES 1
+#endif
+
+//Registros: cada resultado queda en "ans" y "x:=" antes del '(' lo guarda
+//también en x, de la 'a' a la 'z'. Un nombre sirve de operando donde va un
+//número, "(ans*x)=". Con 0 las letras y ':' se ignoran como siempre
+#ifndef CALC_REGISTROS
+#define CALC_REGISTROS 1
+#endif
+
+//Lugar de "ans" en CALC_SESSION.registros, tras las 26 letras
+#define CALC_ANS 26
+
+//Largo del blob de gramática de esta variante, ver calcGramaticaCarga
+#define CALC_GRAMATICA_LARGO APP_GRAMMAR_SIZE(26,10)
+
+//Lo más que escribe una sola salida de la calculadora, un resultado con su
+//'=' y CR; app_port.c no procesa una tecla con menos lugar que esto
+#define CALC_SALIDA_MAX (APP_FORMAT_FLOAT_MAX_LENGTH+2)
+
+#if CALC_PUNTO_FIJO
+typedef int64_t CALC_NUMERO;
+typedef int32_t CALC_PESO;
+#else
+typedef float CALC_NUMERO;
+typedef float CALC_PESO;
+#endif
+
+//Agregados del protocolo de flujo (app_stream.h), en O(1) por muestra
+typedef struct {
+	uint64_t n;			//Muestras
+	uint64_t descartes;	//Números que no cupieron
+	CALC_NUMERO suma;
+#if CALC_PUNTO_FIJO
+	bool desborde;		//La suma pasó de 64 bits y se imprime inf
+#else
+	float compensacion;	//Lo que la suma de Kahan perdió al redondear
+#endif
+	CALC_NUMERO min;
+	CALC_NUMERO max;
+} CALC_FLUJO;
+
+//"n=", " sum=", " min=", " max=", " mean=", " skip=" y CR
+#define CALC_FLUJO_REPORTE_MAX (2+20+5+5+5+6+6+20+1+4*APP_FORMAT_FLOAT_MAX_LENGTH)
+
+typedef struct {
+	int edo;			//Estado actual
+	int edoAnt;			//Estado anterior
+	char chr;			//Último carácter recibido
+	CALC_NUMERO numeroA;	//Primer operando
+	CALC_NUMERO numeroB;	//Segundo operando
+	CALC_PESO producto;		//Peso del siguiente decimal
+	int numeroAEsNegativo;
+	int numeroBEsNegativo;
+#if CALC_PUNTO_FIJO
+	bool desborde;		//Un operando no cupo en CALC_LIMITE
+#endif
+	enum Oper oper;
+#if CALC_EXPRESIONES
+	APP_EXPR expr;		//Expresión compuesta compilada a bytecode
+	CALC_NUMERO operandos[APP_EXPR_OPERANDS_MAX];	//Valores de sus APP_EXPR_PUSH
+	uint8_t ranura;		//Operando que se está tecleando
+	uint8_t literal;	//Qué parte de ese operando, ver enum Literal
+#endif
+#if CALC_REGISTROS
+	CALC_NUMERO registros[CALC_ANS+1];	//Indexados por letra-'a', al final ans
+	char destino;		//Letra que recibe el siguiente resultado, 0 = sólo ans
+	char nombre;		//Letra del registro que se está tecleando, 's' en ans
+#endif
+	APP_TXRING *tx;		//Destino del eco y los resultados
+	APP_TXSPAN *spans;	//Si no es NULL el eco se encola por referencia, ver calcStepRef
+	const char *eco;	//Dónde está el byte que se procesa
+	const uint8_t *clases;			//Clase de cada byte, de la gramática en uso
+	const APP_GRAMMAR_STEP *pasos;	//Su tabla de transiciones
+#if CALC_CACHE
+	APP_RCACHE *cache;	//Resultados ya formateados, puede ser compartida; NULL sin caché
+#endif
+	bool leds;			//Sólo una sesión debe mover los LEDs de la tarjeta
+} CALC_SESSION;
+
+// *****************************************************************************
+/* Function:
+    void calcSessionInit(CALC_SESSION * ses, APP_TXRING * tx, bool leds)
+
+  Summary:
+    Puts a session in the idle state and binds it to its output ring.
+
+  Remarks:
+    leds selects whether this session drives LED/LED2/LED3.  With several
+    sessions alive only one of them should.
+*/
+
+void calcSessionInit(CALC_SESSION * ses, APP_TXRING * tx, bool leds);
+
+// *****************************************************************************
+/* Function:
+    void calcSessionSpans(CALC_SESSION * ses, APP_TXSPAN * spans)
+
+  Summary:
+    Sends the session's output through a span list built on its ring.
+
+  Description:
+    Echo of bytes fed with calcStepRef or calcDigitos is then queued as a
+    reference to the caller's buffer instead of being copied; results
+    still go through the ring.  spans must have been initialized with the
+    session's ring.  NULL goes back to copying everything into the ring.
+*/
+
+void calcSessionSpans(CALC_SESSION * ses, APP_TXSPAN * spans);
+
+// *****************************************************************************
+/* Function:
+    void calcSessionCache(CALC_SESSION * ses, APP_RCACHE * cache)
+
+  Summary:
+    Looks results up in a cache before computing them.
+
+  Description:
+    Every result is kept in cache, keyed on the operator and the operands,
+    and an expression already seen is answered with a copy of its result
+    bytes.  Several sessions may share one cache as long as they are
+    stepped from the same thread.  NULL, the default, computes everything.
+    Does nothing when built with CALC_CACHE 0.
+*/
+
+void calcSessionCache(CALC_SESSION * ses, APP_RCACHE * cache);
+
+// *****************************************************************************
+/* Function:
+    void calcSessionGramatica(CALC_SESSION * ses, const APP_GRAMMAR * gramatica)
+
+  Summary:
+    Steps the session with a grammar that calcGramaticaCarga loaded.
+
+  Description:
+    The session starts over in state 0 and classifies every byte and
+    looks up its transition in the grammar's tables, which must outlive
+    the binding.  NULL, the default, goes back to the tables compiled in.
+    Runs of digits are only taken whole with those; under a loaded
+    grammar every byte goes through the state machine.
+*/
+
+void calcSessionGramatica(CALC_SESSION * ses, const APP_GRAMMAR * gramatica);
+
+// *****************************************************************************
+/* Function:
+    APP_GRAMMAR_STATUS calcGramaticaCarga(APP_GRAMMAR * gramatica,
+                                          const uint8_t * blob, size_t largo)
+
+  Summary:
+    Loads a grammar blob (app_grammar.h) written for this variant.
+
+  Description:
+    The blob must name the action set of this variant and have its
+    CALC_GRAMATICA_LARGO bytes: as many states, classes and actions, with
+    the same numbering, since the actions are compiled in.  What it can
+    change is which bytes fall in each class and where each transition
+    goes.  Nothing is copied; the blob may sit in flash.
+*/
+
+APP_GRAMMAR_STATUS calcGramaticaCarga(APP_GRAMMAR * gramatica, const uint8_t * blob,
+        size_t largo);
+
+// *****************************************************************************
+/* Function:
+    size_t calcGramaticaBlob(uint8_t * blob, size_t tam)
+
+  Summary:
+    Packs the tables compiled in as a blob and returns its length, 0 if
+    tam is smaller than CALC_GRAMATICA_LARGO.
+
+  Remarks:
+    The starting point of a grammar of one's own.
+*/
+
+size_t calcGramaticaBlob(uint8_t * blob, size_t tam);
+
+// *****************************************************************************
+/* Function:
+    void calcStep(CALC_SESSION * ses, char ch)
+
+  Summary:
+    Feeds one received byte to a session.
+
+  Description:
+    Classifies the byte, moves the session to its next state and runs that
+    state's action.  Echo and results are appended to the session's ring.
+    Sessions share nothing but the constant tables, so different sessions
+    may be stepped from different threads.
+*/
+
+void calcStep(CALC_SESSION * ses, char ch);
+
+// *****************************************************************************
+/* Function:
+    void calcStepRef(CALC_SESSION * ses, const char * p)
+
+  Summary:
+    Feeds the byte at p to a session, like calcStep(ses, *p).
+
+  Remarks:
+    With a span list bound the echo points at p, so the byte must stay
+    where it is until the list no longer holds it.
+*/
+
+void calcStepRef(CALC_SESSION * ses, const char * p);
+
+// *****************************************************************************
+/* Function:
+    size_t calcDigitos(CALC_SESSION * ses, const char * data, size_t length)
+
+  Summary:
+    Takes a whole run of digits inside an operand at once.
+
+  Description:
+    When the session is already reading the integer part of an operand,
+    the digits at the start of data are located and converted several at a
+    time, echoed with one write and added to the operand, exactly as that
+    many calcStep calls would.  Returns how many bytes were taken; 0 when
+    the session is elsewhere or data does not start with a digit, and then
+    the caller feeds the next byte to calcStep as usual.
+*/
+
+size_t calcDigitos(CALC_SESSION * ses, const char * data, size_t length);
+
+// *****************************************************************************
+/* Function:
+    bool calcFlush(CALC_SESSION * ses)
+
+  Summary:
+    Writes as much of a pending result as the ring has room for.
+
+  Description:
+    Every punto2 result fits in CALC_SALIDA_MAX, so nothing is ever left
+    pending and this always returns false.  It is there for app_port.c,
+    which also drives punto1's bignum results.
+*/
+
+bool calcFlush(CALC_SESSION * ses);
+
+// *****************************************************************************
+/* Function:
+    uint8_t calcPeticion(const APP_FRAME_REQUEST * pet, APP_FRAME_VALUE * res)
+
+  Summary:
+    Computes one request of the binary protocol, see app_frame.h.
+
+  Description:
+    Uses the same arithmetic as the result of a typed expression but never
+    goes through the keystroke state machine, so it needs no session.
+    Operands and result are APP_FRAME_FLOAT32, or
+    APP_FRAME_DECIMAL with CALC_PUNTO_FIJO.  Returns the APP_FRAME_STATUS of the response and
+    leaves its result in *res.
+*/
+
+uint8_t calcPeticion(const APP_FRAME_REQUEST * pet, APP_FRAME_VALUE * res);
+
+// *****************************************************************************
+/* Function:
+    uint8_t calcLoteEstado(const APP_FRAME_REQUEST * pet)
+
+  Summary:
+    Status of the response header of a bulk request, see app_frame.h.
+*/
+
+uint8_t calcLoteEstado(const APP_FRAME_REQUEST * pet);
+
+// *****************************************************************************
+/* Function:
+    void calcFlujoInicia(CALC_FLUJO * flujo)
+
+  Summary:
+    Empties the aggregates of the streaming protocol.
+*/
+
+void calcFlujoInicia(CALC_FLUJO * flujo);
+
+// *****************************************************************************
+/* Function:
+    void calcFlujoSuma(CALC_FLUJO * flujo, const APP_STREAM_NUMBER * num)
+
+  Summary:
+    Adds one sample to the aggregates in constant time.
+
+  Description:
+    The float sum is compensated (Kahan), so a long stream of
+    samples loses no more than one rounding overall instead of one per
+    sample.  With CALC_PUNTO_FIJO a number is rounded to CALC_DECIMALES
+    and skipped if it does not fit CALC_LIMITE; a sum that overflows
+    prints inf, as a result does.
+*/
+
+void calcFlujoSuma(CALC_FLUJO * flujo, const APP_STREAM_NUMBER * num);
+
+// *****************************************************************************
+/* Function:
+    size_t calcFlujoReporte(const CALC_FLUJO * flujo, char * aux)
+
+  Summary:
+    Writes the aggregates to aux, CALC_FLUJO_REPORTE_MAX bytes at most, and
+    returns how many:
+
+        n=2 sum=3.500000 min=1.000000 max=2.500000 mean=1.750000 skip=0\r
+
+    skip counts the numbers that could not be samples.  Without samples
+    only n and skip are written.
+*/
+
+size_t calcFlujoReporte(const CALC_FLUJO * flujo, char * aux);
+
+// *****************************************************************************
+/* Function:
+    void calcLote(const APP_FRAME_REQUEST * pet, const uint8_t * operandos,
+                  uint8_t * resultados, size_t n)
+
+  Summary:
+    Results of n operands of a bulk request whose status calcLoteEstado
+    gave, packed as on the wire.
+
+  Description:
+    APP_FRAME_FLOAT32 goes through the kernel of app_bulk.h.  With
+    CALC_PUNTO_FIJO each APP_FRAME_DECIMAL goes through calcOpera, and one
+    that does not fit is APP_FRAME_DECIMAL_OVERFLOW.
+*/
+
+void calcLote(const APP_FRAME_REQUEST * pet, const uint8_t * operandos,
+        uint8_t * resultados, size_t n);
+
+#endif /* _INTERFACESP4PUNTO2_H */